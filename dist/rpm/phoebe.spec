@@ -93,6 +93,9 @@ ln -s /usr/sbin/service %{buildroot}%{_sbindir}/rcphoebe
 %dir %{_libdir}/%{name}
 %dir %{_datadir}/%{name}
 %dir %{_sysconfdir}/%{name}
+%{_libdir}/%{name}/libcpu_plugin.so
+%{_libdir}/%{name}/libio_plugin.so
+%{_libdir}/%{name}/libmemory_plugin.so
 %{_libdir}/%{name}/libnetwork_plugin.so
 %{_datadir}/%{name}/rates.csv
 %config(noreplace) %{_sysconfdir}/%{name}/settings.json
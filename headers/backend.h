@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _BACKEND_H_
+#define _BACKEND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "sysctl.h"
+#include "types.h"
+
+#define SYSTEM_BACKEND_HOST 0
+#define SYSTEM_BACKEND_FAKE 1
+
+#define MAX_DEVICE_NAME_LENGTH 32
+
+typedef struct if_queues_s {
+    unsigned int rx;
+    unsigned int tx;
+    /* Name of the underlying device, e.g. "virtio1", which some drivers use
+     * instead of the interface name for their interrupts */
+    char device[MAX_DEVICE_NAME_LENGTH];
+} if_queues_t;
+
+/*
+ * Everything phoebe reads from or writes to the host goes through a backend:
+ * the host backend talks to /proc, /sys and the NIC, the fake one keeps all
+ * of it in memory so the inference-to-apply path runs without root.
+ *
+ * Interface handles are opaque to the callers and only valid for the backend
+ * that opened them.
+ */
+typedef struct system_backend_s {
+    const char *name;
+    /* Writes to a sandboxed backend never reach the host, so they are made
+     * even when phoebe is built without APPLY_CHANGES */
+    bool sandboxed;
+
+    int (*readCpuStats)(cpu_stats_t *stats);
+    /* Reads the first line of a /proc or /sys file, without the newline */
+    int (*readLine)(const char *path, char *buffer, size_t len);
+    /* Opens a /proc or /sys file for reading, e.g. /proc/interrupts */
+    FILE *(*openFile)(const char *path);
+    int (*writeLine)(const char *path, const char *value);
+    int (*readSysctl)(const char *name, char *value, size_t len);
+    unsigned int (*writeSysctls)(sysctl_write_t *batch, unsigned int count);
+
+    void *(*openInterface)(const char *ifname);
+    void (*closeInterface)(void *iface);
+    int (*readLinkStats)(void *iface, if_stats_t *stats);
+    int (*readQueues)(void *iface, if_queues_t *queues);
+    int (*readRingSize)(void *iface, if_ring_size_t *size);
+    int (*readCoalesce)(void *iface, if_coalesce_t *settings);
+    int (*readOffloads)(void *iface, if_offloads_t *settings);
+    /* Same contract as ethtoolWrite(): NULL parts are left alone and a mask
+     * of the ETHTOOL_* parts that failed is returned */
+    unsigned int (*writeInterface)(void *iface, const if_ring_size_t *size,
+                                   const if_coalesce_t *coalesce,
+                                   const if_offloads_t *offloads);
+
+    /* Drops cached file descriptors and sockets */
+    void (*release)();
+} system_backend_t;
+
+const system_backend_t *hostBackend();
+const system_backend_t *fakeBackend();
+
+/* The backend in use; the host one unless another was selected */
+const system_backend_t *systemBackend();
+void setSystemBackend(const system_backend_t *backend);
+
+int systemBackendFromString(const char *name);
+const char *systemBackendName(unsigned int backend);
+
+/**
+ * @brief Switches to the backend chosen by settings->system_backend; the
+ *     fake one is loaded with settings->fake_script when it is set.
+ *
+ * @param logApplied whether the fake backend also appends the knobs it is
+ *     asked to apply to settings->fake_applied_log: only the plugins apply
+ *     knobs, so the core leaves the log to them.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL when the script or log can't be opened.
+ */
+int selectSystemBackend(const app_settings_t *settings, bool logApplied);
+
+/* Without APPLY_CHANGES only a sandboxed backend is written to */
+bool writesEnabled();
+
+/* One knob written to the fake backend; tick is the number of link
+ * statistics read when it was applied */
+typedef struct fake_applied_s {
+    unsigned int tick;
+    char name[MAX_FILENAME_LENGTH];
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+} fake_applied_t;
+
+/* Forgets the script, all values and the applied knobs */
+void fakeBackendReset();
+
+/**
+ * @brief Loads a fake backend script. Each line is one of:
+ *
+ *     tick <bytes> <errors> <drops> <fifo_errors> [<cpu_busy_percent>
+ *         [<disk_ios>]]
+ *     sysctl <name> <value>
+ *     file <path> <value>
+ *     ring <rx> <tx>
+ *     queues <rx> <tx> [<device>]
+ *     coalesce <rx_usecs> <rx_frames> <tx_usecs> <tx_frames>
+ *
+ * Every link statistics read adds the counters of the next tick line, every
+ * CPU statistics read its busy percentage; both wrap around at the end of
+ * the script. A "\n" in a file value stands for a line break, so that files
+ * like /proc/interrupts can be scripted. Unless it is scripted, /proc/stat
+ * shows a single CPU adding the busy percentage of the next tick line on
+ * each open, and /proc/diskstats a single disk, vda, adding its disk reads.
+ * Empty lines and lines starting with '#' are skipped.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL on an unreadable file or bad line.
+ */
+int fakeBackendLoadScript(const char *path);
+int fakeBackendAddTick(const if_stats_t *delta, double cpuBusy,
+                       unsigned long diskIos);
+int fakeBackendSetValue(const char *name, const char *value);
+/* Appends every applied knob to path as "<tick> <name> <value>" */
+int fakeBackendSetLog(const char *path);
+
+unsigned int fakeBackendAppliedCount();
+int fakeBackendApplied(unsigned int index, fake_applied_t *entry);
+
+#endif
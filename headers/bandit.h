@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _BANDIT_H_
+#define _BANDIT_H_
+
+#include "types.h"
+
+#define BANDIT_OFF 0
+#define BANDIT_EPSILON_GREEDY 1
+#define BANDIT_THOMPSON 2
+
+/* Weight of the change of CPU busy percentage points, per 100, in a reward */
+#define BANDIT_CPU_WEIGHT 0.5
+/* Variance of the rewards of a row until it was tried twice */
+#define BANDIT_PRIOR_VARIANCE 1.0
+
+#define APPEND_TO_SCORES_FILE_NAME "scores.csv"
+
+/* Running mean and sum of squared deviations of the rewards of a row */
+typedef struct bandit_score_s {
+    unsigned int pulls;
+    double mean;
+    double m2;
+} bandit_score_t;
+
+typedef struct bandit_s {
+    unsigned int policy;
+    double epsilon;
+    /* One score per table row */
+    unsigned int rows;
+    bandit_score_t *scores;
+    unsigned int seed;
+    unsigned long rounds;
+    unsigned long explorations;
+} bandit_t;
+
+/* What a choice is rewarded on, before and after it was applied */
+typedef struct bandit_measure_s {
+    double transfer_rate;
+    double drop_rate;
+    double errors_rate;
+    double cpu_usage;
+} bandit_measure_t;
+
+/**
+ * @return The BANDIT_* value of a bandit_policy name, or -1 if it's unknown.
+ */
+int banditPolicyFromString(const char *name);
+const char *banditPolicyName(unsigned int policy);
+
+/**
+ * @brief Allocates a bandit without any score for rows table rows.
+ *
+ * @return The bandit, or NULL if it can't be allocated.
+ */
+bandit_t *banditCreate(unsigned int policy, double epsilon, unsigned int rows,
+                       unsigned int seed);
+void banditFree(bandit_t *bandit);
+
+/**
+ * @brief Finds the load bucket of a transfer rate: the candidates rows of
+ *     the table nearest to it, as the range [*first, *first + *count).
+ */
+void banditCandidates(const all_values_t *values, unsigned long transferRate,
+                      unsigned int candidates, unsigned int *first,
+                      unsigned int *count);
+
+/**
+ * @brief Picks one of count rows from first. Rows never tried come first;
+ *     then epsilon-greedy takes the best mean reward, or with a probability
+ *     of epsilon any row, and Thompson sampling takes the row whose reward
+ *     drawn from its posterior is the highest.
+ *
+ * @return The row picked, or @ref RET_FAIL when there is none to pick.
+ */
+int banditChoose(bandit_t *bandit, unsigned int first, unsigned int count);
+
+/**
+ * @brief Rewards the change from before to after: the relative gain of the
+ *     transfer rate, less those of the drop and errors rates, each bounded
+ *     to [-1, 1], less BANDIT_CPU_WEIGHT per 100 points of CPU usage gained.
+ */
+double banditReward(const bandit_measure_t *before,
+                    const bandit_measure_t *after);
+
+void banditUpdate(bandit_t *bandit, unsigned int row, double reward);
+
+/**
+ * @brief Names the scores file of a table: next to it, named after it.
+ */
+void banditScoresPath(const char *tablePath, char *path, size_t size);
+
+/**
+ * @brief Writes the scores, keyed by the transfer rate of their row, to
+ *     path through a temporary file.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if the file can't be written.
+ */
+int banditSave(const bandit_t *bandit, const all_values_t *values,
+               const char *path);
+
+/**
+ * @brief Reads the scores written by banditSave() back for the rows of
+ *     values with the same transfer rate.
+ *
+ * @return The number of scores read, or @ref RET_FAIL if the file can't be
+ *     read.
+ */
+int banditLoad(bandit_t *bandit, const all_values_t *values,
+               const char *path);
+
+#endif
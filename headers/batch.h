@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <stdint.h>
+
+#include "types.h"
+
+/* Samples searched in lockstep, so that their table reads overlap */
+#define BATCH_LANES 16
+
+#define BATCH_MISSED 0
+#define BATCH_MATCHED 1
+#define BATCH_INTERPOLATED 2
+
+/* What a search step reads of a row, side by side in one cache line */
+typedef struct batch_row_s {
+    double weightedValue;
+    double transferRate;
+} batch_row_t;
+
+/*
+ * A table readied for scoring many samples: the weighted value of every row
+ * is computed once, and so is the epsilon for every number of digits of a
+ * weighted value, which is all the tolerance depends on besides the value.
+ * It is only read while scoring, so threads can share it, each scoring its
+ * own share of the samples.
+ */
+typedef struct batch_table_s {
+    const all_values_t *values;
+    weights_reference_t weights;
+    double bias;
+    unsigned int approx_function;
+    bool interpolate;
+    double max_extrapolation;
+    /* Indexed by digits() of the weighted value */
+    double epsilon[21];
+    /* The most steps binarySearchWithTolerance() takes over the rows */
+    unsigned int steps;
+    /* The rows, and a sentinel after them */
+    batch_row_t *rows;
+} batch_table_t;
+
+/* Columns of count samples */
+typedef struct batch_samples_s {
+    unsigned int count;
+    const uint64_t *transfer_rate;
+    const uint64_t *drop_rate;
+    const uint64_t *errors_rate;
+    const uint64_t *fifo_errors_rate;
+} batch_samples_t;
+
+/* Columns the results of as many samples are written to */
+typedef struct batch_results_s {
+    /* The row matched or interpolated around, or -1 */
+    int *rows;
+    /* BATCH_MATCHED, BATCH_INTERPOLATED or BATCH_MISSED */
+    uint8_t *kinds;
+    double *weightedValues;
+    double *tolerances;
+} batch_results_t;
+
+/**
+ * @brief Readies values for batchInfer(), with the weights, bias and the
+ *     accuracy, approx_function, interpolate and max_extrapolation settings
+ *     the live inference uses. values must outlive the table.
+ *
+ * @return The table, or NULL if it can't be allocated.
+ */
+batch_table_t *batchPrepare(const all_values_t *values,
+                            const weights_reference_t *weights, double bias,
+                            const app_settings_t *settings);
+void batchFree(batch_table_t *table);
+
+/**
+ * @brief Matches every sample against the table as networkRunInference()
+ *     matches a live one: the row found by binarySearchWithTolerance() or,
+ *     when interpolate is set and there is none, the row
+ *     interpolateSettings() would return.
+ *
+ * @return The number of samples matched or interpolated.
+ */
+unsigned int batchInfer(const batch_table_t *table,
+                        const batch_samples_t *samples,
+                        batch_results_t *results);
+
+#endif
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _BUS_H_
+#define _BUS_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "io.h"
+#include "stats.h"
+#include "types.h"
+#include "vm.h"
+
+/* Metrics the core collects, each by one collector thread for all plugins */
+#define BUS_METRIC_LINK 0     /* rates of the monitored interface */
+#define BUS_METRIC_CPU 1      /* CPU busy percentage */
+#define BUS_METRIC_PRESSURE 2 /* pressure stall information */
+#define BUS_METRIC_CPUS 3     /* busy percentage and frequency of each CPU */
+#define BUS_METRIC_DISKS 4    /* rates of each block device */
+#define BUS_METRIC_MEMORY 5   /* paging, reclaim and memory use */
+#define BUS_METRICS 6
+
+#define BUS_METRIC_MASK(metric) (1U << (metric))
+#define BUS_ALL_METRICS ((1U << BUS_METRICS) - 1)
+
+/* Groups of knobs a plugin writes; two plugins can't write the same group */
+#define KNOB_NET_SYSCTL (1U << 0)
+#define KNOB_NET_INTERFACE (1U << 1)
+#define KNOB_NET_STEERING (1U << 2)
+#define KNOB_CPU (1U << 3)
+#define KNOB_IO (1U << 4)
+#define KNOB_VM (1U << 5)
+#define KNOB_ALL ((1U << 6) - 1)
+
+#define MAX_BUS_SUBSCRIBERS MAX_PLUGINS
+#define MAX_BUS_CPUS 256
+#define MAX_BUS_DISKS 64
+
+typedef struct bus_cpus_s {
+    unsigned int count;
+    /* Number of each CPU, which offline ones leave gaps in */
+    unsigned int id[MAX_BUS_CPUS];
+    double busy[MAX_BUS_CPUS];
+    /* scaling_cur_freq, 0 when the CPU has no cpufreq */
+    unsigned int khz[MAX_BUS_CPUS];
+} bus_cpus_t;
+
+typedef struct bus_disks_s {
+    unsigned int count;
+    /* Whole devices only, those with a /sys/block queue */
+    char name[MAX_BUS_DISKS][MAX_DISK_NAME_LENGTH];
+    disk_rates_t rates[MAX_BUS_DISKS];
+} bus_disks_t;
+
+typedef struct bus_sample_s {
+    unsigned int metric;
+    /* Number of samples of the metric published so far, this one included */
+    uint64_t sequence;
+    /* Only the field of the metric is set */
+    if_rates_t link;
+    double cpu_busy;
+    psi_stats_t pressure[PSI_RESOURCES];
+    bus_cpus_t cpus;
+    bus_disks_t disks;
+    vm_rates_t memory;
+} bus_sample_t;
+
+/* Called on the collector thread, which waits for it: keep it short */
+typedef void (*bus_callback_t)(const bus_sample_t *sample, void *context);
+
+typedef struct bus_subscriber_s {
+    unsigned int metrics;
+    bus_callback_t callback;
+    void *context;
+} bus_subscriber_t;
+
+typedef struct sample_bus_s {
+    pthread_mutex_t lock;
+    /* Signalled when no publisher runs callbacks anymore */
+    pthread_cond_t idle;
+    unsigned int dispatching;
+    /* Metrics some plugin reads, and so collected */
+    unsigned int requested;
+    /* Knobs claimed by the plugins attached so far */
+    unsigned int claimed;
+    bus_sample_t latest[BUS_METRICS];
+    unsigned int subscriberCount;
+    bus_subscriber_t subscribers[MAX_BUS_SUBSCRIBERS];
+} sample_bus_t;
+
+void busInit(sample_bus_t *bus);
+void busDestroy(sample_bus_t *bus);
+
+/**
+ * @brief Negotiates the capabilities of a plugin: the metrics it reads are
+ *     requested from the collectors and the knobs it writes claimed for it.
+ *
+ * @return @ref RET_OK, or @ref RET_FAIL, leaving the bus as it was, if a
+ *     metric is not collected by this core or a knob is already claimed.
+ */
+int busAttach(sample_bus_t *bus, unsigned int metrics, unsigned int knobs);
+
+/**
+ * @brief Releases the knobs of a plugin being unloaded and drops the
+ *     subscriptions it made, returning once no callback of them runs.
+ */
+void busDetach(sample_bus_t *bus, unsigned int knobs,
+               const bus_subscriber_t *subscriptions, unsigned int count);
+
+/**
+ * @brief Calls callback with every sample of the metrics published from now.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if there are too many subscribers.
+ */
+int busSubscribe(sample_bus_t *bus, unsigned int metrics,
+                 bus_callback_t callback, void *context);
+
+/**
+ * @brief Stores sample as the latest of its metric, numbering it, and hands
+ *     it to the subscribers of the metric.
+ */
+void busPublish(sample_bus_t *bus, bus_sample_t *sample);
+
+/**
+ * @brief Copies the latest sample of metric.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if none was published yet.
+ */
+int busLatest(sample_bus_t *bus, unsigned int metric, bus_sample_t *sample);
+
+#endif
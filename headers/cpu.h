@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _CPU_H_
+#define _CPU_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "types.h"
+
+#define CPUFREQ_CPU_PATH "/sys/devices/system/cpu/cpu%u/cpufreq/"
+/* Where the scheduler granularities moved to from kernel 5.13 */
+#define SCHED_DEBUGFS_PATH "/sys/kernel/debug/sched/"
+
+/* How much of the CPU time the busiest CPU is using */
+#define CPU_LEVEL_IDLE 0
+#define CPU_LEVEL_LOADED 1
+#define CPU_LEVEL_SATURATED 2
+#define CPU_LEVELS 3
+
+/* Samples a lower level must last for before the CPUs are tuned down */
+#define CPU_CALM_SAMPLES 5
+
+/* Shorter slices preempt sooner for the wakeups of latency-sensitive tasks,
+ * longer ones keep the caches of busy throughput-bound tasks warm */
+#define CPU_LATENCY_MIN_GRANULARITY_NS 1000000
+#define CPU_LATENCY_WAKEUP_GRANULARITY_NS 1500000
+#define CPU_THROUGHPUT_MIN_GRANULARITY_NS 10000000
+#define CPU_THROUGHPUT_WAKEUP_GRANULARITY_NS 15000000
+
+/* What cpufreq of cpu0 allows, which all CPUs are assumed to share */
+typedef struct cpu_limits_s {
+    unsigned int min_khz;
+    unsigned int max_khz;
+    /* Bit cpuGovernorIndex() of every governor available */
+    unsigned int governors;
+} cpu_limits_t;
+
+/* What the CPUs are tuned to at a level; 0 stands for the setting found on
+ * the host when the tuning started */
+typedef struct cpu_profile_s {
+    unsigned short governor;
+    unsigned int min_khz;
+    unsigned int sched_min_granularity_ns;
+    unsigned int sched_wakeup_granularity_ns;
+} cpu_profile_t;
+
+typedef struct cpu_tuner_s {
+    double low;
+    double high;
+    /* Never goes below CPU_LEVEL_LOADED, to spare it the frequency ramps */
+    bool latency;
+    unsigned int level;
+    unsigned int calm;
+} cpu_tuner_t;
+
+/**
+ * @brief Reads the per-CPU lines of /proc/stat, skipping the total one, and
+ *     the number of each CPU, which offline ones leave gaps in.
+ *
+ * @return The number of CPUs read, at most max.
+ */
+unsigned int cpuParseStats(FILE *fp, cpu_stats_t *stats, unsigned int *ids,
+                           unsigned int max);
+
+/**
+ * @return The mask of the governors named in a scaling_available_governors
+ *     line, by their cpuGovernorIndex().
+ */
+unsigned int cpuParseGovernors(const char *line);
+
+/**
+ * @return The governor scaling the frequency with the load preferred among
+ *     the available ones, or 0 if there is none.
+ */
+unsigned short cpuDynamicGovernor(unsigned int governors);
+
+const char *cpuLevelName(unsigned int level);
+
+void cpuTunerInit(cpu_tuner_t *tuner, double low, double high, bool latency);
+
+/**
+ * @brief Moves the level of the tuner on the busy percentage of the busiest
+ *     CPU: up right away, down once it stayed below for CPU_CALM_SAMPLES.
+ *
+ * @return The level.
+ */
+unsigned int cpuTunerUpdate(cpu_tuner_t *tuner, double peakBusy);
+
+/**
+ * @brief Fills the profile of a level: a dynamic governor from the minimum
+ *     frequency when idle, from half way when loaded, the performance one at
+ *     the maximum frequency when saturated. Latency-sensitive hosts run at
+ *     the maximum frequency from CPU_LEVEL_LOADED with shorter scheduler
+ *     slices, others get longer slices when saturated. Governors which are
+ *     not available fall back to the dynamic one, and to 0 without one.
+ */
+void cpuProfileFor(unsigned int level, bool latency,
+                   const cpu_limits_t *limits, cpu_profile_t *profile);
+
+#endif
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _DECISION_H_
+#define _DECISION_H_
+
+#include <stdint.h>
+
+#include "knn.h"
+#include "nn.h"
+#include "types.h"
+
+/*
+ * One tick of the inference loop, without its sleep, its logging or the
+ * apply: whether the load calls for new settings, and which ones. The live
+ * inference and the replay of recorded samples both run it.
+ */
+#define DECISION_IDLE 0
+#define DECISION_SMALL_DELTA 1
+#define DECISION_GRACE_PERIOD 2
+#define DECISION_MATCHED 3
+#define DECISION_INTERPOLATED 4
+#define DECISION_MISSED 5
+
+typedef struct inference_load_s {
+    unsigned long transfer_rate;
+    uint64_t drop_rate;
+    uint64_t errors_rate;
+    uint64_t fifo_errors_rate;
+    double cpu_usage;
+} inference_load_t;
+
+/* What the decisions are taken against; knnIndex and model may be NULL */
+typedef struct decision_context_s {
+    all_values_t *values;
+    weights_reference_t *weights;
+    double bias;
+    app_settings_t *settings;
+    knn_index_t *knnIndex;
+    nn_model_t *model;
+} decision_context_t;
+
+/* Carried from one tick to the next; starts zeroed */
+typedef struct decision_state_s {
+    double prevWeightedValue;
+    unsigned long timePassedSinceLastChanges;
+} decision_state_t;
+
+typedef struct decision_s {
+    unsigned int outcome;
+    /* The row matched, or the nearest one to the interpolated settings */
+    int row;
+    unsigned int closestIndex;
+    double weightedValue;
+    double weightedValueDiff;
+    double tolerance;
+    /* Only filled in when the outcome is DECISION_INTERPOLATED */
+    tuning_params_t interpolated;
+} decision_t;
+
+/**
+ * @brief Decides on load, elapsed usec after the previous tick. A match or an
+ *     interpolation restarts the grace period and becomes the reference the
+ *     next deltas are measured against.
+ *
+ * @return The outcome, one of DECISION_*, also stored in decision.
+ */
+unsigned int decide(const decision_context_t *context, decision_state_t *state,
+                    const inference_load_t *load, unsigned long elapsed,
+                    decision_t *decision);
+
+/**
+ * @brief The settings a decision asks to apply: the matched row or the
+ *     interpolated settings.
+ *
+ * @return The settings, or NULL when the outcome applies nothing.
+ */
+const tuning_params_t *decisionSettings(const decision_context_t *context,
+                                        const decision_t *decision);
+
+#endif
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _ETHTOOL_H_
+#define _ETHTOOL_H_
+
+#include <net/if.h>
+
+#include "types.h"
+
+/*
+ * SIOCETHTOOL requests: each ifreq carries the ethtool command buffer it was
+ * allocated with and can be reused by any number of reads and writes.
+ * The readers return @ref RET_OK or @ref RET_FAIL.
+ */
+struct ifreq *allocRingSizeRequest(const char *ifname);
+void freeRingSizeRequest(struct ifreq *ifr);
+int readRingSize(int sock, struct ifreq *ifr, if_ring_size_t *stats);
+int writeRingSize(int sock, struct ifreq *ifr, const if_ring_size_t *size);
+struct ifreq *allocGetCoalesceRequest(const char *ifname);
+void freeGetCoalesceRequest(struct ifreq *ifr);
+int readCoalesce(int sock, struct ifreq *ifr, if_coalesce_t *stats);
+int writeCoalesce(int sock, struct ifreq *ifr, const if_coalesce_t *settings);
+struct ifreq *allocGetOffloadsRequest(const char *ifname);
+void freeGetOffloadsRequest(struct ifreq *ifr);
+int readOffloads(int sock, struct ifreq *ifr, if_offloads_t *stats);
+int writeOffloads(int sock, struct ifreq *ifr, const if_offloads_t *settings);
+
+/* Parts of the interface settings, as reported by ethtoolWrite() */
+#define ETHTOOL_RING_SIZE 1
+#define ETHTOOL_COALESCE 2
+#define ETHTOOL_OFFLOADS 4
+
+/*
+ * Interface settings through ethtool netlink, falling back to the ioctls
+ * above when the kernel does not support it, or when built without
+ * HAVE_ETHTOOL_NETLINK for want of linux/ethtool_netlink.h.
+ */
+typedef struct ethtool_s ethtool_t;
+
+ethtool_t *ethtoolOpen(const char *ifname);
+void ethtoolClose(ethtool_t *e);
+bool ethtoolUsesNetlink(const ethtool_t *e);
+int ethtoolReadRingSize(ethtool_t *e, if_ring_size_t *size);
+int ethtoolReadCoalesce(ethtool_t *e, if_coalesce_t *settings);
+int ethtoolReadOffloads(ethtool_t *e, if_offloads_t *settings);
+
+/**
+ * @brief Writes the given settings, skipping the NULL ones; with netlink all
+ *     the messages are sent before their acknowledgements are read.
+ *
+ * @return The ETHTOOL_* parts which could not be written, 0 on success.
+ */
+unsigned int ethtoolWrite(ethtool_t *e, const if_ring_size_t *size,
+                          const if_coalesce_t *coalesce,
+                          const if_offloads_t *offloads);
+
+#endif
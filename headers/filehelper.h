@@ -13,6 +13,24 @@ int addDataFromFile(tuning_params_t *srcParams, all_values_t *destParams);
 int loadFile(FILE *pFile, unsigned int fileRows,
              all_values_t *reference_values);
 void loadValues(char *line, long lineno, all_values_t *reference_values);
+
+/**
+ * @brief Reads a row of the table into reference_values, adding it only when
+ *     all of its values were found.
+ *
+ * @return The number of values found.
+ */
+int parseValues(char *line, long lineno, all_values_t *reference_values);
+
+/**
+ * @brief Loads the rows following the header of pFile as loadFile() does,
+ *     but fails rather than exiting on a malformed row, so that a table can
+ *     be read while phoebe runs.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if a row is malformed or there are
+ *     more than reference_values was allocated for.
+ */
+int loadFileChecked(FILE *pFile, all_values_t *reference_values);
 void loadValuesFromUnordedFile(char *line, all_values_t *reference_values);
 
 /**
@@ -35,6 +53,16 @@ int readSettingsFromJsonFile(char *settingsFileName,
 unsigned int saveTrainedDataToFile(all_values_t *values,
                                    char *path_with_filename);
 
+/**
+ * @brief Writes weights and bias as a settings fragment, a JSON file with the
+ *     "weights" and "bias" sections of settings.json, next to
+ *     path_with_filename and named after it.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if the file can't be written.
+ */
+int saveWeightsToJsonFile(const weights_reference_t *weights, double bias,
+                          char *path_with_filename);
+
 int writeHeader(FILE *fp);
 int writeRow(FILE *fp, tuning_params_t *row);
 
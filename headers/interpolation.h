@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _INTERPOLATION_H_
+#define _INTERPOLATION_H_
+
+#include "types.h"
+
+/**
+ * @brief Builds the settings for transferRate from the two rows of the table
+ *     bracketing it, or the two outermost ones when it lies beyond the table:
+ *       - buffer, ring and queue sizes are interpolated in log space, as they
+ *         grow geometrically with the rate;
+ *       - other numeric knobs, and the rates, linearly;
+ *       - flags, schedulers, governors and CPU masks are taken from the
+ *         nearest of the two rows.
+ *
+ * @return The index of the nearest of the two rows, or -1 when the table is
+ *     empty or transferRate is more than maxExtrapolation percent beyond it.
+ */
+int interpolateSettings(const all_values_t *values, unsigned long transferRate,
+                        double maxExtrapolation, tuning_params_t *settings);
+
+/* The row interpolateSettings() would return, without building the settings */
+int interpolationRow(const all_values_t *values, unsigned long transferRate,
+                     double maxExtrapolation);
+
+/* Index of the row whose transfer rate is nearest; 0 on an empty table */
+unsigned int findNearestTransferRate(const all_values_t *values,
+                                    unsigned long transferRate);
+
+#endif
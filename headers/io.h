@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _IO_H_
+#define _IO_H_
+
+#include <stdio.h>
+
+#include "types.h"
+
+#define BLOCK_QUEUE_PATH "/sys/block/%s/queue/"
+/* The unit of the sector counts of /proc/diskstats, whatever the device */
+#define DISKSTATS_SECTOR_SIZE 512
+#define MAX_DISK_NAME_LENGTH 32
+#define MAX_IO_TABLE_ROWS 64
+
+/* The counters of a line of /proc/diskstats */
+typedef struct disk_stats_s {
+    char name[MAX_DISK_NAME_LENGTH];
+    unsigned long reads;
+    unsigned long read_sectors;
+    unsigned long read_ms;
+    unsigned long writes;
+    unsigned long write_sectors;
+    unsigned long write_ms;
+    unsigned long in_flight;
+    unsigned long io_ms;
+    unsigned long weighted_io_ms;
+} disk_stats_t;
+
+typedef struct disk_rates_s {
+    double iops;
+    double bytes_rate;
+    /* Requests in flight on average, queued ones included */
+    double queue_depth;
+    /* Average time a request took to complete */
+    double latency_ms;
+    /* Percentage of the time the device was busy */
+    double utilization;
+} disk_rates_t;
+
+/* A row of the I/O table; the settings of its iops are applied to the
+ * devices whose load is nearest to it */
+typedef struct io_params_s {
+    unsigned long iops;
+    unsigned short scheduler; /* An ioSchedulerIndex() */
+    unsigned int nr_requests;
+    unsigned int read_ahead_kb;
+    unsigned short rq_affinity;
+} io_params_t;
+
+typedef struct io_table_s {
+    unsigned int count;
+    /* By increasing iops */
+    io_params_t rows[MAX_IO_TABLE_ROWS];
+} io_table_t;
+
+/**
+ * @brief Reads the lines of /proc/diskstats, partitions and virtual devices
+ *     included.
+ *
+ * @return The number of devices read, at most max.
+ */
+unsigned int ioParseDiskstats(FILE *fp, disk_stats_t *stats, unsigned int max);
+
+/**
+ * @brief Calculates the rates of a device between two reads period seconds
+ *     apart. A counter which went back, as 32 bit ones wrap, counts as 0.
+ */
+void ioRates(const disk_stats_t *prev, const disk_stats_t *cur, double period,
+             disk_rates_t *rates);
+
+/**
+ * @return The mask of the schedulers named in a queue/scheduler line, by
+ *     their ioSchedulerIndex(); active is set to the one in brackets, or 0.
+ */
+unsigned int ioParseSchedulers(const char *line, unsigned short *active);
+
+/**
+ * @brief Fills the table applied when there is no io_table_filename: the
+ *     deadline scheduler and a larger read-ahead for slow devices, no
+ *     scheduler, deeper queues and completions on the submitting CPU for
+ *     fast ones.
+ */
+void ioDefaultTable(io_table_t *table);
+
+/**
+ * @brief Loads a table from a CSV file with the columns
+ *     iops,scheduler,nr_requests,read_ahead_kb,rq_affinity, the scheduler by
+ *     name, and sorts it by iops.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL on an unreadable file, a bad row or
+ *     an empty table.
+ */
+int ioLoadTable(const char *path, io_table_t *table);
+
+/**
+ * @return The row whose iops are nearest to iops, like
+ *     findNearestTransferRate() in the network table.
+ */
+unsigned int ioNearestRow(const io_table_t *table, double iops);
+
+#endif
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _KNN_H_
+#define _KNN_H_
+
+#include "types.h"
+
+/* The load a table row was trained for, in this order */
+#define KNN_TRANSFER_RATE 0
+#define KNN_DROP_RATE 1
+#define KNN_ERRORS_RATE 2
+#define KNN_FIFO_ERRORS_RATE 3
+#define KNN_CPU_USAGE 4
+#define KNN_DIMENSIONS 5
+
+#define KNN_MAX_NEIGHBOURS 16
+
+/*
+ * Static k-d tree over the load of the table rows. The rates span orders of
+ * magnitude and are indexed by their logarithm; every dimension is then
+ * scaled to [0, 1] over the table, and one the table doesn't vary on is left
+ * out of the distance.
+ *
+ * Each node splits its points around the median along the axis of largest
+ * spread. Points equal to the median all go to the same half, and each node
+ * keeps how far its halves reach along the axis, so that the many equal
+ * values of columns like drop rates do not force both halves to be searched.
+ */
+typedef struct knn_point_s {
+    float x[KNN_DIMENSIONS];
+    unsigned int row;
+} knn_point_t;
+
+typedef struct knn_node_s {
+    /* The halves are the points before and after this one */
+    unsigned int point;
+    /* Nodes of the halves, or KNN_NO_NODE for a half scanned linearly */
+    unsigned int left;
+    unsigned int right;
+    unsigned int axis;
+    float leftMax;
+    float rightMin;
+} knn_node_t;
+
+#define KNN_NO_NODE ((unsigned int)-1)
+
+typedef struct knn_index_s {
+    unsigned int count;
+    double min[KNN_DIMENSIONS];
+    double scale[KNN_DIMENSIONS];
+    knn_point_t *points;
+    unsigned int root;
+    unsigned int nodeCount;
+    knn_node_t *nodes;
+} knn_index_t;
+
+typedef struct knn_match_s {
+    unsigned int row;
+    /* Normalized distance of the load to the row */
+    double distance;
+    /* Share of the inverse distance weights of the neighbours that goes to
+     * the row: 1 when it is by far the nearest, 1/k when all k are as near */
+    double confidence;
+} knn_match_t;
+
+/**
+ * @brief Indexes the load of the first count rows.
+ *
+ * @return The index, or NULL when count is 0 or it can't be allocated.
+ */
+knn_index_t *knnBuild(const tuning_params_t *rows, unsigned int count);
+void knnFree(knn_index_t *index);
+
+/* Fills load from the rates and CPU usage of row */
+void knnRowLoad(const tuning_params_t *row, double load[KNN_DIMENSIONS]);
+
+/**
+ * @brief Finds the row nearest to load among its k nearest neighbours, with
+ *     k capped at @ref KNN_MAX_NEIGHBOURS and the number of rows.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL on an empty index.
+ */
+int knnQuery(const knn_index_t *index, const double load[KNN_DIMENSIONS],
+             unsigned int k, knn_match_t *match);
+
+#endif
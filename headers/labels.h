@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _LABELS_H_
+#define _LABELS_H_
+
+#include "types.h"
+
+/* The fields of label_t, in the order of the table columns */
+#define LABEL_GEOGRAPHY 0
+#define LABEL_BUSINESS 1
+#define LABEL_BEHAVIOR 2
+#define LABEL_KINDS 3
+
+/* Room for the label columns at the end of a table row */
+#define MAX_LABEL_COLUMNS_LENGTH 64
+
+/**
+ * @brief Looks up the value of a label by its name, such as "EMEA" for
+ *     @ref LABEL_GEOGRAPHY.
+ *
+ * @return The value, or @ref NOT_SET for NULL, "NOT_SET" and unknown names.
+ */
+unsigned short labelFromName(unsigned int kind, const char *name);
+
+/**
+ * @return The name of a label value, "NOT_SET" for values it doesn't know.
+ */
+const char *labelName(unsigned int kind, unsigned short value);
+
+/**
+ * @return Whether some field of label is set.
+ */
+int labelIsSet(const label_t *label);
+
+/**
+ * @brief A row belongs to the host when each of its fields is equal to that
+ *     of the host, or is not set on either of them.
+ *
+ * @return 1 when the row matches the host, 0 otherwise.
+ */
+int labelsMatch(const label_t *row, const label_t *host);
+
+/**
+ * @brief Reads the label columns, geography, business and behavior by name,
+ *     of a table row; missing columns leave their field unset.
+ */
+void labelsFromColumns(const char *columns, label_t *label);
+
+/**
+ * @brief Writes the label columns of a row, each after a comma, to columns.
+ */
+void labelsToColumns(const label_t *label, char *columns, size_t size);
+
+/**
+ * @brief Builds the partition of the table the host searches: its rows that
+ *     match the host labels, in transfer rate order. Of two rows with the
+ *     same transfer rate, the one with more fields set is kept, so that a
+ *     row labelled for the host overrides a generic one.
+ *
+ * @warning This function calls exit if a call to `malloc(3)` fails.
+ *
+ * @return values itself when every row matches, which holds for tables
+ *     without labels, or a new table holding the partition.
+ */
+all_values_t *labelsPartition(all_values_t *values, const label_t *host);
+
+/**
+ * @brief Frees a partition returned by labelsPartition() for values.
+ */
+void labelsPartitionFree(all_values_t *partition, const all_values_t *values);
+
+#endif
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _LOADER_H_
+#define _LOADER_H_
+
+#include <sys/types.h>
+#include <time.h>
+
+/*
+ * A shared object loaded from a private copy of its file: dlopen(3) hands
+ * back the object already loaded from a path, or from the same file under
+ * another name, even if the file at that path was replaced since. The copy
+ * stays open as long as the object is loaded, so that its /proc/self/fd name
+ * is not given to another copy meanwhile.
+ */
+typedef struct loaded_file_s {
+    void *handle;
+    /* The copy loaded, -1 for none */
+    int fd;
+    /* The file copied, whatever is at its path by now */
+    dev_t device;
+    ino_t inode;
+    struct timespec modified;
+} loaded_file_t;
+
+/**
+ * @brief Loads a copy of the shared object at path with RTLD_NOW: each call
+ *     loads another object, never one already loaded.
+ *
+ * @return @ref RET_OK, filling file, or @ref RET_FAIL if it can't be loaded.
+ */
+int loaderOpen(const char *path, loaded_file_t *file);
+
+/* Unloads the object and closes its copy; one never loaded is ignored */
+void loaderClose(loaded_file_t *file);
+
+#endif
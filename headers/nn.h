@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _NN_H_
+#define _NN_H_
+
+#include <stdint.h>
+
+#include "types.h"
+
+/*
+ * Small dense neural network predicting, from the current load, the transfer
+ * rate of the table row whose settings to apply.
+ *
+ * The model file is little-endian:
+ *
+ *     char     magic[4]            "PHNN"
+ *     uint32_t version             NN_FORMAT_VERSION
+ *     uint32_t inputs              NN_INPUTS
+ *     uint32_t layers              1 to NN_MAX_LAYERS
+ *     float    mean[inputs]
+ *     float    scale[inputs]
+ *     then for each layer, taking as many inputs as the previous one has
+ *     outputs:
+ *     uint32_t outputs             1 to NN_MAX_WIDTH, 1 for the last layer
+ *     uint32_t activation          one of NN_ACTIVATION_*
+ *     float    weights[outputs][inputs]
+ *     float    bias[outputs]
+ *
+ * The inputs are the rates and the CPU usage, in this order; the rates are
+ * fed as log1p(rate). Every input is then standardized as
+ * (x - mean) * scale. The output is log1p of the transfer rate.
+ */
+#define NN_MAGIC "PHNN"
+#define NN_FORMAT_VERSION 1
+
+#define NN_TRANSFER_RATE 0
+#define NN_DROP_RATE 1
+#define NN_ERRORS_RATE 2
+#define NN_FIFO_ERRORS_RATE 3
+#define NN_CPU_USAGE 4
+#define NN_INPUTS 5
+
+#define NN_MAX_LAYERS 8
+#define NN_MAX_WIDTH 256
+
+#define NN_ACTIVATION_LINEAR 0
+#define NN_ACTIVATION_RELU 1
+#define NN_ACTIVATION_TANH 2
+#define NN_ACTIVATION_SIGMOID 3
+
+/* Floats the matrix-vector kernel works on at once */
+#define NN_LANES 8
+
+typedef struct nn_layer_s {
+    unsigned int inputs;
+    unsigned int outputs;
+    unsigned int activation;
+    /* Row length of weights: inputs rounded up to NN_LANES, zero padded */
+    unsigned int stride;
+    float *weights;
+    float *bias;
+} nn_layer_t;
+
+/*
+ * All the weights and the activations live in one arena allocated when the
+ * model is loaded, so that nnPredict() never allocates.
+ */
+typedef struct nn_model_s {
+    unsigned int layerCount;
+    nn_layer_t layers[NN_MAX_LAYERS];
+    float mean[NN_INPUTS];
+    float scale[NN_INPUTS];
+    /* Two activation buffers of NN_MAX_WIDTH floats, used in turn */
+    float *activations[2];
+    void *arena;
+} nn_model_t;
+
+/**
+ * @brief Loads a model file in the format above, logging why it is refused.
+ *
+ * @return The model, or NULL when the file can't be read or is not a valid
+ *     model.
+ */
+nn_model_t *nnLoad(const char *path);
+void nnFree(nn_model_t *model);
+
+/**
+ * @brief Runs the network on load, the rates and the CPU usage in the order
+ *     of the NN_* inputs.
+ *
+ * @return The transfer rate of the row to apply.
+ */
+double nnPredict(nn_model_t *model, const double load[NN_INPUTS]);
+
+#endif
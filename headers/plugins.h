@@ -4,10 +4,22 @@
 #ifndef _NETWORK_PLUGIN_H_
 #define _NETWORK_PLUGIN_H_
 
+#include "bus.h"
+#include "settings.h"
+#include "table.h"
 #include "types.h"
 
 #define PLUGIN_NAME_LEN 32
 
+/*
+ * Version 1 plugins export registerMe(), returning a plugin_t, and collect
+ * their own statistics. Version 2 ones export registerMeV2(), returning a
+ * plugin_v2_t, and read the samples the core collects once for all of them
+ * from the bus. The core loads both, preferring registerMeV2() when a plugin
+ * exports the two.
+ */
+#define PLUGIN_ABI_VERSION 2
+
 typedef struct plugin_s {
     bool active;
     char name[PLUGIN_NAME_LEN];
@@ -22,4 +34,46 @@ typedef struct plugin_s {
 
 } plugin_t;
 
+/* What the core hands a version 2 plugin at init */
+typedef struct plugin_context_s {
+    char *interfaceName;
+    app_settings_t *settings;
+    tuning_params_t *systemSettings;
+    weights_reference_t *weights;
+    /* The rows of the table matching the labels; NULL in inference, where a
+     * reload frees them: the plugin reads tables instead */
+    all_values_t *values;
+    double bias;
+    unsigned int verbosity;
+    sample_bus_t *bus;
+    /* Labels of the host, e.g. whether it is optimized for latency */
+    label_t *labels;
+    /* In inference, the table reloads publish; NULL otherwise */
+    table_store_t *tables;
+    /* In inference, the settings reloads publish, settings, weights, bias and
+     * labels being those of the snapshot current at init, which the core holds
+     * until the plugin is unloaded; NULL otherwise */
+    settings_store_t *settingsStore;
+} plugin_context_t;
+
+typedef struct plugin_v2_s {
+    /* PLUGIN_ABI_VERSION the plugin was built against: fields are only ever
+     * appended to this struct, so a newer core knows which it can read */
+    unsigned int abi_version;
+    bool active;
+    char name[PLUGIN_NAME_LEN];
+    double version;
+    /* BUS_METRIC_MASK() of the metrics the plugin reads */
+    unsigned int metrics;
+    /* KNOB_* groups the plugin writes */
+    unsigned int knobs;
+    /* RET_OK, or RET_FAIL to leave the plugin out */
+    int (*init)(const plugin_context_t *context);
+    void *(*inference)(void *thread_args);
+    void (*training)(char *inputFileName);
+    void (*livetraining)(char *inputFileName);
+    void (*destroy)();
+    void (*print_report)();
+} plugin_v2_t;
+
 #endif
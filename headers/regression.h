@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _REGRESSION_H_
+#define _REGRESSION_H_
+
+#include "types.h"
+
+/* The rates the weighted value is computed from, in this order */
+#define FIT_TRANSFER_RATE 0
+#define FIT_DROP_RATE 1
+#define FIT_ERRORS_RATE 2
+#define FIT_FIFO_ERRORS_RATE 3
+#define FIT_FEATURES 4
+
+typedef struct fit_result_s {
+    weights_reference_t weights;
+    double bias;
+    unsigned int rows;
+    /* Root mean square and largest difference between the weighted value of
+     * a row and its rank, in transfer rates */
+    double rmse;
+    double maxError;
+    /* Share of the variance of the ranks the weights explain */
+    double r2;
+} fit_result_t;
+
+/**
+ * @brief Fits the weights and bias so that the weighted value of the rates of
+ *     every row of the table is as close as possible to its rank, the order
+ *     binarySearchWithTolerance() walks the table in. The ranks are spread
+ *     evenly from the first transfer rate of the table to the last: unlike
+ *     the transfer rate, they are not one of the rates weighed, and the
+ *     other rates count wherever the transfer rates are unevenly spaced.
+ *
+ * The rates are standardized and the normal equations solved by Cholesky
+ * decomposition; ridge, when bigger than 0, adds that much regularization on
+ * the standardized weights (not on the bias), which keeps the weights of
+ * nearly collinear rates small. A rate that does not vary over the table gets
+ * a weight of 0, and the weights are kept from adding up to more than 1, as
+ * readSettingsFromJsonFile() requires.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL when the table has fewer than 2 rows
+ *     or the system is singular.
+ */
+int fitWeights(const all_values_t *values, double ridge, fit_result_t *fit);
+
+/* Fills the errors of fit for the weights and bias it holds */
+void fitError(const all_values_t *values, fit_result_t *fit);
+
+#endif
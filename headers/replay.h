@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include "decision.h"
+#include "sketch.h"
+#include "types.h"
+
+/* Reconfigurations whose time and row are kept for the report */
+#define REPLAY_TIMELINE 32
+
+typedef struct replay_reconfiguration_s {
+    /* Virtual usec since the start of the recording */
+    unsigned long time;
+    int row;
+    unsigned int outcome;
+} replay_reconfiguration_t;
+
+typedef struct replay_report_s {
+    unsigned long samples;
+    unsigned long ticks;
+    /* Ticks by outcome of the decision, indexed by DECISION_* */
+    unsigned long outcomes[DECISION_MISSED + 1];
+    /* Matched or interpolated decisions, which the apply recorder got */
+    unsigned long reconfigurations;
+    /* Of them, those asking for another row than the previous one */
+    unsigned long rowChanges;
+    /* The first REPLAY_TIMELINE reconfigurations, and the last one */
+    replay_reconfiguration_t timeline[REPLAY_TIMELINE];
+    replay_reconfiguration_t last;
+    /* Virtual seconds between two reconfigurations */
+    quantile_sketch_t interval;
+    /* Nanoseconds decide() took per tick, on this host */
+    quantile_sketch_t latency;
+    unsigned long virtualUsec;
+    long wallUsec;
+} replay_report_t;
+
+/**
+ * @brief Loads the samples of a CSV file written by collect_stats.py, in the
+ *     order they were recorded in.
+ *
+ * @return @ref RET_OK, or @ref RET_FAIL if the file can't be read.
+ */
+int replayLoadSamples(const char *path, all_values_t *samples);
+
+/**
+ * @brief Replays samples through decide() as the inference loop would see
+ *     them, at full speed on a virtual clock: the n-th sample arrives n
+ *     stats_collection_period after the start, the inference ticks every
+ *     inference_loop_period and, with load_quantile set, reads the quantile
+ *     over load_window of the samples arrived so far. Applying a decision
+ *     only records it.
+ *
+ * @return @ref RET_OK, or @ref RET_FAIL if either period is not positive.
+ */
+int replay(const decision_context_t *context, const all_values_t *samples,
+           replay_report_t *report);
+
+#endif
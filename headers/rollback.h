@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _ROLLBACK_H_
+#define _ROLLBACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "types.h"
+
+/* Ticks kept for the baseline of an apply: at most its rollback_ticks */
+#define RATE_HISTORY_TICKS 64
+
+/* The rates of the last RATE_HISTORY_TICKS collector ticks, oldest first */
+typedef struct rate_history_s {
+    if_rates_t rates[RATE_HISTORY_TICKS];
+    unsigned int next;
+    unsigned int count;
+} rate_history_t;
+
+/* Records the rates of a tick, dropping the oldest once full */
+void rateHistoryRecord(rate_history_t *history, const if_rates_t *rates);
+
+/**
+ * @brief Sums the rates of the last ticks ticks recorded, or of all those
+ *     recorded if fewer.
+ *
+ * @return The number of ticks summed, also set in totals.
+ */
+unsigned int rateHistoryTotals(const rate_history_t *history,
+                               unsigned int ticks, rate_totals_t *totals);
+
+static inline double rateMean(uint64_t total, unsigned int ticks) {
+    return ticks > 0 ? (double)total / ticks : 0.0;
+}
+
+/**
+ * @brief Whether a rate moved the wrong way by more than threshold percent of
+ *     baseline; rates close to 0 are compared against 1 instead.
+ */
+bool rateWorse(double baseline, double result, double threshold,
+               bool higherIsBetter);
+
+/**
+ * @brief Whether the settings applied between baseline and result made
+ *     things worse: the mean transfer rate fell, or the mean drop or errors
+ *     rate rose, by more than threshold percent.
+ */
+bool rollbackNeeded(const rate_totals_t *baseline, const rate_totals_t *result,
+                    double threshold);
+
+#endif
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _SETTINGS_H_
+#define _SETTINGS_H_
+
+#include <pthread.h>
+
+#include "types.h"
+
+/*
+ * What a settings file holds. Once published it is never written to: a reload
+ * publishes another one, and the last holder of a replaced one frees it.
+ */
+typedef struct settings_snapshot_s {
+    /* 1 for the settings read at startup, one more for each reload */
+    unsigned long generation;
+    unsigned int references;
+    app_settings_t app;
+    weights_reference_t weights;
+    double bias;
+    label_t labels;
+} settings_snapshot_t;
+
+/*
+ * The settings published last. A holder keeps a reference to the snapshot it
+ * reads and only looks at the store again to follow a reload: publishing
+ * never waits for the holders, which drop the snapshot they replace.
+ */
+typedef struct settings_store_s {
+    /* Serializes the publishers and the holders taking a reference */
+    pthread_mutex_t lock;
+    settings_snapshot_t *current;
+} settings_store_t;
+
+/**
+ * @brief Reads fileName into a new snapshot, of which the caller holds the
+ *     only reference.
+ *
+ * @warning This function calls exit if a call to `malloc(3)` fails.
+ *
+ * @return @ref RET_OK, setting snapshot, or @ref RET_FAIL if the file can't be
+ *     read.
+ */
+int settingsLoad(char *fileName, settings_snapshot_t **snapshot);
+
+/* Publishes first, taking the reference of the caller over, as generation 1 */
+void settingsStoreInit(settings_store_t *store, settings_snapshot_t *first);
+
+/* Drops the reference of the store: holders left keep their snapshot */
+void settingsStoreDestroy(settings_store_t *store);
+
+/**
+ * @brief Takes a reference to the settings published last.
+ *
+ * @return The snapshot, to hand back to settingsRelease().
+ */
+settings_snapshot_t *settingsAcquire(settings_store_t *store);
+
+/* Drops a reference, freeing the snapshot with the last one; NULL is ignored */
+void settingsRelease(settings_snapshot_t *snapshot);
+
+/**
+ * @brief Moves held over to the settings published last, if a reload
+ *     published others since: a single atomic load otherwise. held may be
+ *     NULL, for a holder with no reference yet.
+ *
+ * @return Whether held changed.
+ */
+bool settingsFollow(settings_store_t *store, settings_snapshot_t **held);
+
+/**
+ * @brief Replaces the published settings with snapshot, taking the reference
+ *     of the caller over and numbering it, then drops the reference of the
+ *     store to the previous ones.
+ */
+void settingsPublish(settings_store_t *store, settings_snapshot_t *snapshot);
+
+#endif
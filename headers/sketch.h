@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _SKETCH_H_
+#define _SKETCH_H_
+
+#include <stdint.h>
+
+/*
+ * Log-linear (HDR style) histogram: values below SKETCH_SUB_BUCKETS are
+ * counted exactly, larger values are bucketed by their most significant bit
+ * and split linearly into SKETCH_SUB_BUCKETS / 2 sub-buckets, which bounds the
+ * relative error of any reported quantile to 1 / SKETCH_SUB_BUCKETS.
+ */
+#define SKETCH_SUB_BUCKET_BITS 4
+#define SKETCH_SUB_BUCKETS (1 << SKETCH_SUB_BUCKET_BITS)
+#define SKETCH_HALF_SUB_BUCKETS (SKETCH_SUB_BUCKETS / 2)
+#define SKETCH_BUCKETS                                                         \
+    (SKETCH_SUB_BUCKETS +                                                      \
+     (64 - SKETCH_SUB_BUCKET_BITS) * SKETCH_HALF_SUB_BUCKETS)
+
+#define SKETCH_WINDOW_1M 0
+#define SKETCH_WINDOW_5M 1
+#define SKETCH_WINDOW_1H 2
+#define SKETCH_WINDOWS 3
+
+#define SKETCH_MAX_SLOTS 12
+
+typedef struct quantile_sketch_s {
+    uint64_t count;
+    uint32_t buckets[SKETCH_BUCKETS];
+} quantile_sketch_t;
+
+/* A rolling window is a ring of sketches, each covering slot_seconds; slots
+ * older than the window are recycled the next time they are written to. */
+typedef struct rolling_sketch_s {
+    unsigned int slot_seconds;
+    unsigned int slots;
+    uint64_t epochs[SKETCH_MAX_SLOTS];
+    quantile_sketch_t slot[SKETCH_MAX_SLOTS];
+} rolling_sketch_t;
+
+typedef struct windowed_sketch_s {
+    rolling_sketch_t windows[SKETCH_WINDOWS];
+} windowed_sketch_t;
+
+void sketchReset(quantile_sketch_t *sketch);
+void sketchRecord(quantile_sketch_t *sketch, uint64_t value);
+uint64_t sketchQuantile(const quantile_sketch_t *sketch, double quantile);
+
+void windowedSketchInit(windowed_sketch_t *sketch);
+void windowedSketchRecord(windowed_sketch_t *sketch, uint64_t value,
+                          uint64_t now);
+uint64_t windowedSketchQuantile(const windowed_sketch_t *sketch,
+                                unsigned int window, double quantile,
+                                uint64_t now);
+uint64_t windowedSketchCount(const windowed_sketch_t *sketch,
+                             unsigned int window, uint64_t now);
+
+int sketchWindowFromString(const char *window);
+const char *sketchWindowName(unsigned int window);
+
+#endif
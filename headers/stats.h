@@ -7,31 +7,44 @@
 #include <netlink/route/link.h>
 #include <stdint.h>
 
+#include "ethtool.h"
 #include "types.h"
 
+struct sample_bus_s;
+struct bus_sample_s;
+
 typedef struct stats_input_params_s {
     char monitored_interface[MAX_INTERFACE_NAME_LENGTH];
     double stats_collection_period;
+    /* Where the collectors publish their samples; NULL to keep them here */
+    struct sample_bus_s *bus;
 } stats_input_param_t;
 
+#define PSI_CPU 0
+#define PSI_IO 1
+#define PSI_MEMORY 2
+#define PSI_RESOURCES 3
+
+#define HOST_STATE_OK 0
+/* CPU is busy but tasks are not waiting on any resource */
+#define HOST_STATE_BUSY 1
+/* tasks lose wall time waiting on CPU, I/O or memory */
+#define HOST_STATE_STALLED 2
+
 double calculateCpuBusyPercentage(cpu_stats_t *prev, cpu_stats_t *cur);
 void readCpuStats(cpu_stats_t *stats);
-void *collectCpuStats();
-int cpuGovernorIndex(const char *query);
+void *collectCpuStats(void *stats_input_params);
+/* Per-CPU busy percentages and frequencies; published on the bus alone */
+void *collectPerCpuStats(void *stats_input_params);
+/* Per-device rates of the block devices; published on the bus alone */
+void *collectDiskStats(void *stats_input_params);
+/* Paging, reclaim and memory use; published on the bus alone */
+void *collectMemoryStats(void *stats_input_params);
 void calculateInterfaceRatesPerSecond(if_stats_t *prev, if_stats_t *cur,
                                       if_rates_t *rates,
                                       double stats_collection_period);
 void readStats(struct rtnl_link *link, if_stats_t *stats);
 void *collectStats(void *stats_input_params);
-struct ifreq *allocRingSizeRequest(const char *ifname);
-void freeRingSizeRequest(struct ifreq *ifr);
-void readRingSize(int sock, struct ifreq *ifr, if_ring_size_t *stats);
-struct ifreq *allocGetCoalesceRequest(const char *ifname);
-void freeGetCoalesceRequest(struct ifreq *ifr);
-void readCoalesce(int sock, struct ifreq *ifr, if_coalesce_t *stats);
-struct ifreq *allocGetOffloadsRequest(const char *ifname);
-void freeGetOffloadsRequest(struct ifreq *ifr);
-void readOffloads(int sock, struct ifreq *ifr, if_offloads_t *stats);
 
 uint64_t getTransferRate();
 uint64_t getDropRate();
@@ -40,7 +53,32 @@ uint64_t getFifoErrorsRate();
 
 double getCpuBusyTime();
 
+/* Records a sample published on the bus as if it had been collected here */
+void recordBusSample(const struct bus_sample_s *sample, void *context);
+
+/* Number of collector ticks accumulated since the last takeRateTotals() */
+unsigned int getRateTotalsTicks();
+/* Moves the accumulated rate totals into totals; returns their ticks */
+unsigned int takeRateTotals(rate_totals_t *totals);
+/* Sets recent to the totals of the last ticks collector ticks, at most
+ * RATE_HISTORY_TICKS, and restarts the accumulated ones; returns its ticks */
+unsigned int restartRateTotals(unsigned int ticks, rate_totals_t *recent);
+
+int parsePressure(const char *buffer, psi_stats_t *stats);
+int readPressure(int fd, psi_stats_t *stats);
+void *collectPressureStats(void *stats_input_params);
+/* Percentage of the last 10s some (or all, when full) tasks were stalled */
+double getPressure(unsigned int resource, bool full);
+unsigned int getHostState(double busyThreshold, double stallThreshold);
+
 uint64_t getMinTransferRate();
 uint64_t getMaxTransferRate();
 
+/* Rolling-window quantiles; window is one of the SKETCH_WINDOW_* values */
+uint64_t getTransferRateQuantile(unsigned int window, double quantile);
+uint64_t getDropRateQuantile(unsigned int window, double quantile);
+uint64_t getErrorsRateQuantile(unsigned int window, double quantile);
+uint64_t getFifoErrorsRateQuantile(unsigned int window, double quantile);
+double getCpuBusyTimeQuantile(unsigned int window, double quantile);
+
 #endif
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _STEERING_H_
+#define _STEERING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+
+#define MAX_STEERING_CPUS 64
+#define MAX_STEERING_QUEUES 64
+/* Longest mask of MAX_STEERING_CPUS CPUs, "ffffffff,ffffffff" */
+#define MAX_CPU_MASK_LENGTH 18
+
+#define STEERING_RPS_CPUS 1
+#define STEERING_XPS_CPUS 2
+#define STEERING_RPS_FLOW_CNT 4
+#define STEERING_IRQ_AFFINITY 8
+/* The settings readSteeringSettings() reads, one per STEERING_* above */
+#define STEERING_SETTINGS 4
+
+typedef struct steering_s {
+    unsigned long rps_cpus;
+    unsigned long xps_cpus;
+    unsigned int rps_flow_cnt;
+    unsigned long irq_affinity;
+} steering_t;
+
+/* One interrupt line of a queue of the interface, from /proc/interrupts */
+typedef struct irq_queue_s {
+    unsigned int irq;
+    /* Interrupts serviced since boot, summed over all CPUs */
+    uint64_t count;
+    /* CPUs which serviced at least one of them */
+    unsigned long cpus;
+} irq_queue_t;
+
+/* Formats mask the way /sys and /proc/irq expect it: comma separated groups
+ * of 32 bits */
+int formatCpuMask(unsigned long mask, char *buffer, size_t len);
+int parseCpuMask(const char *buffer, unsigned long *mask);
+
+/**
+ * @brief Collects the interrupt lines of an interface from a /proc/interrupts
+ *     file: those named after ifname, or after device followed by a dash
+ *     (e.g. "virtio1-input.0") when device is not empty.
+ *
+ * @return The number of lines stored in queues, at most max, or @ref RET_FAIL
+ *     if fp is not a /proc/interrupts file.
+ */
+int parseInterrupts(FILE *fp, const char *ifname, const char *device,
+                    irq_queue_t *queues, unsigned int max);
+
+/**
+ * @brief Reads the packet steering of the interface opened as iface on the
+ *     system backend into settings: rps_cpus and rps_flow_cnt of its first
+ *     receive queue, the union of the xps_cpus of its transmit queues, and
+ *     the union of the smp_affinity of its queue interrupts, found in
+ *     /proc/interrupts.
+ *
+ * @return The number of settings which could not be read.
+ */
+unsigned int readSteeringSettings(void *iface, const char *ifname,
+                                  tuning_params_t *settings);
+
+/**
+ * @brief Applies the non-zero fields of target which differ from applied, or
+ *     all of them when applied is NULL, through the system backend:
+ *       - rps_cpus and rps_flow_cnt are written to every receive queue, and
+ *         net.core.rps_sock_flow_entries is sized for all of them;
+ *       - the CPUs of xps_cpus are handed out to the transmit queues in turn;
+ *       - the CPUs of irq_affinity are handed out to the interrupt lines of
+ *         the interface, busiest first, so that with fewer CPUs than queues
+ *         the quietest ones are the ones sharing a CPU.
+ *
+ * @return A mask of the STEERING_* parts which could not be applied.
+ */
+unsigned int applySteering(void *iface, const char *ifname,
+                           const steering_t *target,
+                           const steering_t *applied);
+
+#endif
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _SYSCTL_H_
+#define _SYSCTL_H_
+
+#include <stddef.h>
+
+#define SYSCTL_PROC_PATH "/proc/sys/"
+#define MAX_SYSCTL_NAME_LENGTH 64
+#define MAX_SYSCTL_VALUE_LENGTH 64
+#define MAX_SYSCTLS 64
+
+typedef struct sysctl_write_s {
+    char name[MAX_SYSCTL_NAME_LENGTH];
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+    /* errno of the failed write, 0 when the value was applied */
+    int error;
+} sysctl_write_t;
+
+/* Resolves sysctl names below root instead of SYSCTL_PROC_PATH; closes all
+ * cached file descriptors */
+void sysctlSetRoot(const char *root);
+int sysctlPath(const char *name, char *path, size_t len);
+
+/**
+ * @brief Writes value to the sysctl name, e.g. "net.core.rmem_max", with a
+ *     single pwrite(2) on a file descriptor that is opened on first use and
+ *     kept open afterwards.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL with errno set.
+ */
+int sysctlWrite(const char *name, const char *value);
+
+/**
+ * @brief Reads the current value of the sysctl name into value, with the
+ *     trailing newline removed.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL with errno set.
+ */
+int sysctlRead(const char *name, char *value, size_t len);
+
+void sysctlSet(sysctl_write_t *entry, const char *name, const char *format,
+               ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Writes all entries of batch, carrying on past failing ones; the
+ *     outcome of each write is stored in its error field.
+ *
+ * @return The number of sysctls that could not be written.
+ */
+unsigned int sysctlWriteBatch(sysctl_write_t *batch, unsigned int count);
+
+void sysctlCloseAll();
+
+#endif
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _TABLE_H_
+#define _TABLE_H_
+
+#include <pthread.h>
+
+#include "knn.h"
+#include "nn.h"
+#include "types.h"
+
+/* Readers of a table store, one per inference thread following reloads */
+#define MAX_TABLE_READERS MAX_PLUGINS
+
+/* How often a publisher checks whether the readers moved on, in usec */
+#define TABLE_GRACE_POLL_USEC 10000
+
+/*
+ * The table the inference searches, with what is built over it. Once
+ * published it is never written to: a reload publishes another one.
+ */
+typedef struct table_snapshot_s {
+    /* 1 for the table loaded at startup, one more for each reload */
+    unsigned long generation;
+    all_values_t values;
+    /* The rows of values matching the labels of the host */
+    all_values_t *partition;
+    /* NULL unless knn_neighbours, model_filename respectively, are set */
+    knn_index_t *knnIndex;
+    nn_model_t *model;
+} table_snapshot_t;
+
+/*
+ * The published table, under quiescent state based RCU: a reader tells the
+ * store, on each tableRead(), that it is done with the tables it read before,
+ * and a publisher frees the table it replaced once every reader did so.
+ * Readers take no lock.
+ */
+typedef struct table_store_s {
+    /* Serializes the publishers and the readers registering */
+    pthread_mutex_t lock;
+    table_snapshot_t *current;
+    /* One more on each publish, starting at 1 */
+    unsigned long epoch;
+    /* The epoch of the last tableRead() of each reader, 0 for a free slot */
+    unsigned long seen[MAX_TABLE_READERS];
+} table_store_t;
+
+/**
+ * @brief Takes the arrays of values over, zeroing it, and builds the
+ *     partition matching labels, the k-d tree and the model the settings ask
+ *     for; an index or model which can't be built is logged and left NULL.
+ *
+ * @warning This function calls exit if a call to `malloc(3)` fails.
+ *
+ * @return The snapshot, not published yet.
+ */
+table_snapshot_t *tableCreate(all_values_t *values, const label_t *labels,
+                              const app_settings_t *settings);
+
+/**
+ * @brief Loads and checks rates_filename for a reload: it must parse, have
+ *     rows matching labels, sorted by transfer rate, and the index and model
+ *     the settings ask for must build.
+ *
+ * @return @ref RET_OK, setting snapshot, or @ref RET_FAIL if the table can't
+ *     replace the one in use.
+ */
+int tableLoad(const app_settings_t *settings, const label_t *labels,
+              table_snapshot_t **snapshot);
+
+/**
+ * @brief Checks the table can be searched: not empty, and sorted by transfer
+ *     rate as the binary search expects.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL.
+ */
+int tableValidate(const all_values_t *values);
+
+void tableFree(table_snapshot_t *snapshot);
+
+/* Publishes first, which the store then owns, as generation 1 */
+void tableStoreInit(table_store_t *store, table_snapshot_t *first);
+
+/* Frees the table published last; no reader must be left */
+void tableStoreDestroy(table_store_t *store);
+
+/**
+ * @brief Registers the calling thread as a reader.
+ *
+ * @return The reader to pass to tableRead(), or -1 if there are
+ *     MAX_TABLE_READERS already.
+ */
+int tableReaderRegister(table_store_t *store);
+
+/* Safe in a cancellation cleanup handler: it never waits for a publisher */
+void tableReaderUnregister(table_store_t *store, int reader);
+
+/**
+ * @brief Marks the reader done with the tables it read before, which may be
+ *     freed from then on.
+ *
+ * @return The table published last.
+ */
+table_snapshot_t *tableRead(table_store_t *store, int reader);
+
+/**
+ * @brief Replaces the published table with snapshot, numbering it, and frees
+ *     the previous one once no reader holds it: this waits until each reader
+ *     calls tableRead() again.
+ */
+void tablePublish(table_store_t *store, table_snapshot_t *snapshot);
+
+/**
+ * @brief Builds the k-d tree over the rows of values when knn_neighbours is
+ *     set, logging how long it took.
+ *
+ * @return The index, or NULL when not asked for or it can't be built.
+ */
+knn_index_t *tableBuildKnn(const all_values_t *values,
+                           const app_settings_t *settings);
+
+/**
+ * @brief Loads model_filename when set.
+ *
+ * @return The model, or NULL when not asked for or it can't be loaded.
+ */
+nn_model_t *tableLoadModel(const app_settings_t *settings);
+
+#endif
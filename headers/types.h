@@ -34,15 +34,66 @@ typedef struct app_settings_s {
     unsigned int grace_period;
     double stats_collection_period;
     double inference_loop_period;
+    double load_quantile;
+    unsigned int load_window;
+    unsigned int knn_neighbours;
+    double knn_min_confidence;
+    bool interpolate;
+    double max_extrapolation;
+    double fit_ridge;
+    double stall_threshold;
+    double memory_pressure_threshold;
+    unsigned int disruptive_change_interval;
+    unsigned int rollback_ticks;
+    double rollback_threshold;
+    unsigned int bandit_policy;
+    double bandit_epsilon;
+    unsigned int bandit_candidates;
+    double cpu_busy_low;
+    double cpu_busy_high;
+    double vm_available_low;
+    double vm_available_high;
+    unsigned int system_backend;
+    char fake_script[MAX_FILENAME_LENGTH];
+    char fake_applied_log[MAX_FILENAME_LENGTH];
+    char model_filename[MAX_FILENAME_LENGTH];
+    char replay_filename[MAX_FILENAME_LENGTH];
+    char io_table_filename[MAX_FILENAME_LENGTH];
     char plugins_path[MAX_FILENAME_LENGTH];
     char rates_filename[MAX_FILENAME_LENGTH];
 } app_settings_t;
 
+/* Percentage of stalled wall time (PSI "some" avg10) */
+#define DEFAULT_STALL_THRESHOLD 10.0
+/* Seconds between two ring size or offload changes */
+#define DEFAULT_DISRUPTIVE_CHANGE_INTERVAL 60
+/* Collector ticks to watch after an apply, and percentage by which the rates
+ * may get worse before the previous settings are restored */
+#define DEFAULT_ROLLBACK_TICKS 5
+#define DEFAULT_ROLLBACK_THRESHOLD 10.0
+/* Share of the choices of an epsilon-greedy bandit made at random, and rows
+ * of the load bucket the bandit picks among */
+#define DEFAULT_BANDIT_EPSILON 0.1
+#define DEFAULT_BANDIT_CANDIDATES 5
+/* Busy percentages of the busiest CPU from which the CPU plugin tunes the
+ * CPUs for a loaded and for a saturated host */
+#define DEFAULT_CPU_BUSY_LOW 20.0
+#define DEFAULT_CPU_BUSY_HIGH 75.0
+#define DEFAULT_VM_AVAILABLE_LOW 10.0
+#define DEFAULT_VM_AVAILABLE_HIGH 25.0
+/* Neighbours the inference looks at; 0 keys on the weighted value alone */
+#define DEFAULT_KNN_NEIGHBOURS 0
+/* Percentage of the transfer rate of the first or last row of the table a
+ * load may lie beyond them and still be extrapolated to */
+#define DEFAULT_MAX_EXTRAPOLATION 10.0
+
 #define USEC_IN_SEC 1000000 /* Expressed in microseconds; 1s = 10^6usec */
 
 #define MAX_CPU_NAME_LENGTH 7
 
-#define NUM_TUNING_PARAMS 53
+#define NUM_TUNING_PARAMS 57
+/* Tables written before packet steering was tunable lack its 4 columns */
+#define NUM_LEGACY_TUNING_PARAMS 53
 
 // Offsets into CSV file data
 typedef struct tuning_params_s {
@@ -57,8 +108,7 @@ typedef struct tuning_params_s {
     unsigned short governor; /* Requires a INTEGER to STRING mapping for the
                                 setting eventually */
     unsigned int cpu_speed;
-    unsigned short io_scheduler; /* Requires a INTEGER to STRING mapping for the
-                                    setting eventually */
+    unsigned short io_scheduler; /* An ioSchedulerIndex() */
     unsigned short task_scheduler; /* Requires a INTEGER to STRING mapping for
                                       the setting eventually */
     unsigned int kernel_sched_min_granularity_ns;
@@ -103,6 +153,12 @@ typedef struct tuning_params_s {
     unsigned short rx_vlan_offload;
     unsigned short tx_vlan_offload;
     unsigned short rx_hash;
+    /* Packet steering of the interface queues: CPU masks covering the first
+     * 64 CPUs, where 0 leaves the current setting alone */
+    unsigned long rps_cpus;
+    unsigned long xps_cpus;
+    unsigned int rps_flow_cnt;
+    unsigned long irq_affinity;
 } tuning_params_t;
 
 typedef struct weights_reference_s {
@@ -165,6 +221,20 @@ typedef struct cpu_stats_s {
     unsigned int nonIdleTotal;
 } cpu_stats_t;
 
+/* One line ("some" or "full") of a /proc/pressure file; the averages are
+ * percentages of wall time, total is the stall time in microseconds */
+typedef struct psi_line_s {
+    double avg10;
+    double avg60;
+    double avg300;
+    uint64_t total;
+} psi_line_t;
+
+typedef struct psi_stats_s {
+    psi_line_t some;
+    psi_line_t full;
+} psi_stats_t;
+
 typedef struct if_raw_stats_s {
     uint64_t rx_errors;
     uint64_t tx_errors;
@@ -192,6 +262,14 @@ typedef struct if_rates_s {
     uint64_t max_transfer_rate;
 } if_rates_t;
 
+/* Sums of the rates measured over a number of collector ticks */
+typedef struct rate_totals_s {
+    unsigned int ticks;
+    uint64_t transfer_rate;
+    uint64_t drop_rate;
+    uint64_t errors_rate;
+} rate_totals_t;
+
 typedef struct if_ring_size_s {
     int rx;
     int tx;
@@ -219,6 +297,7 @@ typedef struct if_offloads_s {
 #define MINUTES_IN_USEC (60 * 1000000)
 
 #define APPEND_TO_FILE_NAME "trained_data.csv"
+#define APPEND_TO_WEIGHTS_FILE_NAME "weights.json"
 
 #define SETTINGS_DEFAULT_PATH "/etc/phoebe/settings.json"
 
@@ -44,12 +44,61 @@ double calculateWeightedValue(unsigned long currentTransferRate,
 double calculateEpsilon(double weightedValue, double accuracy);
 double calculateTolerance(double weightedValue, double eps,
                           unsigned int approx_function);
+int binarySearchWithTolerance(tuning_params_t *parameters, int l, int r,
+                              double weighted_value, double tolerance,
+                              unsigned int *closestIndex,
+                              weights_reference_t *weights, double bias);
 
 void retrieveNumberOfCores(unsigned int *threads);
 
 void printTable(all_values_t *values);
 
-void readSystemSettings(tuning_params_t *systemSettings);
+#define CPUFREQ_PATH "/sys/devices/system/cpu/cpu0/cpufreq/"
+
+int cpuGovernorIndex(const char *query);
+/* The name of a cpuGovernorIndex(), or "?" */
+const char *cpuGovernorName(int index);
+
+/* The blk-mq schedulers, like the io_scheduler of tuning_params_t */
+int ioSchedulerIndex(const char *query);
+/* The name of an ioSchedulerIndex(), or "?" */
+const char *ioSchedulerName(int index);
+
+/**
+ * @brief Moves level to measured: up right away, down one level at a time,
+ *     each once lower levels were measured calmSamples times in a row, which
+ *     calm counts.
+ *
+ * @return The level.
+ */
+unsigned int levelUpdate(unsigned int *level, unsigned int *calm,
+                         unsigned int measured, unsigned int calmSamples);
+
+/**
+ * @brief Parses a /sys line listing choices with the selected one in
+ *     brackets, like "[mq-deadline] kyber none".
+ *
+ * @return The mask of the choices known to indexOf, by their index; active
+ *     is set to the index of the selected one, or 0.
+ */
+unsigned int parseSelection(const char *line, int (*indexOf)(const char *),
+                            unsigned short *active);
+
+/**
+ * @brief Reads the current value of all the settings of tuning_params_t in one
+ *     pass: sysctls from /proc/sys, the ring sizes, interrupt coalescing and
+ *     offloads of interfaceName through ethtool, its packet steering and
+ *     interrupt affinity (see readSteeringSettings()), and the governor and
+ *     frequency from cpufreq. Settings which cannot be read are left as they
+ *     are; no interface settings are read when interfaceName is NULL. Nothing
+ *     is written to stdout but with write_adv_log().
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if any setting there could not be read;
+ *     settings absent from the host, like sysctls of older or newer kernels,
+ *     do not count.
+ */
+int readSystemSettings(const char *interfaceName,
+                       tuning_params_t *systemSettings);
 
 unsigned short digits(unsigned long int num);
 
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#ifndef _VM_H_
+#define _VM_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "types.h"
+
+#define THP_DEFRAG_PATH "/sys/kernel/mm/transparent_hugepage/defrag"
+
+/* How short of memory the host is */
+#define VM_LEVEL_RELAXED 0
+#define VM_LEVEL_TIGHT 1
+#define VM_LEVEL_RECLAIMING 2
+#define VM_LEVELS 3
+
+/* Samples a lower level must last for before the memory is tuned down */
+#define VM_CALM_SAMPLES 5
+
+/* kswapd scanning this percentage of the memory per second is more than
+ * the background reclaim keeping the free pages topped up */
+#define VM_TIGHT_SCAN_PERCENT 1.0
+/* Pages reclaimed per page scanned below which reclaim struggles, once the
+ * scanning is a tenth of VM_TIGHT_SCAN_PERCENT */
+#define VM_TIGHT_RECLAIM_EFFICIENCY 0.5
+
+/* Dirty pages can only be reclaimed once written back: fewer of them are
+ * allowed when memory is short */
+#define VM_TIGHT_DIRTY_RATIO 10
+#define VM_TIGHT_DIRTY_BACKGROUND_BYTES (64UL << 20)
+#define VM_RECLAIMING_DIRTY_RATIO 5
+#define VM_RECLAIMING_DIRTY_BACKGROUND_BYTES (16UL << 20)
+/* Drops page cache rather than swapping out anonymous memory */
+#define VM_SHORT_SWAPPINESS 10
+/* The kernel advises against keeping more free */
+#define VM_MAX_MIN_FREE_PERCENT 5
+/* min_free_kbytes moves by whole steps, and only by more than one, so that
+ * the TCP buffers going up and down do not rewrite it on every sample */
+#define VM_MIN_FREE_STEP_KB 16384UL
+
+/* The counters of /proc/vmstat, /proc/meminfo and /proc/net/sockstat */
+typedef struct vm_stats_s {
+    unsigned long pgfault;
+    unsigned long pgmajfault;
+    unsigned long pgscan_kswapd;
+    unsigned long pgscan_direct;
+    unsigned long pgsteal_kswapd;
+    unsigned long pgsteal_direct;
+    unsigned long thp_fault_fallback;
+    unsigned long thp_collapse_alloc_failed;
+    unsigned long mem_total_kb;
+    unsigned long mem_available_kb;
+    unsigned long dirty_kb;
+    unsigned long writeback_kb;
+    /* Pages of the TCP socket buffers */
+    unsigned long tcp_pages;
+} vm_stats_t;
+
+typedef struct vm_rates_s {
+    double fault_rate;
+    double major_fault_rate;
+    /* Pages scanned by kswapd and by the allocating tasks themselves */
+    double kswapd_scan_rate;
+    double direct_scan_rate;
+    double steal_rate;
+    double thp_failure_rate;
+    unsigned long mem_total_kb;
+    unsigned long mem_available_kb;
+    unsigned long dirty_kb;
+    unsigned long writeback_kb;
+    unsigned long tcp_kb;
+    unsigned long page_kb;
+} vm_rates_t;
+
+/* The memory settings; the dirty background limit is either a ratio or a
+ * number of bytes, the other one is 0 */
+typedef struct vm_profile_s {
+    unsigned int dirty_ratio;
+    unsigned int dirty_background_ratio;
+    unsigned long dirty_background_bytes;
+    unsigned int swappiness;
+    unsigned long min_free_kbytes;
+    /* A vmThpDefragIndex(), 0 when THP is not tuned */
+    unsigned short thp_defrag;
+} vm_profile_t;
+
+typedef struct vm_tuner_s {
+    /* Percentages of the memory available */
+    double low;
+    double high;
+    unsigned int level;
+    unsigned int calm;
+} vm_tuner_t;
+
+/**
+ * @brief Reads the counters of /proc/vmstat into stats, leaving the others
+ *     as they are.
+ *
+ * @return The number of counters found.
+ */
+unsigned int vmParseVmstat(FILE *fp, vm_stats_t *stats);
+
+/**
+ * @brief Reads the sizes of /proc/meminfo into stats, leaving the others as
+ *     they are.
+ *
+ * @return The number of sizes found.
+ */
+unsigned int vmParseMeminfo(FILE *fp, vm_stats_t *stats);
+
+/* The pages of the TCP socket buffers in /proc/net/sockstat, or 0 */
+unsigned long vmParseSockstat(FILE *fp);
+
+/**
+ * @brief Calculates the rates between two reads period seconds apart, and
+ *     copies the sizes of the latest one.
+ */
+void vmRates(const vm_stats_t *prev, const vm_stats_t *cur, double period,
+             unsigned long pageKb, vm_rates_t *rates);
+
+int vmThpDefragIndex(const char *query);
+/* The name of a vmThpDefragIndex(), or "?" */
+const char *vmThpDefragName(int index);
+
+const char *vmLevelName(unsigned int level);
+
+void vmTunerInit(vm_tuner_t *tuner, double low, double high);
+
+/**
+ * @brief Moves the level of the tuner: reclaiming when tasks reclaim memory
+ *     themselves or less than low percent is available, tight when kswapd
+ *     scans VM_TIGHT_SCAN_PERCENT of the memory per second or reclaims
+ *     poorly, THP allocations fail or less than high percent is available.
+ *     Up right away, down once the memory stayed calmer for
+ *     VM_CALM_SAMPLES.
+ *
+ * @return The level.
+ */
+unsigned int vmTunerUpdate(vm_tuner_t *tuner, const vm_rates_t *rates);
+
+/**
+ * @brief Fills the profile of a level from the settings found on the host:
+ *     those when relaxed; when memory is short, lower dirty limits and
+ *     swappiness, deferred THP compaction and room kept free for a share of
+ *     the TCP buffers, which are allocated atomically, rounded up to
+ *     VM_MIN_FREE_STEP_KB and kept as in applied, which may be NULL, unless
+ *     it moved by more than a step. Settings are never raised over those of
+ *     the host, but for min_free_kbytes, which is never lowered; defrag modes
+ *     missing from thpModes are left out.
+ */
+void vmProfileFor(unsigned int level, const vm_profile_t *baseline,
+                  unsigned int thpModes, const vm_rates_t *rates,
+                  const vm_profile_t *applied, vm_profile_t *profile);
+
+#endif
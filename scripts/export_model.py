@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+
+# SPDX-License-Identifier: BSD-3-Clause
+# Copyright SUSE LLC
+
+"""Writes a dense network in the model format of headers/nn.h.
+
+The network is read from a JSON file:
+
+    {
+        "mean": [5 floats],
+        "scale": [5 floats],
+        "layers": [
+            {"weights": [[...], ...], "bias": [...], "activation": "relu"},
+            ...
+        ]
+    }
+
+where the weights of each layer are one row per output, as in the kernel of
+a Keras Dense layer transposed, and the activation is one of "linear",
+"relu", "tanh" or "sigmoid". The inputs are log1p of the transfer, drop,
+errors and FIFO errors rates and the CPU usage; the last layer has a single
+output, log1p of the transfer rate of the row to apply.
+"""
+
+import json
+import struct
+import sys
+
+MAGIC = b'PHNN'
+FORMAT_VERSION = 1
+INPUTS = 5
+MAX_LAYERS = 8
+MAX_WIDTH = 256
+ACTIVATIONS = {'linear': 0, 'relu': 1, 'tanh': 2, 'sigmoid': 3}
+
+
+def floats(values):
+    return struct.pack('<%df' % len(values), *values)
+
+
+def export(network, output):
+    layers = network['layers']
+    if not 0 < len(layers) <= MAX_LAYERS:
+        raise ValueError('1 to %d layers are supported' % MAX_LAYERS)
+    if len(network['mean']) != INPUTS or len(network['scale']) != INPUTS:
+        raise ValueError('mean and scale need %d values' % INPUTS)
+
+    output.write(MAGIC)
+    output.write(struct.pack('<III', FORMAT_VERSION, INPUTS, len(layers)))
+    output.write(floats(network['mean']))
+    output.write(floats(network['scale']))
+
+    inputs = INPUTS
+    for n, layer in enumerate(layers):
+        weights, bias = layer['weights'], layer['bias']
+        outputs = len(weights)
+        if not 0 < outputs <= MAX_WIDTH or len(bias) != outputs:
+            raise ValueError('layer %d: 1 to %d outputs, one bias each'
+                             % (n, MAX_WIDTH))
+        if any(len(row) != inputs for row in weights):
+            raise ValueError('layer %d: rows of %d weights expected'
+                             % (n, inputs))
+        output.write(struct.pack('<II', outputs,
+                                 ACTIVATIONS[layer.get('activation',
+                                                       'linear')]))
+        for row in weights:
+            output.write(floats(row))
+        output.write(floats(bias))
+        inputs = outputs
+
+    if inputs != 1:
+        raise ValueError('the last layer must have a single output')
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        print('Usage: %s network.json model.bin' % sys.argv[0],
+              file=sys.stderr)
+        sys.exit(1)
+    with open(sys.argv[1]) as f:
+        network = json.load(f)
+    with open(sys.argv[2], 'wb') as f:
+        export(network, f)
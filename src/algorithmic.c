@@ -37,6 +37,9 @@ int addData(all_values_t *values, unsigned int origTableIndex,
     _repositionElements(values, pivot);
 
     values->parameters[pivot].transfer_rate = transferRate;
+    /* A derived row belongs to the partition of the row it comes from */
+    if (values->labels != NULL)
+        values->labels[pivot] = values->labels[origTableIndex];
 
     /* The following parameters can be read from the system - when running
      * liveTraining - instead of being inferred.
@@ -108,6 +111,15 @@ int addData(all_values_t *values, unsigned int origTableIndex,
         values->parameters[origTableIndex].io_scheduler;
     values->parameters[pivot].task_scheduler =
         values->parameters[origTableIndex].task_scheduler;
+    /* CPU masks can't be interpolated */
+    values->parameters[pivot].rps_cpus =
+        values->parameters[origTableIndex].rps_cpus;
+    values->parameters[pivot].xps_cpus =
+        values->parameters[origTableIndex].xps_cpus;
+    values->parameters[pivot].rps_flow_cnt =
+        values->parameters[origTableIndex].rps_flow_cnt;
+    values->parameters[pivot].irq_affinity =
+        values->parameters[origTableIndex].irq_affinity;
 
     values->parameters[pivot].kernel_sched_min_granularity_ns =
         values->parameters[origTableIndex].kernel_sched_min_granularity_ns;
@@ -218,39 +230,6 @@ int addData(all_values_t *values, unsigned int origTableIndex,
     return RET_OK;
 }
 
-extern inline int binarySearchWithTolerance(tuning_params_t *parameters, int l,
-                                            int r, double weighted_value,
-                                            double tolerance,
-                                            unsigned int *closestIndex,
-                                            weights_reference_t *weights,
-                                            double bias) {
-    if (r >= l) {
-        unsigned int mid = l + (r - l) / 2;
-
-        double ref_weighted_value = calculateWeightedValue(
-            parameters[mid].transfer_rate, parameters[mid].drop_rate,
-            parameters[mid].errors_rate, parameters[mid].fifo_errors_rate,
-            weights, bias);
-
-        double diff = fabs(weighted_value - ref_weighted_value);
-
-        *closestIndex = mid;
-
-        if (diff <= tolerance)
-            return mid;
-
-        if (parameters[mid].transfer_rate > weighted_value)
-            return binarySearchWithTolerance(parameters, l, mid - 1,
-                                             weighted_value, tolerance,
-                                             closestIndex, weights, bias);
-
-        return binarySearchWithTolerance(parameters, mid + 1, r, weighted_value,
-                                         tolerance, closestIndex, weights,
-                                         bias);
-    }
-    return -1;
-}
-
 extern inline unsigned long
 generatePseudoRandomTransferRate(all_values_t *values) {
     unsigned long transferRate =
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <netlink/netlink.h>
+#include <netlink/route/link.h>
+#include <netlink/route/rtnl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "ethtool.h"
+#include "stats.h"
+#include "utils.h"
+
+static const char *BACKEND_NAMES[] = {"host", "fake"};
+
+/* The link statistics socket is only opened when the statistics are read:
+ * the apply path needs the ethtool handle alone */
+typedef struct host_interface_s {
+    char ifname[MAX_INTERFACE_NAME_LENGTH];
+    ethtool_t *ethtool;
+    struct nl_sock *nl;
+} host_interface_t;
+
+static int hostReadCpuStats(cpu_stats_t *stats) {
+    char str[MAX_PROC_STRING_LENGTH];
+    cpu_raw_stats_t raw;
+    memset(&raw, 0, sizeof(cpu_raw_stats_t));
+
+    /*  cpu user nice system idle iowait irq softirq steal guest guest_nice
+     */
+    FILE *fp = fopen("/proc/stat", "r");
+    if (fp == NULL)
+        return RET_FAIL;
+    if (fgets(str, MAX_PROC_STRING_LENGTH, fp) == NULL) {
+        fclose(fp);
+        return RET_FAIL;
+    }
+    sscanf(str, "%s %u %u %u %u %u %u %u %u %u %u", raw.cpu, &raw.user,
+           &raw.nice, &raw.system, &raw.idle, &raw.iowait, &raw.irq,
+           &raw.softirq, &raw.steal, &raw.guest, &raw.guest_nice);
+    fclose(fp);
+
+    stats->idleTotal = raw.idle + raw.iowait;
+    stats->nonIdleTotal =
+        raw.user + raw.nice + raw.system + raw.irq + raw.softirq + raw.steal;
+    return RET_OK;
+}
+
+static int hostReadLine(const char *path, char *buffer, size_t len) {
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return RET_FAIL;
+
+    if (fgets(buffer, len, fp) == NULL) {
+        fclose(fp);
+        return RET_FAIL;
+    }
+    fclose(fp);
+
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return RET_OK;
+}
+
+static FILE *hostOpenFile(const char *path) { return fopen(path, "r"); }
+
+static int hostWriteLine(const char *path, const char *value) {
+    size_t len = strlen(value);
+    ssize_t written;
+    int fd, err;
+
+    if ((fd = open(path, O_WRONLY | O_CLOEXEC)) < 0)
+        return RET_FAIL;
+    written = write(fd, value, len);
+    err = errno;
+    close(fd);
+
+    if (written != (ssize_t)len) {
+        errno = written < 0 ? err : EIO;
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+static void *hostOpenInterface(const char *ifname) {
+    host_interface_t *iface = calloc(1, sizeof(host_interface_t));
+
+    if (iface == NULL)
+        return NULL;
+
+    snprintf(iface->ifname, sizeof(iface->ifname), "%s", ifname);
+    if ((iface->ethtool = ethtoolOpen(ifname)) == NULL)
+        write_log("Could not open ethtool on %s: %s\n", ifname,
+                  strerror(errno));
+    else
+        write_adv_log("Using ethtool %s on %s\n",
+                      ethtoolUsesNetlink(iface->ethtool) ? "netlink"
+                                                         : "ioctls",
+                      ifname);
+    return iface;
+}
+
+static void hostCloseInterface(void *handle) {
+    host_interface_t *iface = handle;
+
+    if (iface == NULL)
+        return;
+    ethtoolClose(iface->ethtool);
+    if (iface->nl != NULL)
+        nl_socket_free(iface->nl);
+    free(iface);
+}
+
+void readStats(struct rtnl_link *link, if_stats_t *stats) {
+    if_raw_stats_t raw;
+
+    raw.rx_errors = rtnl_link_get_stat(link, RTNL_LINK_RX_ERRORS);
+    raw.tx_errors = rtnl_link_get_stat(link, RTNL_LINK_TX_ERRORS);
+    raw.rx_dropped = rtnl_link_get_stat(link, RTNL_LINK_RX_DROPPED);
+    raw.tx_dropped = rtnl_link_get_stat(link, RTNL_LINK_TX_DROPPED);
+    raw.rx_fifo_err = rtnl_link_get_stat(link, RTNL_LINK_RX_FIFO_ERR);
+    raw.tx_fifo_err = rtnl_link_get_stat(link, RTNL_LINK_TX_FIFO_ERR);
+    raw.bytes_in = rtnl_link_get_stat(link, RTNL_LINK_RX_BYTES);
+    raw.bytes_out = rtnl_link_get_stat(link, RTNL_LINK_TX_BYTES);
+
+    stats->bytes_total = raw.bytes_in + raw.bytes_out;
+    stats->errors_total = raw.rx_errors + raw.tx_errors;
+    stats->dropped_total = raw.rx_dropped + raw.tx_dropped;
+    stats->fifo_err_total = raw.rx_fifo_err + raw.tx_fifo_err;
+
+    write_adv_log("rx_errors=%ld, tx_errors=%ld, rx_dropped=%ld, "
+                  "tx_dropped=%ld, rx_fifo_err=%ld, tx_fifo_err=%ld, ",
+                  raw.rx_errors, raw.tx_errors, raw.rx_dropped, raw.tx_dropped,
+                  raw.rx_fifo_err, raw.tx_fifo_err);
+}
+
+static int hostReadLinkStats(void *handle, if_stats_t *stats) {
+    host_interface_t *iface = handle;
+    struct rtnl_link *link;
+
+    if (iface->nl == NULL) {
+        if ((iface->nl = nl_socket_alloc()) == NULL)
+            return RET_FAIL;
+        if (nl_connect(iface->nl, NETLINK_ROUTE) < 0) {
+            nl_socket_free(iface->nl);
+            iface->nl = NULL;
+            return RET_FAIL;
+        }
+    }
+
+    if (rtnl_link_get_kernel(iface->nl, 0, iface->ifname, &link) < 0)
+        return RET_FAIL;
+    readStats(link, stats);
+    rtnl_link_put(link);
+
+    return RET_OK;
+}
+
+static int hostReadQueues(void *handle, if_queues_t *queues) {
+    host_interface_t *iface = handle;
+    char path[PATH_MAX], target[PATH_MAX];
+    struct dirent *entry;
+    ssize_t len;
+    DIR *dir;
+
+    memset(queues, 0, sizeof(if_queues_t));
+
+    snprintf(path, sizeof(path), "/sys/class/net/%s/queues", iface->ifname);
+    if ((dir = opendir(path)) == NULL)
+        return RET_FAIL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "rx-", 3) == 0)
+            queues->rx++;
+        else if (strncmp(entry->d_name, "tx-", 3) == 0)
+            queues->tx++;
+    }
+    closedir(dir);
+
+    /* Virtual interfaces have no device */
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device", iface->ifname);
+    if ((len = readlink(path, target, sizeof(target) - 1)) > 0) {
+        target[len] = '\0';
+        snprintf(queues->device, sizeof(queues->device), "%s",
+                 basename(target));
+    }
+    return RET_OK;
+}
+
+static int hostReadRingSize(void *handle, if_ring_size_t *size) {
+    host_interface_t *iface = handle;
+
+    if (iface->ethtool == NULL)
+        return RET_FAIL;
+    return ethtoolReadRingSize(iface->ethtool, size);
+}
+
+static int hostReadCoalesce(void *handle, if_coalesce_t *settings) {
+    host_interface_t *iface = handle;
+
+    if (iface->ethtool == NULL)
+        return RET_FAIL;
+    return ethtoolReadCoalesce(iface->ethtool, settings);
+}
+
+static int hostReadOffloads(void *handle, if_offloads_t *settings) {
+    host_interface_t *iface = handle;
+
+    if (iface->ethtool == NULL)
+        return RET_FAIL;
+    return ethtoolReadOffloads(iface->ethtool, settings);
+}
+
+static unsigned int hostWriteInterface(void *handle,
+                                       const if_ring_size_t *size,
+                                       const if_coalesce_t *coalesce,
+                                       const if_offloads_t *offloads) {
+    host_interface_t *iface = handle;
+
+    if (iface->ethtool == NULL)
+        return (size ? ETHTOOL_RING_SIZE : 0) |
+               (coalesce ? ETHTOOL_COALESCE : 0) |
+               (offloads ? ETHTOOL_OFFLOADS : 0);
+    return ethtoolWrite(iface->ethtool, size, coalesce, offloads);
+}
+
+static const system_backend_t HOST_BACKEND = {
+    .name = "host",
+    .sandboxed = false,
+    .readCpuStats = hostReadCpuStats,
+    .readLine = hostReadLine,
+    .openFile = hostOpenFile,
+    .writeLine = hostWriteLine,
+    .readSysctl = sysctlRead,
+    .writeSysctls = sysctlWriteBatch,
+    .openInterface = hostOpenInterface,
+    .closeInterface = hostCloseInterface,
+    .readLinkStats = hostReadLinkStats,
+    .readQueues = hostReadQueues,
+    .readRingSize = hostReadRingSize,
+    .readCoalesce = hostReadCoalesce,
+    .readOffloads = hostReadOffloads,
+    .writeInterface = hostWriteInterface,
+    .release = sysctlCloseAll};
+
+static const system_backend_t *_backend = &HOST_BACKEND;
+
+const system_backend_t *hostBackend() { return &HOST_BACKEND; }
+
+const system_backend_t *systemBackend() { return _backend; }
+
+void setSystemBackend(const system_backend_t *backend) {
+    _backend = backend != NULL ? backend : &HOST_BACKEND;
+}
+
+int systemBackendFromString(const char *name) {
+    for (unsigned int b = 0; b < sizeof(BACKEND_NAMES) / sizeof(char *); b++)
+        if (strcmp(name, BACKEND_NAMES[b]) == 0)
+            return b;
+    return -1;
+}
+
+const char *systemBackendName(unsigned int backend) {
+    if (backend >= sizeof(BACKEND_NAMES) / sizeof(char *))
+        return "?";
+    return BACKEND_NAMES[backend];
+}
+
+bool writesEnabled() {
+#ifdef APPLY_CHANGES
+    return true;
+#else
+    return _backend->sandboxed;
+#endif
+}
+
+int selectSystemBackend(const app_settings_t *settings, bool logApplied) {
+    if (settings->system_backend != SYSTEM_BACKEND_FAKE) {
+        setSystemBackend(hostBackend());
+        return RET_OK;
+    }
+
+    fakeBackendReset();
+    if (settings->fake_script[0] != '\0' &&
+        fakeBackendLoadScript(settings->fake_script) != RET_OK) {
+        write_log("Could not load the fake backend script %s\n",
+                  settings->fake_script);
+        return RET_FAIL;
+    }
+    if (logApplied && settings->fake_applied_log[0] != '\0' &&
+        fakeBackendSetLog(settings->fake_applied_log) != RET_OK) {
+        write_log("Could not open the fake backend log %s: %s\n",
+                  settings->fake_applied_log, strerror(errno));
+        return RET_FAIL;
+    }
+
+    setSystemBackend(fakeBackend());
+    write_log("Using the fake system backend: counters and settings are "
+              "kept in memory.\n");
+    return RET_OK;
+}
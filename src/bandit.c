@@ -0,0 +1,224 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <libgen.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bandit.h"
+#include "interpolation.h"
+#include "utils.h"
+
+static const char *POLICY_NAMES[] = {"off", "epsilon-greedy", "thompson"};
+
+int banditPolicyFromString(const char *name) {
+    for (unsigned int p = 0; p < sizeof(POLICY_NAMES) / sizeof(char *); p++)
+        if (strcmp(name, POLICY_NAMES[p]) == 0)
+            return p;
+    return -1;
+}
+
+const char *banditPolicyName(unsigned int policy) {
+    if (policy >= sizeof(POLICY_NAMES) / sizeof(char *))
+        return "?";
+    return POLICY_NAMES[policy];
+}
+
+bandit_t *banditCreate(unsigned int policy, double epsilon, unsigned int rows,
+                       unsigned int seed) {
+    bandit_t *bandit;
+
+    if ((bandit = calloc(1, sizeof(bandit_t))) == NULL)
+        return NULL;
+    if ((bandit->scores = calloc(rows > 0 ? rows : 1,
+                                 sizeof(bandit_score_t))) == NULL) {
+        free(bandit);
+        return NULL;
+    }
+
+    bandit->policy = policy;
+    bandit->epsilon = epsilon;
+    bandit->rows = rows;
+    bandit->seed = seed;
+    return bandit;
+}
+
+void banditFree(bandit_t *bandit) {
+    if (bandit == NULL)
+        return;
+
+    free(bandit->scores);
+    free(bandit);
+}
+
+void banditCandidates(const all_values_t *values, unsigned long transferRate,
+                      unsigned int candidates, unsigned int *first,
+                      unsigned int *count) {
+    unsigned int nearest = findNearestTransferRate(values, transferRate);
+
+    *count =
+        candidates < values->validValues ? candidates : values->validValues;
+    if (*count == 0)
+        *count = values->validValues > 0;
+
+    /* Centered on the nearest row, shifted to stay within the table */
+    *first = nearest > *count / 2 ? nearest - *count / 2 : 0;
+    if (*first + *count > values->validValues)
+        *first = values->validValues - *count;
+}
+
+static inline double uniform(unsigned int *seed) {
+    return (rand_r(seed) + 1.0) / (RAND_MAX + 2.0);
+}
+
+/* Box-Muller: a draw of the standard normal distribution */
+static inline double normal(unsigned int *seed) {
+    return sqrt(-2.0 * log(uniform(seed))) * cos(2.0 * M_PI * uniform(seed));
+}
+
+/* A draw of the mean reward of a row given the rewards seen so far */
+static double sampleMean(const bandit_score_t *score, unsigned int *seed) {
+    double variance = score->pulls > 1 ? score->m2 / (score->pulls - 1)
+                                       : BANDIT_PRIOR_VARIANCE;
+
+    return score->mean + sqrt(variance / (score->pulls + 1)) * normal(seed);
+}
+
+int banditChoose(bandit_t *bandit, unsigned int first, unsigned int count) {
+    unsigned int best = first;
+    double bestValue = -INFINITY;
+
+    if (count == 0)
+        return RET_FAIL;
+    bandit->rounds++;
+
+    for (unsigned int row = first; row < first + count; row++)
+        if (bandit->scores[row].pulls == 0) {
+            bandit->explorations++;
+            return row;
+        }
+
+    if (bandit->policy == BANDIT_EPSILON_GREEDY &&
+        uniform(&bandit->seed) < bandit->epsilon) {
+        bandit->explorations++;
+        return first + rand_r(&bandit->seed) % count;
+    }
+
+    for (unsigned int row = first; row < first + count; row++) {
+        double value = bandit->policy == BANDIT_THOMPSON
+                           ? sampleMean(&bandit->scores[row], &bandit->seed)
+                           : bandit->scores[row].mean;
+
+        if (value > bestValue) {
+            bestValue = value;
+            best = row;
+        }
+    }
+
+    return best;
+}
+
+/* Relative change of a rate; rates close to 0 are compared against 1 */
+static inline double relativeChange(double before, double after) {
+    return fmin(fmax((after - before) / fmax(before, 1.0), -1.0), 1.0);
+}
+
+double banditReward(const bandit_measure_t *before,
+                    const bandit_measure_t *after) {
+    return relativeChange(before->transfer_rate, after->transfer_rate) -
+           relativeChange(before->drop_rate, after->drop_rate) -
+           relativeChange(before->errors_rate, after->errors_rate) -
+           BANDIT_CPU_WEIGHT * (after->cpu_usage - before->cpu_usage) / 100.0;
+}
+
+void banditUpdate(bandit_t *bandit, unsigned int row, double reward) {
+    bandit_score_t *score;
+    double delta;
+
+    if (row >= bandit->rows)
+        return;
+
+    /* Welford's online mean and variance */
+    score = &bandit->scores[row];
+    score->pulls++;
+    delta = reward - score->mean;
+    score->mean += delta / score->pulls;
+    score->m2 += delta * (reward - score->mean);
+}
+
+void banditScoresPath(const char *tablePath, char *path, size_t size) {
+    char file[MAX_FILENAME_LENGTH];
+    char directory[MAX_FILENAME_LENGTH];
+
+    snprintf(file, sizeof(file), "%s", tablePath);
+    snprintf(directory, sizeof(directory), "%s", tablePath);
+
+    snprintf(path, size, "%s/%s_%s", dirname(directory),
+             strtok(basename(file), "."), APPEND_TO_SCORES_FILE_NAME);
+}
+
+int banditSave(const bandit_t *bandit, const all_values_t *values,
+               const char *path) {
+    char tmpPath[MAX_FILENAME_LENGTH + 4];
+    FILE *fp;
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+    if ((fp = fopen(tmpPath, "w")) == NULL)
+        return RET_FAIL;
+
+    fprintf(fp, "transfer_rate,pulls,mean_reward,reward_m2\n");
+    for (unsigned int row = 0;
+         row < bandit->rows && row < values->validValues; row++)
+        if (bandit->scores[row].pulls > 0)
+            fprintf(fp, "%lu,%u,%lf,%lf\n",
+                    values->parameters[row].transfer_rate,
+                    bandit->scores[row].pulls, bandit->scores[row].mean,
+                    bandit->scores[row].m2);
+
+    if (fclose(fp) != 0 || rename(tmpPath, path) != 0) {
+        unlink(tmpPath);
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+int banditLoad(bandit_t *bandit, const all_values_t *values,
+               const char *path) {
+    char line[MAX_COMMAND_LENGTH];
+    bandit_score_t score;
+    unsigned long transferRate;
+    int loaded = 0;
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return RET_FAIL;
+
+    /* skip the header */
+    if (fgets(line, sizeof(line), fp) == NULL) {
+        fclose(fp);
+        return RET_FAIL;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        unsigned int row;
+
+        if (sscanf(line, "%lu,%u,%lf,%lf", &transferRate, &score.pulls,
+                   &score.mean, &score.m2) != 4)
+            continue;
+
+        /* Rows which are gone from the table lose their score */
+        row = findNearestTransferRate(values, transferRate);
+        if (row >= bandit->rows || values->validValues == 0 ||
+            values->parameters[row].transfer_rate != transferRate)
+            continue;
+
+        bandit->scores[row] = score;
+        loaded++;
+    }
+
+    fclose(fp);
+    return loaded;
+}
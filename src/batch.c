@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "batch.h"
+#include "interpolation.h"
+#include "utils.h"
+
+#define BATCH_MAX_DIGITS 20
+
+/* Lowered to the vector unit of the target by GCC and clang */
+typedef double batch_vector_t
+    __attribute__((vector_size(BATCH_LANES * sizeof(double))));
+
+static const double POWERS_OF_10[BATCH_MAX_DIGITS] = {
+    1e0,
+    1e1,
+    1e2,
+    1e3,
+    1e4,
+    1e5,
+    1e6,
+    1e7,
+    1e8,
+    1e9,
+    1e10,
+    1e11,
+    1e12,
+    1e13,
+    1e14,
+    1e15,
+    1e16,
+    1e17,
+    1e18,
+    1e19};
+
+batch_table_t *batchPrepare(const all_values_t *values,
+                            const weights_reference_t *weights, double bias,
+                            const app_settings_t *settings) {
+    unsigned int count = values->validValues;
+    batch_table_t *table;
+
+    if ((table = calloc(1, sizeof(batch_table_t))) == NULL)
+        return NULL;
+    /* One more, the sentinel read by a search that is over */
+    if ((table->rows = calloc(count + 1, sizeof(batch_row_t))) == NULL) {
+        batchFree(table);
+        return NULL;
+    }
+
+    table->values = values;
+    table->weights = *weights;
+    table->bias = bias;
+    table->approx_function = settings->approx_function;
+    table->interpolate = settings->interpolate;
+    table->max_extrapolation = settings->max_extrapolation;
+
+    /* As networkRunInference() derives it from the digits of the value */
+    for (unsigned int d = 1; d <= BATCH_MAX_DIGITS; d++) {
+        unsigned short zeros = d * settings->accuracy;
+
+        table->epsilon[d] = calculateEpsilon(zeros, settings->accuracy);
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        const tuning_params_t *row = &values->parameters[i];
+
+        table->rows[i].weightedValue = calculateWeightedValue(
+            row->transfer_rate, row->drop_rate, row->errors_rate,
+            row->fifo_errors_rate, &table->weights, bias);
+        table->rows[i].transferRate = row->transfer_rate;
+    }
+
+    /* Halving the rows left until there are none */
+    for (unsigned int left = count; left > 0; left /= 2)
+        table->steps++;
+
+    return table;
+}
+
+void batchFree(batch_table_t *table) {
+    if (table == NULL)
+        return;
+    free(table->rows);
+    free(table);
+}
+
+/* digits() without the logarithm, nor a branch on the value; they agree
+ * below 10^15, past which log10() rounds 10^n - 1 up */
+static inline unsigned int countDigits(double value) {
+    unsigned int d = 1;
+
+    for (unsigned int p = 1; p < BATCH_MAX_DIGITS; p++)
+        d += value >= POWERS_OF_10[p];
+    return d;
+}
+
+/* calculateTolerance(), without its logging */
+static inline double tolerance(const batch_table_t *table, double value) {
+    double t = value * table->epsilon[countDigits(value)];
+
+    switch (table->approx_function) {
+    case 1:
+        return sqrt(t);
+    case 2:
+        return pow(t, 2);
+    case 3:
+        return log10(t);
+    case 4:
+        return log(t);
+    default:
+        return t;
+    }
+}
+
+/* Weighted values of the lanes samples from first, in the order of the
+ * operations of calculateWeightedValue(); the lanes past them repeat the
+ * first */
+static inline void weigh(const batch_table_t *table,
+                         const batch_samples_t *samples, unsigned int first,
+                         unsigned int lanes, double *weightedValues) {
+    batch_vector_t transfer, drop, errors, fifo, value;
+
+    for (unsigned int k = 0; k < BATCH_LANES; k++) {
+        unsigned int i = first + (k < lanes ? k : 0);
+
+        transfer[k] = samples->transfer_rate[i];
+        drop[k] = samples->drop_rate[i];
+        errors[k] = samples->errors_rate[i];
+        fifo[k] = samples->fifo_errors_rate[i];
+    }
+
+    value = transfer * table->weights.transfer_rate_weight +
+            drop * table->weights.drop_rate_weight +
+            errors * table->weights.errors_rate_weight +
+            fifo * table->weights.fifo_errors_rate_weight;
+    value += table->bias;
+
+    for (unsigned int k = 0; k < BATCH_LANES; k++)
+        weightedValues[k] = value[k];
+}
+
+/*
+ * binarySearchWithTolerance() for lanes samples at once. Every search takes
+ * at most table->steps steps, so all of them are advanced that many times
+ * without a branch on their outcome: a search that is over keeps its bounds,
+ * its reads stay within the rows and the sentinel after them, and it is no
+ * longer recorded. The reads of the lanes are then in flight together, and
+ * a random load mispredicts nothing.
+ */
+static inline void search(const batch_table_t *table,
+                          const double *weightedValues,
+                          const double *tolerances, int *found) {
+    int lo[BATCH_LANES], hi[BATCH_LANES];
+
+    for (unsigned int k = 0; k < BATCH_LANES; k++) {
+        lo[k] = 0;
+        hi[k] = (int)table->values->validValues - 1;
+        found[k] = -1;
+    }
+
+    for (unsigned int step = 0; step < table->steps; step++) {
+        for (unsigned int k = 0; k < BATCH_LANES; k++) {
+            int mid = lo[k] + (hi[k] - lo[k]) / 2;
+            const batch_row_t *row = &table->rows[mid];
+            /* All ones or all zeros, combined with & rather than && */
+            int going = -((found[k] == -1) & (lo[k] <= hi[k]));
+            int hit = -(fabs(weightedValues[k] - row->weightedValue) <=
+                        tolerances[k]);
+            int right = -(row->transferRate <= weightedValues[k]);
+
+            found[k] ^= (found[k] ^ mid) & going & hit;
+            lo[k] ^= (lo[k] ^ (mid + 1)) & going & ~hit & right;
+            hi[k] ^= (hi[k] ^ (mid - 1)) & going & ~hit & ~right;
+        }
+    }
+}
+
+unsigned int batchInfer(const batch_table_t *table,
+                        const batch_samples_t *samples,
+                        batch_results_t *results) {
+    unsigned int matched = 0;
+
+    for (unsigned int first = 0; first < samples->count;
+         first += BATCH_LANES) {
+        unsigned int lanes = samples->count - first < BATCH_LANES
+                                 ? samples->count - first
+                                 : BATCH_LANES;
+        double weightedValues[BATCH_LANES], tolerances[BATCH_LANES];
+        int found[BATCH_LANES];
+
+        weigh(table, samples, first, lanes, weightedValues);
+        for (unsigned int k = 0; k < BATCH_LANES; k++)
+            tolerances[k] = tolerance(table, weightedValues[k]);
+
+        search(table, weightedValues, tolerances, found);
+
+        for (unsigned int k = 0; k < lanes; k++) {
+            unsigned int i = first + k;
+            int row = found[k];
+            uint8_t kind = BATCH_MATCHED;
+
+            if (row == -1) {
+                kind = BATCH_MISSED;
+                if (table->interpolate &&
+                    (row = interpolationRow(table->values,
+                                            samples->transfer_rate[i],
+                                            table->max_extrapolation)) != -1)
+                    kind = BATCH_INTERPOLATED;
+            }
+
+            results->rows[i] = row;
+            results->kinds[i] = kind;
+            results->weightedValues[i] = weightedValues[k];
+            results->tolerances[i] = tolerances[k];
+            matched += kind != BATCH_MISSED;
+        }
+    }
+
+    return matched;
+}
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <string.h>
+
+#include "bus.h"
+
+void busInit(sample_bus_t *bus) {
+    memset(bus, 0, sizeof(sample_bus_t));
+    pthread_mutex_init(&bus->lock, NULL);
+    pthread_cond_init(&bus->idle, NULL);
+}
+
+void busDestroy(sample_bus_t *bus) {
+    pthread_cond_destroy(&bus->idle);
+    pthread_mutex_destroy(&bus->lock);
+}
+
+int busAttach(sample_bus_t *bus, unsigned int metrics, unsigned int knobs) {
+    int ret = RET_FAIL;
+
+    pthread_mutex_lock(&bus->lock);
+    if ((metrics & ~BUS_ALL_METRICS) == 0 && (knobs & bus->claimed) == 0) {
+        bus->requested |= metrics;
+        bus->claimed |= knobs;
+        ret = RET_OK;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    return ret;
+}
+
+static inline bool sameSubscriber(const bus_subscriber_t *a,
+                                  const bus_subscriber_t *b) {
+    return a->metrics == b->metrics && a->callback == b->callback &&
+           a->context == b->context;
+}
+
+void busDetach(sample_bus_t *bus, unsigned int knobs,
+               const bus_subscriber_t *subscriptions, unsigned int count) {
+    pthread_mutex_lock(&bus->lock);
+    bus->claimed &= ~knobs;
+
+    for (unsigned int s = 0; s < count; s++)
+        for (unsigned int i = 0; i < bus->subscriberCount; i++)
+            if (sameSubscriber(&bus->subscribers[i], &subscriptions[s])) {
+                memmove(&bus->subscribers[i], &bus->subscribers[i + 1],
+                        (bus->subscriberCount - i - 1) *
+                            sizeof(bus_subscriber_t));
+                bus->subscriberCount--;
+                break;
+            }
+
+    /* A publisher may have copied them before: its callbacks must end */
+    while (bus->dispatching > 0)
+        pthread_cond_wait(&bus->idle, &bus->lock);
+    pthread_mutex_unlock(&bus->lock);
+}
+
+int busSubscribe(sample_bus_t *bus, unsigned int metrics,
+                 bus_callback_t callback, void *context) {
+    int ret = RET_FAIL;
+
+    pthread_mutex_lock(&bus->lock);
+    if (bus->subscriberCount < MAX_BUS_SUBSCRIBERS) {
+        bus_subscriber_t *subscriber =
+            &bus->subscribers[bus->subscriberCount++];
+
+        subscriber->metrics = metrics;
+        subscriber->callback = callback;
+        subscriber->context = context;
+        ret = RET_OK;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    return ret;
+}
+
+void busPublish(sample_bus_t *bus, bus_sample_t *sample) {
+    bus_subscriber_t subscribers[MAX_BUS_SUBSCRIBERS];
+    unsigned int count = 0;
+
+    if (sample->metric >= BUS_METRICS)
+        return;
+
+    pthread_mutex_lock(&bus->lock);
+    sample->sequence = bus->latest[sample->metric].sequence + 1;
+    bus->latest[sample->metric] = *sample;
+    for (unsigned int i = 0; i < bus->subscriberCount; i++)
+        if (bus->subscribers[i].metrics & BUS_METRIC_MASK(sample->metric))
+            subscribers[count++] = bus->subscribers[i];
+    bus->dispatching++;
+    pthread_mutex_unlock(&bus->lock);
+
+    /* Out of the lock, so that a subscriber can read the bus */
+    for (unsigned int i = 0; i < count; i++)
+        subscribers[i].callback(sample, subscribers[i].context);
+
+    pthread_mutex_lock(&bus->lock);
+    if (--bus->dispatching == 0)
+        pthread_cond_broadcast(&bus->idle);
+    pthread_mutex_unlock(&bus->lock);
+}
+
+int busLatest(sample_bus_t *bus, unsigned int metric, bus_sample_t *sample) {
+    int ret = RET_FAIL;
+
+    if (metric >= BUS_METRICS)
+        return RET_FAIL;
+
+    pthread_mutex_lock(&bus->lock);
+    if (bus->latest[metric].sequence > 0) {
+        *sample = bus->latest[metric];
+        ret = RET_OK;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    return ret;
+}
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <ctype.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "utils.h"
+
+static const char *LEVEL_NAMES[CPU_LEVELS] = {"idle", "loaded", "saturated"};
+
+/* The governors scaling the frequency with the load, by preference; the
+ * powersave one of intel_pstate does too, that of acpi-cpufreq does not but
+ * comes with ondemand */
+static const char *DYNAMIC_GOVERNORS[] = {"schedutil", "ondemand",
+                                          "conservative", "powersave"};
+
+unsigned int cpuParseStats(FILE *fp, cpu_stats_t *stats, unsigned int *ids,
+                           unsigned int max) {
+    char line[MAX_PROC_STRING_LENGTH];
+    cpu_raw_stats_t raw;
+    unsigned int count = 0;
+
+    while (count < max && fgets(line, sizeof(line), fp) != NULL) {
+        if (strncmp(line, "cpu", 3) != 0)
+            break;
+        /* the total line, "cpu  ...", has no number */
+        if (!isdigit((unsigned char)line[3]))
+            continue;
+        memset(&raw, 0, sizeof(cpu_raw_stats_t));
+        if (sscanf(line, "cpu%u %u %u %u %u %u %u %u %u", &ids[count],
+                   &raw.user, &raw.nice, &raw.system, &raw.idle, &raw.iowait,
+                   &raw.irq, &raw.softirq, &raw.steal) < 5)
+            continue;
+
+        stats[count].idleTotal = raw.idle + raw.iowait;
+        stats[count].nonIdleTotal = raw.user + raw.nice + raw.system +
+                                    raw.irq + raw.softirq + raw.steal;
+        count++;
+    }
+
+    return count;
+}
+
+unsigned int cpuParseGovernors(const char *line) {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    char *rest = buffer, *name;
+    unsigned int governors = 0;
+    int governor;
+
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    while ((name = strsep(&rest, " \t\n")) != NULL)
+        if (*name != '\0' && (governor = cpuGovernorIndex(name)) != -1)
+            governors |= 1U << governor;
+
+    return governors;
+}
+
+unsigned short cpuDynamicGovernor(unsigned int governors) {
+    for (unsigned int i = 0;
+         i < sizeof(DYNAMIC_GOVERNORS) / sizeof(DYNAMIC_GOVERNORS[0]); i++) {
+        int governor = cpuGovernorIndex(DYNAMIC_GOVERNORS[i]);
+
+        if (governors & (1U << governor))
+            return governor;
+    }
+    return 0;
+}
+
+const char *cpuLevelName(unsigned int level) {
+    if (level >= CPU_LEVELS)
+        return "?";
+    return LEVEL_NAMES[level];
+}
+
+void cpuTunerInit(cpu_tuner_t *tuner, double low, double high, bool latency) {
+    memset(tuner, 0, sizeof(cpu_tuner_t));
+    tuner->low = low;
+    tuner->high = high;
+    tuner->latency = latency;
+    tuner->level = latency ? CPU_LEVEL_LOADED : CPU_LEVEL_IDLE;
+}
+
+unsigned int cpuTunerUpdate(cpu_tuner_t *tuner, double peakBusy) {
+    unsigned int level = CPU_LEVEL_IDLE;
+
+    if (peakBusy >= tuner->high)
+        level = CPU_LEVEL_SATURATED;
+    else if (peakBusy >= tuner->low)
+        level = CPU_LEVEL_LOADED;
+    if (tuner->latency && level < CPU_LEVEL_LOADED)
+        level = CPU_LEVEL_LOADED;
+
+    return levelUpdate(&tuner->level, &tuner->calm, level, CPU_CALM_SAMPLES);
+}
+
+void cpuProfileFor(unsigned int level, bool latency,
+                   const cpu_limits_t *limits, cpu_profile_t *profile) {
+    unsigned short dynamic = cpuDynamicGovernor(limits->governors);
+    unsigned short performance = cpuGovernorIndex("performance");
+    bool maximum = level == CPU_LEVEL_SATURATED ||
+                   (latency && level == CPU_LEVEL_LOADED);
+
+    memset(profile, 0, sizeof(cpu_profile_t));
+
+    profile->governor = dynamic;
+    if (maximum && (limits->governors & (1U << performance)))
+        profile->governor = performance;
+
+    if (maximum)
+        profile->min_khz = limits->max_khz;
+    else if (level == CPU_LEVEL_LOADED)
+        profile->min_khz =
+            limits->min_khz + (limits->max_khz - limits->min_khz) / 2;
+    else
+        profile->min_khz = limits->min_khz;
+
+    if (latency) {
+        profile->sched_min_granularity_ns = CPU_LATENCY_MIN_GRANULARITY_NS;
+        profile->sched_wakeup_granularity_ns =
+            CPU_LATENCY_WAKEUP_GRANULARITY_NS;
+    } else if (level == CPU_LEVEL_SATURATED) {
+        profile->sched_min_granularity_ns = CPU_THROUGHPUT_MIN_GRANULARITY_NS;
+        profile->sched_wakeup_granularity_ns =
+            CPU_THROUGHPUT_WAKEUP_GRANULARITY_NS;
+    }
+}
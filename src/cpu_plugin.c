@@ -0,0 +1,307 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "bus.h"
+#include "cpu.h"
+#include "plugins.h"
+#include "settings.h"
+#include "utils.h"
+
+static app_settings_t *_cpu_app_settings;
+/* The settings reloads publish, in inference, and those followed from them */
+static settings_store_t *_settingsStore;
+static settings_snapshot_t *_followed;
+static tuning_params_t *_cpu_settings;
+static sample_bus_t *_bus;
+
+/* Whether cpu0 has cpufreq; without it only the scheduler is tuned */
+static bool _cpufreq;
+static cpu_limits_t _limits;
+static cpu_tuner_t _tuner;
+
+/* The governor and scheduler slices found on the host, which 0 in a profile
+ * stands for */
+static cpu_profile_t _baseline;
+static cpu_profile_t _applied;
+static bool _profileApplied = false;
+/* EEVDF, from kernel 6.6, has a single base slice instead of granularities */
+static bool _eevdf = false;
+
+static unsigned long _changes = 0L;
+static unsigned long _levelSamples[CPU_LEVELS];
+
+static inline unsigned int readNumber(const char *path) {
+    char buffer[MAX_SYSCTL_VALUE_LENGTH];
+
+    if (systemBackend()->readLine(path, buffer, sizeof(buffer)) != RET_OK)
+        return 0;
+    return strtoul(buffer, NULL, 10);
+}
+
+static void readLimits() {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    unsigned short dynamic;
+
+    _limits.min_khz = readNumber(CPUFREQ_PATH "cpuinfo_min_freq");
+    _limits.max_khz = readNumber(CPUFREQ_PATH "cpuinfo_max_freq");
+    if (systemBackend()->readLine(CPUFREQ_PATH "scaling_available_governors",
+                                  buffer, sizeof(buffer)) == RET_OK)
+        _limits.governors = cpuParseGovernors(buffer);
+
+    _cpufreq = _limits.max_khz > 0 && _limits.governors != 0;
+    dynamic = cpuDynamicGovernor(_limits.governors);
+    if (_cpufreq)
+        write_log("CPU frequencies %u..%u kHz, dynamic governor %s\n",
+                  _limits.min_khz, _limits.max_khz,
+                  dynamic != 0 ? cpuGovernorName(dynamic) : "none");
+    else
+        write_log("The CPUs have no cpufreq: tuning the scheduler alone.\n");
+}
+
+/* The sysctls are gone from kernel 5.13 on, which has them in debugfs */
+static unsigned int readGranularity(unsigned int sysctlValue,
+                                    const char *name) {
+    char path[MAX_FILENAME_LENGTH];
+
+    if (sysctlValue != 0)
+        return sysctlValue;
+    snprintf(path, sizeof(path), SCHED_DEBUGFS_PATH "%s", name);
+    return readNumber(path);
+}
+
+/* Without granularities, the base slice stands for the minimum one */
+static void readBaseline() {
+    _baseline.governor = _cpu_settings->governor;
+    _baseline.sched_min_granularity_ns =
+        readGranularity(_cpu_settings->kernel_sched_min_granularity_ns,
+                        "min_granularity_ns");
+    _baseline.sched_wakeup_granularity_ns =
+        readGranularity(_cpu_settings->kernel_sched_wakeup_granularity_ns,
+                        "wakeup_granularity_ns");
+    if (_baseline.sched_min_granularity_ns != 0 ||
+        _baseline.sched_wakeup_granularity_ns != 0)
+        return;
+
+    _baseline.sched_min_granularity_ns =
+        readNumber(SCHED_DEBUGFS_PATH "base_slice_ns");
+    _eevdf = _baseline.sched_min_granularity_ns != 0;
+    if (_eevdf)
+        write_log("EEVDF scheduler: tuning its base slice of %u ns.\n",
+                  _baseline.sched_min_granularity_ns);
+}
+
+/* sysctl is NULL for a setting found in debugfs alone */
+static void writeGranularity(const char *sysctl, const char *name,
+                             unsigned int value) {
+    char path[MAX_FILENAME_LENGTH];
+    sysctl_write_t write;
+
+    sysctlSet(&write, sysctl != NULL ? sysctl : name, "%u", value);
+    if (sysctl != NULL && systemBackend()->writeSysctls(&write, 1) == 0)
+        return;
+
+    snprintf(path, sizeof(path), SCHED_DEBUGFS_PATH "%s", name);
+    if (systemBackend()->writeLine(path, write.value) != RET_OK)
+        write_log("Could not set %s to %u: %s\n", write.name, value,
+                  strerror(errno));
+}
+
+static void writeCpuFreq(const bus_cpus_t *cpus, const char *file,
+                         const char *value) {
+    char path[MAX_FILENAME_LENGTH];
+
+    for (unsigned int i = 0; i < cpus->count; i++) {
+        if (cpus->khz[i] == 0)
+            continue;
+        snprintf(path, sizeof(path), CPUFREQ_CPU_PATH "%s", cpus->id[i],
+                 file);
+        if (systemBackend()->writeLine(path, value) != RET_OK)
+            write_log("Could not set %s to %s: %s\n", path, value,
+                      strerror(errno));
+    }
+}
+
+/* The governor first: the minimum frequency is that of the new governor */
+static void applyProfile(const bus_cpus_t *cpus,
+                         const cpu_profile_t *profile) {
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+
+    write_log("\033[1;32m"); // Set the text to the color green
+    write_log("CPUs %s: governor %s, minimum frequency %u kHz, scheduler "
+              "slices %u/%u ns\n",
+              cpuLevelName(_tuner.level),
+              profile->governor != 0 ? cpuGovernorName(profile->governor)
+                                     : "unchanged",
+              profile->min_khz, profile->sched_min_granularity_ns,
+              profile->sched_wakeup_granularity_ns);
+    write_log("\033[0m"); // Resets the text to default
+
+    if (writesEnabled()) {
+        if (_cpufreq && profile->governor != 0 &&
+            profile->governor != _applied.governor)
+            writeCpuFreq(cpus, "scaling_governor",
+                         cpuGovernorName(profile->governor));
+        if (_cpufreq && profile->min_khz != _applied.min_khz) {
+            snprintf(value, sizeof(value), "%u", profile->min_khz);
+            writeCpuFreq(cpus, "scaling_min_freq", value);
+        }
+        if (profile->sched_min_granularity_ns != 0 &&
+            profile->sched_min_granularity_ns !=
+                _applied.sched_min_granularity_ns)
+            writeGranularity(_eevdf ? NULL : "kernel.sched_min_granularity_ns",
+                             _eevdf ? "base_slice_ns" : "min_granularity_ns",
+                             profile->sched_min_granularity_ns);
+        if (profile->sched_wakeup_granularity_ns != 0 &&
+            profile->sched_wakeup_granularity_ns !=
+                _applied.sched_wakeup_granularity_ns)
+            writeGranularity("kernel.sched_wakeup_granularity_ns",
+                             "wakeup_granularity_ns",
+                             profile->sched_wakeup_granularity_ns);
+    }
+
+    _applied = *profile;
+    _profileApplied = true;
+    _changes++;
+}
+
+static double peakBusy(const bus_cpus_t *cpus) {
+    double peak = NAN;
+
+    for (unsigned int i = 0; i < cpus->count; i++)
+        if (!isnan(cpus->busy[i]) && (isnan(peak) || cpus->busy[i] > peak))
+            peak = cpus->busy[i];
+    return peak;
+}
+
+/* Moves over to the settings a reload published, with their thresholds */
+static void followSettings() {
+    if (_settingsStore == NULL || !settingsFollow(_settingsStore, &_followed))
+        return;
+
+    _cpu_app_settings = &_followed->app;
+    _tuner.low = _cpu_app_settings->cpu_busy_low;
+    _tuner.high = _cpu_app_settings->cpu_busy_high;
+    _tuner.latency = _followed->labels.optimize_for == LATENCY;
+}
+
+void *cpuRunInference(void *args __attribute__((unused))) {
+    unsigned long period;
+    static bus_sample_t sample;
+    uint64_t lastSequence = 0;
+    cpu_profile_t profile;
+
+    readBaseline();
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    while (1) {
+        period = USEC_IN_SEC * _cpu_app_settings->inference_loop_period;
+
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        usleep(period);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        followSettings();
+
+        if (busLatest(_bus, BUS_METRIC_CPUS, &sample) == RET_FAIL ||
+            sample.sequence == lastSequence)
+            continue;
+        lastSequence = sample.sequence;
+
+        double peak = peakBusy(&sample.cpus);
+        if (isnan(peak))
+            continue;
+
+        unsigned int level = cpuTunerUpdate(&_tuner, peak);
+        _levelSamples[level]++;
+        write_adv_log("Busiest CPU at %.2lf%%: %s\n", peak,
+                      cpuLevelName(level));
+
+        cpuProfileFor(level, _tuner.latency, &_limits, &profile);
+        if (profile.governor == 0)
+            profile.governor = _baseline.governor;
+        if (profile.sched_min_granularity_ns == 0)
+            profile.sched_min_granularity_ns =
+                _baseline.sched_min_granularity_ns;
+        if (profile.sched_wakeup_granularity_ns == 0 || _eevdf)
+            profile.sched_wakeup_granularity_ns =
+                _baseline.sched_wakeup_granularity_ns;
+
+        if (!_profileApplied ||
+            memcmp(&profile, &_applied, sizeof(cpu_profile_t)) != 0)
+            applyProfile(&sample.cpus, &profile);
+    }
+
+    return NULL;
+}
+
+/* Nothing is learnt into a table: the CPUs are tuned from the load alone */
+void cpuRunTraining(char *inputFileName __attribute__((unused))) {
+    write_log("The CPU plugin has no table to train.\n");
+}
+
+static inline void cpuPrintReport() {
+    write_log("\033[0;34m"); // Set the text to the color blue
+    write_log("CPUs idle/loaded/saturated for %lu/%lu/%lu samples, tuned %lu "
+              "times; now %s\n",
+              _levelSamples[CPU_LEVEL_IDLE], _levelSamples[CPU_LEVEL_LOADED],
+              _levelSamples[CPU_LEVEL_SATURATED], _changes,
+              cpuLevelName(_tuner.level));
+    write_log("\033[0m"); // Resets the text to default color
+}
+
+int cpuInit(const plugin_context_t *context) {
+    bool latency = context->labels != NULL &&
+                   context->labels->optimize_for == LATENCY;
+
+    _cpu_app_settings = context->settings;
+    _cpu_settings = context->systemSettings;
+    _settingsStore = context->settingsStore;
+    _bus = context->bus;
+    set_verbosity(context->verbosity);
+
+    if (selectSystemBackend(context->settings, true) != RET_OK)
+        return RET_FAIL;
+
+    readLimits();
+    cpuTunerInit(&_tuner, _cpu_app_settings->cpu_busy_low,
+                 _cpu_app_settings->cpu_busy_high, latency);
+    if (latency)
+        write_log("Optimized for latency: the CPUs are never left idle.\n");
+
+    return RET_OK;
+}
+
+void cpuDestroy() {
+    settingsRelease(_followed);
+    _followed = NULL;
+    systemBackend()->release();
+}
+
+plugin_v2_t meV2 = {.abi_version = PLUGIN_ABI_VERSION,
+                    .active = TRUE,
+                    .name = "CPU_PLUGIN",
+                    .version = 0.1,
+                    .metrics = BUS_METRIC_MASK(BUS_METRIC_CPUS),
+                    .knobs = KNOB_CPU,
+                    .init = cpuInit,
+                    .destroy = cpuDestroy,
+                    .inference = cpuRunInference,
+                    .training = cpuRunTraining,
+                    .livetraining = cpuRunTraining,
+                    .print_report = cpuPrintReport};
+
+plugin_v2_t *registerMeV2() {
+    write_log("Registering plugin %s ver. %g (ABI %u)\n", meV2.name,
+              meV2.version, meV2.abi_version);
+
+    return &meV2;
+}
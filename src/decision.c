@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <limits.h>
+#include <math.h>
+
+#include "decision.h"
+#include "interpolation.h"
+#include "utils.h"
+
+/*
+ * Returns the row nearest to the load, or -1 when the neighbours are too
+ * evenly spread to trust it; closestIndex is set in both cases.
+ */
+static int findNearestRow(const decision_context_t *context,
+                          const double load[KNN_DIMENSIONS],
+                          unsigned int *closestIndex) {
+    knn_match_t match;
+
+    if (knnQuery(context->knnIndex, load, context->settings->knn_neighbours,
+                 &match) != RET_OK)
+        return -1;
+
+    *closestIndex = match.row;
+    write_adv_log("Nearest row %u at distance %lf, confidence %lf\n",
+                  match.row, match.distance, match.confidence);
+    return match.confidence >= context->settings->knn_min_confidence
+               ? (int)match.row
+               : -1;
+}
+
+/* Returns the row whose transfer rate is nearest to the model's prediction */
+static int predictRow(const decision_context_t *context,
+                      const double load[NN_INPUTS],
+                      unsigned int *closestIndex) {
+    double predicted = nnPredict(context->model, load);
+    unsigned long transferRate =
+        predicted < (double)ULONG_MAX ? predicted : ULONG_MAX;
+
+    if (context->values->validValues == 0)
+        return -1;
+
+    *closestIndex = findNearestTransferRate(context->values, transferRate);
+    write_adv_log("Model predicts transfer rate %lu: row %u\n", transferRate,
+                  *closestIndex);
+    return *closestIndex;
+}
+
+/* The model takes precedence over the neighbours, which take precedence over
+ * the weighted value */
+static int findRow(const decision_context_t *context,
+                   const inference_load_t *load, decision_t *decision) {
+    double dimensions[KNN_DIMENSIONS] = {
+        load->transfer_rate, load->drop_rate, load->errors_rate,
+        load->fifo_errors_rate, load->cpu_usage};
+
+    if (context->model != NULL)
+        return predictRow(context, dimensions, &decision->closestIndex);
+    if (context->knnIndex != NULL)
+        return findNearestRow(context, dimensions, &decision->closestIndex);
+    return binarySearchWithTolerance(
+        context->values->parameters, 0, context->values->validValues,
+        decision->weightedValue, decision->tolerance, &decision->closestIndex,
+        context->weights, context->bias);
+}
+
+unsigned int decide(const decision_context_t *context, decision_state_t *state,
+                    const inference_load_t *load, unsigned long elapsed,
+                    decision_t *decision) {
+    const app_settings_t *settings = context->settings;
+
+    decision->row = -1;
+    decision->closestIndex = 0;
+    state->timePassedSinceLastChanges += elapsed;
+
+    if (load->transfer_rate == 0 && load->drop_rate == 0 &&
+        load->errors_rate == 0 && load->fifo_errors_rate == 0)
+        return decision->outcome = DECISION_IDLE;
+
+#ifdef LINEAR_REGRESSION
+    decision->weightedValue = calculateWeightedValue(
+        load->transfer_rate, load->drop_rate, load->errors_rate,
+        load->fifo_errors_rate, context->weights, context->bias);
+    unsigned short zeros = digits(decision->weightedValue) * settings->accuracy;
+    double epsilon = calculateEpsilon(zeros, settings->accuracy);
+    decision->tolerance = calculateTolerance(decision->weightedValue, epsilon,
+                                             settings->approx_function);
+    decision->weightedValueDiff =
+        fabs(decision->weightedValue - state->prevWeightedValue);
+#endif
+
+    if (decision->weightedValueDiff < decision->tolerance)
+        return decision->outcome = DECISION_SMALL_DELTA;
+
+    if (decision->weightedValue < state->prevWeightedValue &&
+        (state->timePassedSinceLastChanges <=
+         settings->grace_period * MINUTES_IN_USEC))
+        return decision->outcome = DECISION_GRACE_PERIOD;
+
+    decision->outcome = DECISION_MISSED;
+    if ((decision->row = findRow(context, load, decision)) != -1)
+        decision->outcome = DECISION_MATCHED;
+    else if (settings->interpolate && context->knnIndex == NULL &&
+             context->model == NULL &&
+             (decision->row = interpolateSettings(
+                  context->values, load->transfer_rate,
+                  settings->max_extrapolation, &decision->interpolated)) != -1)
+        decision->outcome = DECISION_INTERPOLATED;
+
+    if (decision->outcome != DECISION_MISSED) {
+        state->timePassedSinceLastChanges = 0;
+        state->prevWeightedValue = decision->weightedValue;
+    }
+    return decision->outcome;
+}
+
+const tuning_params_t *decisionSettings(const decision_context_t *context,
+                                        const decision_t *decision) {
+    switch (decision->outcome) {
+    case DECISION_MATCHED:
+        return &context->values->parameters[decision->row];
+    case DECISION_INTERPOLATED:
+        return &decision->interpolated;
+    default:
+        return NULL;
+    }
+}
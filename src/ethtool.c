@@ -0,0 +1,785 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <linux/ethtool.h>
+#ifdef HAVE_ETHTOOL_NETLINK
+#include <linux/ethtool_netlink.h>
+#endif
+#include <linux/genetlink.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <netlink/attr.h>
+#include <netlink/msg.h>
+#include <netlink/netlink.h>
+#include <netlink/socket.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ethtool.h"
+#include "types.h"
+#include "utils.h"
+
+struct ifreq *allocInterfaceRequest(const char *ifname) {
+    struct ifreq *ifr;
+
+    ifr = (struct ifreq *)malloc(sizeof(struct ifreq));
+    if (!ifr) {
+        return NULL;
+    }
+    strncpy(ifr->ifr_name, ifname, sizeof(ifr->ifr_name) - 1);
+
+    return ifr;
+}
+
+static inline void freeInterfaceRequest(struct ifreq *ifr) { free(ifr); }
+
+struct ifreq *allocRingSizeRequest(const char *ifname) {
+    struct ifreq *ifr;
+    struct ethtool_ringparam *ering;
+
+    ifr = allocInterfaceRequest(ifname);
+    if (!ifr)
+        return NULL;
+
+    ering =
+        (struct ethtool_ringparam *)malloc(sizeof(struct ethtool_ringparam));
+    if (!ering) {
+        freeInterfaceRequest(ifr);
+        return NULL;
+    }
+    ifr->ifr_data = (char *)ering;
+
+    return ifr;
+}
+
+void freeRingSizeRequest(struct ifreq *ifr) {
+    free(ifr->ifr_data);
+    freeInterfaceRequest(ifr);
+}
+
+int readRingSize(int sock, struct ifreq *ifr, if_ring_size_t *stats) {
+    struct ethtool_ringparam *ering = (struct ethtool_ringparam *)ifr->ifr_data;
+
+    ering->cmd = ETHTOOL_GRINGPARAM;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GRINGPARAM failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+
+    stats->rx = ering->rx_pending;
+    stats->tx = ering->tx_pending;
+    return RET_OK;
+}
+
+int writeRingSize(int sock, struct ifreq *ifr, const if_ring_size_t *size) {
+    struct ethtool_ringparam *ering = (struct ethtool_ringparam *)ifr->ifr_data;
+
+    /* Read the current parameters first so that the mini and jumbo rings are
+     * written back unchanged */
+    ering->cmd = ETHTOOL_GRINGPARAM;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("ETHTOOL_GRINGPARAM failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+
+    if (ering->rx_pending == (__u32)size->rx &&
+        ering->tx_pending == (__u32)size->tx)
+        return RET_OK;
+
+    ering->cmd = ETHTOOL_SRINGPARAM;
+    ering->rx_pending = size->rx;
+    ering->tx_pending = size->tx;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("ETHTOOL_SRINGPARAM (rx %d tx %d) failed: %s\n", size->rx,
+                  size->tx, strerror(errno));
+        return RET_FAIL;
+    }
+
+    return RET_OK;
+}
+
+struct ifreq *allocGetCoalesceRequest(const char *ifname) {
+    struct ifreq *ifr;
+    struct ethtool_coalesce *ecoalesce;
+
+    ifr = allocInterfaceRequest(ifname);
+    if (!ifr)
+        return NULL;
+
+    ecoalesce =
+        (struct ethtool_coalesce *)malloc(sizeof(struct ethtool_coalesce));
+    if (!ecoalesce) {
+        freeInterfaceRequest(ifr);
+        return NULL;
+    }
+    ecoalesce->cmd = ETHTOOL_GCOALESCE;
+    ifr->ifr_data = (char *)ecoalesce;
+
+    return ifr;
+}
+
+void freeGetCoalesceRequest(struct ifreq *ifr) {
+    free(ifr->ifr_data);
+    freeInterfaceRequest(ifr);
+}
+
+int readCoalesce(int sock, struct ifreq *ifr, if_coalesce_t *stats) {
+    struct ethtool_coalesce *ecoalesce =
+        (struct ethtool_coalesce *)ifr->ifr_data;
+
+    /* the request is shared with writeCoalesce */
+    ecoalesce->cmd = ETHTOOL_GCOALESCE;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GCOALESCE failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+
+    stats->rx_coalesce_usecs = ecoalesce->rx_coalesce_usecs;
+    stats->rx_max_coalesced_frames = ecoalesce->rx_max_coalesced_frames;
+    stats->tx_coalesce_usecs = ecoalesce->tx_coalesce_usecs;
+    stats->tx_max_coalesced_frames = ecoalesce->tx_max_coalesced_frames;
+
+    return RET_OK;
+}
+
+int writeCoalesce(int sock, struct ifreq *ifr, const if_coalesce_t *settings) {
+    struct ethtool_coalesce *ecoalesce =
+        (struct ethtool_coalesce *)ifr->ifr_data;
+
+    /* Only the four fields we tune are changed, everything else (adaptive
+     * coalescing, irq variants, ...) is written back as the driver has it */
+    ecoalesce->cmd = ETHTOOL_GCOALESCE;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("ETHTOOL_GCOALESCE failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+
+    if (ecoalesce->rx_coalesce_usecs == (__u32)settings->rx_coalesce_usecs &&
+        ecoalesce->rx_max_coalesced_frames ==
+            (__u32)settings->rx_max_coalesced_frames &&
+        ecoalesce->tx_coalesce_usecs == (__u32)settings->tx_coalesce_usecs &&
+        ecoalesce->tx_max_coalesced_frames ==
+            (__u32)settings->tx_max_coalesced_frames)
+        return RET_OK;
+
+    ecoalesce->cmd = ETHTOOL_SCOALESCE;
+    ecoalesce->rx_coalesce_usecs = settings->rx_coalesce_usecs;
+    ecoalesce->rx_max_coalesced_frames = settings->rx_max_coalesced_frames;
+    ecoalesce->tx_coalesce_usecs = settings->tx_coalesce_usecs;
+    ecoalesce->tx_max_coalesced_frames = settings->tx_max_coalesced_frames;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("ETHTOOL_SCOALESCE failed: %s\n", strerror(errno));
+        ecoalesce->cmd = ETHTOOL_GCOALESCE;
+        return RET_FAIL;
+    }
+
+    ecoalesce->cmd = ETHTOOL_GCOALESCE;
+    return RET_OK;
+}
+
+struct ifreq *allocGetOffloadsRequest(const char *ifname) {
+    struct ifreq *ifr;
+    struct ethtool_value *evalue;
+
+    ifr = allocInterfaceRequest(ifname);
+    if (!ifr)
+        return NULL;
+
+    evalue = (struct ethtool_value *)malloc(sizeof(struct ethtool_value));
+    if (!evalue) {
+        freeInterfaceRequest(ifr);
+        return NULL;
+    }
+    ifr->ifr_data = (char *)evalue;
+
+    return ifr;
+}
+
+void freeGetOffloadsRequest(struct ifreq *ifr) {
+    free(ifr->ifr_data);
+    freeInterfaceRequest(ifr);
+}
+
+int readOffloads(int sock, struct ifreq *ifr, if_offloads_t *stats) {
+    struct ethtool_value *evalue = (struct ethtool_value *)ifr->ifr_data;
+
+    evalue->cmd = ETHTOOL_GRXCSUM;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GRXCSUM failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->rx_chksum_offload = !!evalue->data;
+
+    evalue->cmd = ETHTOOL_GTXCSUM;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GTXCSUM failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->tx_chksum_offload = !!evalue->data;
+
+    evalue->cmd = ETHTOOL_GGSO;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GGSO failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->general_segmentation_offload = !!evalue->data;
+
+    evalue->cmd = ETHTOOL_GTSO;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GTSO failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->tcp_segmentation_offload = !!evalue->data;
+
+    evalue->cmd = ETHTOOL_GGRO;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GGRO failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->general_receive_offload = !!evalue->data;
+
+    evalue->cmd = ETHTOOL_GFLAGS;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        printf("ETHTOOL_GFLAGS failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+    stats->large_receive_offload = ETH_FLAG_LRO & evalue->data;
+    stats->rx_vlan_offload = ETH_FLAG_RXVLAN & evalue->data;
+    stats->tx_vlan_offload = ETH_FLAG_TXVLAN & evalue->data;
+    stats->rx_hash = ETH_FLAG_RXHASH & evalue->data;
+
+    return RET_OK;
+}
+
+static inline int setOffload(int sock, struct ifreq *ifr, __u32 cmd,
+                             const char *name, bool enabled) {
+    struct ethtool_value *evalue = (struct ethtool_value *)ifr->ifr_data;
+
+    evalue->cmd = cmd;
+    evalue->data = enabled;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("%s (%s) failed: %s\n", name, onOrOff(enabled),
+                  strerror(errno));
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+static inline __u32 setFlag(__u32 flags, __u32 flag, bool enabled) {
+    return enabled ? flags | flag : flags & ~flag;
+}
+
+/* Sets field unless current, when not NULL, has the same value */
+#define SET_OFFLOAD(current, settings, cmd, field, ret)                        \
+    do {                                                                       \
+        if (((current) == NULL || (current)->field != (settings)->field) &&    \
+            setOffload(sock, ifr, cmd, #cmd, (settings)->field) == RET_FAIL)   \
+            ret = RET_FAIL;                                                    \
+    } while (0)
+
+int writeOffloads(int sock, struct ifreq *ifr, const if_offloads_t *settings) {
+    struct ethtool_value *evalue = (struct ethtool_value *)ifr->ifr_data;
+    if_offloads_t read, *current = &read;
+    int ret = RET_OK;
+
+    /* Drivers reject changes to the offloads they fix, even to the value
+     * they have: only those which differ are set. A failure does not stop
+     * the remaining ones, so that it does not hide the rest */
+    if (readOffloads(sock, ifr, &read) != RET_OK)
+        current = NULL;
+    SET_OFFLOAD(current, settings, ETHTOOL_SRXCSUM, rx_chksum_offload, ret);
+    SET_OFFLOAD(current, settings, ETHTOOL_STXCSUM, tx_chksum_offload, ret);
+    SET_OFFLOAD(current, settings, ETHTOOL_SGSO, general_segmentation_offload,
+                ret);
+    SET_OFFLOAD(current, settings, ETHTOOL_STSO, tcp_segmentation_offload,
+                ret);
+    SET_OFFLOAD(current, settings, ETHTOOL_SGRO, general_receive_offload,
+                ret);
+
+    evalue->cmd = ETHTOOL_GFLAGS;
+    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+        write_log("ETHTOOL_GFLAGS failed: %s\n", strerror(errno));
+        return RET_FAIL;
+    }
+
+    __u32 flags = evalue->data;
+    flags = setFlag(flags, ETH_FLAG_LRO, settings->large_receive_offload);
+    flags = setFlag(flags, ETH_FLAG_RXVLAN, settings->rx_vlan_offload);
+    flags = setFlag(flags, ETH_FLAG_TXVLAN, settings->tx_vlan_offload);
+    flags = setFlag(flags, ETH_FLAG_RXHASH, settings->rx_hash);
+
+    if (flags != evalue->data) {
+        evalue->cmd = ETHTOOL_SFLAGS;
+        evalue->data = flags;
+        if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
+            write_log("ETHTOOL_SFLAGS (0x%x) failed: %s\n", flags,
+                      strerror(errno));
+            ret = RET_FAIL;
+        }
+    }
+
+    return ret;
+}
+
+/*
+ * ethtool netlink backend: one request per group of settings instead of one
+ * ioctl per setting. The generic netlink family is resolved by hand with
+ * CTRL_CMD_GETFAMILY so that only the libnl core library is needed. Built
+ * without the kernel headers defining it, the ioctls are used alone.
+ */
+struct ethtool_s {
+    char ifname[IFNAMSIZ];
+    /* NULL when the kernel, or the build, has no ethtool netlink interface */
+    struct nl_sock *nl;
+    int family;
+    int sock;
+    struct ifreq *ringSizeRequest;
+    struct ifreq *coalesceRequest;
+    struct ifreq *offloadsRequest;
+};
+
+#ifdef HAVE_ETHTOOL_NETLINK
+/* The legacy offloads are groups of netdev features */
+typedef struct ethtool_feature_s {
+    const char *name;
+    size_t offset;
+} ethtool_feature_t;
+
+#define OFFLOAD(field) offsetof(if_offloads_t, field)
+
+static const ethtool_feature_t FEATURES[] = {
+    {"rx-checksum", OFFLOAD(rx_chksum_offload)},
+    {"tx-checksum-ipv4", OFFLOAD(tx_chksum_offload)},
+    {"tx-checksum-ip-generic", OFFLOAD(tx_chksum_offload)},
+    {"tx-checksum-ipv6", OFFLOAD(tx_chksum_offload)},
+    {"tx-generic-segmentation", OFFLOAD(general_segmentation_offload)},
+    {"tx-tcp-segmentation", OFFLOAD(tcp_segmentation_offload)},
+    {"tx-tcp6-segmentation", OFFLOAD(tcp_segmentation_offload)},
+    {"rx-gro", OFFLOAD(general_receive_offload)},
+    {"rx-lro", OFFLOAD(large_receive_offload)},
+    {"rx-vlan-hw-parse", OFFLOAD(rx_vlan_offload)},
+    {"tx-vlan-hw-insert", OFFLOAD(tx_vlan_offload)},
+    {"rx-hashing", OFFLOAD(rx_hash)},
+};
+
+#define FEATURES_COUNT (sizeof(FEATURES) / sizeof(FEATURES[0]))
+
+static inline bool *offloadField(if_offloads_t *offloads, size_t offset) {
+    return (bool *)((char *)offloads + offset);
+}
+
+static struct nl_msg *genlRequest(int family, uint8_t cmd, int flags) {
+    struct genlmsghdr header = {.cmd = cmd, .version = ETHTOOL_GENL_VERSION};
+    struct nl_msg *msg;
+
+    if ((msg = nlmsg_alloc_simple(family, NLM_F_REQUEST | flags)) == NULL)
+        return NULL;
+
+    if (nlmsg_append(msg, &header, sizeof(header), NLMSG_ALIGNTO) < 0) {
+        nlmsg_free(msg);
+        return NULL;
+    }
+    return msg;
+}
+
+static int parseFamilyId(struct nl_msg *msg, void *arg) {
+    struct nlattr *tb[CTRL_ATTR_MAX + 1];
+
+    if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, CTRL_ATTR_MAX, NULL) < 0)
+        return NL_SKIP;
+    if (tb[CTRL_ATTR_FAMILY_ID])
+        *(int *)arg = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+
+    return NL_OK;
+}
+
+static int ignoreReply(struct nl_msg *msg __attribute__((unused)),
+                       void *arg __attribute__((unused))) {
+    return NL_OK;
+}
+
+/* Sends msg, which is freed, and hands the reply over to parser */
+static int ethnlQuery(struct nl_sock *nl, struct nl_msg *msg,
+                      nl_recvmsg_msg_cb_t parser, void *arg) {
+    int err;
+
+    nl_socket_modify_cb(nl, NL_CB_VALID, NL_CB_CUSTOM, parser, arg);
+    err = nl_send_auto(nl, msg);
+    nlmsg_free(msg);
+    if (err >= 0)
+        err = nl_recvmsgs_default(nl);
+    nl_socket_modify_cb(nl, NL_CB_VALID, NL_CB_CUSTOM, ignoreReply, NULL);
+
+    return err < 0 ? err : 0;
+}
+
+static int resolveEthtoolFamily(struct nl_sock *nl) {
+    struct nl_msg *msg;
+    int family = -1;
+
+    if ((msg = genlRequest(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 0)) == NULL)
+        return -1;
+    if (nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, ETHTOOL_GENL_NAME) < 0) {
+        nlmsg_free(msg);
+        return -1;
+    }
+    if (ethnlQuery(nl, msg, parseFamilyId, &family) < 0)
+        return -1;
+
+    return family;
+}
+
+static struct nl_msg *ethnlRequest(ethtool_t *e, uint8_t cmd, int headerAttr,
+                                   uint32_t headerFlags, int flags) {
+    struct nl_msg *msg;
+    struct nlattr *header;
+
+    if ((msg = genlRequest(e->family, cmd, flags)) == NULL)
+        return NULL;
+
+    if ((header = nla_nest_start(msg, headerAttr | NLA_F_NESTED)) == NULL ||
+        nla_put_string(msg, ETHTOOL_A_HEADER_DEV_NAME, e->ifname) < 0 ||
+        (headerFlags &&
+         nla_put_u32(msg, ETHTOOL_A_HEADER_FLAGS, headerFlags) < 0)) {
+        nlmsg_free(msg);
+        return NULL;
+    }
+    nla_nest_end(msg, header);
+
+    return msg;
+}
+#endif
+
+ethtool_t *ethtoolOpen(const char *ifname) {
+    ethtool_t *e = calloc(1, sizeof(ethtool_t));
+
+    if (e == NULL)
+        return NULL;
+
+    snprintf(e->ifname, sizeof(e->ifname), "%s", ifname);
+    e->sock = -1;
+
+#ifdef HAVE_ETHTOOL_NETLINK
+    if ((e->nl = nl_socket_alloc()) != NULL) {
+        /* acks are only requested, and waited for, by the writes */
+        nl_socket_disable_auto_ack(e->nl);
+        if (nl_connect(e->nl, NETLINK_GENERIC) == 0 &&
+            (e->family = resolveEthtoolFamily(e->nl)) >= 0)
+            return e;
+    }
+
+    write_adv_log("ethtool netlink is not available: using ioctls\n");
+    if (e->nl != NULL) {
+        nl_socket_free(e->nl);
+        e->nl = NULL;
+    }
+#endif
+
+    e->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    e->ringSizeRequest = allocRingSizeRequest(ifname);
+    e->coalesceRequest = allocGetCoalesceRequest(ifname);
+    e->offloadsRequest = allocGetOffloadsRequest(ifname);
+    if (e->sock < 0 || !e->ringSizeRequest || !e->coalesceRequest ||
+        !e->offloadsRequest) {
+        ethtoolClose(e);
+        return NULL;
+    }
+
+    return e;
+}
+
+void ethtoolClose(ethtool_t *e) {
+    if (e == NULL)
+        return;
+
+    if (e->nl != NULL)
+        nl_socket_free(e->nl);
+    if (e->sock >= 0)
+        close(e->sock);
+    if (e->ringSizeRequest)
+        freeRingSizeRequest(e->ringSizeRequest);
+    if (e->coalesceRequest)
+        freeGetCoalesceRequest(e->coalesceRequest);
+    if (e->offloadsRequest)
+        freeGetOffloadsRequest(e->offloadsRequest);
+    free(e);
+}
+
+bool ethtoolUsesNetlink(const ethtool_t *e) { return e->nl != NULL; }
+
+#ifdef HAVE_ETHTOOL_NETLINK
+static int parseRingSize(struct nl_msg *msg, void *arg) {
+    struct nlattr *tb[ETHTOOL_A_RINGS_MAX + 1];
+    if_ring_size_t *size = arg;
+
+    if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, ETHTOOL_A_RINGS_MAX,
+                    NULL) < 0)
+        return NL_SKIP;
+    if (tb[ETHTOOL_A_RINGS_RX])
+        size->rx = nla_get_u32(tb[ETHTOOL_A_RINGS_RX]);
+    if (tb[ETHTOOL_A_RINGS_TX])
+        size->tx = nla_get_u32(tb[ETHTOOL_A_RINGS_TX]);
+
+    return NL_OK;
+}
+
+static int parseCoalesce(struct nl_msg *msg, void *arg) {
+    struct nlattr *tb[ETHTOOL_A_COALESCE_MAX + 1];
+    if_coalesce_t *c = arg;
+
+    if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, ETHTOOL_A_COALESCE_MAX,
+                    NULL) < 0)
+        return NL_SKIP;
+    if (tb[ETHTOOL_A_COALESCE_RX_USECS])
+        c->rx_coalesce_usecs = nla_get_u32(tb[ETHTOOL_A_COALESCE_RX_USECS]);
+    if (tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES])
+        c->rx_max_coalesced_frames =
+            nla_get_u32(tb[ETHTOOL_A_COALESCE_RX_MAX_FRAMES]);
+    if (tb[ETHTOOL_A_COALESCE_TX_USECS])
+        c->tx_coalesce_usecs = nla_get_u32(tb[ETHTOOL_A_COALESCE_TX_USECS]);
+    if (tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES])
+        c->tx_max_coalesced_frames =
+            nla_get_u32(tb[ETHTOOL_A_COALESCE_TX_MAX_FRAMES]);
+
+    return NL_OK;
+}
+
+/* Marks the offloads whose features are listed as set in a verbose bitset */
+static void parseFeatureBitset(struct nlattr *bitset, if_offloads_t *offloads) {
+    struct nlattr *tb[ETHTOOL_A_BITSET_MAX + 1];
+    struct nlattr *bit;
+    int remaining;
+
+    if (nla_parse_nested(tb, ETHTOOL_A_BITSET_MAX, bitset, NULL) < 0 ||
+        !tb[ETHTOOL_A_BITSET_BITS])
+        return;
+
+    /* Without a mask only the bits which are set are listed */
+    bool listedAreSet = tb[ETHTOOL_A_BITSET_NOMASK] != NULL;
+
+    nla_for_each_nested(bit, tb[ETHTOOL_A_BITSET_BITS], remaining) {
+        struct nlattr *tbBit[ETHTOOL_A_BITSET_BIT_MAX + 1];
+
+        if (nla_parse_nested(tbBit, ETHTOOL_A_BITSET_BIT_MAX, bit, NULL) < 0 ||
+            !tbBit[ETHTOOL_A_BITSET_BIT_NAME])
+            continue;
+        if (!listedAreSet && !tbBit[ETHTOOL_A_BITSET_BIT_VALUE])
+            continue;
+
+        const char *name = nla_get_string(tbBit[ETHTOOL_A_BITSET_BIT_NAME]);
+        for (unsigned int i = 0; i < FEATURES_COUNT; i++)
+            if (strcmp(name, FEATURES[i].name) == 0)
+                *offloadField(offloads, FEATURES[i].offset) = true;
+    }
+}
+
+static int parseFeatures(struct nl_msg *msg, void *arg) {
+    struct nlattr *tb[ETHTOOL_A_FEATURES_MAX + 1];
+    if_offloads_t *offloads = arg;
+
+    if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, ETHTOOL_A_FEATURES_MAX,
+                    NULL) < 0)
+        return NL_SKIP;
+
+    memset(offloads, 0, sizeof(if_offloads_t));
+    if (tb[ETHTOOL_A_FEATURES_ACTIVE])
+        parseFeatureBitset(tb[ETHTOOL_A_FEATURES_ACTIVE], offloads);
+
+    return NL_OK;
+}
+
+static int ethnlGet(ethtool_t *e, uint8_t cmd, int headerAttr,
+                    nl_recvmsg_msg_cb_t parser, void *arg) {
+    struct nl_msg *msg;
+    int err;
+
+    if ((msg = ethnlRequest(e, cmd, headerAttr, 0, 0)) == NULL)
+        return RET_FAIL;
+
+    if ((err = ethnlQuery(e->nl, msg, parser, arg)) < 0) {
+        write_adv_log("ethtool netlink command %d on %s failed: %s\n", cmd,
+                      e->ifname, nl_geterror(err));
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+#endif
+
+int ethtoolReadRingSize(ethtool_t *e, if_ring_size_t *size) {
+#ifdef HAVE_ETHTOOL_NETLINK
+    if (e->nl != NULL)
+        return ethnlGet(e, ETHTOOL_MSG_RINGS_GET, ETHTOOL_A_RINGS_HEADER,
+                        parseRingSize, size);
+#endif
+    return readRingSize(e->sock, e->ringSizeRequest, size);
+}
+
+int ethtoolReadCoalesce(ethtool_t *e, if_coalesce_t *settings) {
+#ifdef HAVE_ETHTOOL_NETLINK
+    if (e->nl != NULL)
+        return ethnlGet(e, ETHTOOL_MSG_COALESCE_GET,
+                        ETHTOOL_A_COALESCE_HEADER, parseCoalesce, settings);
+#endif
+    return readCoalesce(e->sock, e->coalesceRequest, settings);
+}
+
+int ethtoolReadOffloads(ethtool_t *e, if_offloads_t *settings) {
+#ifdef HAVE_ETHTOOL_NETLINK
+    if (e->nl != NULL)
+        return ethnlGet(e, ETHTOOL_MSG_FEATURES_GET,
+                        ETHTOOL_A_FEATURES_HEADER, parseFeatures, settings);
+#endif
+    return readOffloads(e->sock, e->offloadsRequest, settings);
+}
+
+static unsigned int ioctlWrite(ethtool_t *e, const if_ring_size_t *size,
+                               const if_coalesce_t *coalesce,
+                               const if_offloads_t *offloads) {
+    unsigned int failed = 0;
+
+    if (coalesce &&
+        writeCoalesce(e->sock, e->coalesceRequest, coalesce) != RET_OK)
+        failed |= ETHTOOL_COALESCE;
+    if (offloads &&
+        writeOffloads(e->sock, e->offloadsRequest, offloads) != RET_OK)
+        failed |= ETHTOOL_OFFLOADS;
+    if (size && writeRingSize(e->sock, e->ringSizeRequest, size) != RET_OK)
+        failed |= ETHTOOL_RING_SIZE;
+
+    return failed;
+}
+
+#ifdef HAVE_ETHTOOL_NETLINK
+static struct nl_msg *ringSizeMessage(ethtool_t *e,
+                                      const if_ring_size_t *size) {
+    struct nl_msg *msg = ethnlRequest(e, ETHTOOL_MSG_RINGS_SET,
+                                      ETHTOOL_A_RINGS_HEADER, 0, NLM_F_ACK);
+
+    if (msg == NULL)
+        return NULL;
+    if (nla_put_u32(msg, ETHTOOL_A_RINGS_RX, size->rx) < 0 ||
+        nla_put_u32(msg, ETHTOOL_A_RINGS_TX, size->tx) < 0) {
+        nlmsg_free(msg);
+        return NULL;
+    }
+    return msg;
+}
+
+static struct nl_msg *coalesceMessage(ethtool_t *e, const if_coalesce_t *c) {
+    struct nl_msg *msg = ethnlRequest(e, ETHTOOL_MSG_COALESCE_SET,
+                                      ETHTOOL_A_COALESCE_HEADER, 0, NLM_F_ACK);
+
+    if (msg == NULL)
+        return NULL;
+    if (nla_put_u32(msg, ETHTOOL_A_COALESCE_RX_USECS, c->rx_coalesce_usecs) <
+            0 ||
+        nla_put_u32(msg, ETHTOOL_A_COALESCE_RX_MAX_FRAMES,
+                    c->rx_max_coalesced_frames) < 0 ||
+        nla_put_u32(msg, ETHTOOL_A_COALESCE_TX_USECS, c->tx_coalesce_usecs) <
+            0 ||
+        nla_put_u32(msg, ETHTOOL_A_COALESCE_TX_MAX_FRAMES,
+                    c->tx_max_coalesced_frames) < 0) {
+        nlmsg_free(msg);
+        return NULL;
+    }
+    return msg;
+}
+
+/* Features not supported by the device are ignored by the kernel */
+static struct nl_msg *offloadsMessage(ethtool_t *e,
+                                      const if_offloads_t *offloads) {
+    struct nl_msg *msg =
+        ethnlRequest(e, ETHTOOL_MSG_FEATURES_SET, ETHTOOL_A_FEATURES_HEADER,
+                     ETHTOOL_FLAG_OMIT_REPLY, NLM_F_ACK);
+    struct nlattr *wanted, *bits, *bit;
+
+    if (msg == NULL)
+        return NULL;
+
+    if ((wanted = nla_nest_start(msg, ETHTOOL_A_FEATURES_WANTED |
+                                          NLA_F_NESTED)) == NULL ||
+        (bits = nla_nest_start(msg, ETHTOOL_A_BITSET_BITS | NLA_F_NESTED)) ==
+            NULL)
+        goto fail;
+
+    for (unsigned int i = 0; i < FEATURES_COUNT; i++) {
+        bool enabled = *offloadField((if_offloads_t *)offloads,
+                                     FEATURES[i].offset);
+
+        if ((bit = nla_nest_start(msg, ETHTOOL_A_BITSET_BITS_BIT |
+                                           NLA_F_NESTED)) == NULL ||
+            nla_put_string(msg, ETHTOOL_A_BITSET_BIT_NAME, FEATURES[i].name) <
+                0 ||
+            (enabled && nla_put_flag(msg, ETHTOOL_A_BITSET_BIT_VALUE) < 0))
+            goto fail;
+        nla_nest_end(msg, bit);
+    }
+    nla_nest_end(msg, bits);
+    nla_nest_end(msg, wanted);
+
+    return msg;
+
+fail:
+    nlmsg_free(msg);
+    return NULL;
+}
+
+static unsigned int netlinkWrite(ethtool_t *e, const if_ring_size_t *size,
+                                 const if_coalesce_t *coalesce,
+                                 const if_offloads_t *offloads) {
+    unsigned int parts[3], sent = 0, failed = 0;
+    struct nl_msg *msg;
+
+    /* Same order as the ioctls: the kernel skips settings which are already
+     * in place, so an unchanged ring size does not reset the link */
+    const struct {
+        unsigned int part;
+        struct nl_msg *msg;
+    } requests[] = {
+        {ETHTOOL_COALESCE, coalesce ? coalesceMessage(e, coalesce) : NULL},
+        {ETHTOOL_OFFLOADS, offloads ? offloadsMessage(e, offloads) : NULL},
+        {ETHTOOL_RING_SIZE, size ? ringSizeMessage(e, size) : NULL},
+    };
+    const bool wanted[] = {coalesce != NULL, offloads != NULL, size != NULL};
+
+    /* Send all the messages first, then collect their acks in order */
+    for (unsigned int i = 0; i < 3; i++) {
+        if (!wanted[i])
+            continue;
+        if ((msg = requests[i].msg) == NULL || nl_send_auto(e->nl, msg) < 0)
+            failed |= requests[i].part;
+        else
+            parts[sent++] = requests[i].part;
+        if (msg != NULL)
+            nlmsg_free(msg);
+    }
+
+    for (unsigned int i = 0; i < sent; i++) {
+        int err = nl_wait_for_ack(e->nl);
+        if (err < 0) {
+            write_log("ethtool netlink write on %s failed: %s\n", e->ifname,
+                      nl_geterror(err));
+            failed |= parts[i];
+        }
+    }
+
+    return failed;
+}
+#endif
+
+unsigned int ethtoolWrite(ethtool_t *e, const if_ring_size_t *size,
+                          const if_coalesce_t *coalesce,
+                          const if_offloads_t *offloads) {
+#ifdef HAVE_ETHTOOL_NETLINK
+    if (e->nl != NULL)
+        return netlinkWrite(e, size, coalesce, offloads);
+#endif
+    return ioctlWrite(e, size, coalesce, offloads);
+}
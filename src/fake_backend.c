@@ -0,0 +1,568 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "ethtool.h"
+#include "io.h"
+#include "utils.h"
+
+#define FAKE_MAX_VALUES 128
+/* Big enough for a scripted /proc/interrupts */
+#define FAKE_MAX_VALUE_LENGTH 4096
+/* CPU time added to the counters by each scripted tick */
+#define FAKE_TICK_JIFFIES 1000
+/* The block device of the synthesized /proc/diskstats */
+#define FAKE_DISK "253 0 vda"
+
+typedef struct fake_tick_s {
+    if_stats_t delta;
+    double cpuBusy;
+    unsigned long diskIos;
+} fake_tick_t;
+
+/* sysctls and files share one table: their names can't collide */
+typedef struct fake_value_s {
+    char name[MAX_FILENAME_LENGTH];
+    char value[FAKE_MAX_VALUE_LENGTH];
+} fake_value_t;
+
+typedef struct fake_state_s {
+    pthread_mutex_t lock;
+
+    fake_tick_t *ticks;
+    unsigned int tickCount;
+    unsigned int linkCursor;
+    unsigned int cpuCursor;
+    unsigned int statCursor;
+    unsigned int diskCursor;
+    unsigned int linkReads;
+    if_stats_t link;
+    cpu_stats_t cpu;
+    cpu_stats_t stat;
+    disk_stats_t disk;
+
+    fake_value_t values[FAKE_MAX_VALUES];
+    unsigned int valueCount;
+
+    if_queues_t queues;
+    if_ring_size_t ringSize;
+    if_coalesce_t coalesce;
+    if_offloads_t offloads;
+
+    fake_applied_t *applied;
+    unsigned int appliedCount;
+    unsigned int appliedLength;
+    FILE *log;
+} fake_state_t;
+
+static fake_state_t _fake = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static fake_value_t *findValue(const char *name) {
+    for (unsigned int i = 0; i < _fake.valueCount; i++)
+        if (strcmp(_fake.values[i].name, name) == 0)
+            return &_fake.values[i];
+    return NULL;
+}
+
+/* Called with the lock held */
+static int setValue(const char *name, const char *value) {
+    fake_value_t *entry = findValue(name);
+
+    if (entry == NULL) {
+        if (_fake.valueCount == FAKE_MAX_VALUES) {
+            errno = ENOSPC;
+            return RET_FAIL;
+        }
+        entry = &_fake.values[_fake.valueCount++];
+        snprintf(entry->name, sizeof(entry->name), "%s", name);
+    }
+    snprintf(entry->value, sizeof(entry->value), "%s", value);
+    return RET_OK;
+}
+
+/* Called with the lock held */
+static void recordApplied(const char *name, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void recordApplied(const char *name, const char *format, ...) {
+    fake_applied_t *entry;
+    va_list args;
+
+    if (_fake.appliedCount == _fake.appliedLength) {
+        unsigned int length =
+            _fake.appliedLength ? _fake.appliedLength * 2 : 64;
+        fake_applied_t *applied =
+            realloc(_fake.applied, length * sizeof(fake_applied_t));
+        if (applied == NULL)
+            return;
+        _fake.applied = applied;
+        _fake.appliedLength = length;
+    }
+
+    entry = &_fake.applied[_fake.appliedCount++];
+    entry->tick = _fake.linkReads;
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    va_start(args, format);
+    vsnprintf(entry->value, sizeof(entry->value), format, args);
+    va_end(args);
+
+    if (_fake.log != NULL) {
+        fprintf(_fake.log, "%u %s %s\n", entry->tick, entry->name,
+                entry->value);
+        fflush(_fake.log);
+    }
+}
+
+/* Adds the CPU time of the tick at *cursor to stats; the lock is held */
+static void addCpuTick(cpu_stats_t *stats, unsigned int *cursor) {
+    if (_fake.tickCount > 0) {
+        unsigned int busy =
+            _fake.ticks[*cursor].cpuBusy * FAKE_TICK_JIFFIES / 100;
+
+        stats->nonIdleTotal += busy;
+        stats->idleTotal += FAKE_TICK_JIFFIES - busy;
+        *cursor = (*cursor + 1) % _fake.tickCount;
+    }
+}
+
+static int fakeReadCpuStats(cpu_stats_t *stats) {
+    pthread_mutex_lock(&_fake.lock);
+    addCpuTick(&_fake.cpu, &_fake.cpuCursor);
+    *stats = _fake.cpu;
+    pthread_mutex_unlock(&_fake.lock);
+
+    return RET_OK;
+}
+
+/* Adds the reads of the tick at the disk cursor, of 4 KiB in 0.1 ms each;
+ * the lock is held */
+static void addDiskTick() {
+    if (_fake.tickCount > 0) {
+        unsigned long ios = _fake.ticks[_fake.diskCursor].diskIos;
+
+        _fake.disk.reads += ios;
+        _fake.disk.read_sectors += ios * 8;
+        _fake.disk.read_ms += ios / 10;
+        _fake.disk.weighted_io_ms += ios / 10;
+        _fake.diskCursor = (_fake.diskCursor + 1) % _fake.tickCount;
+    }
+}
+
+static FILE *fakeOpenFile(const char *path) {
+    fake_value_t *entry;
+    FILE *fp = NULL;
+
+    pthread_mutex_lock(&_fake.lock);
+    if ((entry = findValue(path)) == NULL &&
+        strcmp(path, "/proc/stat") == 0) {
+        /* A single CPU, as busy as the ticks say */
+        addCpuTick(&_fake.stat, &_fake.statCursor);
+        if ((fp = tmpfile()) != NULL) {
+            fprintf(fp, "cpu  %u 0 0 %u 0 0 0 0 0 0\n",
+                    _fake.stat.nonIdleTotal, _fake.stat.idleTotal);
+            fprintf(fp, "cpu0 %u 0 0 %u 0 0 0 0 0 0\n",
+                    _fake.stat.nonIdleTotal, _fake.stat.idleTotal);
+            rewind(fp);
+        }
+    } else if (entry == NULL && strcmp(path, "/proc/diskstats") == 0) {
+        /* A single disk, reading as much as the ticks say */
+        addDiskTick();
+        if ((fp = tmpfile()) != NULL) {
+            fprintf(fp, FAKE_DISK " %lu 0 %lu %lu 0 0 0 0 0 %lu %lu\n",
+                    _fake.disk.reads, _fake.disk.read_sectors,
+                    _fake.disk.read_ms, _fake.disk.read_ms,
+                    _fake.disk.weighted_io_ms);
+            rewind(fp);
+        }
+    } else if (entry == NULL)
+        errno = ENOENT;
+    else if ((fp = tmpfile()) != NULL) {
+        fputs(entry->value, fp);
+        rewind(fp);
+    }
+    pthread_mutex_unlock(&_fake.lock);
+
+    return fp;
+}
+
+static int fakeWriteLine(const char *path, const char *value) {
+    int ret;
+
+    pthread_mutex_lock(&_fake.lock);
+    if ((ret = setValue(path, value)) == RET_OK)
+        recordApplied(path, "%s", value);
+    pthread_mutex_unlock(&_fake.lock);
+
+    return ret;
+}
+
+static int readValue(const char *name, char *value, size_t len) {
+    fake_value_t *entry;
+    int ret = RET_OK;
+
+    pthread_mutex_lock(&_fake.lock);
+    if ((entry = findValue(name)) != NULL)
+        snprintf(value, len, "%s", entry->value);
+    else {
+        errno = ENOENT;
+        ret = RET_FAIL;
+    }
+    pthread_mutex_unlock(&_fake.lock);
+
+    return ret;
+}
+
+static unsigned int fakeWriteSysctls(sysctl_write_t *batch,
+                                     unsigned int count) {
+    unsigned int failed = 0;
+
+    pthread_mutex_lock(&_fake.lock);
+    for (unsigned int i = 0; i < count; i++) {
+        batch[i].error = 0;
+        if (setValue(batch[i].name, batch[i].value) != RET_OK) {
+            batch[i].error = errno;
+            failed++;
+            continue;
+        }
+        recordApplied(batch[i].name, "%s", batch[i].value);
+    }
+    pthread_mutex_unlock(&_fake.lock);
+
+    return failed;
+}
+
+/* There is a single fake NIC: every interface name opens it */
+static void *fakeOpenInterface(const char *ifname) {
+    (void)ifname;
+    return &_fake;
+}
+
+static void fakeCloseInterface(void *iface) { (void)iface; }
+
+static int fakeReadLinkStats(void *iface, if_stats_t *stats) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    if (_fake.tickCount > 0) {
+        const if_stats_t *delta = &_fake.ticks[_fake.linkCursor].delta;
+
+        _fake.link.bytes_total += delta->bytes_total;
+        _fake.link.errors_total += delta->errors_total;
+        _fake.link.dropped_total += delta->dropped_total;
+        _fake.link.fifo_err_total += delta->fifo_err_total;
+        _fake.linkCursor = (_fake.linkCursor + 1) % _fake.tickCount;
+    }
+    _fake.linkReads++;
+    *stats = _fake.link;
+    pthread_mutex_unlock(&_fake.lock);
+
+    return RET_OK;
+}
+
+static int fakeReadQueues(void *iface, if_queues_t *queues) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    *queues = _fake.queues;
+    pthread_mutex_unlock(&_fake.lock);
+    return RET_OK;
+}
+
+static int fakeReadRingSize(void *iface, if_ring_size_t *size) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    *size = _fake.ringSize;
+    pthread_mutex_unlock(&_fake.lock);
+    return RET_OK;
+}
+
+static int fakeReadCoalesce(void *iface, if_coalesce_t *settings) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    *settings = _fake.coalesce;
+    pthread_mutex_unlock(&_fake.lock);
+    return RET_OK;
+}
+
+static int fakeReadOffloads(void *iface, if_offloads_t *settings) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    *settings = _fake.offloads;
+    pthread_mutex_unlock(&_fake.lock);
+    return RET_OK;
+}
+
+static unsigned int fakeWriteInterface(void *iface, const if_ring_size_t *size,
+                                       const if_coalesce_t *coalesce,
+                                       const if_offloads_t *offloads) {
+    (void)iface;
+
+    pthread_mutex_lock(&_fake.lock);
+    if (coalesce != NULL) {
+        _fake.coalesce = *coalesce;
+        recordApplied("coalesce", "%d %d %d %d", coalesce->rx_coalesce_usecs,
+                      coalesce->rx_max_coalesced_frames,
+                      coalesce->tx_coalesce_usecs,
+                      coalesce->tx_max_coalesced_frames);
+    }
+    if (offloads != NULL) {
+        const if_offloads_t *o = offloads;
+
+        _fake.offloads = *offloads;
+        recordApplied("offloads", "%d %d %d %d %d %d %d %d %d",
+                      o->rx_chksum_offload, o->tx_chksum_offload,
+                      o->general_segmentation_offload,
+                      o->tcp_segmentation_offload, o->general_receive_offload,
+                      o->large_receive_offload, o->rx_vlan_offload,
+                      o->tx_vlan_offload, o->rx_hash);
+    }
+    if (size != NULL) {
+        _fake.ringSize = *size;
+        recordApplied("ring", "%d %d", size->rx, size->tx);
+    }
+    pthread_mutex_unlock(&_fake.lock);
+
+    return 0;
+}
+
+static void fakeRelease() {}
+
+static const system_backend_t FAKE_BACKEND = {
+    .name = "fake",
+    .sandboxed = true,
+    .readCpuStats = fakeReadCpuStats,
+    .readLine = readValue,
+    .openFile = fakeOpenFile,
+    .writeLine = fakeWriteLine,
+    .readSysctl = readValue,
+    .writeSysctls = fakeWriteSysctls,
+    .openInterface = fakeOpenInterface,
+    .closeInterface = fakeCloseInterface,
+    .readLinkStats = fakeReadLinkStats,
+    .readQueues = fakeReadQueues,
+    .readRingSize = fakeReadRingSize,
+    .readCoalesce = fakeReadCoalesce,
+    .readOffloads = fakeReadOffloads,
+    .writeInterface = fakeWriteInterface,
+    .release = fakeRelease};
+
+const system_backend_t *fakeBackend() { return &FAKE_BACKEND; }
+
+void fakeBackendReset() {
+    pthread_mutex_lock(&_fake.lock);
+    free(_fake.ticks);
+    free(_fake.applied);
+    if (_fake.log != NULL)
+        fclose(_fake.log);
+
+    _fake.ticks = NULL;
+    _fake.tickCount = _fake.linkCursor = _fake.cpuCursor = 0;
+    _fake.statCursor = _fake.diskCursor = _fake.linkReads = 0;
+    memset(&_fake.link, 0, sizeof(if_stats_t));
+    memset(&_fake.cpu, 0, sizeof(cpu_stats_t));
+    memset(&_fake.stat, 0, sizeof(cpu_stats_t));
+    memset(&_fake.disk, 0, sizeof(disk_stats_t));
+    _fake.valueCount = 0;
+    _fake.queues = (if_queues_t){.rx = 1, .tx = 1};
+    memset(&_fake.ringSize, 0, sizeof(if_ring_size_t));
+    memset(&_fake.coalesce, 0, sizeof(if_coalesce_t));
+    memset(&_fake.offloads, 0, sizeof(if_offloads_t));
+    _fake.applied = NULL;
+    _fake.appliedCount = _fake.appliedLength = 0;
+    _fake.log = NULL;
+    pthread_mutex_unlock(&_fake.lock);
+}
+
+int fakeBackendAddTick(const if_stats_t *delta, double cpuBusy,
+                       unsigned long diskIos) {
+    fake_tick_t *ticks;
+
+    pthread_mutex_lock(&_fake.lock);
+    ticks = realloc(_fake.ticks, (_fake.tickCount + 1) * sizeof(fake_tick_t));
+    if (ticks == NULL) {
+        pthread_mutex_unlock(&_fake.lock);
+        return RET_FAIL;
+    }
+    _fake.ticks = ticks;
+    _fake.ticks[_fake.tickCount].delta = *delta;
+    _fake.ticks[_fake.tickCount].cpuBusy = cpuBusy;
+    _fake.ticks[_fake.tickCount].diskIos = diskIos;
+    _fake.tickCount++;
+    pthread_mutex_unlock(&_fake.lock);
+
+    return RET_OK;
+}
+
+int fakeBackendSetValue(const char *name, const char *value) {
+    int ret;
+
+    pthread_mutex_lock(&_fake.lock);
+    ret = setValue(name, value);
+    pthread_mutex_unlock(&_fake.lock);
+
+    return ret;
+}
+
+/* Turns the "\n" sequences of a scripted value into line breaks */
+static void unescapeValue(char *value) {
+    char *out = value;
+
+    for (char *in = value; *in != '\0'; in++) {
+        if (in[0] == '\\' && in[1] == 'n') {
+            *out++ = '\n';
+            in++;
+        } else
+            *out++ = *in;
+    }
+    *out = '\0';
+}
+
+static int parseScriptLine(const char *line) {
+    char keyword[16], name[MAX_FILENAME_LENGTH];
+    char value[FAKE_MAX_VALUE_LENGTH];
+    int consumed = 0;
+
+    if (sscanf(line, "%15s %n", keyword, &consumed) != 1)
+        return RET_OK;
+
+    if (strcmp(keyword, "tick") == 0) {
+        if_stats_t delta;
+        double cpuBusy = 0.0;
+        unsigned long diskIos = 0;
+
+        if (sscanf(line + consumed,
+                   "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %lf %lu",
+                   &delta.bytes_total, &delta.errors_total,
+                   &delta.dropped_total, &delta.fifo_err_total, &cpuBusy,
+                   &diskIos) < 4 ||
+            cpuBusy < 0.0 || cpuBusy > 100.0)
+            return RET_FAIL;
+        return fakeBackendAddTick(&delta, cpuBusy, diskIos);
+    }
+
+    if (strcmp(keyword, "sysctl") == 0 || strcmp(keyword, "file") == 0) {
+        int offset = 0;
+
+        if (sscanf(line + consumed, "%254s %n", name, &offset) != 1 ||
+            line[consumed + offset] == '\0')
+            return RET_FAIL;
+        snprintf(value, sizeof(value), "%s", line + consumed + offset);
+        value[strcspn(value, "\n")] = '\0';
+        unescapeValue(value);
+        return fakeBackendSetValue(name, value);
+    }
+
+    if (strcmp(keyword, "queues") == 0) {
+        if_queues_t queues = {0};
+
+        if (sscanf(line + consumed, "%u %u %31s", &queues.rx, &queues.tx,
+                   queues.device) < 2)
+            return RET_FAIL;
+        pthread_mutex_lock(&_fake.lock);
+        _fake.queues = queues;
+        pthread_mutex_unlock(&_fake.lock);
+        return RET_OK;
+    }
+
+    if (strcmp(keyword, "ring") == 0) {
+        if_ring_size_t size;
+
+        if (sscanf(line + consumed, "%d %d", &size.rx, &size.tx) != 2)
+            return RET_FAIL;
+        pthread_mutex_lock(&_fake.lock);
+        _fake.ringSize = size;
+        pthread_mutex_unlock(&_fake.lock);
+        return RET_OK;
+    }
+
+    if (strcmp(keyword, "coalesce") == 0) {
+        if_coalesce_t c;
+
+        if (sscanf(line + consumed, "%d %d %d %d", &c.rx_coalesce_usecs,
+                   &c.rx_max_coalesced_frames, &c.tx_coalesce_usecs,
+                   &c.tx_max_coalesced_frames) != 4)
+            return RET_FAIL;
+        pthread_mutex_lock(&_fake.lock);
+        _fake.coalesce = c;
+        pthread_mutex_unlock(&_fake.lock);
+        return RET_OK;
+    }
+
+    return RET_FAIL;
+}
+
+int fakeBackendLoadScript(const char *path) {
+    unsigned int lineNumber = 0;
+    char *line = NULL;
+    size_t len = 0;
+    int ret = RET_OK;
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return RET_FAIL;
+
+    while (getline(&line, &len, fp) != -1) {
+        lineNumber++;
+        if (line[0] == '#')
+            continue;
+        if (parseScriptLine(line) != RET_OK) {
+            write_log("%s:%u: invalid fake backend script line\n", path,
+                      lineNumber);
+            ret = RET_FAIL;
+            break;
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    return ret;
+}
+
+int fakeBackendSetLog(const char *path) {
+    FILE *fp;
+
+    if ((fp = fopen(path, "a")) == NULL)
+        return RET_FAIL;
+
+    pthread_mutex_lock(&_fake.lock);
+    if (_fake.log != NULL)
+        fclose(_fake.log);
+    _fake.log = fp;
+    pthread_mutex_unlock(&_fake.lock);
+
+    return RET_OK;
+}
+
+unsigned int fakeBackendAppliedCount() {
+    unsigned int count;
+
+    pthread_mutex_lock(&_fake.lock);
+    count = _fake.appliedCount;
+    pthread_mutex_unlock(&_fake.lock);
+
+    return count;
+}
+
+int fakeBackendApplied(unsigned int index, fake_applied_t *entry) {
+    int ret = RET_FAIL;
+
+    pthread_mutex_lock(&_fake.lock);
+    if (index < _fake.appliedCount) {
+        *entry = _fake.applied[index];
+        ret = RET_OK;
+    }
+    pthread_mutex_unlock(&_fake.lock);
+
+    return ret;
+}
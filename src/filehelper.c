@@ -25,11 +25,19 @@
 #include <json-c/json.h>
 
 #include "algorithmic.h"
+#include "backend.h"
+#include "bandit.h"
 #include "filehelper.h"
+#include "labels.h"
 #include "phoebe.h"
+#include "sketch.h"
 #include "types.h"
 #include "utils.h"
 
+static int writeHeaderColumns(FILE *fp, int labelled);
+static int writeRowColumns(FILE *fp, tuning_params_t *row,
+                           const label_t *label);
+
 int addDataFromFile(tuning_params_t *srcParams, all_values_t *destParams) {
     unsigned int pivot;
 
@@ -40,6 +48,10 @@ int addDataFromFile(tuning_params_t *srcParams, all_values_t *destParams) {
     _repositionElements(destParams, pivot);
 
     memcpy(&destParams->parameters[pivot], srcParams, sizeof(tuning_params_t));
+    if (destParams->labels != NULL)
+        destParams->labels[pivot] =
+            (label_t){.geo = NOT_SET, .business = NOT_SET,
+                      .optimize_for = NOT_SET};
 
     destParams->validValues++;
 
@@ -53,6 +65,7 @@ unsigned int saveTrainedDataToFile(all_values_t *values,
     char outputFileName[MAX_FILENAME_LENGTH];
     char file[MAX_FILENAME_LENGTH];
     unsigned int i;
+    int labelled = 0;
 
     memset(outputFileName, 0, MAX_FILENAME_LENGTH);
     memset(file, 0, MAX_FILENAME_LENGTH);
@@ -69,29 +82,87 @@ unsigned int saveTrainedDataToFile(all_values_t *values,
     if ((fp = fopen(outputFileName, "w")) == NULL)
         return -1;
 
-    writeHeader(fp);
+    /* Tables without labels are written as they were read */
+    for (i = 0; values->labels != NULL && i < values->validValues; i++)
+        if ((labelled = labelIsSet(&values->labels[i])))
+            break;
+
+    writeHeaderColumns(fp, labelled);
 
     unsigned long prevTransferRate = 0;
+    const label_t *prevLabel = NULL;
     unsigned int totalFileEntries = 0;
 
     /* 46 parameters */
     for (i = 0; i < values->validValues; i++) {
-        /* Do not write any potential duplicates to the final file */
-        if (values->parameters[i].transfer_rate == prevTransferRate)
+        /* Do not write any potential duplicates to the final file; rows of
+         * other partitions may share a transfer rate */
+        if (values->parameters[i].transfer_rate == prevTransferRate &&
+            (!labelled ||
+             (prevLabel != NULL &&
+              memcmp(&values->labels[i], prevLabel, sizeof(label_t)) == 0)))
             continue;
 
         ++totalFileEntries;
 
-        writeRow(fp, &values->parameters[i]);
+        writeRowColumns(fp, &values->parameters[i],
+                        labelled ? &values->labels[i] : NULL);
 
         prevTransferRate = values->parameters[i].transfer_rate;
+        if (labelled)
+            prevLabel = &values->labels[i];
     }
 
     fclose(fp);
     return totalFileEntries;
 }
 
-int writeHeader(FILE *fp) {
+int saveWeightsToJsonFile(const weights_reference_t *weights, double bias,
+                          char *path_with_filename) {
+    char outputFileName[MAX_FILENAME_LENGTH];
+    char file[MAX_FILENAME_LENGTH];
+    struct json_object *fragment, *weights_settings;
+    int ret;
+
+    memset(file, 0, MAX_FILENAME_LENGTH);
+    memcpy(file, path_with_filename, MAX_FILENAME_LENGTH - 1);
+
+    char *filename = basename(file);
+    char *directory = dirname(file);
+
+    snprintf(outputFileName, MAX_FILENAME_LENGTH, "%s/%s_%s", directory,
+             strtok(filename, "."), APPEND_TO_WEIGHTS_FILE_NAME);
+
+    weights_settings = json_object_new_object();
+    json_object_object_add(
+        weights_settings, "transfer_rate_weight",
+        json_object_new_double(weights->transfer_rate_weight));
+    json_object_object_add(weights_settings, "drop_rate_weight",
+                           json_object_new_double(weights->drop_rate_weight));
+    json_object_object_add(
+        weights_settings, "errors_rate_weight",
+        json_object_new_double(weights->errors_rate_weight));
+    json_object_object_add(
+        weights_settings, "fifo_errors_rate_weight",
+        json_object_new_double(weights->fifo_errors_rate_weight));
+
+    fragment = json_object_new_object();
+    json_object_object_add(fragment, "weights", weights_settings);
+    json_object_object_add(fragment, "bias", json_object_new_double(bias));
+
+    ret = json_object_to_file_ext(outputFileName, fragment,
+                                  JSON_C_TO_STRING_PRETTY);
+    json_object_put(fragment);
+
+    if (ret == -1)
+        return RET_FAIL;
+
+    write_log("Weights and bias written to %s\n", outputFileName);
+    return RET_OK;
+}
+
+/* The label columns follow the tuning parameters in labelled tables */
+static int writeHeaderColumns(FILE *fp, int labelled) {
     return fprintf(
         fp,
         "transfer_rate,drop_rate,errors_rate,fifo_errors_rate,"
@@ -112,10 +183,20 @@ int writeHeader(FILE *fp) {
         "rx_checksum_offload,tx_checksum_offload,"
         "general_segmentation_offload,tcp_segmentation_offload,"
         "general_receive_offload,large_receive_offload,"
-        "rx_vlan_offload,tx_vlan_offload,rx_hash\n");
+        "rx_vlan_offload,tx_vlan_offload,rx_hash,"
+        "rps_cpus,xps_cpus,rps_flow_cnt,irq_affinity%s\n",
+        labelled ? ",geography,business,behavior" : "");
 }
 
-int writeRow(FILE *fp, tuning_params_t *row) {
+int writeHeader(FILE *fp) { return writeHeaderColumns(fp, 0); }
+
+static int writeRowColumns(FILE *fp, tuning_params_t *row,
+                           const label_t *label) {
+    char labelColumns[MAX_LABEL_COLUMNS_LENGTH] = "";
+
+    if (label != NULL)
+        labelsToColumns(label, labelColumns, sizeof(labelColumns));
+
     return fprintf(
         fp,
         "%lu,%lu,%lu,%lu,%lf,%hu,%hu,%hu,%hu,%u,%hu,%hu,%u,"
@@ -123,7 +204,8 @@ int writeRow(FILE *fp, tuning_params_t *row) {
         "%u,%u,%u,%hu,%hu,%lu,%lu,%lu,%lu,%hu,%hu,%hu,%lu,"
         "%lu,%lu,%lu,%lu,%lu,"
         "%u,%hu,%hu,%hu,%u,%hu,%hu,%hu,%hu,"
-        "%hu,%hu,%hu,%hu,%hu,%hu,%hu,%hu,%hu\n",
+        "%hu,%hu,%hu,%hu,%hu,%hu,%hu,%hu,%hu,"
+        "%lu,%lu,%u,%lu%s\n",
         row->transfer_rate, row->drop_rate, row->errors_rate,
         row->fifo_errors_rate, row->cpu_usage_percentage, row->rx_ring_size,
         row->tx_ring_size, row->cores, row->governor, row->cpu_speed,
@@ -145,8 +227,30 @@ int writeRow(FILE *fp, tuning_params_t *row) {
         row->rx_checksum_offload, row->tx_checksum_offload,
         row->general_segmentation_offload, row->tcp_segmentation_offload,
         row->general_receive_offload, row->large_receive_offload,
-        row->rx_vlan_offload, row->tx_vlan_offload, row->rx_hash);
+        row->rx_vlan_offload, row->tx_vlan_offload, row->rx_hash, row->rps_cpus,
+        row->xps_cpus, row->rps_flow_cnt, row->irq_affinity, labelColumns);
 }
+
+int writeRow(FILE *fp, tuning_params_t *row) {
+    return writeRowColumns(fp, row, NULL);
+}
+
+/* A label missing from the settings or with an unknown name is not set */
+static unsigned short readLabel(struct json_object *name, unsigned int kind) {
+    const char *tmpString;
+    unsigned short value;
+
+    if (name == NULL)
+        return NOT_SET;
+
+    tmpString = json_object_get_string(name);
+    if ((value = labelFromName(kind, tmpString)) == NOT_SET &&
+        strcmp(tmpString, "NOT_SET") != 0)
+        write_log("Unknown label %s: leaving it NOT_SET\n", tmpString);
+
+    return value;
+}
+
 int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
                              label_t *labels, weights_reference_t *weights,
                              double *bias) {
@@ -168,6 +272,31 @@ int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
     struct json_object *inference_loop_period;
     struct json_object *plugins_path;
     struct json_object *rates_filename;
+    struct json_object *load_quantile;
+    struct json_object *load_window;
+    struct json_object *knn_neighbours;
+    struct json_object *knn_min_confidence;
+    struct json_object *interpolate;
+    struct json_object *max_extrapolation;
+    struct json_object *fit_ridge;
+    struct json_object *model_filename;
+    struct json_object *replay_filename;
+    struct json_object *stall_threshold;
+    struct json_object *memory_pressure_threshold;
+    struct json_object *disruptive_change_interval;
+    struct json_object *rollback_ticks;
+    struct json_object *rollback_threshold;
+    struct json_object *bandit_policy;
+    struct json_object *bandit_epsilon;
+    struct json_object *bandit_candidates;
+    struct json_object *cpu_busy_low;
+    struct json_object *cpu_busy_high;
+    struct json_object *io_table_filename;
+    struct json_object *vm_available_low;
+    struct json_object *vm_available_high;
+    struct json_object *system_backend;
+    struct json_object *fake_script;
+    struct json_object *fake_applied_log;
     struct json_object *geography;
     struct json_object *business;
     struct json_object *behavior;
@@ -184,7 +313,10 @@ int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
     buffer[read_size] = '\0';
     fclose(fp);
 
-    parsed_json = json_tokener_parse(buffer);
+    if ((parsed_json = json_tokener_parse(buffer)) == NULL) {
+        write_log("%s is not valid JSON.\n", settingsFileName);
+        return RET_FAIL;
+    }
 
     json_object_object_get_ex(parsed_json, "app_settings", &app_settings);
     json_object_object_get_ex(app_settings, "max_learning_values",
@@ -231,6 +363,227 @@ int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
                       settings->rates_filename);
     }
 
+    settings->load_quantile = 0.0;
+    if (json_object_object_get_ex(app_settings, "load_quantile",
+                                  &load_quantile))
+        settings->load_quantile = json_object_get_double(load_quantile);
+
+    settings->load_window = SKETCH_WINDOW_1M;
+    if (json_object_object_get_ex(app_settings, "load_window", &load_window)) {
+        int window =
+            sketchWindowFromString(json_object_get_string(load_window));
+        if (window < 0) {
+            write_log("The settings->load_window is invalid.\n");
+            json_object_put(parsed_json);
+            return RET_FAIL;
+        }
+        settings->load_window = window;
+    }
+
+    write_adv_log("settings->load_quantile: %f over %s\n",
+                  settings->load_quantile,
+                  sketchWindowName(settings->load_window));
+
+    settings->knn_neighbours = DEFAULT_KNN_NEIGHBOURS;
+    if (json_object_object_get_ex(app_settings, "knn_neighbours",
+                                  &knn_neighbours))
+        settings->knn_neighbours = json_object_get_int(knn_neighbours);
+
+    settings->knn_min_confidence = 0.0;
+    if (json_object_object_get_ex(app_settings, "knn_min_confidence",
+                                  &knn_min_confidence))
+        settings->knn_min_confidence =
+            json_object_get_double(knn_min_confidence);
+
+    write_adv_log("settings->knn_neighbours: %u, "
+                  "settings->knn_min_confidence: %f\n",
+                  settings->knn_neighbours, settings->knn_min_confidence);
+
+    settings->interpolate = false;
+    if (json_object_object_get_ex(app_settings, "interpolate", &interpolate))
+        settings->interpolate = json_object_get_boolean(interpolate);
+
+    settings->max_extrapolation = DEFAULT_MAX_EXTRAPOLATION;
+    if (json_object_object_get_ex(app_settings, "max_extrapolation",
+                                  &max_extrapolation))
+        settings->max_extrapolation = json_object_get_double(max_extrapolation);
+
+    write_adv_log("settings->interpolate: %s, "
+                  "settings->max_extrapolation: %f\n",
+                  settings->interpolate ? "true" : "false",
+                  settings->max_extrapolation);
+
+    settings->fit_ridge = 0.0;
+    if (json_object_object_get_ex(app_settings, "fit_ridge", &fit_ridge))
+        settings->fit_ridge = json_object_get_double(fit_ridge);
+
+    write_adv_log("settings->fit_ridge: %f\n", settings->fit_ridge);
+
+    settings->model_filename[0] = '\0';
+    if (json_object_object_get_ex(app_settings, "model_filename",
+                                  &model_filename)) {
+        assert(sizeof(settings->model_filename) >
+               (long unsigned int)json_object_get_string_len(model_filename));
+        memcpy(settings->model_filename, json_object_get_string(model_filename),
+               json_object_get_string_len(model_filename) + 1);
+    }
+
+    write_adv_log("settings->model_filename: %s\n", settings->model_filename);
+
+    settings->replay_filename[0] = '\0';
+    if (json_object_object_get_ex(app_settings, "replay_filename",
+                                  &replay_filename)) {
+        assert(sizeof(settings->replay_filename) >
+               (long unsigned int)json_object_get_string_len(replay_filename));
+        memcpy(settings->replay_filename,
+               json_object_get_string(replay_filename),
+               json_object_get_string_len(replay_filename) + 1);
+    }
+
+    write_adv_log("settings->replay_filename: %s\n",
+                  settings->replay_filename);
+
+    settings->stall_threshold = DEFAULT_STALL_THRESHOLD;
+    if (json_object_object_get_ex(app_settings, "stall_threshold",
+                                  &stall_threshold))
+        settings->stall_threshold = json_object_get_double(stall_threshold);
+
+    settings->memory_pressure_threshold = DEFAULT_STALL_THRESHOLD;
+    if (json_object_object_get_ex(app_settings, "memory_pressure_threshold",
+                                  &memory_pressure_threshold))
+        settings->memory_pressure_threshold =
+            json_object_get_double(memory_pressure_threshold);
+
+    write_adv_log("settings->stall_threshold: %f, "
+                  "settings->memory_pressure_threshold: %f\n",
+                  settings->stall_threshold,
+                  settings->memory_pressure_threshold);
+
+    settings->disruptive_change_interval = DEFAULT_DISRUPTIVE_CHANGE_INTERVAL;
+    if (json_object_object_get_ex(app_settings, "disruptive_change_interval",
+                                  &disruptive_change_interval))
+        settings->disruptive_change_interval =
+            json_object_get_int(disruptive_change_interval);
+
+    write_adv_log("settings->disruptive_change_interval: %u\n",
+                  settings->disruptive_change_interval);
+
+    settings->rollback_ticks = DEFAULT_ROLLBACK_TICKS;
+    if (json_object_object_get_ex(app_settings, "rollback_ticks",
+                                  &rollback_ticks))
+        settings->rollback_ticks = json_object_get_int(rollback_ticks);
+
+    settings->rollback_threshold = DEFAULT_ROLLBACK_THRESHOLD;
+    if (json_object_object_get_ex(app_settings, "rollback_threshold",
+                                  &rollback_threshold))
+        settings->rollback_threshold =
+            json_object_get_double(rollback_threshold);
+
+    write_adv_log("settings->rollback_ticks: %u, "
+                  "settings->rollback_threshold: %f\n",
+                  settings->rollback_ticks, settings->rollback_threshold);
+
+    settings->bandit_policy = BANDIT_OFF;
+    if (json_object_object_get_ex(app_settings, "bandit_policy",
+                                  &bandit_policy)) {
+        int policy =
+            banditPolicyFromString(json_object_get_string(bandit_policy));
+        if (policy < 0) {
+            write_log("The settings->bandit_policy is invalid.\n");
+            json_object_put(parsed_json);
+            return RET_FAIL;
+        }
+        settings->bandit_policy = policy;
+    }
+
+    settings->bandit_epsilon = DEFAULT_BANDIT_EPSILON;
+    if (json_object_object_get_ex(app_settings, "bandit_epsilon",
+                                  &bandit_epsilon))
+        settings->bandit_epsilon = json_object_get_double(bandit_epsilon);
+
+    settings->bandit_candidates = DEFAULT_BANDIT_CANDIDATES;
+    if (json_object_object_get_ex(app_settings, "bandit_candidates",
+                                  &bandit_candidates))
+        settings->bandit_candidates = json_object_get_int(bandit_candidates);
+
+    write_adv_log("settings->bandit_policy: %s, settings->bandit_epsilon: %f, "
+                  "settings->bandit_candidates: %u\n",
+                  banditPolicyName(settings->bandit_policy),
+                  settings->bandit_epsilon, settings->bandit_candidates);
+
+    settings->cpu_busy_low = DEFAULT_CPU_BUSY_LOW;
+    if (json_object_object_get_ex(app_settings, "cpu_busy_low", &cpu_busy_low))
+        settings->cpu_busy_low = json_object_get_double(cpu_busy_low);
+
+    settings->cpu_busy_high = DEFAULT_CPU_BUSY_HIGH;
+    if (json_object_object_get_ex(app_settings, "cpu_busy_high",
+                                  &cpu_busy_high))
+        settings->cpu_busy_high = json_object_get_double(cpu_busy_high);
+
+    write_adv_log("settings->cpu_busy_low: %f, settings->cpu_busy_high: %f\n",
+                  settings->cpu_busy_low, settings->cpu_busy_high);
+
+    settings->io_table_filename[0] = '\0';
+    if (json_object_object_get_ex(app_settings, "io_table_filename",
+                                  &io_table_filename)) {
+        assert(sizeof(settings->io_table_filename) >
+               (long unsigned int)json_object_get_string_len(
+                   io_table_filename));
+        memcpy(settings->io_table_filename,
+               json_object_get_string(io_table_filename),
+               json_object_get_string_len(io_table_filename) + 1);
+    }
+
+    write_adv_log("settings->io_table_filename: %s\n",
+                  settings->io_table_filename);
+
+    settings->vm_available_low = DEFAULT_VM_AVAILABLE_LOW;
+    if (json_object_object_get_ex(app_settings, "vm_available_low",
+                                  &vm_available_low))
+        settings->vm_available_low = json_object_get_double(vm_available_low);
+
+    settings->vm_available_high = DEFAULT_VM_AVAILABLE_HIGH;
+    if (json_object_object_get_ex(app_settings, "vm_available_high",
+                                  &vm_available_high))
+        settings->vm_available_high =
+            json_object_get_double(vm_available_high);
+
+    write_adv_log(
+        "settings->vm_available_low: %f, settings->vm_available_high: %f\n",
+        settings->vm_available_low, settings->vm_available_high);
+
+    settings->system_backend = SYSTEM_BACKEND_HOST;
+    if (json_object_object_get_ex(app_settings, "system_backend",
+                                  &system_backend)) {
+        int backend =
+            systemBackendFromString(json_object_get_string(system_backend));
+        if (backend < 0) {
+            write_log("The settings->system_backend is invalid.\n");
+            json_object_put(parsed_json);
+            return RET_FAIL;
+        }
+        settings->system_backend = backend;
+    }
+
+    if (json_object_object_get_ex(app_settings, "fake_script", &fake_script)) {
+        assert(sizeof(settings->fake_script) >
+               (long unsigned int)json_object_get_string_len(fake_script));
+        memcpy(settings->fake_script, json_object_get_string(fake_script),
+               json_object_get_string_len(fake_script) + 1);
+    }
+
+    if (json_object_object_get_ex(app_settings, "fake_applied_log",
+                                  &fake_applied_log)) {
+        assert(sizeof(settings->fake_applied_log) >
+               (long unsigned int)json_object_get_string_len(fake_applied_log));
+        memcpy(settings->fake_applied_log,
+               json_object_get_string(fake_applied_log),
+               json_object_get_string_len(fake_applied_log) + 1);
+    }
+
+    write_adv_log("settings->system_backend: %s\n",
+                  systemBackendName(settings->system_backend));
+
     write_adv_log("settings->max_learning_values: %d\n",
                   settings->max_learning_values);
     if (settings->saving_loop < 1000) {
@@ -252,46 +605,23 @@ int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
     write_adv_log("settings->approx_function: %d\n", settings->approx_function);
     write_adv_log("settings->grace_period: %d\n", settings->grace_period);
 
+    geography = business = behavior = NULL;
     json_object_object_get_ex(parsed_json, "labels", &labels_settings);
     json_object_object_get_ex(labels_settings, "geography", &geography);
     json_object_object_get_ex(labels_settings, "business", &business);
     json_object_object_get_ex(labels_settings, "behavior", &behavior);
 
-    const char *tmpString = json_object_get_string(geography);
-    if (strncmp(tmpString, "NOT_SET", strlen("NOT_SET")))
-        labels->geo = NOT_SET;
-    else if (strncmp(tmpString, "EMEA", strlen("EMEA")))
-        labels->geo = EMEA;
-    else if (strncmp(tmpString, "NA", strlen("NA")))
-        labels->geo = NA;
-    else if (strncmp(tmpString, "LAT", strlen("LAT")))
-        labels->geo = LAT;
-    else if (strncmp(tmpString, "APAC", strlen("APAC")))
-        labels->geo = APAC;
-
-    write_adv_log("labels->geography: %s --> %u\n", tmpString, labels->geo);
-
-    tmpString = json_object_get_string(business);
-    if (strncmp(tmpString, "NOT_SET", strlen("NOT_SET")))
-        labels->business = NOT_SET;
-    else if (strncmp(tmpString, "RETAIL", strlen("RETAIL")))
-        labels->business = RETAIL;
-    else if (strncmp(tmpString, "AUTOMOTIVE", strlen("AUTOMOTIVE")))
-        labels->geo = AUTOMOTIVE;
-    else if (strncmp(tmpString, "SERVICE", strlen("SERVICE")))
-        labels->geo = SERVICE;
-
-    write_adv_log("labels->business: %s --> %u\n", tmpString, labels->business);
-
-    tmpString = json_object_get_string(behavior);
-    if (strncmp(tmpString, "THROUGHPUT", strlen("THROUGHPUT")))
-        labels->business = THROUGHPUT;
-    else if (strncmp(tmpString, "LATENCY", strlen("LATENCY")))
-        labels->geo = LATENCY;
-    else if (strncmp(tmpString, "POWER", strlen("POWER")))
-        labels->geo = POWER;
-
-    write_adv_log("labels->behavior: %s --> %u\n", tmpString,
+    labels->geo = readLabel(geography, LABEL_GEOGRAPHY);
+    labels->business = readLabel(business, LABEL_BUSINESS);
+    labels->optimize_for = readLabel(behavior, LABEL_BEHAVIOR);
+
+    write_adv_log("labels->geography: %s --> %u\n",
+                  labelName(LABEL_GEOGRAPHY, labels->geo), labels->geo);
+    write_adv_log("labels->business: %s --> %u\n",
+                  labelName(LABEL_BUSINESS, labels->business),
+                  labels->business);
+    write_adv_log("labels->behavior: %s --> %u\n",
+                  labelName(LABEL_BEHAVIOR, labels->optimize_for),
                   labels->optimize_for);
 
     json_object_object_get_ex(parsed_json, "weights", &weights_settings);
@@ -333,6 +663,22 @@ int readSettingsFromJsonFile(char *settingsFileName, app_settings_t *settings,
         return RET_FAIL;
     }
 
+    if (settings->stall_threshold <= 0.0 ||
+        settings->memory_pressure_threshold <= 0.0) {
+        write_log("The pressure thresholds must be bigger than 0.\n");
+        return RET_FAIL;
+    }
+
+    if (settings->load_quantile < 0.0 || settings->load_quantile > 1.0) {
+        write_log("The settings->load_quantile must be between 0 and 1.\n");
+        return RET_FAIL;
+    }
+
+    if (settings->rollback_threshold < 0.0) {
+        write_log("The settings->rollback_threshold must not be negative.\n");
+        return RET_FAIL;
+    }
+
     return RET_OK;
 }
 
@@ -364,11 +710,19 @@ int allocateMemoryBasedOnInputAndMaxLearningValues(
     reference_values->parameters =
         calloc(reference_values->totalLength, sizeof(tuning_params_t));
 
-    if (reference_values->parameters == NULL) {
+    reference_values->labels =
+        calloc(reference_values->totalLength, sizeof(label_t));
+
+    if (reference_values->parameters == NULL ||
+        reference_values->labels == NULL) {
         perror(strerror(errno));
         exit(EXIT_FAILURE);
     }
 
+    for (unsigned int i = 0; i < reference_values->totalLength; i++)
+        reference_values->labels[i] = (label_t){
+            .geo = NOT_SET, .business = NOT_SET, .optimize_for = NOT_SET};
+
     return lineno;
 }
 
@@ -379,6 +733,7 @@ inline void loadValuesFromUnordedFile(char *line, all_values_t *allValues) {
     if (line == NULL)
         return;
 
+    memset(&param, 0, sizeof(tuning_params_t));
     valueCount = sscanf(
         line,
         "%lu, %lu, %lu, %lu, %lf, %hu, %hu, %hu, %hu, %u, %hu, %hu, %u, "
@@ -386,7 +741,8 @@ inline void loadValuesFromUnordedFile(char *line, all_values_t *allValues) {
         "%u, %u, %u, %hu, %hu, %lu, %lu, %lu, %lu, %hu, %hu, %hu, %lu, "
         "%lu, %lu, %lu, %lu, %lu, "
         "%u, %hu, %hu, %hu, %u, %hu, %hu, %hu, %hu, %hu, %hu, %hu, %hu, "
-        "%hu, %hu, %hu, %hu, %hu",
+        "%hu, %hu, %hu, %hu, %hu, "
+        "%lu, %lu, %u, %lu",
         &param.transfer_rate, &param.drop_rate, &param.errors_rate,
         &param.fifo_errors_rate, &param.cpu_usage_percentage,
         &param.rx_ring_size, &param.tx_ring_size, &param.cores, &param.governor,
@@ -410,10 +766,14 @@ inline void loadValuesFromUnordedFile(char *line, all_values_t *allValues) {
         &param.tx_checksum_offload, &param.general_segmentation_offload,
         &param.tcp_segmentation_offload, &param.general_receive_offload,
         &param.large_receive_offload, &param.rx_vlan_offload,
-        &param.tx_vlan_offload, &param.rx_hash);
-    if (valueCount != NUM_TUNING_PARAMS) {
-        fprintf(stderr, "Expecting %d values but only got %d in line \"%s\"",
-                NUM_TUNING_PARAMS, valueCount, line);
+        &param.tx_vlan_offload, &param.rx_hash, &param.rps_cpus,
+        &param.xps_cpus, &param.rps_flow_cnt, &param.irq_affinity);
+    /* Tables written before the steering knobs leave them at 0, untuned */
+    if (valueCount != NUM_TUNING_PARAMS &&
+        valueCount != NUM_LEGACY_TUNING_PARAMS) {
+        fprintf(stderr,
+                "Expecting %d or %d values but only got %d in line \"%s\"",
+                NUM_TUNING_PARAMS, NUM_LEGACY_TUNING_PARAMS, valueCount, line);
         exit(RET_FAIL);
     }
 
@@ -422,12 +782,26 @@ inline void loadValuesFromUnordedFile(char *line, all_values_t *allValues) {
     return;
 }
 
-inline void loadValues(char *line, long lineno, all_values_t *allValues) {
-    int valueCount = 0;
+/* The label columns, if any, follow the values of the row */
+static void loadLabels(const char *line, int valueCount, label_t *label) {
+    int columns = 1;
 
-    if (line == NULL)
-        return;
+    for (; *line != '\0' && columns <= valueCount; line++)
+        if (*line == ',')
+            columns++;
 
+    labelsFromColumns(columns > valueCount ? line : "", label);
+}
+
+static inline bool rowComplete(int valueCount) {
+    return valueCount == NUM_TUNING_PARAMS ||
+           valueCount == NUM_LEGACY_TUNING_PARAMS;
+}
+
+int parseValues(char *line, long lineno, all_values_t *allValues) {
+    int valueCount = 0;
+
+    memset(&allValues->parameters[lineno], 0, sizeof(tuning_params_t));
     valueCount = sscanf(
         line,
         "%lu, %lu, %lu, %lu, %lf, %hu, %hu, %hu, %hu, %u, %hu, %hu, %u, "
@@ -435,7 +809,8 @@ inline void loadValues(char *line, long lineno, all_values_t *allValues) {
         "%u, %u, %u, %hu, %hu, %lu, %lu, %lu, %lu, %hu, %hu, %hu, %lu, "
         "%lu, %lu, %lu, %lu, %lu, "
         "%u, %hu, %hu, %hu, %u, %hu, %hu, %hu, %hu, %hu, %hu, %hu, %hu, "
-        "%hu, %hu, %hu, %hu, %hu",
+        "%hu, %hu, %hu, %hu, %hu, "
+        "%lu, %lu, %u, %lu",
         &allValues->parameters[lineno].transfer_rate,
         &allValues->parameters[lineno].drop_rate,
         &allValues->parameters[lineno].errors_rate,
@@ -488,17 +863,35 @@ inline void loadValues(char *line, long lineno, all_values_t *allValues) {
         &allValues->parameters[lineno].large_receive_offload,
         &allValues->parameters[lineno].rx_vlan_offload,
         &allValues->parameters[lineno].tx_vlan_offload,
-        &allValues->parameters[lineno].rx_hash);
-    if (valueCount != NUM_TUNING_PARAMS) {
-        fprintf(stderr,
-                "Expecting %d values but only got %d in line number %ld",
-                NUM_TUNING_PARAMS, valueCount, lineno);
-        exit(RET_FAIL);
-    }
+        &allValues->parameters[lineno].rx_hash,
+        &allValues->parameters[lineno].rps_cpus,
+        &allValues->parameters[lineno].xps_cpus,
+        &allValues->parameters[lineno].rps_flow_cnt,
+        &allValues->parameters[lineno].irq_affinity);
+    if (!rowComplete(valueCount))
+        return valueCount;
+
+    if (allValues->labels != NULL)
+        loadLabels(line, valueCount, &allValues->labels[lineno]);
 
     allValues->validValues++;
 
-    return;
+    return valueCount;
+}
+
+inline void loadValues(char *line, long lineno, all_values_t *allValues) {
+    int valueCount;
+
+    if (line == NULL)
+        return;
+
+    if (!rowComplete((valueCount = parseValues(line, lineno, allValues)))) {
+        fprintf(stderr,
+                "Expecting %d or %d values but only got %d in line number %ld",
+                NUM_TUNING_PARAMS, NUM_LEGACY_TUNING_PARAMS, valueCount,
+                lineno);
+        exit(RET_FAIL);
+    }
 }
 
 int loadFile(FILE *pFile, unsigned int fileRows,
@@ -540,3 +933,28 @@ int loadFile(FILE *pFile, unsigned int fileRows,
     // printTable(allValues);
     return RET_OK;
 }
+
+int loadFileChecked(FILE *pFile, all_values_t *reference_values) {
+    char sInputBuf[BUFFER_SIZE];
+    int valueCount;
+
+    // skip first spreadsheet row
+    if (pFile == NULL || fgets(sInputBuf, BUFFER_SIZE - 1, pFile) == NULL)
+        return RET_FAIL;
+
+    while (fgets(sInputBuf, BUFFER_SIZE - 1, pFile) != NULL) {
+        unsigned int row = reference_values->validValues;
+
+        if (row >= reference_values->totalLength)
+            return RET_FAIL;
+        if (!rowComplete((valueCount = parseValues(sInputBuf, row,
+                                                   reference_values)))) {
+            write_log("Expecting %d or %d values but only got %d in row %u\n",
+                      NUM_TUNING_PARAMS, NUM_LEGACY_TUNING_PARAMS, valueCount,
+                      row + 1);
+            return RET_FAIL;
+        }
+    }
+
+    return RET_OK;
+}
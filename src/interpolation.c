@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "interpolation.h"
+
+#define KNOB_LINEAR 0
+#define KNOB_LOG 1
+#define KNOB_NEAREST 2
+
+typedef struct knob_s {
+    size_t offset;
+    size_t size;
+    unsigned int scale;
+} knob_t;
+
+#define KNOB(field, scale)                                                     \
+    {                                                                          \
+        offsetof(tuning_params_t, field),                                      \
+            sizeof(((tuning_params_t *)0)->field), scale                       \
+    }
+
+/* Every integer field of tuning_params_t; the transfer rate is the key and
+ * the CPU usage, a double, is handled apart */
+static const knob_t KNOBS[] = {
+    KNOB(drop_rate, KNOB_LINEAR),
+    KNOB(errors_rate, KNOB_LINEAR),
+    KNOB(fifo_errors_rate, KNOB_LINEAR),
+    KNOB(rx_ring_size, KNOB_LOG),
+    KNOB(tx_ring_size, KNOB_LOG),
+    KNOB(cores, KNOB_NEAREST),
+    KNOB(governor, KNOB_NEAREST),
+    KNOB(cpu_speed, KNOB_LINEAR),
+    KNOB(io_scheduler, KNOB_NEAREST),
+    KNOB(task_scheduler, KNOB_NEAREST),
+    KNOB(kernel_sched_min_granularity_ns, KNOB_LINEAR),
+    KNOB(kernel_sched_wakeup_granularity_ns, KNOB_LINEAR),
+    KNOB(kernel_sched_migration_cost_ns, KNOB_LINEAR),
+    KNOB(kernel_numa_balancing, KNOB_NEAREST),
+    KNOB(kernel_pid_max, KNOB_LINEAR),
+    KNOB(net_core_netdev_max_backlog, KNOB_LOG),
+    KNOB(net_core_netdev_budget, KNOB_LINEAR),
+    KNOB(net_core_somaxconn, KNOB_LOG),
+    KNOB(net_core_busy_poll, KNOB_LINEAR),
+    KNOB(net_core_busy_read, KNOB_LINEAR),
+    KNOB(net_core_rmem_max, KNOB_LOG),
+    KNOB(net_core_wmem_max, KNOB_LOG),
+    KNOB(net_core_rmem_default, KNOB_LOG),
+    KNOB(net_core_wmem_default, KNOB_LOG),
+    KNOB(tcp_fastopen, KNOB_NEAREST),
+    KNOB(tcp_low_latency, KNOB_NEAREST),
+    KNOB(tcp_sack, KNOB_NEAREST),
+    KNOB(tcp_rmem0, KNOB_LOG),
+    KNOB(tcp_rmem1, KNOB_LOG),
+    KNOB(tcp_rmem2, KNOB_LOG),
+    KNOB(tcp_wmem0, KNOB_LOG),
+    KNOB(tcp_wmem1, KNOB_LOG),
+    KNOB(tcp_wmem2, KNOB_LOG),
+    KNOB(tcp_max_syn_backlog, KNOB_LOG),
+    KNOB(tcp_tw_reuse, KNOB_NEAREST),
+    KNOB(tcp_tw_recycle, KNOB_NEAREST),
+    KNOB(tcp_timestamps, KNOB_NEAREST),
+    KNOB(tcp_syn_retries, KNOB_NEAREST),
+    KNOB(rx_interrupt_coalesce_usecs, KNOB_LINEAR),
+    KNOB(rx_interrupt_max_coalesce_frames, KNOB_LINEAR),
+    KNOB(tx_interrupt_coalesce_usecs, KNOB_LINEAR),
+    KNOB(tx_interrupt_max_coalesce_frames, KNOB_LINEAR),
+    KNOB(rx_checksum_offload, KNOB_NEAREST),
+    KNOB(tx_checksum_offload, KNOB_NEAREST),
+    KNOB(general_segmentation_offload, KNOB_NEAREST),
+    KNOB(tcp_segmentation_offload, KNOB_NEAREST),
+    KNOB(general_receive_offload, KNOB_NEAREST),
+    KNOB(large_receive_offload, KNOB_NEAREST),
+    KNOB(rx_vlan_offload, KNOB_NEAREST),
+    KNOB(tx_vlan_offload, KNOB_NEAREST),
+    KNOB(rx_hash, KNOB_NEAREST),
+    KNOB(rps_cpus, KNOB_NEAREST),
+    KNOB(xps_cpus, KNOB_NEAREST),
+    KNOB(rps_flow_cnt, KNOB_LOG),
+    KNOB(irq_affinity, KNOB_NEAREST)};
+
+static double getKnob(const tuning_params_t *row, const knob_t *knob) {
+    const char *field = (const char *)row + knob->offset;
+
+    switch (knob->size) {
+    case sizeof(unsigned short):
+        return *(const unsigned short *)field;
+    case sizeof(unsigned int):
+        return *(const unsigned int *)field;
+    default:
+        return *(const unsigned long *)field;
+    }
+}
+
+static void setKnob(tuning_params_t *row, const knob_t *knob, double value) {
+    char *field = (char *)row + knob->offset;
+    double max = knob->size == sizeof(unsigned short) ? 65535.0
+                 : knob->size == sizeof(unsigned int) ? 4294967295.0
+                                                      : 1.8e19;
+
+    value = value < 0.0 ? 0.0 : (value > max ? max : round(value));
+    switch (knob->size) {
+    case sizeof(unsigned short):
+        *(unsigned short *)field = value;
+        break;
+    case sizeof(unsigned int):
+        *(unsigned int *)field = value;
+        break;
+    default:
+        *(unsigned long *)field = value;
+    }
+}
+
+static double blend(unsigned int scale, double a, double b, double t) {
+    if (scale == KNOB_NEAREST)
+        return t < 0.5 ? a : b;
+    /* A zero size can't be interpolated geometrically */
+    if (scale == KNOB_LOG && a > 0.0 && b > 0.0)
+        return exp(log(a) + t * (log(b) - log(a)));
+    return a + t * (b - a);
+}
+
+/* Index of the first row whose transfer rate is not below transferRate */
+static unsigned int lowerBound(const all_values_t *values,
+                               unsigned long transferRate) {
+    unsigned int l = 0, r = values->validValues;
+
+    while (l < r) {
+        unsigned int mid = l + (r - l) / 2;
+
+        if (values->parameters[mid].transfer_rate < transferRate)
+            l = mid + 1;
+        else
+            r = mid;
+    }
+    return l;
+}
+
+unsigned int findNearestTransferRate(const all_values_t *values,
+                                    unsigned long transferRate) {
+    const tuning_params_t *rows = values->parameters;
+    unsigned int upper = lowerBound(values, transferRate);
+
+    if (upper == values->validValues)
+        return upper > 0 ? upper - 1 : 0;
+    if (upper > 0 && transferRate - rows[upper - 1].transfer_rate <
+                         rows[upper].transfer_rate - transferRate)
+        return upper - 1;
+    return upper;
+}
+
+/*
+ * Finds the two rows to interpolate transferRate between, upper and the one
+ * before it, and how far between them it lies; RET_FAIL when the table is
+ * empty or transferRate is too far beyond it. A single row table has
+ * upper == 0.
+ */
+static int bracket(const all_values_t *values, unsigned long transferRate,
+                   double maxExtrapolation, unsigned int *upper, double *t) {
+    unsigned int count = values->validValues;
+    const tuning_params_t *a, *b;
+    double beyond = 0.0;
+
+    if (count == 0)
+        return RET_FAIL;
+
+    a = &values->parameters[0];
+    b = &values->parameters[count - 1];
+    if (transferRate < a->transfer_rate)
+        beyond = (double)(a->transfer_rate - transferRate) / a->transfer_rate;
+    else if (transferRate > b->transfer_rate && b->transfer_rate > 0)
+        beyond = (double)(transferRate - b->transfer_rate) / b->transfer_rate;
+    if (beyond * 100.0 > maxExtrapolation)
+        return RET_FAIL;
+
+    *upper = 0;
+    *t = 0.0;
+    if (count == 1)
+        return RET_OK;
+
+    /* Past either end, the two outermost rows are extrapolated from */
+    *upper = lowerBound(values, transferRate);
+    if (*upper == 0)
+        *upper = 1;
+    else if (*upper == count)
+        *upper = count - 1;
+    a = &values->parameters[*upper - 1];
+    b = &values->parameters[*upper];
+
+    if (b->transfer_rate > a->transfer_rate)
+        *t = ((double)transferRate - a->transfer_rate) /
+             ((double)b->transfer_rate - a->transfer_rate);
+    return RET_OK;
+}
+
+int interpolationRow(const all_values_t *values, unsigned long transferRate,
+                     double maxExtrapolation) {
+    unsigned int upper;
+    double t;
+
+    if (bracket(values, transferRate, maxExtrapolation, &upper, &t) ==
+        RET_FAIL)
+        return -1;
+    return upper == 0 || t >= 0.5 ? (int)upper : (int)(upper - 1);
+}
+
+int interpolateSettings(const all_values_t *values, unsigned long transferRate,
+                        double maxExtrapolation, tuning_params_t *settings) {
+    const tuning_params_t *a, *b;
+    unsigned int upper;
+    double t;
+
+    if (bracket(values, transferRate, maxExtrapolation, &upper, &t) ==
+        RET_FAIL)
+        return -1;
+
+    if (upper == 0) {
+        *settings = values->parameters[0];
+        settings->transfer_rate = transferRate;
+        return 0;
+    }
+
+    a = &values->parameters[upper - 1];
+    b = &values->parameters[upper];
+
+    *settings = t < 0.5 ? *a : *b;
+    settings->transfer_rate = transferRate;
+    settings->cpu_usage_percentage =
+        blend(KNOB_LINEAR, a->cpu_usage_percentage, b->cpu_usage_percentage, t);
+    for (unsigned int k = 0; k < sizeof(KNOBS) / sizeof(knob_t); k++)
+        setKnob(settings, &KNOBS[k],
+                blend(KNOBS[k].scale, getKnob(a, &KNOBS[k]),
+                      getKnob(b, &KNOBS[k]), t));
+
+    return t < 0.5 ? (int)(upper - 1) : (int)upper;
+}
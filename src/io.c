@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io.h"
+#include "utils.h"
+
+unsigned int ioParseDiskstats(FILE *fp, disk_stats_t *stats,
+                              unsigned int max) {
+    char line[MAX_PROC_STRING_LENGTH];
+    unsigned int count = 0;
+
+    while (count < max && fgets(line, sizeof(line), fp) != NULL) {
+        disk_stats_t *disk = &stats[count];
+
+        /* Kernels from 4.18 on add discard and flush counters after these */
+        if (sscanf(line,
+                   "%*u %*u %31s %lu %*u %lu %lu %lu %*u %lu %lu %lu %lu %lu",
+                   disk->name, &disk->reads, &disk->read_sectors,
+                   &disk->read_ms, &disk->writes, &disk->write_sectors,
+                   &disk->write_ms, &disk->in_flight, &disk->io_ms,
+                   &disk->weighted_io_ms) == 10)
+            count++;
+    }
+
+    return count;
+}
+
+static inline double delta(unsigned long prev, unsigned long cur) {
+    return cur >= prev ? (double)(cur - prev) : 0.0;
+}
+
+void ioRates(const disk_stats_t *prev, const disk_stats_t *cur, double period,
+             disk_rates_t *rates) {
+    double ios =
+        delta(prev->reads, cur->reads) + delta(prev->writes, cur->writes);
+    double sectors = delta(prev->read_sectors, cur->read_sectors) +
+                     delta(prev->write_sectors, cur->write_sectors);
+    double periodMs = period * 1000.0;
+
+    memset(rates, 0, sizeof(disk_rates_t));
+    if (period <= 0.0)
+        return;
+
+    rates->iops = ios / period;
+    rates->bytes_rate = sectors * DISKSTATS_SECTOR_SIZE / period;
+    rates->queue_depth =
+        delta(prev->weighted_io_ms, cur->weighted_io_ms) / periodMs;
+    if (ios > 0)
+        rates->latency_ms = (delta(prev->read_ms, cur->read_ms) +
+                             delta(prev->write_ms, cur->write_ms)) /
+                            ios;
+    rates->utilization = delta(prev->io_ms, cur->io_ms) * 100.0 / periodMs;
+    if (rates->utilization > 100.0)
+        rates->utilization = 100.0;
+}
+
+unsigned int ioParseSchedulers(const char *line, unsigned short *active) {
+    return parseSelection(line, ioSchedulerIndex, active);
+}
+
+void ioDefaultTable(io_table_t *table) {
+    static const io_params_t rows[] = {
+        {.iops = 0, .nr_requests = 64, .read_ahead_kb = 256, .rq_affinity = 1},
+        {.iops = 2000,
+         .nr_requests = 128,
+         .read_ahead_kb = 128,
+         .rq_affinity = 1},
+        {.iops = 20000,
+         .nr_requests = 256,
+         .read_ahead_kb = 128,
+         .rq_affinity = 2},
+        {.iops = 100000,
+         .nr_requests = 1023,
+         .read_ahead_kb = 64,
+         .rq_affinity = 2}};
+
+    table->count = sizeof(rows) / sizeof(rows[0]);
+    memcpy(table->rows, rows, sizeof(rows));
+    table->rows[0].scheduler = table->rows[1].scheduler =
+        ioSchedulerIndex("mq-deadline");
+    table->rows[2].scheduler = table->rows[3].scheduler =
+        ioSchedulerIndex("none");
+}
+
+static int compareIops(const void *a, const void *b) {
+    const io_params_t *x = a, *y = b;
+
+    return (x->iops > y->iops) - (x->iops < y->iops);
+}
+
+int ioLoadTable(const char *path, io_table_t *table) {
+    char line[MAX_PROC_STRING_LENGTH], scheduler[16];
+    io_params_t *row;
+    int index;
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL)
+        return RET_FAIL;
+
+    table->count = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        /* The header and empty lines */
+        if (!isdigit((unsigned char)line[0]))
+            continue;
+        if (table->count == MAX_IO_TABLE_ROWS) {
+            write_log("Only the first %d rows of %s are used\n",
+                      MAX_IO_TABLE_ROWS, path);
+            break;
+        }
+
+        row = &table->rows[table->count];
+        if (sscanf(line, "%lu,%15[^,],%u,%u,%hu", &row->iops, scheduler,
+                   &row->nr_requests, &row->read_ahead_kb,
+                   &row->rq_affinity) != 5 ||
+            (index = ioSchedulerIndex(scheduler)) == -1) {
+            write_log("Bad row in %s: %s", path, line);
+            fclose(fp);
+            return RET_FAIL;
+        }
+        row->scheduler = index;
+        table->count++;
+    }
+    fclose(fp);
+
+    qsort(table->rows, table->count, sizeof(io_params_t), compareIops);
+    return table->count > 0 ? RET_OK : RET_FAIL;
+}
+
+unsigned int ioNearestRow(const io_table_t *table, double iops) {
+    unsigned int upper = 0;
+
+    while (upper < table->count && table->rows[upper].iops < iops)
+        upper++;
+
+    if (upper == table->count)
+        return upper > 0 ? upper - 1 : 0;
+    if (upper > 0 &&
+        iops - table->rows[upper - 1].iops < table->rows[upper].iops - iops)
+        return upper - 1;
+    return upper;
+}
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "bus.h"
+#include "io.h"
+#include "plugins.h"
+#include "settings.h"
+#include "utils.h"
+
+typedef struct io_device_s {
+    char name[MAX_DISK_NAME_LENGTH];
+    /* The schedulers of its queue, by ioSchedulerIndex(); 0 if unknown */
+    unsigned int schedulers;
+    unsigned short scheduler;
+    /* The row of the table applied, -1 until one is */
+    int row;
+    unsigned long timePassedSinceLastChanges;
+    double peakIops;
+} io_device_t;
+
+static app_settings_t *_io_app_settings;
+/* The settings reloads publish, in inference, and those followed from them */
+static settings_store_t *_settingsStore;
+static settings_snapshot_t *_followed;
+static sample_bus_t *_bus;
+
+static io_table_t _table;
+static io_device_t _devices[MAX_BUS_DISKS];
+static unsigned int _deviceCount = 0;
+
+static unsigned long _changes = 0L;
+
+static io_device_t *findDevice(const char *name) {
+    char path[MAX_FILENAME_LENGTH], buffer[MAX_PROC_STRING_LENGTH];
+    io_device_t *device;
+
+    for (unsigned int i = 0; i < _deviceCount; i++)
+        if (strcmp(_devices[i].name, name) == 0)
+            return &_devices[i];
+    if (_deviceCount == MAX_BUS_DISKS)
+        return NULL;
+
+    device = &_devices[_deviceCount++];
+    memset(device, 0, sizeof(io_device_t));
+    snprintf(device->name, sizeof(device->name), "%s", name);
+    device->row = -1;
+
+    snprintf(path, sizeof(path), BLOCK_QUEUE_PATH "scheduler", name);
+    if (systemBackend()->readLine(path, buffer, sizeof(buffer)) == RET_OK)
+        device->schedulers = ioParseSchedulers(buffer, &device->scheduler);
+
+    return device;
+}
+
+static void writeQueue(const io_device_t *device, const char *file,
+                       const char *value) {
+    char path[MAX_FILENAME_LENGTH];
+
+    snprintf(path, sizeof(path), BLOCK_QUEUE_PATH "%s", device->name, file);
+    if (systemBackend()->writeLine(path, value) != RET_OK)
+        write_log("Could not set %s to %s: %s\n", path, value,
+                  strerror(errno));
+}
+
+/* The scheduler first, when it changes: that resets nr_requests */
+static void applyRow(io_device_t *device, const io_params_t *row) {
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+
+    write_log("\033[1;32m"); // Set the text to the color green
+    write_log("%s: scheduler %s, nr_requests %u, read_ahead_kb %u, "
+              "rq_affinity %hu for %lu IOPS\n",
+              device->name, ioSchedulerName(row->scheduler),
+              row->nr_requests, row->read_ahead_kb, row->rq_affinity,
+              row->iops);
+    write_log("\033[0m"); // Resets the text to default
+
+    if (writesEnabled()) {
+        if (device->schedulers & (1U << row->scheduler)) {
+            if (row->scheduler != device->scheduler)
+                writeQueue(device, "scheduler",
+                           ioSchedulerName(row->scheduler));
+            device->scheduler = row->scheduler;
+        } else
+            write_adv_log("%s has no %s scheduler\n", device->name,
+                          ioSchedulerName(row->scheduler));
+
+        snprintf(value, sizeof(value), "%u", row->nr_requests);
+        writeQueue(device, "nr_requests", value);
+        snprintf(value, sizeof(value), "%u", row->read_ahead_kb);
+        writeQueue(device, "read_ahead_kb", value);
+        snprintf(value, sizeof(value), "%hu", row->rq_affinity);
+        writeQueue(device, "rq_affinity", value);
+    }
+
+    _changes++;
+}
+
+/* Like decide() for the network table: a busier row is applied at once, a
+ * calmer one once the grace period passed since the last change */
+static void tuneDevice(io_device_t *device, const disk_rates_t *rates,
+                       unsigned long elapsed) {
+    unsigned long grace = _io_app_settings->grace_period * MINUTES_IN_USEC;
+    int row;
+
+    device->timePassedSinceLastChanges += elapsed;
+    if (rates->iops > device->peakIops)
+        device->peakIops = rates->iops;
+
+    write_verb_log("%s: %.0lf IOPS, %.0lf B/s, queue depth %.2lf, latency "
+                   "%.2lf ms, %.1lf%% busy\n",
+                   device->name, rates->iops, rates->bytes_rate,
+                   rates->queue_depth, rates->latency_ms, rates->utilization);
+
+    /* An idle device is left as it is */
+    if (rates->iops == 0)
+        return;
+
+    row = ioNearestRow(&_table, rates->iops);
+    if (row == device->row ||
+        (device->row != -1 && row < device->row &&
+         device->timePassedSinceLastChanges <= grace))
+        return;
+
+    applyRow(device, &_table.rows[row]);
+    device->row = row;
+    device->timePassedSinceLastChanges = 0;
+}
+
+/* Moves over to the settings a reload published; the table stays */
+static void followSettings() {
+    if (_settingsStore != NULL && settingsFollow(_settingsStore, &_followed))
+        _io_app_settings = &_followed->app;
+}
+
+void *ioRunInference(void *args __attribute__((unused))) {
+    unsigned long period;
+    static bus_sample_t sample;
+    uint64_t lastSequence = 0;
+    io_device_t *device;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    while (1) {
+        period = USEC_IN_SEC * _io_app_settings->inference_loop_period;
+
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        usleep(period);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        followSettings();
+
+        if (busLatest(_bus, BUS_METRIC_DISKS, &sample) == RET_FAIL ||
+            sample.sequence == lastSequence)
+            continue;
+        lastSequence = sample.sequence;
+
+        for (unsigned int i = 0; i < sample.disks.count; i++)
+            if ((device = findDevice(sample.disks.name[i])) != NULL)
+                tuneDevice(device, &sample.disks.rates[i], period);
+    }
+
+    return NULL;
+}
+
+/* The table is written by hand, or shipped: there is nothing to learn */
+void ioRunTraining(char *inputFileName __attribute__((unused))) {
+    write_log("The I/O plugin has no table to train.\n");
+}
+
+static inline void ioPrintReport() {
+    write_log("\033[0;34m"); // Set the text to the color blue
+    write_log("I/O tuned %lu times on %u devices\n", _changes, _deviceCount);
+    for (unsigned int i = 0; i < _deviceCount; i++)
+        if (_devices[i].row != -1)
+            write_log("%s: peak %.0lf IOPS, row of %lu IOPS\n",
+                      _devices[i].name, _devices[i].peakIops,
+                      _table.rows[_devices[i].row].iops);
+    write_log("\033[0m"); // Resets the text to default color
+}
+
+int ioInit(const plugin_context_t *context) {
+    _io_app_settings = context->settings;
+    _settingsStore = context->settingsStore;
+    _bus = context->bus;
+    set_verbosity(context->verbosity);
+
+    if (selectSystemBackend(context->settings, true) != RET_OK)
+        return RET_FAIL;
+
+    if (_io_app_settings->io_table_filename[0] == '\0')
+        ioDefaultTable(&_table);
+    else if (ioLoadTable(_io_app_settings->io_table_filename, &_table) !=
+             RET_OK) {
+        write_log("Could not load the I/O table %s\n",
+                  _io_app_settings->io_table_filename);
+        return RET_FAIL;
+    }
+    write_log("I/O table of %u rows\n", _table.count);
+
+    return RET_OK;
+}
+
+void ioDestroy() {
+    settingsRelease(_followed);
+    _followed = NULL;
+    systemBackend()->release();
+}
+
+plugin_v2_t meV2 = {.abi_version = PLUGIN_ABI_VERSION,
+                    .active = TRUE,
+                    .name = "IO_PLUGIN",
+                    .version = 0.1,
+                    .metrics = BUS_METRIC_MASK(BUS_METRIC_DISKS),
+                    .knobs = KNOB_IO,
+                    .init = ioInit,
+                    .destroy = ioDestroy,
+                    .inference = ioRunInference,
+                    .training = ioRunTraining,
+                    .livetraining = ioRunTraining,
+                    .print_report = ioPrintReport};
+
+plugin_v2_t *registerMeV2() {
+    write_log("Registering plugin %s ver. %g (ABI %u)\n", meV2.name,
+              meV2.version, meV2.abi_version);
+
+    return &meV2;
+}
@@ -0,0 +1,285 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knn.h"
+#include "utils.h"
+
+/* Below this many points a subtree is scanned rather than split */
+#define KNN_LEAF_SIZE 8
+/* Keeps the weight of a neighbour at distance 0 finite */
+#define KNN_EPSILON 1e-6
+
+typedef struct knn_heap_s {
+    unsigned int k;
+    unsigned int n;
+    /* Squared distances, nearest first */
+    double d2[KNN_MAX_NEIGHBOURS];
+    unsigned int row[KNN_MAX_NEIGHBOURS];
+} knn_heap_t;
+
+void knnRowLoad(const tuning_params_t *row, double load[KNN_DIMENSIONS]) {
+    load[KNN_TRANSFER_RATE] = row->transfer_rate;
+    load[KNN_DROP_RATE] = row->drop_rate;
+    load[KNN_ERRORS_RATE] = row->errors_rate;
+    load[KNN_FIFO_ERRORS_RATE] = row->fifo_errors_rate;
+    load[KNN_CPU_USAGE] = row->cpu_usage_percentage;
+}
+
+static inline double transform(unsigned int d, double value) {
+    if (value < 0.0)
+        value = 0.0;
+    return d == KNN_CPU_USAGE ? value : log1p(value);
+}
+
+static inline void normalize(const knn_index_t *index,
+                             const double load[KNN_DIMENSIONS],
+                             float x[KNN_DIMENSIONS]) {
+    for (unsigned int d = 0; d < KNN_DIMENSIONS; d++)
+        x[d] = (transform(d, load[d]) - index->min[d]) * index->scale[d];
+}
+
+static inline void swapPoints(knn_point_t *points, unsigned int a,
+                              unsigned int b) {
+    knn_point_t tmp = points[a];
+
+    points[a] = points[b];
+    points[b] = tmp;
+}
+
+/*
+ * Moves the nth point along axis in place, with the points equal to it in
+ * [*lt, *gt), those before smaller and those after larger; the three-way
+ * partition keeps columns full of equal values linear.
+ */
+static void selectNth(knn_point_t *points, unsigned int lo, unsigned int hi,
+                      unsigned int nth, unsigned int axis, unsigned int *lt,
+                      unsigned int *gt) {
+    for (;;) {
+        float pivot = points[lo + (hi - lo) / 2].x[axis];
+        unsigned int i = lo;
+
+        *lt = lo;
+        *gt = hi;
+        while (i < *gt) {
+            if (points[i].x[axis] < pivot)
+                swapPoints(points, (*lt)++, i++);
+            else if (points[i].x[axis] > pivot)
+                swapPoints(points, i, --(*gt));
+            else
+                i++;
+        }
+
+        if (nth < *lt)
+            hi = *lt;
+        else if (nth >= *gt)
+            lo = *gt;
+        else
+            return;
+    }
+}
+
+static unsigned int buildTree(knn_index_t *index, unsigned int lo,
+                              unsigned int hi) {
+    knn_point_t *points = index->points;
+    float min[KNN_DIMENSIONS], max[KNN_DIMENSIONS];
+    unsigned int mid = lo + (hi - lo) / 2, axis = 0, lt, gt, split;
+    knn_node_t *node;
+
+    if (hi - lo <= KNN_LEAF_SIZE)
+        return KNN_NO_NODE;
+
+    memcpy(min, points[lo].x, sizeof(min));
+    memcpy(max, points[lo].x, sizeof(max));
+    for (unsigned int i = lo + 1; i < hi; i++)
+        for (unsigned int d = 0; d < KNN_DIMENSIONS; d++) {
+            if (points[i].x[d] < min[d])
+                min[d] = points[i].x[d];
+            if (points[i].x[d] > max[d])
+                max[d] = points[i].x[d];
+        }
+    for (unsigned int d = 1; d < KNN_DIMENSIONS; d++)
+        if (max[d] - min[d] > max[axis] - min[axis])
+            axis = d;
+    /* Identical points can't be split */
+    if (max[axis] == min[axis])
+        return KNN_NO_NODE;
+
+    /* The points equal to the median go to the half that keeps the tree
+     * the most balanced */
+    selectNth(points, lo, hi, mid, axis, &lt, &gt);
+    split = mid - lt <= gt - 1 - mid ? lt : gt - 1;
+
+    node = &index->nodes[index->nodeCount];
+    node->point = split;
+    node->axis = axis;
+    node->leftMax = -INFINITY;
+    node->rightMin = INFINITY;
+    for (unsigned int i = lo; i < split; i++)
+        if (points[i].x[axis] > node->leftMax)
+            node->leftMax = points[i].x[axis];
+    for (unsigned int i = split + 1; i < hi; i++)
+        if (points[i].x[axis] < node->rightMin)
+            node->rightMin = points[i].x[axis];
+
+    index->nodeCount++;
+    node->left = buildTree(index, lo, split);
+    node->right = buildTree(index, split + 1, hi);
+    return node - index->nodes;
+}
+
+knn_index_t *knnBuild(const tuning_params_t *rows, unsigned int count) {
+    double load[KNN_DIMENSIONS], max[KNN_DIMENSIONS];
+    knn_index_t *index;
+
+    if (count == 0 || (index = calloc(1, sizeof(knn_index_t))) == NULL)
+        return NULL;
+    /* Every node takes one point out of its halves */
+    if ((index->points = malloc(count * sizeof(knn_point_t))) == NULL ||
+        (index->nodes = malloc(count * sizeof(knn_node_t))) == NULL) {
+        free(index->points);
+        free(index);
+        return NULL;
+    }
+    index->count = count;
+
+    for (unsigned int d = 0; d < KNN_DIMENSIONS; d++) {
+        index->min[d] = INFINITY;
+        max[d] = -INFINITY;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        knnRowLoad(&rows[i], load);
+        for (unsigned int d = 0; d < KNN_DIMENSIONS; d++) {
+            double value = transform(d, load[d]);
+
+            if (value < index->min[d])
+                index->min[d] = value;
+            if (value > max[d])
+                max[d] = value;
+        }
+    }
+    /* A dimension all the rows agree on can't tell them apart */
+    for (unsigned int d = 0; d < KNN_DIMENSIONS; d++)
+        index->scale[d] =
+            max[d] > index->min[d] ? 1.0 / (max[d] - index->min[d]) : 0.0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        knnRowLoad(&rows[i], load);
+        normalize(index, load, index->points[i].x);
+        index->points[i].row = i;
+    }
+    index->root = buildTree(index, 0, count);
+
+    return index;
+}
+
+void knnFree(knn_index_t *index) {
+    if (index == NULL)
+        return;
+    free(index->points);
+    free(index->nodes);
+    free(index);
+}
+
+static inline double worstDistance(const knn_heap_t *heap) {
+    return heap->n < heap->k ? INFINITY : heap->d2[heap->n - 1];
+}
+
+static inline void consider(knn_heap_t *heap, const knn_point_t *point,
+                            const float q[KNN_DIMENSIONS]) {
+    double d2 = 0.0;
+    unsigned int i;
+
+    for (unsigned int d = 0; d < KNN_DIMENSIONS; d++) {
+        double diff = q[d] - point->x[d];
+        d2 += diff * diff;
+    }
+    if (d2 >= worstDistance(heap))
+        return;
+
+    i = heap->n < heap->k ? heap->n++ : heap->n - 1;
+    for (; i > 0 && heap->d2[i - 1] > d2; i--) {
+        heap->d2[i] = heap->d2[i - 1];
+        heap->row[i] = heap->row[i - 1];
+    }
+    heap->d2[i] = d2;
+    heap->row[i] = point->row;
+}
+
+/*
+ * Visits the nearer half first. A half is only searched when the cell it
+ * covers is nearer than the worst neighbour so far; off holds the distance
+ * from q to the current cell along each axis and rd its squared norm, so
+ * that the test accounts for every split on the way down.
+ */
+static void search(const knn_index_t *index, unsigned int node,
+                   unsigned int lo, unsigned int hi,
+                   const float q[KNN_DIMENSIONS], knn_heap_t *heap, double rd,
+                   double off[KNN_DIMENSIONS]) {
+    const knn_node_t *n;
+    double leftGap, rightGap, oldOff, gap[2], halfRd;
+    unsigned int first;
+
+    if (node == KNN_NO_NODE) {
+        for (unsigned int i = lo; i < hi; i++)
+            consider(heap, &index->points[i], q);
+        return;
+    }
+
+    n = &index->nodes[node];
+    consider(heap, &index->points[n->point], q);
+
+    leftGap = q[n->axis] - n->leftMax;
+    rightGap = n->rightMin - q[n->axis];
+    gap[0] = leftGap > 0 ? leftGap : 0;
+    gap[1] = rightGap > 0 ? rightGap : 0;
+    first = gap[0] <= gap[1] ? 0 : 1;
+
+    oldOff = off[n->axis];
+    for (unsigned int h = 0; h < 2; h++) {
+        unsigned int half = h == 0 ? first : 1 - first;
+
+        if (gap[half] < oldOff)
+            gap[half] = oldOff;
+        halfRd = rd - oldOff * oldOff + gap[half] * gap[half];
+        if (halfRd >= worstDistance(heap))
+            continue;
+
+        off[n->axis] = gap[half];
+        if (half == 0)
+            search(index, n->left, lo, n->point, q, heap, halfRd, off);
+        else
+            search(index, n->right, n->point + 1, hi, q, heap, halfRd, off);
+    }
+    off[n->axis] = oldOff;
+}
+
+int knnQuery(const knn_index_t *index, const double load[KNN_DIMENSIONS],
+             unsigned int k, knn_match_t *match) {
+    double off[KNN_DIMENSIONS] = {0};
+    float q[KNN_DIMENSIONS];
+    knn_heap_t heap;
+    double total = 0.0;
+
+    if (index == NULL || index->count == 0)
+        return RET_FAIL;
+
+    heap.n = 0;
+    heap.k = k == 0 ? 1 : (k > KNN_MAX_NEIGHBOURS ? KNN_MAX_NEIGHBOURS : k);
+    if (heap.k > index->count)
+        heap.k = index->count;
+
+    normalize(index, load, q);
+    search(index, index->root, 0, index->count, q, &heap, 0.0, off);
+
+    for (unsigned int i = 0; i < heap.n; i++)
+        total += 1.0 / (sqrt(heap.d2[i]) + KNN_EPSILON);
+
+    match->row = heap.row[0];
+    match->distance = sqrt(heap.d2[0]);
+    match->confidence = 1.0 / (match->distance + KNN_EPSILON) / total;
+    return RET_OK;
+}
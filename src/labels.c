@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "labels.h"
+
+/* Names of the label values, indexed by value */
+static const char *const _geographies[] = {"EMEA", "NA", "LAT", "APAC"};
+static const char *const _businesses[] = {"RETAIL", "AUTOMOTIVE", "SERVICE"};
+static const char *const _behaviors[] = {"THROUGHPUT", "LATENCY", "POWER"};
+
+static const char *const *const _names[LABEL_KINDS] = {
+    _geographies, _businesses, _behaviors};
+static const unsigned short _counts[LABEL_KINDS] = {
+    sizeof(_geographies) / sizeof(_geographies[0]),
+    sizeof(_businesses) / sizeof(_businesses[0]),
+    sizeof(_behaviors) / sizeof(_behaviors[0])};
+
+unsigned short labelFromName(unsigned int kind, const char *name) {
+    if (kind >= LABEL_KINDS || name == NULL)
+        return NOT_SET;
+
+    for (unsigned short value = 0; value < _counts[kind]; value++)
+        if (strcmp(name, _names[kind][value]) == 0)
+            return value;
+
+    return NOT_SET;
+}
+
+const char *labelName(unsigned int kind, unsigned short value) {
+    if (kind >= LABEL_KINDS || value >= _counts[kind])
+        return "NOT_SET";
+
+    return _names[kind][value];
+}
+
+int labelIsSet(const label_t *label) {
+    return label->geo != NOT_SET || label->business != NOT_SET ||
+           label->optimize_for != NOT_SET;
+}
+
+static inline int fieldMatches(unsigned short row, unsigned short host) {
+    return row == NOT_SET || host == NOT_SET || row == host;
+}
+
+int labelsMatch(const label_t *row, const label_t *host) {
+    return fieldMatches(row->geo, host->geo) &&
+           fieldMatches(row->business, host->business) &&
+           fieldMatches(row->optimize_for, host->optimize_for);
+}
+
+void labelsFromColumns(const char *columns, label_t *label) {
+    unsigned short *fields[LABEL_KINDS] = {&label->geo, &label->business,
+                                           &label->optimize_for};
+    char buffer[MAX_LABEL_COLUMNS_LENGTH];
+    char *rest = buffer, *name;
+
+    label->geo = label->business = label->optimize_for = NOT_SET;
+    snprintf(buffer, sizeof(buffer), "%s", columns);
+
+    for (unsigned int kind = 0; kind < LABEL_KINDS; kind++) {
+        if ((name = strsep(&rest, ",")) == NULL)
+            break;
+        name += strspn(name, " \t");
+        name[strcspn(name, " \t\r\n")] = '\0';
+        *fields[kind] = labelFromName(kind, name);
+    }
+}
+
+void labelsToColumns(const label_t *label, char *columns, size_t size) {
+    snprintf(columns, size, ",%s,%s,%s",
+             labelName(LABEL_GEOGRAPHY, label->geo),
+             labelName(LABEL_BUSINESS, label->business),
+             labelName(LABEL_BEHAVIOR, label->optimize_for));
+}
+
+static inline unsigned int fieldsSet(const label_t *label) {
+    return (label->geo != NOT_SET) + (label->business != NOT_SET) +
+           (label->optimize_for != NOT_SET);
+}
+
+all_values_t *labelsPartition(all_values_t *values, const label_t *host) {
+    all_values_t *partition;
+    unsigned int i;
+
+    if (values->labels == NULL)
+        return values;
+    for (i = 0; i < values->validValues; i++)
+        if (!labelsMatch(&values->labels[i], host))
+            break;
+    if (i == values->validValues)
+        return values;
+
+    if ((partition = calloc(1, sizeof(all_values_t))) == NULL ||
+        (partition->parameters =
+             calloc(values->validValues, sizeof(tuning_params_t))) == NULL ||
+        (partition->labels = calloc(values->validValues, sizeof(label_t))) ==
+            NULL) {
+        perror(strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    partition->totalLength = values->validValues;
+
+    for (i = 0; i < values->validValues; i++) {
+        unsigned int row = partition->validValues;
+
+        if (!labelsMatch(&values->labels[i], host))
+            continue;
+
+        if (row > 0 && partition->parameters[row - 1].transfer_rate ==
+                           values->parameters[i].transfer_rate) {
+            if (fieldsSet(&values->labels[i]) <=
+                fieldsSet(&partition->labels[row - 1]))
+                continue;
+            row--;
+        } else
+            partition->validValues++;
+
+        partition->parameters[row] = values->parameters[i];
+        partition->labels[row] = values->labels[i];
+    }
+
+    return partition;
+}
+
+void labelsPartitionFree(all_values_t *partition, const all_values_t *values) {
+    if (partition == NULL || partition == values)
+        return;
+
+    free(partition->parameters);
+    free(partition->labels);
+    free(partition);
+}
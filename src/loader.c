@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+/* For memfd_create() */
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loader.h"
+#include "types.h"
+#include "utils.h"
+
+/* Returns a memory file holding what source holds, or -1 */
+static int copyFile(int source, const struct stat *st) {
+    off_t offset = 0;
+    ssize_t sent;
+    int copy;
+
+    if ((copy = memfd_create("phoebe-plugin", MFD_CLOEXEC)) < 0)
+        return -1;
+
+    while (offset < st->st_size) {
+        if ((sent = sendfile(copy, source, &offset, st->st_size - offset)) <=
+            0) {
+            if (sent == 0)
+                errno = EIO;
+            close(copy);
+            return -1;
+        }
+    }
+    return copy;
+}
+
+static void nameOf(int fd, char *name, size_t len) {
+    snprintf(name, len, "/proc/self/fd/%d", fd);
+}
+
+int loaderOpen(const char *path, loaded_file_t *file) {
+    char name[32];
+    struct stat st;
+    void *handle;
+    int source, copy = -1;
+
+    if ((source = open(path, O_RDONLY | O_CLOEXEC)) < 0 ||
+        fstat(source, &st) != 0 || (copy = copyFile(source, &st)) < 0) {
+        write_log("Could not copy %s: %s\n", path, strerror(errno));
+        if (source >= 0)
+            close(source);
+        return RET_FAIL;
+    }
+    close(source);
+
+    nameOf(copy, name, sizeof(name));
+    if ((handle = dlopen(name, RTLD_NOW)) == NULL) {
+        write_log("%s: %s\n", path, dlerror());
+        close(copy);
+        return RET_FAIL;
+    }
+
+    file->handle = handle;
+    file->fd = copy;
+    file->device = st.st_dev;
+    file->inode = st.st_ino;
+    file->modified = st.st_mtim;
+    return RET_OK;
+}
+
+void loaderClose(loaded_file_t *file) {
+    char name[32];
+    void *resident;
+
+    if (file->handle == NULL)
+        return;
+
+    dlclose(file->handle);
+    file->handle = NULL;
+
+    /* An object dlclose(3) keeps would be handed back for a new copy's name */
+    nameOf(file->fd, name, sizeof(name));
+    if ((resident = dlopen(name, RTLD_NOW | RTLD_NOLOAD)) != NULL) {
+        write_verb_log("%s stays loaded: keeping its copy open.\n", name);
+        dlclose(resident);
+    } else
+        close(file->fd);
+    file->fd = -1;
+}
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "bus.h"
+#include "plugins.h"
+#include "settings.h"
+#include "utils.h"
+#include "vm.h"
+
+static app_settings_t *_memory_app_settings;
+/* The settings reloads publish, in inference, and those followed from them */
+static settings_store_t *_settingsStore;
+static settings_snapshot_t *_followed;
+static sample_bus_t *_bus;
+
+/* The defrag modes of THP, 0 without THP */
+static unsigned int _thpModes;
+static vm_tuner_t _tuner;
+
+/* The settings found on the host, restored once memory is relaxed */
+static vm_profile_t _baseline;
+static vm_profile_t _applied;
+
+static unsigned long _changes = 0L;
+static unsigned long _levelSamples[VM_LEVELS];
+
+static int readSysctlNumber(const char *name, unsigned long *value) {
+    char buffer[MAX_SYSCTL_VALUE_LENGTH];
+
+    if (systemBackend()->readSysctl(name, buffer, sizeof(buffer)) != RET_OK) {
+        write_log("Could not read %s: %s\n", name, strerror(errno));
+        return RET_FAIL;
+    }
+    *value = strtoul(buffer, NULL, 10);
+    return RET_OK;
+}
+
+static int readBaseline() {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    unsigned long ratio, backgroundRatio, swappiness;
+
+    if (readSysctlNumber("vm.dirty_ratio", &ratio) != RET_OK ||
+        readSysctlNumber("vm.dirty_background_ratio", &backgroundRatio) !=
+            RET_OK ||
+        readSysctlNumber("vm.dirty_background_bytes",
+                         &_baseline.dirty_background_bytes) != RET_OK ||
+        readSysctlNumber("vm.swappiness", &swappiness) != RET_OK ||
+        readSysctlNumber("vm.min_free_kbytes", &_baseline.min_free_kbytes) !=
+            RET_OK)
+        return RET_FAIL;
+    _baseline.dirty_ratio = ratio;
+    _baseline.dirty_background_ratio = backgroundRatio;
+    _baseline.swappiness = swappiness;
+
+    if (systemBackend()->readLine(THP_DEFRAG_PATH, buffer, sizeof(buffer)) ==
+        RET_OK)
+        _thpModes =
+            parseSelection(buffer, vmThpDefragIndex, &_baseline.thp_defrag);
+    if (_thpModes == 0)
+        write_log("No transparent huge pages: their defrag is not tuned.\n");
+
+    _applied = _baseline;
+    return RET_OK;
+}
+
+/* A ratio and a number of bytes for the same limit zero each other */
+static unsigned int addDirtyBackground(sysctl_write_t *batch,
+                                       const vm_profile_t *profile) {
+    if (profile->dirty_background_bytes != 0 &&
+        profile->dirty_background_bytes != _applied.dirty_background_bytes) {
+        sysctlSet(batch, "vm.dirty_background_bytes", "%lu",
+                  profile->dirty_background_bytes);
+        return 1;
+    }
+    if (profile->dirty_background_bytes == 0 &&
+        profile->dirty_background_ratio != _applied.dirty_background_ratio) {
+        sysctlSet(batch, "vm.dirty_background_ratio", "%u",
+                  profile->dirty_background_ratio);
+        return 1;
+    }
+    return 0;
+}
+
+static void applyProfile(const vm_profile_t *profile) {
+    sysctl_write_t batch[4];
+    unsigned int count = 0;
+
+    write_log("\033[1;32m"); // Set the text to the color green
+    write_log("Memory %s: dirty_ratio %u, dirty_background %lu bytes or %u%%, "
+              "swappiness %u, min_free_kbytes %lu, THP defrag %s\n",
+              vmLevelName(_tuner.level), profile->dirty_ratio,
+              profile->dirty_background_bytes, profile->dirty_background_ratio,
+              profile->swappiness, profile->min_free_kbytes,
+              vmThpDefragName(profile->thp_defrag));
+    write_log("\033[0m"); // Resets the text to default
+
+    if (writesEnabled()) {
+        if (profile->dirty_ratio != _applied.dirty_ratio)
+            sysctlSet(&batch[count++], "vm.dirty_ratio", "%u",
+                      profile->dirty_ratio);
+        count += addDirtyBackground(&batch[count], profile);
+        if (profile->swappiness != _applied.swappiness)
+            sysctlSet(&batch[count++], "vm.swappiness", "%u",
+                      profile->swappiness);
+        if (profile->min_free_kbytes != _applied.min_free_kbytes)
+            sysctlSet(&batch[count++], "vm.min_free_kbytes", "%lu",
+                      profile->min_free_kbytes);
+
+        if (systemBackend()->writeSysctls(batch, count) > 0)
+            for (unsigned int i = 0; i < count; i++)
+                if (batch[i].error != 0)
+                    write_log("Could not set %s to %s: %s\n", batch[i].name,
+                              batch[i].value, strerror(batch[i].error));
+
+        if (profile->thp_defrag != _applied.thp_defrag &&
+            systemBackend()->writeLine(
+                THP_DEFRAG_PATH, vmThpDefragName(profile->thp_defrag)) !=
+                RET_OK)
+            write_log("Could not set the THP defrag to %s: %s\n",
+                      vmThpDefragName(profile->thp_defrag), strerror(errno));
+    }
+
+    _applied = *profile;
+    _changes++;
+}
+
+/* Moves over to the settings a reload published, with their thresholds */
+static void followSettings() {
+    if (_settingsStore == NULL || !settingsFollow(_settingsStore, &_followed))
+        return;
+
+    _memory_app_settings = &_followed->app;
+    _tuner.low = _memory_app_settings->vm_available_low;
+    _tuner.high = _memory_app_settings->vm_available_high;
+}
+
+void *memoryRunInference(void *args __attribute__((unused))) {
+    unsigned long period;
+    static bus_sample_t sample;
+    uint64_t lastSequence = 0;
+    vm_profile_t profile;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    while (1) {
+        period = USEC_IN_SEC * _memory_app_settings->inference_loop_period;
+
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        usleep(period);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+        followSettings();
+
+        if (busLatest(_bus, BUS_METRIC_MEMORY, &sample) == RET_FAIL ||
+            sample.sequence == lastSequence)
+            continue;
+        lastSequence = sample.sequence;
+
+        const vm_rates_t *rates = &sample.memory;
+        unsigned int level = vmTunerUpdate(&_tuner, rates);
+
+        _levelSamples[level]++;
+        write_adv_log("Memory %lu of %lu kB available, %lu kB dirty, %lu kB "
+                      "in TCP buffers, %.0lf/%.0lf pages/s scanned by "
+                      "kswapd/directly: %s\n",
+                      rates->mem_available_kb, rates->mem_total_kb,
+                      rates->dirty_kb, rates->tcp_kb, rates->kswapd_scan_rate,
+                      rates->direct_scan_rate, vmLevelName(level));
+
+        vmProfileFor(level, &_baseline, _thpModes, rates, &_applied, &profile);
+        if (memcmp(&profile, &_applied, sizeof(vm_profile_t)) != 0)
+            applyProfile(&profile);
+    }
+
+    return NULL;
+}
+
+/* Nothing is learnt into a table: the memory is tuned from its use alone */
+void memoryRunTraining(char *inputFileName __attribute__((unused))) {
+    write_log("The memory plugin has no table to train.\n");
+}
+
+static inline void memoryPrintReport() {
+    write_log("\033[0;34m"); // Set the text to the color blue
+    write_log("Memory relaxed/tight/reclaiming for %lu/%lu/%lu samples, tuned "
+              "%lu times; now %s\n",
+              _levelSamples[VM_LEVEL_RELAXED], _levelSamples[VM_LEVEL_TIGHT],
+              _levelSamples[VM_LEVEL_RECLAIMING], _changes,
+              vmLevelName(_tuner.level));
+    write_log("\033[0m"); // Resets the text to default color
+}
+
+int memoryInit(const plugin_context_t *context) {
+    _memory_app_settings = context->settings;
+    _settingsStore = context->settingsStore;
+    _bus = context->bus;
+    set_verbosity(context->verbosity);
+
+    if (selectSystemBackend(context->settings, true) != RET_OK)
+        return RET_FAIL;
+
+    if (readBaseline() != RET_OK)
+        return RET_FAIL;
+    vmTunerInit(&_tuner, _memory_app_settings->vm_available_low,
+                _memory_app_settings->vm_available_high);
+
+    return RET_OK;
+}
+
+void memoryDestroy() {
+    settingsRelease(_followed);
+    _followed = NULL;
+    systemBackend()->release();
+}
+
+plugin_v2_t meV2 = {.abi_version = PLUGIN_ABI_VERSION,
+                    .active = TRUE,
+                    .name = "MEMORY_PLUGIN",
+                    .version = 0.1,
+                    .metrics = BUS_METRIC_MASK(BUS_METRIC_MEMORY),
+                    .knobs = KNOB_VM,
+                    .init = memoryInit,
+                    .destroy = memoryDestroy,
+                    .inference = memoryRunInference,
+                    .training = memoryRunTraining,
+                    .livetraining = memoryRunTraining,
+                    .print_report = memoryPrintReport};
+
+plugin_v2_t *registerMeV2() {
+    write_log("Registering plugin %s ver. %g (ABI %u)\n", meV2.name,
+              meV2.version, meV2.abi_version);
+
+    return &meV2;
+}
@@ -2,6 +2,7 @@
 // Copyright SUSE LLC
 
 #include <assert.h>
+#include <errno.h>
 #include <math.h>
 #include <netlink/route/link.h>
 #include <netlink/route/rtnl.h>
@@ -9,17 +10,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "algorithmic.h"
+#include "backend.h"
+#include "bandit.h"
+#include "bus.h"
+#include "decision.h"
 #include "filehelper.h"
+#include "knn.h"
+#include "nn.h"
 #include "plugins.h"
+#include "rollback.h"
+#include "sketch.h"
 #include "stats.h"
+#include "steering.h"
+#include "sysctl.h"
+#include "settings.h"
+#include "table.h"
 #include "utils.h"
 
 static pthread_mutex_t tableWriteLock;
 static pthread_t netStatsThreadId;
 static pthread_t cpuStatsThreadId;
+static pthread_t pressureStatsThreadId;
+static pthread_t applyThreadId;
 
 static all_values_t *_all_values;
 static weights_reference_t *_weights;
@@ -29,125 +45,884 @@ static double _bias;
 
 static stats_input_param_t stats_input_params;
 
-static unsigned long matches, total = 0L;
+/* opened once on the system backend and reused by every apply */
+static void *_interface;
 
-void applySettings(char *interfaceName, tuning_params_t *parameters,
-                   unsigned int tableIndex) {
-    char netCoreCommand[MAX_COMMAND_LENGTH];
-    char netIPCommand[MAX_COMMAND_LENGTH];
-    char ringSizeCommand[MAX_COMMAND_LENGTH];
-    char offloadCommand[MAX_COMMAND_LENGTH];
+/* built over the table when the inference starts, if knn_neighbours is set */
+static knn_index_t *_knnIndex;
+static nn_model_t *_model;
+
+/* The tables reloads publish, which come with their index and model */
+static table_store_t *_tables;
+static int _tableReader = -1;
+
+/*
+ * The settings reloads publish, which the inference and the apply worker
+ * follow each with a snapshot of their own: the inference through its decision
+ * context, the apply worker through _applyAppSettings, which is the settings
+ * of the init otherwise.
+ */
+static settings_store_t *_settingsStore;
+static settings_snapshot_t *_inferenceHeld;
+static settings_snapshot_t *_applyHeld;
+static app_settings_t *_applyAppSettings;
+
+static unsigned long matches, interpolations, total = 0L;
+
+/* Scores of the rows in live training with a bandit_policy; the apply worker
+ * rewards the choices as it judges them */
+static bandit_t *_bandit;
+static pthread_mutex_t _banditLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Above this CPU busy percentage a host not stalling is reported as busy */
+#define BUSY_CPU_PERCENTAGE 75.0
+
+static const char *HOST_STATES[] = {"ok", "busy", "stalled"};
+
+/* Keeps a knob at its current value if the target would raise it */
+#define DO_NOT_RAISE(target, field)                                            \
+    do {                                                                       \
+        if ((target)->field > _network_settings->field)                        \
+            (target)->field = _network_settings->field;                        \
+    } while (0)
+
+/*
+ * Bigger socket buffers are only useful if the memory backing them is there:
+ * under memory pressure they compete with the page cache and make reclaim
+ * worse. Likewise, a bigger softirq budget or busy polling burns more CPU,
+ * which only pays off on a host that is busy but does not stall on it.
+ */
+static void gateSettings(tuning_params_t *target) {
+    if (getPressure(PSI_MEMORY, false) >=
+        _applyAppSettings->memory_pressure_threshold) {
+        write_log("Memory pressure is high: not raising buffer sizes.\n");
+        DO_NOT_RAISE(target, net_core_rmem_max);
+        DO_NOT_RAISE(target, net_core_wmem_max);
+        DO_NOT_RAISE(target, net_core_rmem_default);
+        DO_NOT_RAISE(target, net_core_wmem_default);
+        DO_NOT_RAISE(target, tcp_rmem0);
+        DO_NOT_RAISE(target, tcp_rmem1);
+        DO_NOT_RAISE(target, tcp_rmem2);
+        DO_NOT_RAISE(target, tcp_wmem0);
+        DO_NOT_RAISE(target, tcp_wmem1);
+        DO_NOT_RAISE(target, tcp_wmem2);
+    }
+
+    if (getPressure(PSI_CPU, false) >=
+        _applyAppSettings->stall_threshold) {
+        write_log("CPU is stalled: not raising softirq budget or busy "
+                  "polling.\n");
+        DO_NOT_RAISE(target, net_core_netdev_budget);
+        DO_NOT_RAISE(target, net_core_busy_poll);
+        DO_NOT_RAISE(target, net_core_busy_read);
+    }
+}
+
+/* Fills batch with the sysctls of target; returns the number of entries */
+static unsigned int buildSysctlBatch(tuning_params_t *target,
+                                     sysctl_write_t *batch) {
+    unsigned int n = 0;
+
+    sysctlSet(&batch[n++], "net.core.netdev_max_backlog", "%u",
+              target->net_core_netdev_max_backlog);
+    sysctlSet(&batch[n++], "net.core.netdev_budget", "%u",
+              target->net_core_netdev_budget);
+    sysctlSet(&batch[n++], "net.core.somaxconn", "%u",
+              target->net_core_somaxconn);
+    sysctlSet(&batch[n++], "net.core.busy_poll", "%hu",
+              target->net_core_busy_poll);
+    sysctlSet(&batch[n++], "net.core.busy_read", "%hu",
+              target->net_core_busy_read);
+    sysctlSet(&batch[n++], "net.core.rmem_max", "%lu",
+              target->net_core_rmem_max);
+    sysctlSet(&batch[n++], "net.core.wmem_max", "%lu",
+              target->net_core_wmem_max);
+    sysctlSet(&batch[n++], "net.core.rmem_default", "%lu",
+              target->net_core_rmem_default);
+    sysctlSet(&batch[n++], "net.core.wmem_default", "%lu",
+              target->net_core_wmem_default);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_fastopen", "%hu",
+              target->tcp_fastopen);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_low_latency", "%hu",
+              target->tcp_low_latency);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_sack", "%hu", target->tcp_sack);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_rmem", "%lu %lu %lu",
+              target->tcp_rmem0, target->tcp_rmem1, target->tcp_rmem2);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_wmem", "%lu %lu %lu",
+              target->tcp_wmem0, target->tcp_wmem1, target->tcp_wmem2);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_max_syn_backlog", "%u",
+              target->tcp_max_syn_backlog);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_tw_reuse", "%hu",
+              target->tcp_tw_reuse);
+    /* net.ipv4.tcp_tw_recycle is no longer available */
+    sysctlSet(&batch[n++], "net.ipv4.tcp_timestamps", "%hu",
+              target->tcp_timestamps);
+    sysctlSet(&batch[n++], "net.ipv4.tcp_syn_retries", "%u",
+              target->tcp_syn_retries);
+
+    return n;
+}
+
+static inline long elapsedUsec(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * USEC_IN_SEC +
+           (now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+/*
+ * Applied state of every knob, so that each decision only touches what
+ * changes. The sysctls are seeded from /proc/sys on the first apply; the
+ * interface settings are unknown until then and the first apply goes through
+ * the ethtool setters, which compare against the device before writing. The
+ * packet steering is seeded with the sysctls when it can be read.
+ */
+typedef struct applied_state_s {
+    sysctl_write_t sysctls[MAX_SYSCTLS];
+    unsigned int sysctlCount;
+    bool interfaceKnown;
+    if_ring_size_t ringSize;
+    if_coalesce_t coalesce;
+    if_offloads_t offloads;
+    bool steeringKnown;
+    steering_t steering;
+} applied_state_t;
+
+static applied_state_t _applied;
+static bool _appliedSeeded = false;
+static struct timespec _lastDisruptiveChange;
+static bool _disruptiveChangeMade = false;
+
+/*
+ * An apply is watched for rollback_ticks collector ticks; if the rates get
+ * worse than over the rollback_ticks before it by more than
+ * rollback_threshold percent, the snapshot taken before the apply is restored.
+ */
+typedef struct apply_transaction_s {
+    bool pending;
+    unsigned int tableIndex;
+    applied_state_t snapshot;
+    tuning_params_t networkSettings;
+    rate_totals_t baseline;
+    double cpuBusy;
+} apply_transaction_t;
+
+static apply_transaction_t _transaction;
+static unsigned long _kept, _rolledBack = 0L;
+
+/*
+ * Decisions are applied by a worker thread so that slow ethtool calls do not
+ * hold up the inference loop. The mailbox holds a single decision: posting
+ * while the previous one has not been picked up yet replaces it.
+ *
+ * The settings are copied as they need not be a row of the table: when they
+ * were interpolated, tableIndex is the nearest row.
+ */
+typedef struct apply_decision_s {
+    tuning_params_t settings;
+    unsigned int tableIndex;
+    struct timespec posted;
+} apply_decision_t;
+
+typedef struct apply_mailbox_s {
+    pthread_mutex_t lock;
+    pthread_cond_t posted;
+    bool full;
+    apply_decision_t decision;
+    unsigned long applied;
+    unsigned long superseded;
+    /* from posting to the end of the apply, and of the apply alone, in usec */
+    quantile_sketch_t latency;
+    quantile_sketch_t duration;
+} apply_mailbox_t;
+
+static apply_mailbox_t _mailbox = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                                   .posted = PTHREAD_COND_INITIALIZER};
+
+static void seedAppliedState(tuning_params_t *target) {
+    tuning_params_t current;
+
+    _applied.sysctlCount = buildSysctlBatch(target, _applied.sysctls);
+
+    for (unsigned int i = 0; i < _applied.sysctlCount; i++) {
+        char *value = _applied.sysctls[i].value;
+
+        /* An unreadable sysctl is always considered changed */
+        if (systemBackend()->readSysctl(_applied.sysctls[i].name, value,
+                                        MAX_SYSCTL_VALUE_LENGTH) != RET_OK) {
+            value[0] = '\0';
+            continue;
+        }
+        /* Vectors like tcp_rmem are tab separated in /proc/sys */
+        for (char *c = value; *c != '\0'; c++)
+            if (*c == '\t')
+                *c = ' ';
+    }
+
+    memset(&current, 0, sizeof(tuning_params_t));
+    if (_interface != NULL &&
+        readSteeringSettings(_interface, stats_input_params.monitored_interface,
+                             &current) == 0) {
+        _applied.steering = (steering_t){.rps_cpus = current.rps_cpus,
+                                         .xps_cpus = current.xps_cpus,
+                                         .rps_flow_cnt = current.rps_flow_cnt,
+                                         .irq_affinity = current.irq_affinity};
+        _applied.steeringKnown = true;
+    }
+    _appliedSeeded = true;
+}
+
+/*
+ * Copies the entries of batch whose value differs from the applied one into
+ * changes, remembering their position in the batch; returns their number.
+ */
+static unsigned int diffSysctls(const sysctl_write_t *batch,
+                                unsigned int count, sysctl_write_t *changes,
+                                unsigned int *positions) {
+    unsigned int n = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        /* Empty values come from sysctls which could not be read */
+        if (batch[i].value[0] == '\0' ||
+            strcmp(batch[i].value, _applied.sysctls[i].value) == 0)
+            continue;
+        changes[n] = batch[i];
+        positions[n++] = i;
+    }
+    return n;
+}
+
+static inline bool disruptiveChangeAllowed() {
+    if (!_disruptiveChangeMade)
+        return true;
+
+    return elapsedUsec(&_lastDisruptiveChange) >=
+           (long)_applyAppSettings->disruptive_change_interval *
+               USEC_IN_SEC;
+}
+
+static void applySysctls(const sysctl_write_t *batch, unsigned int count) {
+    sysctl_write_t changes[MAX_SYSCTLS];
+    unsigned int positions[MAX_SYSCTLS];
+    unsigned int changed = diffSysctls(batch, count, changes, positions);
+
+    if (changed == 0) {
+        write_adv_log("All %u sysctls are unchanged\n", count);
+        return;
+    }
+
+    for (unsigned int i = 0; i < changed; i++)
+        write_log("%s = %s (was %s)\n", changes[i].name, changes[i].value,
+                  _applied.sysctls[positions[i]].value);
+    if (writesEnabled()) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        unsigned int failed = systemBackend()->writeSysctls(changes, changed);
+        long latency = elapsedUsec(&start);
+
+        for (unsigned int i = 0; i < changed; i++)
+            if (changes[i].error != 0)
+                write_log("Could not set %s to %s: %s\n", changes[i].name,
+                          changes[i].value, strerror(changes[i].error));
+        write_log("Applied %u of %u changed sysctls (%u unchanged) in %ld "
+                  "usec\n",
+                  changed - failed, changed, count - changed, latency);
+    }
+    /* Failed writes keep their old value and are retried next time */
+    for (unsigned int i = 0; i < changed; i++)
+        if (changes[i].error == 0)
+            memcpy(_applied.sysctls[positions[i]].value, changes[i].value,
+                   MAX_SYSCTL_VALUE_LENGTH);
+}
+
+/*
+ * Some offloads were refused, others may have been set: what the interface
+ * reports is applied, so that a rollback restores the offloads changed and the
+ * next apply only retries those refused, once per disruptive_change_interval.
+ */
+static void recordOffloadsInEffect() {
+    if_offloads_t offloads;
+
+    memset(&offloads, 0, sizeof(if_offloads_t));
+    if (systemBackend()->readOffloads(_interface, &offloads) == RET_OK)
+        _applied.offloads = offloads;
+    else
+        write_log("Could not read the offloads back: %s\n", strerror(errno));
+}
+
+/*
+ * Applies the interface settings of state; a rollback is always allowed to
+ * restore the ring size and offloads, bypassing the rate limit.
+ */
+static void applyInterfaceSettings(const applied_state_t *state,
+                                   bool rollback) {
+    bool coalesceChanged =
+        !_applied.interfaceKnown ||
+        memcmp(&state->coalesce, &_applied.coalesce, sizeof(if_coalesce_t));
+    bool offloadsChanged =
+        !_applied.interfaceKnown ||
+        memcmp(&state->offloads, &_applied.offloads, sizeof(if_offloads_t));
+    bool ringSizeChanged =
+        !_applied.interfaceKnown ||
+        memcmp(&state->ringSize, &_applied.ringSize, sizeof(if_ring_size_t));
+
+    unsigned int failed = 0;
+
+    if (writesEnabled() && _interface == NULL) {
+        write_log("No interface handle: interface settings not applied.\n");
+        return;
+    }
+
+    if (coalesceChanged) {
+        const if_coalesce_t *c = &state->coalesce;
+
+        write_log("coalesce: rx-usecs %d rx-frames %d tx-usecs %d "
+                  "tx-frames %d\n",
+                  c->rx_coalesce_usecs, c->rx_max_coalesced_frames,
+                  c->tx_coalesce_usecs, c->tx_max_coalesced_frames);
+        if (writesEnabled())
+            failed = systemBackend()->writeInterface(_interface, NULL, c, NULL);
+        if (!(failed & ETHTOOL_COALESCE))
+            _applied.coalesce = *c;
+    }
+
+    if (!offloadsChanged && !ringSizeChanged) {
+        _applied.interfaceKnown = true;
+        return;
+    }
+
+    /* Toggling offloads and resizing the rings can reset the link: they are
+     * applied together, at most once per disruptive_change_interval */
+    if (!rollback && !disruptiveChangeAllowed()) {
+        write_log("Deferring ring size and offload changes: last change was "
+                  "%ld seconds ago\n",
+                  elapsedUsec(&_lastDisruptiveChange) / USEC_IN_SEC);
+        return;
+    }
+
+    if (offloadsChanged) {
+        const if_offloads_t *o = &state->offloads;
+
+        write_log("offloads: rx %s tx %s gso %s tso %s gro %s lro %s "
+                  "rxvlan %s txvlan %s rxhash %s\n",
+                  onOrOff(o->rx_chksum_offload), onOrOff(o->tx_chksum_offload),
+                  onOrOff(o->general_segmentation_offload),
+                  onOrOff(o->tcp_segmentation_offload),
+                  onOrOff(o->general_receive_offload),
+                  onOrOff(o->large_receive_offload),
+                  onOrOff(o->rx_vlan_offload), onOrOff(o->tx_vlan_offload),
+                  onOrOff(o->rx_hash));
+    }
+    if (ringSizeChanged)
+        write_log("ring: rx %d tx %d\n", state->ringSize.rx,
+                  state->ringSize.tx);
+    if (writesEnabled())
+        failed = systemBackend()->writeInterface(
+            _interface, ringSizeChanged ? &state->ringSize : NULL, NULL,
+            offloadsChanged ? &state->offloads : NULL);
+    if (offloadsChanged && !(failed & ETHTOOL_OFFLOADS))
+        _applied.offloads = state->offloads;
+    else if (offloadsChanged)
+        recordOffloadsInEffect();
+    if (ringSizeChanged && !(failed & ETHTOOL_RING_SIZE))
+        _applied.ringSize = state->ringSize;
+
+    clock_gettime(CLOCK_MONOTONIC, &_lastDisruptiveChange);
+    _disruptiveChangeMade = true;
+    _applied.interfaceKnown = true;
+}
+
+/* Packet steering and interrupt affinity only move work between CPUs: unlike
+ * the ring size they are not rate limited */
+static void applySteeringSettings(const applied_state_t *state) {
+    const steering_t *s = &state->steering;
+    const steering_t *applied =
+        _applied.steeringKnown ? &_applied.steering : NULL;
+    unsigned int failed = 0;
+
+    /* Zero fields are left alone, as in tables predating these knobs */
+    if ((s->rps_cpus == 0 && s->xps_cpus == 0 && s->rps_flow_cnt == 0 &&
+         s->irq_affinity == 0) ||
+        (applied != NULL && memcmp(s, applied, sizeof(steering_t)) == 0))
+        return;
+
+    write_log("steering: rps %lx xps %lx rps_flow_cnt %u irq %lx\n",
+              s->rps_cpus, s->xps_cpus, s->rps_flow_cnt, s->irq_affinity);
+    if (writesEnabled()) {
+        if (_interface == NULL) {
+            write_log("No interface handle: steering not applied.\n");
+            return;
+        }
+        failed = applySteering(_interface,
+                               stats_input_params.monitored_interface, s,
+                               applied);
+    }
+
+    /* Failed parts are retried next time */
+    if (s->rps_cpus != 0 && !(failed & STEERING_RPS_CPUS))
+        _applied.steering.rps_cpus = s->rps_cpus;
+    if (s->xps_cpus != 0 && !(failed & STEERING_XPS_CPUS))
+        _applied.steering.xps_cpus = s->xps_cpus;
+    if (s->rps_flow_cnt != 0 && !(failed & STEERING_RPS_FLOW_CNT))
+        _applied.steering.rps_flow_cnt = s->rps_flow_cnt;
+    if (s->irq_affinity != 0 && !(failed & STEERING_IRQ_AFFINITY))
+        _applied.steering.irq_affinity = s->irq_affinity;
+    _applied.steeringKnown = true;
+}
+
+/* Builds the state a table row asks for */
+static void buildTargetState(tuning_params_t *target, applied_state_t *state) {
+    state->sysctlCount = buildSysctlBatch(target, state->sysctls);
+    state->interfaceKnown = true;
+    state->ringSize = (if_ring_size_t){.rx = target->rx_ring_size,
+                                       .tx = target->tx_ring_size};
+    state->coalesce = (if_coalesce_t){
+        .rx_coalesce_usecs = target->rx_interrupt_coalesce_usecs,
+        .rx_max_coalesced_frames = target->rx_interrupt_max_coalesce_frames,
+        .tx_coalesce_usecs = target->tx_interrupt_coalesce_usecs,
+        .tx_max_coalesced_frames = target->tx_interrupt_max_coalesce_frames};
+    state->offloads = (if_offloads_t){
+        .rx_chksum_offload = target->rx_checksum_offload,
+        .tx_chksum_offload = target->tx_checksum_offload,
+        .general_segmentation_offload = target->general_segmentation_offload,
+        .tcp_segmentation_offload = target->tcp_segmentation_offload,
+        .general_receive_offload = target->general_receive_offload,
+        .large_receive_offload = target->large_receive_offload,
+        .rx_vlan_offload = target->rx_vlan_offload,
+        .tx_vlan_offload = target->tx_vlan_offload,
+        .rx_hash = target->rx_hash};
+    state->steeringKnown = true;
+    state->steering = (steering_t){.rps_cpus = target->rps_cpus,
+                                   .xps_cpus = target->xps_cpus,
+                                   .rps_flow_cnt = target->rps_flow_cnt,
+                                   .irq_affinity = target->irq_affinity};
+}
+
+/* Cheap knobs first: sysctls, then interrupt coalescing, then the
+ * disruptive interface settings, then the packet steering */
+static void applyState(const applied_state_t *state, bool rollback) {
+    write_log("\033[1;32m"); // Set the text to the color green
+    applySysctls(state->sysctls, state->sysctlCount);
+    if (state->interfaceKnown)
+        applyInterfaceSettings(state, rollback);
+    else
+        write_log("Interface settings before the apply are unknown: not "
+                  "restoring them.\n");
+    if (state->steeringKnown)
+        applySteeringSettings(state);
+    write_log("\033[0m"); // Resets the text to default
+}
+
+static void beginTransaction(unsigned int tableIndex) {
+    if (_applyAppSettings->rollback_ticks == 0)
+        return;
+
+    _transaction.snapshot = _applied;
+    _transaction.networkSettings = *_network_settings;
+    _transaction.tableIndex = tableIndex;
+
+    /* The baseline covers the rollback_ticks before the apply, not the
+     * settings applied earlier since the previous transaction ended */
+    if (restartRateTotals(_applyAppSettings->rollback_ticks,
+                          &_transaction.baseline) == 0) {
+        _transaction.baseline.ticks = 1;
+        _transaction.baseline.transfer_rate = getTransferRate();
+        _transaction.baseline.drop_rate = getDropRate();
+        _transaction.baseline.errors_rate = getErrorsRate();
+    }
+    _transaction.cpuBusy = getCpuBusyTime();
+    _transaction.pending = true;
+}
+
+void applySettings(const tuning_params_t *settings, unsigned int tableIndex) {
+    tuning_params_t gated = *settings;
+    tuning_params_t *target = &gated;
+    applied_state_t state;
+
+    gateSettings(target);
 
 #ifdef CHECK_INITIAL_SETTINGS
-    if (_network_settings->rx_ring_size > parameters->rx_ring_size ||
-        _network_settings->tx_ring_size > parameters->tx_ring_size) {
+    if (_network_settings->rx_ring_size > target->rx_ring_size ||
+        _network_settings->tx_ring_size > target->tx_ring_size) {
         write_log("Settings not being applied: current values are better.\n");
         return;
     }
 
-    if (_network_settings->net_core_somaxconn >
-            parameters->net_core_somaxconn ||
+    if (_network_settings->net_core_somaxconn > target->net_core_somaxconn ||
         _network_settings->net_core_netdev_budget >
-            parameters->net_core_netdev_budget ||
+            target->net_core_netdev_budget ||
         _network_settings->net_core_netdev_max_backlog >
-            parameters->net_core_netdev_max_backlog) {
+            target->net_core_netdev_max_backlog) {
         write_log("Settings not being applied: current values are better.\n");
         return;
     }
+#endif
 
-    memcpy(_network_settings, parameters, sizeof(tuning_params_t));
+    if (!_appliedSeeded)
+        seedAppliedState(target);
+
+    beginTransaction(tableIndex);
+#ifdef CHECK_INITIAL_SETTINGS
+    memcpy(_network_settings, target, sizeof(tuning_params_t));
 #endif
+    buildTargetState(target, &state);
+    applyState(&state, false);
+}
+
+/* Counts the outcome, which is settled once the transaction is seen ended */
+static void endTransaction(unsigned long *outcome) {
+    pthread_mutex_lock(&_mailbox.lock);
+    (*outcome)++;
+    _transaction.pending = false;
+    pthread_mutex_unlock(&_mailbox.lock);
+}
 
-    snprintf(netCoreCommand, MAX_COMMAND_LENGTH,
-             "sysctl -w net.core.netdev_max_backlog=%d "
-             "net.core.netdev_budget=%d "
-             "net.core.somaxconn=%d "
-             "net.core.busy_poll=%hd "
-             "net.core.busy_read=%hd "
-             "net.core.rmem_max=%ld "
-             "net.core.wmem_max=%ld "
-             "net.core.rmem_default=%ld "
-             "net.core.wmem_default=%ld ",
-             parameters[tableIndex].net_core_netdev_max_backlog,
-             parameters[tableIndex].net_core_netdev_budget,
-             parameters[tableIndex].net_core_somaxconn,
-             parameters[tableIndex].net_core_busy_poll,
-             parameters[tableIndex].net_core_busy_read,
-             parameters[tableIndex].net_core_rmem_max,
-             parameters[tableIndex].net_core_wmem_max,
-             parameters[tableIndex].net_core_rmem_default,
-             parameters[tableIndex].net_core_wmem_default);
-    snprintf(netIPCommand, MAX_COMMAND_LENGTH,
-             "sysctl -w net.ipv4.tcp_fastopen=%hu "
-             "net.ipv4.tcp_low_latency=%hu "
-             "net.ipv4.tcp_sack=%hu "
-             "net.ipv4.tcp_rmem='%lu %lu %lu' "
-             "net.ipv4.tcp_wmem='%lu %lu %lu' "
-             "net.ipv4.tcp_max_syn_backlog=%u "
-             "net.ipv4.tcp_tw_reuse=%hu "
-             /* "net.ipv4.tcp_tw_recycle=%hu " no longer available */
-             "net.ipv4.tcp_timestamps=%hu "
-             "net.ipv4.tcp_syn_retries=%u ",
-             parameters[tableIndex].tcp_fastopen,
-             parameters[tableIndex].tcp_low_latency,
-             parameters[tableIndex].tcp_sack, parameters[tableIndex].tcp_rmem0,
-             parameters[tableIndex].tcp_rmem1, parameters[tableIndex].tcp_rmem2,
-             parameters[tableIndex].tcp_wmem0, parameters[tableIndex].tcp_wmem1,
-             parameters[tableIndex].tcp_wmem2,
-             parameters[tableIndex].tcp_max_syn_backlog,
-             parameters[tableIndex].tcp_tw_reuse,
-             /* parameters[tableIndex].tcp_tw_recycle, no longer available */
-             parameters[tableIndex].tcp_timestamps,
-             parameters[tableIndex].tcp_syn_retries);
-    snprintf(ringSizeCommand, MAX_COMMAND_LENGTH, "ethtool -G %s rx %hu tx %hu",
-             interfaceName, parameters[tableIndex].rx_ring_size,
-             parameters[tableIndex].tx_ring_size);
-    snprintf(offloadCommand, MAX_COMMAND_LENGTH,
-             "ethtool -K %s "
-             "rx %s "
-             "tx %s "
-             "gso %s "
-             "tso %s "
-             "gro %s "
-             "lro %s "
-             "rxvlan %s "
-             "txvlan %s "
-             "rxhash %s ",
-             interfaceName, onOrOff(parameters[tableIndex].rx_checksum_offload),
-             onOrOff(parameters[tableIndex].tx_checksum_offload),
-             onOrOff(parameters[tableIndex].general_segmentation_offload),
-             onOrOff(parameters[tableIndex].tcp_segmentation_offload),
-             onOrOff(parameters[tableIndex].general_receive_offload),
-             onOrOff(parameters[tableIndex].large_receive_offload),
-             onOrOff(parameters[tableIndex].rx_vlan_offload),
-             onOrOff(parameters[tableIndex].tx_vlan_offload),
-             onOrOff(parameters[tableIndex].rx_hash));
+/*
+ * Called by the apply worker: returns true while an apply is still being
+ * watched, in which case no new decision must be applied.
+ */
+static bool watchTransaction() {
+    rate_totals_t result;
+    const rate_totals_t *base = &_transaction.baseline;
 
-    write_log("\033[1;32m"); // Set the text to the color green
-    write_log("$ %s\n", netCoreCommand);
-    write_log("$ %s\n", netIPCommand);
-    write_log("$ %s\n", ringSizeCommand);
-    write_log("$ %s\n", offloadCommand);
-#ifdef APPLY_CHANGES
-    system(netCoreCommand);
-    system(netIPCommand);
-    system(ringSizeCommand);
-    system(offloadCommand);
+    if (!_transaction.pending)
+        return false;
+    if (getRateTotalsTicks() < _applyAppSettings->rollback_ticks)
+        return true;
+
+    takeRateTotals(&result);
+
+    double baseTransfer = rateMean(base->transfer_rate, base->ticks);
+    double baseDrop = rateMean(base->drop_rate, base->ticks);
+    double baseErrors = rateMean(base->errors_rate, base->ticks);
+    double transfer = rateMean(result.transfer_rate, result.ticks);
+    double drop = rateMean(result.drop_rate, result.ticks);
+    double errors = rateMean(result.errors_rate, result.ticks);
+    unsigned int row = _transaction.tableIndex;
+
+    write_adv_log("Row %u: transfer rate %.0lf -> %.0lf, drop rate %.2lf -> "
+                  "%.2lf, errors rate %.2lf -> %.2lf over %u ticks\n",
+                  row, baseTransfer, transfer, baseDrop, drop, baseErrors,
+                  errors, result.ticks);
+
+    /* The bandit learns from every watched apply, kept or not */
+    if (_bandit != NULL) {
+        bandit_measure_t before = {baseTransfer, baseDrop, baseErrors,
+                                   _transaction.cpuBusy};
+        bandit_measure_t after = {transfer, drop, errors, getCpuBusyTime()};
+        double reward = banditReward(&before, &after);
+
+        pthread_mutex_lock(&_banditLock);
+        banditUpdate(_bandit, row, reward);
+        pthread_mutex_unlock(&_banditLock);
+        write_adv_log("Row %u rewarded %lf\n", row, reward);
+    }
+
+    if (!rollbackNeeded(base, &result,
+                        _applyAppSettings->rollback_threshold)) {
+        endTransaction(&_kept);
+        return false;
+    }
+
+    write_log("Settings of row %u made things worse (transfer rate %.0lf -> "
+              "%.0lf, drop rate %.2lf -> %.2lf, errors rate %.2lf -> %.2lf): "
+              "rolling back\n",
+              row, baseTransfer, transfer, baseDrop, drop, baseErrors, errors);
+    applyState(&_transaction.snapshot, true);
+#ifdef CHECK_INITIAL_SETTINGS
+    *_network_settings = _transaction.networkSettings;
 #endif
-    write_log("\033[0m"); // Resets the text to default
+    endTransaction(&_rolledBack);
+    return false;
+}
+
+static void postSettings(const tuning_params_t *settings,
+                         unsigned int tableIndex) {
+    pthread_mutex_lock(&_mailbox.lock);
+    if (_mailbox.full) {
+        write_adv_log("Decision for row %u superseded by row %u\n",
+                      _mailbox.decision.tableIndex, tableIndex);
+        _mailbox.superseded++;
+    }
+    _mailbox.decision.settings = *settings;
+    _mailbox.decision.tableIndex = tableIndex;
+    clock_gettime(CLOCK_MONOTONIC, &_mailbox.decision.posted);
+    _mailbox.full = true;
+    pthread_cond_signal(&_mailbox.posted);
+    pthread_mutex_unlock(&_mailbox.lock);
+}
+
+static void unlockMailbox(void *args __attribute__((unused))) {
+    pthread_mutex_unlock(&_mailbox.lock);
+}
+
+/*
+ * Only cancelled while waiting: an apply, and the judgement and rollback of
+ * one, always run to their end.
+ */
+static void *applyWorker(void *args __attribute__((unused))) {
+    apply_decision_t decision;
+    struct timespec start;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    while (1) {
+        pthread_mutex_lock(&_mailbox.lock);
+        pthread_cleanup_push(unlockMailbox, NULL);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        while (!_mailbox.full && !_transaction.pending)
+            pthread_cond_wait(&_mailbox.posted, &_mailbox.lock);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        pthread_cleanup_pop(1);
+
+        if (_settingsStore != NULL &&
+            settingsFollow(_settingsStore, &_applyHeld))
+            _applyAppSettings = &_applyHeld->app;
+
+        /* A new decision waits until the previous apply was judged */
+        if (watchTransaction()) {
+            pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+            usleep(USEC_IN_SEC *
+                   _applyAppSettings->stats_collection_period);
+            pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+            continue;
+        }
+
+        pthread_mutex_lock(&_mailbox.lock);
+        if (!_mailbox.full) {
+            pthread_mutex_unlock(&_mailbox.lock);
+            continue;
+        }
+        decision = _mailbox.decision;
+        _mailbox.full = false;
+        pthread_mutex_unlock(&_mailbox.lock);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        applySettings(&decision.settings, decision.tableIndex);
+        long duration = elapsedUsec(&start);
+        long latency = elapsedUsec(&decision.posted);
+
+        write_adv_log("Applied row %u in %ld usec, %ld usec after the "
+                      "decision\n",
+                      decision.tableIndex, duration, latency);
+
+        pthread_mutex_lock(&_mailbox.lock);
+        _mailbox.applied++;
+        sketchRecord(&_mailbox.latency, latency);
+        sketchRecord(&_mailbox.duration, duration);
+        pthread_mutex_unlock(&_mailbox.lock);
+    }
+
+    return NULL;
 }
 
 static inline void networkPrintReport() {
     write_log("\033[1;32m"); // Set the text to the color green
-    printf("\n\nTotal inference loops: %ld, Matches=%ld, Success Rate=%f%%, "
-           "Min Transfer Rate = %ld, Max Transfer Rate = %ld\n",
-           total, matches, ((double)matches / (double)total) * 100,
+    printf("\n\nTotal inference loops: %ld, Matches=%ld (interpolated=%ld), "
+           "Success Rate=%f%%, Min Transfer Rate = %ld, "
+           "Max Transfer Rate = %ld\n",
+           total, matches, interpolations,
+           ((double)matches / (double)total) * 100,
            getMinTransferRate(), getMaxTransferRate());
+
+    for (unsigned int w = 0; w < SKETCH_WINDOWS; w++)
+        printf("[%s] Transfer Rate p50/p95/p99 = %ld/%ld/%ld, "
+               "Drop Rate p95 = %ld, Errors Rate p95 = %ld, "
+               "CPU Busy p95 = %.2f%%\n",
+               sketchWindowName(w), getTransferRateQuantile(w, 0.50),
+               getTransferRateQuantile(w, 0.95),
+               getTransferRateQuantile(w, 0.99), getDropRateQuantile(w, 0.95),
+               getErrorsRateQuantile(w, 0.95), getCpuBusyTimeQuantile(w, 0.95));
+
+    printf("Stalled (some avg10): cpu=%.2lf%%, io=%.2lf%%, memory=%.2lf%% "
+           "(full %.2lf%%); host is %s\n",
+           getPressure(PSI_CPU, false), getPressure(PSI_IO, false),
+           getPressure(PSI_MEMORY, false), getPressure(PSI_MEMORY, true),
+           HOST_STATES[getHostState(BUSY_CPU_PERCENTAGE,
+                                    _network_app_settings->stall_threshold)]);
+
+    printf("Applied settings kept %ld times, rolled back %ld times\n", _kept,
+           _rolledBack);
+
+    pthread_mutex_lock(&_mailbox.lock);
+    printf("Decisions applied: %ld, superseded: %ld, pending: %d; apply "
+           "latency p50/p99 = %ld/%ld usec (apply alone %ld/%ld usec)\n",
+           _mailbox.applied, _mailbox.superseded, _mailbox.full,
+           sketchQuantile(&_mailbox.latency, 0.50),
+           sketchQuantile(&_mailbox.latency, 0.99),
+           sketchQuantile(&_mailbox.duration, 0.50),
+           sketchQuantile(&_mailbox.duration, 0.99));
+    pthread_mutex_unlock(&_mailbox.lock);
+
+    if (_bandit != NULL) {
+        pthread_mutex_lock(&_banditLock);
+        printf("Bandit (%s): %lu rounds, %lu of them exploring\n",
+               banditPolicyName(_bandit->policy), _bandit->rounds,
+               _bandit->explorations);
+        pthread_mutex_unlock(&_banditLock);
+    }
+
+    if (_all_values != NULL && _all_values->validValues > 0) {
+        unsigned long tableMax =
+            _all_values->parameters[_all_values->validValues - 1].transfer_rate;
+        uint64_t observedMax = getTransferRateQuantile(SKETCH_WINDOW_1H, 0.99);
+
+        printf("Table covers transfer rates %ld..%ld",
+               _all_values->parameters[0].transfer_rate, tableMax);
+        if (observedMax > tableMax)
+            printf(" (below the observed 1h p99 of %ld: consider retraining "
+                   "with a wider range)",
+                   observedMax);
+        printf("\n");
+    }
     write_log("\033[0m"); // Resets the text to default color
 }
 
+/*
+ * Reads the load the inference keys on: the instantaneous rates or, when
+ * load_quantile is set, the given quantile over load_window so that short
+ * spikes and dips do not trigger reconfigurations on their own.
+ */
+static inline void readLoad(const app_settings_t *settings,
+                            inference_load_t *load) {
+    double quantile = settings->load_quantile;
+    unsigned int window = settings->load_window;
+
+    if (quantile > 0.0) {
+        load->transfer_rate = getTransferRateQuantile(window, quantile);
+        load->drop_rate = getDropRateQuantile(window, quantile);
+        load->errors_rate = getErrorsRateQuantile(window, quantile);
+        load->fifo_errors_rate = getFifoErrorsRateQuantile(window, quantile);
+        load->cpu_usage = getCpuBusyTimeQuantile(window, quantile);
+        return;
+    }
+
+    load->transfer_rate = getTransferRate();
+    load->drop_rate = getDropRate();
+    load->errors_rate = getErrorsRate();
+    load->fifo_errors_rate = getFifoErrorsRate();
+    load->cpu_usage = getCpuBusyTime();
+}
+
+/*
+ * Waits until the decision posted after the first applied ones was applied
+ * and, if it began a transaction, judged.
+ */
+static void awaitJudgement(unsigned long applied, unsigned long period) {
+    bool judged = false;
+
+    while (!judged) {
+        usleep(period);
+        pthread_mutex_lock(&_mailbox.lock);
+        judged = _mailbox.applied > applied && !_transaction.pending;
+        pthread_mutex_unlock(&_mailbox.lock);
+    }
+}
+
+/*
+ * Online tuning: each round picks one of the rows of the load bucket, applies
+ * it as the inference does and rewards it, once the apply was judged, on how
+ * the rates and CPU usage moved against the rollback_ticks before. Only rows
+ * of the table are ever applied, through the same gating, rate limiting and
+ * rollback as in inference. A row picked while it is in place already would
+ * be rewarded on no change at all: the round is skipped.
+ */
+static void runBandit() {
+    char scoresPath[MAX_FILENAME_LENGTH];
+    unsigned long period =
+        USEC_IN_SEC * _network_app_settings->stats_collection_period;
+    inference_load_t load;
+    /* The row kept last, -1 before any */
+    int inPlace = -1;
+    int loaded;
+
+    if (_network_app_settings->rollback_ticks == 0) {
+        write_log("The bandit rewards its choices over rollback_ticks: set it "
+                  "above 0.\n");
+        return;
+    }
+    if (_all_values->validValues == 0) {
+        write_log("The table has no rows for the bandit to pick.\n");
+        return;
+    }
+    if ((_bandit = banditCreate(_network_app_settings->bandit_policy,
+                                _network_app_settings->bandit_epsilon,
+                                _all_values->validValues, time(NULL))) ==
+        NULL) {
+        write_log("Could not allocate the scores of the bandit.\n");
+        return;
+    }
+
+    banditScoresPath(_network_app_settings->rates_filename, scoresPath,
+                     sizeof(scoresPath));
+    if ((loaded = banditLoad(_bandit, _all_values, scoresPath)) != RET_FAIL)
+        write_log("Loaded the scores of %d rows from %s\n", loaded,
+                  scoresPath);
+    write_log("Bandit (%s) running over %u rows...\n",
+              banditPolicyName(_bandit->policy), _all_values->validValues);
+
+    while (1) {
+        unsigned int first, count, pulls;
+        int row;
+        unsigned long applied, rolledBack;
+
+        /* The rates under the settings in place are the baseline */
+        usleep(period * _network_app_settings->rollback_ticks);
+
+        readLoad(_network_app_settings, &load);
+        if (load.transfer_rate == 0 && load.drop_rate == 0 &&
+            load.errors_rate == 0 && load.fifo_errors_rate == 0)
+            continue;
+
+        banditCandidates(_all_values, load.transfer_rate,
+                         _network_app_settings->bandit_candidates, &first,
+                         &count);
+        pthread_mutex_lock(&_banditLock);
+        if ((row = banditChoose(_bandit, first, count)) == RET_FAIL) {
+            pthread_mutex_unlock(&_banditLock);
+            continue;
+        }
+        pulls = _bandit->scores[row].pulls;
+        pthread_mutex_unlock(&_banditLock);
+
+        write_log("Bandit picked row %d of rows %u..%u for transfer rate "
+                  "%lu\n",
+                  row, first, first + count - 1, load.transfer_rate);
+        if (row == inPlace) {
+            write_adv_log("Row %d is in place already: not rewarded\n", row);
+            continue;
+        }
+
+        pthread_mutex_lock(&_mailbox.lock);
+        applied = _mailbox.applied;
+        rolledBack = _rolledBack;
+        pthread_mutex_unlock(&_mailbox.lock);
+
+        postSettings(&_all_values->parameters[row], row);
+        awaitJudgement(applied, period);
+
+        pthread_mutex_lock(&_banditLock);
+        /* Settings kept back by the gating leave the rates as they were */
+        if (_bandit->scores[row].pulls == pulls) {
+            write_adv_log("Row %d was not applied: rewarded 0\n", row);
+            banditUpdate(_bandit, row, 0.0);
+        } else if (_rolledBack == rolledBack)
+            inPlace = row;
+        if (banditSave(_bandit, _all_values, scoresPath) == RET_FAIL)
+            write_log("Could not save the scores to %s\n", scoresPath);
+        pthread_mutex_unlock(&_banditLock);
+    }
+}
+
 void networkLiveTraining(char *inputFileName) {
     int origTableIndex = 0;
+
+    if (_network_app_settings->bandit_policy != BANDIT_OFF) {
+        runBandit();
+        return;
+    }
+
     while (_all_values->validValues < _all_values->totalLength) {
         unsigned long transferRate = getTransferRate();
         uint64_t dropRate = getDropRate();
@@ -201,122 +976,188 @@ void networkLiveTraining(char *inputFileName) {
     }
 }
 
+/*
+ * Moves the decisions over to the settings published last: the weights, bias,
+ * tolerance and thresholds of a reload apply from the next search on.
+ */
+static void followSettings(decision_context_t *context) {
+    bool first = _inferenceHeld == NULL;
+
+    if (!settingsFollow(_settingsStore, &_inferenceHeld))
+        return;
+
+    if (!first)
+        write_log("Inference now using settings generation %lu\n",
+                  _inferenceHeld->generation);
+    context->settings = &_inferenceHeld->app;
+    context->weights = &_inferenceHeld->weights;
+    context->bias = _inferenceHeld->bias;
+}
+
+/*
+ * Moves the decisions over to the table published last, with its index and
+ * model. The decision state, and so the grace period, carries over.
+ */
+static void followTable(decision_context_t *context) {
+    table_snapshot_t *snapshot = tableRead(_tables, _tableReader);
+
+    if (snapshot->partition == context->values)
+        return;
+
+    if (context->values != NULL)
+        write_log("Inference now searching table generation %lu: %u rows\n",
+                  snapshot->generation, snapshot->partition->validValues);
+    context->values = _all_values = snapshot->partition;
+    context->knnIndex = snapshot->knnIndex;
+    context->model = snapshot->model;
+}
+
 void *networkRunInference(void *args __attribute__((unused))) {
 
-    int i = 0;
-    double prevWeightedValue = 0L;
-    unsigned long timePassedSinceLastChanges = 0;
     unsigned short printAdviseMsg = 0;
+    unsigned int hostState = HOST_STATE_OK;
+    decision_state_t state = {0};
+    decision_t decision;
+    inference_load_t load;
+    decision_context_t context = {.values = _all_values,
+                                  .weights = _weights,
+                                  .bias = _bias,
+                                  .settings = _network_app_settings};
+
+    if (_settingsStore != NULL)
+        followSettings(&context);
 
     write_log("Inference running: %f...\n",
-              _network_app_settings->inference_loop_period);
+              context.settings->inference_loop_period);
+    if (_tables == NULL) {
+        _knnIndex = tableBuildKnn(_all_values, context.settings);
+        _model = tableLoadModel(context.settings);
+    } else if ((_tableReader = tableReaderRegister(_tables)) == -1) {
+        write_log("Too many readers of the table: inference not started.\n");
+        return NULL;
+    }
+    context.knnIndex = _knnIndex;
+    context.model = _model;
 
+    /* Filled in from the table published, on the first tick */
+    if (_tables != NULL)
+        context.values = NULL;
+
+    /* Stopped between ticks only */
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
     while (1) {
-        usleep(USEC_IN_SEC * _network_app_settings->inference_loop_period);
+        unsigned long period =
+            USEC_IN_SEC * context.settings->inference_loop_period;
 
-        timePassedSinceLastChanges +=
-            (USEC_IN_SEC * _network_app_settings->inference_loop_period);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        usleep(period);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 
-        unsigned long transferRate = getTransferRate();
-        uint64_t dropRate = getDropRate();
-        uint64_t errorsRate = getErrorsRate();
-        uint64_t fifoErrorsRate = getFifoErrorsRate();
+        if (_settingsStore != NULL)
+            followSettings(&context);
+        if (_tables != NULL)
+            followTable(&context);
 
-        if (transferRate == 0 && dropRate == 0 && errorsRate == 0 &&
-            fifoErrorsRate == 0)
-            continue;
+        readLoad(context.settings, &load);
 
-#ifdef LINEAR_REGRESSION
-        double weightedValue =
-            calculateWeightedValue(transferRate, dropRate, errorsRate,
-                                   fifoErrorsRate, _weights, _bias);
-        unsigned short zeros =
-            digits(weightedValue) * _network_app_settings->accuracy;
-        double epsilon =
-            calculateEpsilon(zeros, _network_app_settings->accuracy);
-        double toleranceValue = calculateTolerance(
-            weightedValue, epsilon, _network_app_settings->approx_function);
-        double weightedValueDiff = fabs(weightedValue - prevWeightedValue);
-#endif
+        unsigned int hostNow = getHostState(BUSY_CPU_PERCENTAGE,
+                                            context.settings->stall_threshold);
+        if (hostNow != hostState) {
+            write_log("Host is now %s (was %s)\n", HOST_STATES[hostNow],
+                      HOST_STATES[hostState]);
+            hostState = hostNow;
+        }
 
-        printAdviseMsg++;
+        double prevWeightedValue = state.prevWeightedValue;
+
+        switch (decide(&context, &state, &load, period, &decision)) {
+        case DECISION_IDLE:
+            continue;
 
-        if (weightedValueDiff < toleranceValue) {
-            if (printAdviseMsg % 10 == 0) {
+        case DECISION_SMALL_DELTA:
+            if (++printAdviseMsg % 10 == 0) {
                 write_log("Avoiding too little delta %lf (tolerance = %lf)\n",
-                          weightedValueDiff, toleranceValue);
+                          decision.weightedValueDiff, decision.tolerance);
                 printAdviseMsg = 0;
             }
             continue;
-        }
 
-        if (weightedValue < prevWeightedValue &&
-            (timePassedSinceLastChanges <=
-             _network_app_settings->grace_period * MINUTES_IN_USEC)) {
-            if (printAdviseMsg % 10 == 0) {
+        case DECISION_GRACE_PERIOD:
+            if (++printAdviseMsg % 10 == 0) {
                 write_log(
                     "Skipping changing values: weightedValue=%lf, "
                     "prevWeightedValue=%lf, timePassedSinceLastChanges=%ld\n",
-                    weightedValue, prevWeightedValue,
-                    timePassedSinceLastChanges);
+                    decision.weightedValue, prevWeightedValue,
+                    state.timePassedSinceLastChanges);
                 printAdviseMsg = 0;
             }
             continue;
         }
 
+        printAdviseMsg++;
+
         write_log("Searching for: weightedValue=%lf, prevWeightedValue=%lf "
                   "with a tolerance of=%lf\n",
-                  weightedValue, prevWeightedValue, toleranceValue);
+                  decision.weightedValue, prevWeightedValue,
+                  decision.tolerance);
 
         if (total % 10 == 0) {
             networkPrintReport();
         }
 
-        unsigned int closestIndex = 0;
+        unsigned int closestIndex = decision.closestIndex;
+        int i = decision.row;
 
-        if ((i = binarySearchWithTolerance(
-                 _all_values->parameters, 0, _all_values->validValues,
-                 weightedValue, toleranceValue, &closestIndex, _weights,
-                 _bias)) != -1) {
+        if (decision.outcome == DECISION_MATCHED) {
             matches++;
 
             write_adv_log("Match found for value %ld; actual delta = %ld where "
                           "tolerance is = %lf\n",
-                          weightedValue,
+                          decision.weightedValue,
                           _all_values->parameters[closestIndex].transfer_rate,
                           _all_values->parameters[closestIndex].transfer_rate -
-                              transferRate,
-                          toleranceValue);
+                              load.transfer_rate,
+                          decision.tolerance);
+
+            postSettings(decisionSettings(&context, &decision), i);
+            printAdviseMsg = 0;
+        } else if (decision.outcome == DECISION_INTERPOLATED) {
+            matches++;
+            interpolations++;
 
-            applySettings(stats_input_params.monitored_interface,
-                          _all_values->parameters, i);
+            write_adv_log("Interpolated settings for transfer rate %ld; the "
+                          "nearest row %d has %ld\n",
+                          load.transfer_rate, i,
+                          _all_values->parameters[i].transfer_rate);
 
-            timePassedSinceLastChanges = 0;
+            postSettings(decisionSettings(&context, &decision), i);
             printAdviseMsg = 0;
-            prevWeightedValue = weightedValue;
         } else {
             write_log("Could not find a match for value %ld; the closest "
                       "transfer rate "
                       "value at index %u is %ld. Actual delta = %ld where "
                       "tolerance is = %lf\n",
-                      transferRate, closestIndex,
+                      load.transfer_rate, closestIndex,
                       _all_values->parameters[closestIndex].transfer_rate,
                       _all_values->parameters[closestIndex].transfer_rate -
-                          transferRate,
-                      toleranceValue);
+                          load.transfer_rate,
+                      decision.tolerance);
         }
 
         total++;
     }
 }
 
-void networkInit(char *interfaceName, app_settings_t *network_app_settings,
-                 tuning_params_t *network_settings,
-                 weights_reference_t *weights, all_values_t *all_values,
-                 double bias, unsigned int v_level) {
+static void networkSetup(char *interfaceName,
+                         app_settings_t *network_app_settings,
+                         tuning_params_t *network_settings,
+                         weights_reference_t *weights,
+                         all_values_t *all_values, double bias,
+                         unsigned int v_level) {
     pthread_mutex_init(&tableWriteLock, NULL);
 
     _network_app_settings = network_app_settings;
+    _applyAppSettings = network_app_settings;
     _network_settings = network_settings;
     _all_values = all_values;
     _weights = weights;
@@ -328,8 +1169,48 @@ void networkInit(char *interfaceName, app_settings_t *network_app_settings,
     stats_input_params.stats_collection_period =
         _network_app_settings->stats_collection_period;
 
+    if (selectSystemBackend(network_app_settings, true) != RET_OK)
+        exit(EXIT_FAILURE);
+    if ((_interface = systemBackend()->openInterface(interfaceName)) == NULL)
+        write_log("Could not open %s: %s\n", interfaceName, strerror(errno));
+}
+
+/* Plugin ABI 1: the plugin collects its statistics itself */
+void networkInit(char *interfaceName, app_settings_t *network_app_settings,
+                 tuning_params_t *network_settings,
+                 weights_reference_t *weights, all_values_t *all_values,
+                 double bias, unsigned int v_level) {
+    networkSetup(interfaceName, network_app_settings, network_settings,
+                 weights, all_values, bias, v_level);
+
     pthread_create(&netStatsThreadId, NULL, collectStats, &stats_input_params);
-    pthread_create(&cpuStatsThreadId, NULL, collectCpuStats, NULL);
+    pthread_create(&cpuStatsThreadId, NULL, collectCpuStats,
+                   &stats_input_params);
+    pthread_create(&pressureStatsThreadId, NULL, collectPressureStats,
+                   &stats_input_params);
+    pthread_create(&applyThreadId, NULL, applyWorker, NULL);
+}
+
+#define NETWORK_METRICS                                                        \
+    (BUS_METRIC_MASK(BUS_METRIC_LINK) | BUS_METRIC_MASK(BUS_METRIC_CPU) |      \
+     BUS_METRIC_MASK(BUS_METRIC_PRESSURE))
+
+/* Plugin ABI 2: the samples the core collects are recorded as they come */
+int networkInitV2(const plugin_context_t *context) {
+    networkSetup(context->interfaceName, context->settings,
+                 context->systemSettings, context->weights, context->values,
+                 context->bias, context->verbosity);
+    _tables = context->tables;
+    _settingsStore = context->settingsStore;
+
+    if (busSubscribe(context->bus, NETWORK_METRICS, recordBusSample, NULL) ==
+        RET_FAIL) {
+        write_log("Could not subscribe to the samples of the core.\n");
+        return RET_FAIL;
+    }
+
+    pthread_create(&applyThreadId, NULL, applyWorker, NULL);
+    return RET_OK;
 }
 
 void networkRunTraining(char *inputFileName) {
@@ -398,7 +1279,29 @@ void networkRunTraining(char *inputFileName) {
     return;
 }
 
-void networkDestroy() { pthread_mutex_destroy(&tableWriteLock); }
+void networkDestroy() {
+    /* An apply under way ends first */
+    pthread_cancel(applyThreadId);
+    pthread_join(applyThreadId, NULL);
+    /* The inference thread was stopped already */
+    if (_tables != NULL)
+        tableReaderUnregister(_tables, _tableReader);
+    _tableReader = -1;
+    settingsRelease(_inferenceHeld);
+    settingsRelease(_applyHeld);
+    _inferenceHeld = NULL;
+    _applyHeld = NULL;
+
+    knnFree(_knnIndex);
+    nnFree(_model);
+    banditFree(_bandit);
+    _knnIndex = NULL;
+    _model = NULL;
+    _bandit = NULL;
+    systemBackend()->closeInterface(_interface);
+    systemBackend()->release();
+    pthread_mutex_destroy(&tableWriteLock);
+}
 
 plugin_t me = {.active = TRUE,
                .name = "NETWORK_PLUGIN",
@@ -410,6 +1313,20 @@ plugin_t me = {.active = TRUE,
                .livetraining = networkLiveTraining,
                .print_report = networkPrintReport};
 
+plugin_v2_t meV2 = {.abi_version = PLUGIN_ABI_VERSION,
+                    .active = TRUE,
+                    .name = "NETWORK_PLUGIN",
+                    .version = 0.2,
+                    .metrics = NETWORK_METRICS,
+                    .knobs = KNOB_NET_SYSCTL | KNOB_NET_INTERFACE |
+                             KNOB_NET_STEERING,
+                    .init = networkInitV2,
+                    .destroy = networkDestroy,
+                    .inference = networkRunInference,
+                    .training = networkRunTraining,
+                    .livetraining = networkLiveTraining,
+                    .print_report = networkPrintReport};
+
 plugin_t *registerMe() {
     /* HERE call the function to add this plugin to the list of registered
      * plugins */
@@ -417,3 +1334,10 @@ plugin_t *registerMe() {
 
     return &me;
 }
+
+plugin_v2_t *registerMeV2() {
+    write_log("Registering plugin %s ver. %g (ABI %u)\n", meV2.name,
+              meV2.version, meV2.abi_version);
+
+    return &meV2;
+}
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <endian.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nn.h"
+#include "utils.h"
+
+/* GCC and clang lower this to the widest vector unit of the target, be it
+ * SSE, AVX or NEON, without tying the code to one of them */
+typedef float nn_vector_t
+    __attribute__((vector_size(NN_LANES * sizeof(float))));
+
+#define NN_ALIGNMENT sizeof(nn_vector_t)
+
+static inline unsigned int padded(unsigned int count) {
+    return (count + NN_LANES - 1) / NN_LANES * NN_LANES;
+}
+
+static int readUint(FILE *fp, uint32_t *value) {
+    if (fread(value, sizeof(uint32_t), 1, fp) != 1)
+        return RET_FAIL;
+    *value = le32toh(*value);
+    return RET_OK;
+}
+
+static int readFloats(FILE *fp, float *values, unsigned int count) {
+    uint32_t raw;
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (fread(&raw, sizeof(raw), 1, fp) != 1)
+            return RET_FAIL;
+        raw = le32toh(raw);
+        memcpy(&values[i], &raw, sizeof(float));
+        if (!isfinite(values[i]))
+            return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+/* Reads the shape of the layers and sizes the arena they need */
+static int readShape(FILE *fp, const char *path, nn_model_t *model,
+                     size_t *arenaFloats) {
+    char magic[sizeof(NN_MAGIC) - 1];
+    uint32_t version, inputs, layers;
+
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+        memcmp(magic, NN_MAGIC, sizeof(magic)) != 0 ||
+        readUint(fp, &version) == RET_FAIL) {
+        write_log("%s is not a model file\n", path);
+        return RET_FAIL;
+    }
+    if (version != NN_FORMAT_VERSION) {
+        write_log("%s: unsupported model format version %u (expected %u)\n",
+                  path, version, NN_FORMAT_VERSION);
+        return RET_FAIL;
+    }
+    if (readUint(fp, &inputs) == RET_FAIL ||
+        readUint(fp, &layers) == RET_FAIL || inputs != NN_INPUTS ||
+        layers == 0 || layers > NN_MAX_LAYERS) {
+        write_log("%s: the model must take %u inputs through 1 to %u "
+                  "layers\n",
+                  path, NN_INPUTS, NN_MAX_LAYERS);
+        return RET_FAIL;
+    }
+    model->layerCount = layers;
+
+    *arenaFloats = 2 * NN_MAX_WIDTH;
+    if (fseek(fp, 2 * NN_INPUTS * sizeof(float), SEEK_CUR) != 0)
+        return RET_FAIL;
+    for (unsigned int l = 0; l < layers; l++) {
+        nn_layer_t *layer = &model->layers[l];
+        uint32_t outputs, activation;
+
+        if (readUint(fp, &outputs) == RET_FAIL ||
+            readUint(fp, &activation) == RET_FAIL || outputs == 0 ||
+            outputs > NN_MAX_WIDTH ||
+            (l == layers - 1 && outputs != 1) ||
+            activation > NN_ACTIVATION_SIGMOID) {
+            write_log("%s: bad shape or activation of layer %u\n", path, l);
+            return RET_FAIL;
+        }
+        layer->inputs = l == 0 ? NN_INPUTS : model->layers[l - 1].outputs;
+        layer->outputs = outputs;
+        layer->activation = activation;
+        layer->stride = padded(layer->inputs);
+        *arenaFloats += (size_t)outputs * layer->stride + padded(outputs);
+
+        if (fseek(fp, ((long)outputs * layer->inputs + outputs) * sizeof(float),
+                  SEEK_CUR) != 0)
+            return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+static int readWeights(FILE *fp, nn_model_t *model) {
+    float *next = model->arena;
+    uint32_t skip;
+
+    if (fseek(fp, sizeof(NN_MAGIC) - 1 + 3 * sizeof(uint32_t), SEEK_SET) != 0 ||
+        readFloats(fp, model->mean, NN_INPUTS) == RET_FAIL ||
+        readFloats(fp, model->scale, NN_INPUTS) == RET_FAIL)
+        return RET_FAIL;
+
+    model->activations[0] = next;
+    model->activations[1] = next + NN_MAX_WIDTH;
+    next += 2 * NN_MAX_WIDTH;
+
+    for (unsigned int l = 0; l < model->layerCount; l++) {
+        nn_layer_t *layer = &model->layers[l];
+
+        layer->weights = next;
+        next += (size_t)layer->outputs * layer->stride;
+        layer->bias = next;
+        next += padded(layer->outputs);
+
+        if (readUint(fp, &skip) == RET_FAIL ||
+            readUint(fp, &skip) == RET_FAIL)
+            return RET_FAIL;
+        for (unsigned int o = 0; o < layer->outputs; o++)
+            if (readFloats(fp, &layer->weights[o * layer->stride],
+                           layer->inputs) == RET_FAIL)
+                return RET_FAIL;
+        if (readFloats(fp, layer->bias, layer->outputs) == RET_FAIL)
+            return RET_FAIL;
+    }
+
+    /* Anything left means the shapes do not describe this file */
+    return fgetc(fp) == EOF ? RET_OK : RET_FAIL;
+}
+
+nn_model_t *nnLoad(const char *path) {
+    nn_model_t *model;
+    size_t arenaFloats;
+    FILE *fp;
+
+    if ((fp = fopen(path, "rb")) == NULL) {
+        write_log("Could not open the model %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if ((model = calloc(1, sizeof(nn_model_t))) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+
+    if (readShape(fp, path, model, &arenaFloats) == RET_FAIL ||
+        posix_memalign(&model->arena, NN_ALIGNMENT,
+                       arenaFloats * sizeof(float)) != 0) {
+        fclose(fp);
+        free(model);
+        return NULL;
+    }
+    /* The padding must be zeros for the kernel to ignore it */
+    memset(model->arena, 0, arenaFloats * sizeof(float));
+
+    if (readWeights(fp, model) == RET_FAIL) {
+        write_log("%s: truncated model, or weights that are not finite\n",
+                  path);
+        fclose(fp);
+        nnFree(model);
+        return NULL;
+    }
+
+    fclose(fp);
+    return model;
+}
+
+void nnFree(nn_model_t *model) {
+    if (model == NULL)
+        return;
+    free(model->arena);
+    free(model);
+}
+
+static inline float activate(unsigned int activation, float x) {
+    switch (activation) {
+    case NN_ACTIVATION_RELU:
+        return x > 0.0f ? x : 0.0f;
+    case NN_ACTIVATION_TANH:
+        return tanhf(x);
+    case NN_ACTIVATION_SIGMOID:
+        return 1.0f / (1.0f + expf(-x));
+    default:
+        return x;
+    }
+}
+
+/* out = activation(weights * in + bias), NN_LANES products at a time */
+static void dense(const nn_layer_t *layer, const float *in, float *out) {
+    const nn_vector_t *x = (const nn_vector_t *)in;
+    unsigned int lanes = layer->stride / NN_LANES;
+
+    for (unsigned int o = 0; o < layer->outputs; o++) {
+        const nn_vector_t *w =
+            (const nn_vector_t *)&layer->weights[o * layer->stride];
+        nn_vector_t acc = {0};
+        float sum = layer->bias[o];
+
+        for (unsigned int l = 0; l < lanes; l++)
+            acc += w[l] * x[l];
+        for (unsigned int k = 0; k < NN_LANES; k++)
+            sum += acc[k];
+        out[o] = activate(layer->activation, sum);
+    }
+    /* The next layer reads up to its stride; a wider layer before may
+     * have left values there */
+    for (unsigned int o = layer->outputs; o < padded(layer->outputs); o++)
+        out[o] = 0.0f;
+}
+
+double nnPredict(nn_model_t *model, const double load[NN_INPUTS]) {
+    float *in = model->activations[0], *out = model->activations[1], *tmp;
+
+    for (unsigned int d = 0; d < NN_INPUTS; d++) {
+        double x = load[d] > 0.0 ? load[d] : 0.0;
+
+        if (d != NN_CPU_USAGE)
+            x = log1p(x);
+        in[d] = (x - model->mean[d]) * model->scale[d];
+    }
+    for (unsigned int d = NN_INPUTS; d < padded(NN_INPUTS); d++)
+        in[d] = 0.0f;
+
+    for (unsigned int l = 0; l < model->layerCount; l++) {
+        dense(&model->layers[l], in, out);
+        tmp = in;
+        in = out;
+        out = tmp;
+    }
+
+    return in[0] > 0.0f ? expm1(in[0]) : 0.0;
+}
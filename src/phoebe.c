@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <math.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -16,15 +17,25 @@
 #include <unistd.h>
 
 #include <dirent.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <dlfcn.h>
 
 #include "algorithmic.h"
+#include "backend.h"
+#include "bandit.h"
+#include "bus.h"
 #include "filehelper.h"
+#include "labels.h"
+#include "loader.h"
 #include "phoebe.h"
 #include "plugins.h"
+#include "regression.h"
+#include "replay.h"
+#include "settings.h"
 #include "stats.h"
+#include "table.h"
 #include "utils.h"
 
 char inputFileName[MAX_FILENAME_LENGTH];
@@ -32,23 +43,65 @@ char settingsFileName[MAX_FILENAME_LENGTH];
 
 static int fileRows = 0;
 
+/* Set by the deprecated -f switch, which overrides rates_filename */
+static char rates_filename[MAX_FILENAME_LENGTH];
+
 static all_values_t reference_values;
-static weights_reference_t weights;
-static double bias;
-static app_settings_t app_settings;
+/* Reloads publish the settings there, the plugins in inference following */
+static settings_store_t settings_store;
+/* The settings read at startup, which the main thread and ABI 1 plugins keep */
+static settings_snapshot_t *settings;
 static tuning_params_t system_settings;
-static label_t labels;
+/* The rows of reference_values matching the labels, which inference searches */
+static all_values_t *partition = &reference_values;
+/* In inference, the table moves to the store, where reloads replace it */
+static table_store_t tables;
+static bool tables_published = false;
 
 static unsigned int registered_plugin_count = 0;
 
 static char operationalMode[MAX_COMMAND_LENGTH];
 static char interfaceName[MAX_INTERFACE_NAME_LENGTH];
 
-static plugin_t *plugins[MAX_PLUGINS];
+static plugin_v2_t *plugins[MAX_PLUGINS];
+/* Version 1 plugins, and their descriptors adapted to version 2 */
+static plugin_t *legacy_plugins[MAX_PLUGINS];
+static plugin_v2_t adapted_plugins[MAX_PLUGINS];
+
+/* Where each plugin was loaded from, so that a reload can swap it */
+typedef struct plugin_file_s {
+    char path[MAX_FILENAME_LENGTH * 2 + 1];
+    /* Not loaded, with a NULL handle, for the skipped files */
+    loaded_file_t loaded;
+    /* Whether its inference thread runs */
+    bool running;
+    /* The settings handed to its init, held until it is unloaded */
+    settings_snapshot_t *settings;
+    /* The subscriptions its init made, dropped when it is unloaded */
+    unsigned int subscriberCount;
+    bus_subscriber_t subscribers[MAX_BUS_SUBSCRIBERS];
+} plugin_file_t;
+
+static plugin_file_t plugin_files[MAX_PLUGINS];
+/* Files which did not register, only tried again once replaced */
+static plugin_file_t skipped_files[MAX_PLUGINS];
+static unsigned int skipped_count = 0;
+
+/* Samples collected once for all the version 2 plugins */
+static sample_bus_t bus;
+static stats_input_param_t collector_params;
 
 static pthread_t *threads;
 static unsigned int n_threads = 1;
 
+/* Signal handlers only post these: the work is done on regular threads */
+static sem_t reload_requested;
+static sem_t stop_requested;
+static volatile sig_atomic_t inference_running = 0;
+
+static void startInference(unsigned int index);
+static void *reloadWorker(void *arg);
+
 void *runStdTraining(void *arg __attribute__((unused))) {
 
     for (unsigned int i = 0; i < registered_plugin_count; i++)
@@ -57,26 +110,275 @@ void *runStdTraining(void *arg __attribute__((unused))) {
     return NULL;
 }
 
-void runLiveTraining() {
+void *runLiveTraining(void *arg __attribute__((unused))) {
 
     for (unsigned int i = 0; i < registered_plugin_count; i++)
         plugins[i]->livetraining(inputFileName);
+
+    return NULL;
 }
 
+/*
+ * The threads of the plugins are swapped by reloads: the main thread waits for
+ * SIGINT or SIGTERM rather than for them, and stops them once no reload runs.
+ */
 void runInference() {
+    pthread_t reloadThread;
 
-    threads = calloc(registered_plugin_count, sizeof(pthread_t));
+    threads = calloc(MAX_PLUGINS, sizeof(pthread_t));
     n_threads = registered_plugin_count;
 
+    inference_running = 1;
     for (unsigned int i = 0; i < n_threads; i++)
-        pthread_create(&threads[i], NULL, plugins[i]->inference, NULL);
+        startInference(i);
+    pthread_create(&reloadThread, NULL, reloadWorker, NULL);
 
-    for (unsigned int i = 0; i < n_threads; i++)
-        pthread_join(threads[i], NULL);
+    while (sem_wait(&stop_requested) != 0)
+        ;
+    pthread_cancel(reloadThread);
+    pthread_join(reloadThread, NULL);
+
+    for (unsigned int i = 0; i < registered_plugin_count; i++)
+        if (plugin_files[i].running)
+            plugins[i]->print_report();
+    for (unsigned int i = 0; i < registered_plugin_count; i++)
+        if (plugin_files[i].running) {
+            pthread_cancel(threads[i]);
+            pthread_join(threads[i], NULL);
+            plugin_files[i].running = false;
+        }
+    fflush(stdout);
     free(threads);
 }
 
+/**
+ * @brief Fits the weights and bias to the table and writes them as a settings
+ *     fragment next to it, reporting how well they and the current ones fit.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if they can't be fitted or saved.
+ */
+int runFit() {
+    fit_result_t fit, current = {.weights = settings->weights,
+                                 .bias = settings->bias};
+
+    fitError(&reference_values, &current);
+
+    if (fitWeights(&reference_values, settings->app.fit_ridge, &fit) ==
+        RET_FAIL) {
+        write_log("Could not fit the weights: the table needs 2 rows or "
+                  "more, and fit_ridge set when its rates are collinear.\n");
+        return RET_FAIL;
+    }
+
+    printf("Fitted over %u rows with a ridge of %g:\n", fit.rows,
+           settings->app.fit_ridge);
+    printf("\ttransfer_rate_weight = %g\n\tdrop_rate_weight = %g\n"
+           "\terrors_rate_weight = %g\n\tfifo_errors_rate_weight = %g\n"
+           "\tbias = %g\n",
+           fit.weights.transfer_rate_weight, fit.weights.drop_rate_weight,
+           fit.weights.errors_rate_weight, fit.weights.fifo_errors_rate_weight,
+           fit.bias);
+    printf("Error against the ranks of the rows: RMSE = %g, max = %g, R2 = %f "
+           "(current weights: RMSE = %g, max = %g, R2 = %f)\n",
+           fit.rmse, fit.maxError, fit.r2, current.rmse, current.maxError,
+           current.r2);
+
+    return saveWeightsToJsonFile(&fit.weights, fit.bias,
+                                 settings->app.rates_filename);
+}
+
+static const char *DECISION_NAMES[] = {"idle", "small delta", "grace period",
+                                       "matched", "interpolated", "missed"};
+
+static void printReplayReport(const replay_report_t *report) {
+    unsigned long searched = report->outcomes[DECISION_MATCHED] +
+                             report->outcomes[DECISION_INTERPOLATED] +
+                             report->outcomes[DECISION_MISSED];
+    double hours = (double)report->virtualUsec / USEC_IN_SEC / 3600;
+
+    printf("Replayed %lu samples, %.2lf hours, in %ld usec: %lu inference "
+           "loops\n",
+           report->samples, hours, report->wallUsec, report->ticks);
+    for (unsigned int o = DECISION_IDLE; o <= DECISION_MISSED; o++)
+        printf("\t%s: %lu\n", DECISION_NAMES[o], report->outcomes[o]);
+    printf("Matches=%lu (interpolated=%lu), Success Rate=%f%%\n",
+           searched - report->outcomes[DECISION_MISSED],
+           report->outcomes[DECISION_INTERPOLATED],
+           searched > 0 ? (double)(searched -
+                                   report->outcomes[DECISION_MISSED]) /
+                              searched * 100
+                        : 0.0);
+    printf("Reconfigurations: %lu (%.2lf per hour), %lu of them to another "
+           "row; seconds between two p50/p99 = %ld/%ld\n",
+           report->reconfigurations,
+           hours > 0 ? report->reconfigurations / hours : 0.0,
+           report->rowChanges, sketchQuantile(&report->interval, 0.50),
+           sketchQuantile(&report->interval, 0.99));
+    for (unsigned long r = 0;
+         r < report->reconfigurations && r < REPLAY_TIMELINE; r++)
+        printf("\t%8.1lfs: row %d (%s)\n",
+               (double)report->timeline[r].time / USEC_IN_SEC,
+               report->timeline[r].row,
+               DECISION_NAMES[report->timeline[r].outcome]);
+    if (report->reconfigurations > REPLAY_TIMELINE)
+        printf("\t...\n\t%8.1lfs: row %d (%s)\n",
+               (double)report->last.time / USEC_IN_SEC, report->last.row,
+               DECISION_NAMES[report->last.outcome]);
+    printf("Decision latency p50/p99 = %ld/%ld nsec\n",
+           sketchQuantile(&report->latency, 0.50),
+           sketchQuantile(&report->latency, 0.99));
+}
+
+/**
+ * @brief Replays the samples of replay_filename through the inference
+ *     decisions against the table, and prints what they would have done.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if the samples can't be replayed.
+ */
+int runReplay() {
+    all_values_t samples = {0};
+    replay_report_t report;
+    unsigned int verbosity = get_verbosity();
+    decision_context_t context = {.values = partition,
+                                  .weights = &settings->weights,
+                                  .bias = settings->bias,
+                                  .settings = &settings->app};
+    int ret;
+
+    if (settings->app.replay_filename[0] == '\0') {
+        write_log("No replay_filename set: nothing to replay.\n");
+        return RET_FAIL;
+    }
+    if (replayLoadSamples(settings->app.replay_filename, &samples) ==
+        RET_FAIL)
+        return RET_FAIL;
+
+    if (settings->app.model_filename[0] != '\0' &&
+        (context.model = nnLoad(settings->app.model_filename)) == NULL)
+        write_log("Could not load the model: matching the table without "
+                  "it.\n");
+    if (context.model == NULL && settings->app.knn_neighbours > 0)
+        context.knnIndex =
+            knnBuild(partition->parameters, partition->validValues);
+
+    /* The per sample messages of the inference would drown the report */
+    if (verbosity < 2)
+        set_verbosity(0);
+    ret = replay(&context, &samples, &report);
+    set_verbosity(verbosity);
+
+    if (ret == RET_OK)
+        printReplayReport(&report);
+
+    knnFree(context.knnIndex);
+    nnFree(context.model);
+    free(samples.parameters);
+    free(samples.labels);
+    return ret;
+}
+
+/* Logs how many of the rows of values the partition keeps */
+static void logPartition(const all_values_t *values) {
+    write_log("Labels %s/%s/%s: searching %u of %u rows\n",
+              labelName(LABEL_GEOGRAPHY, settings->labels.geo),
+              labelName(LABEL_BUSINESS, settings->labels.business),
+              labelName(LABEL_BEHAVIOR, settings->labels.optimize_for),
+              partition->validValues, values->validValues);
+}
+
+/**
+ * @brief Narrows the table searched by the inference down to the partition
+ *     matching the labels of the host.
+ */
+void selectPartition() {
+    partition = labelsPartition(&reference_values, &settings->labels);
+    logPartition(&reference_values);
+}
+
+/**
+ * @brief Moves the table into the store the inference reads it from, which
+ *     partitions and indexes it, so that a reload can replace it.
+ */
+static void publishTable() {
+    table_snapshot_t *first =
+        tableCreate(&reference_values, &settings->labels, &settings->app);
+
+    tableStoreInit(&tables, first);
+    tables_published = true;
+    partition = first->partition;
+    logPartition(&first->values);
+}
+
+/**
+ * @brief Reads the settings file, applying the command line over it.
+ *
+ * @return @ref RET_OK, setting snapshot, or @ref RET_FAIL.
+ */
+static int loadSettings(settings_snapshot_t **snapshot) {
+    if (settingsLoad(settingsFileName, snapshot) == RET_FAIL)
+        return RET_FAIL;
+
+    if (rates_filename[0] != '\0')
+        snprintf((*snapshot)->app.rates_filename, MAX_FILENAME_LENGTH, "%s",
+                 rates_filename);
+    return RET_OK;
+}
+
+/**
+ * @brief Reads the settings file again and publishes it to the plugins, which
+ *     move over to it on their next tick. The settings in use stay if the
+ *     file can't be read.
+ */
+static void reloadSettings() {
+    settings_snapshot_t *snapshot;
+
+    if (loadSettings(&snapshot) == RET_FAIL) {
+        write_log("Could not read %s: keeping settings generation %lu.\n",
+                  settingsFileName, settings_store.current->generation);
+        return;
+    }
+
+    settingsPublish(&settings_store, snapshot);
+    write_log("Published settings generation %lu of %s\n",
+              snapshot->generation, settingsFileName);
+}
+
+/**
+ * @brief Loads, checks and indexes the rates_filename of current, then
+ *     publishes it to the inference, which moves over to it on its next tick.
+ *     The table in use stays if the new one can't replace it, or if a plugin
+ *     of ABI 1, which can't follow, is registered.
+ */
+static void reloadTable(const settings_snapshot_t *current) {
+    table_snapshot_t *snapshot;
+
+    for (unsigned int i = 0; i < registered_plugin_count; i++)
+        if (plugins[i]->abi_version == 1) {
+            write_log("Plugin %s searches the table it was started with (ABI "
+                      "1): restart phoebe to reload the table.\n",
+                      plugins[i]->name);
+            return;
+        }
+
+    if (tableLoad(&current->app, &current->labels, &snapshot) == RET_FAIL) {
+        write_log("Keeping table generation %lu.\n",
+                  tables.current->generation);
+        return;
+    }
+
+    tablePublish(&tables, snapshot);
+    write_log("Published table generation %lu of %s: %u of %u rows match "
+              "the labels\n",
+              snapshot->generation, current->app.rates_filename,
+              snapshot->partition->validValues, snapshot->values.validValues);
+}
+
 void handleSigint(int sig __attribute__((unused))) {
+    /* The main thread stops the inference itself */
+    if (inference_running) {
+        sem_post(&stop_requested);
+        return;
+    }
 
     for (unsigned int i = 0; i < registered_plugin_count; i++)
         plugins[i]->print_report();
@@ -88,24 +390,15 @@ void handleSigint(int sig __attribute__((unused))) {
 }
 
 void handleSighup(int sig __attribute__((unused))) {
-    app_settings_t tmpAppSettings;
-    weights_reference_t tmpWeights;
-    label_t tmpLabels;
-    double tmpBias;
-
-    if (readSettingsFromJsonFile(settingsFileName, &tmpAppSettings, &tmpLabels,
-                                 &tmpWeights, &tmpBias) == RET_OK) {
-        memcpy(&app_settings, &tmpAppSettings, sizeof(app_settings_t));
-        memcpy(&weights, &tmpWeights, sizeof(weights_reference_t));
-        memcpy(&labels, &tmpLabels, sizeof(labels));
-        bias = tmpBias;
-    }
+    /* The settings are read by the reload thread, not in the handler */
+    sem_post(&reload_requested);
 }
 
 void printHelp(char *argv0) {
     printf("Usage: %s [options]\n\n", argv0);
     printf("\t-i, --interface\t\tinterface to monitor\n");
-    printf("\t-m, --mode\t\ttraining | live-training | inference\n");
+    printf("\t-m, --mode\t\ttraining | live-training | inference | fit | "
+           "replay\n");
     printf("\t-s, --settings\t\tJSON file for app-settings\n");
     printf("\t-v, --verbose\t\tBe verbose, repeat to be more verbose\n");
     printf("\t-q, --quite\t\tBe quite, just print startup message\n");
@@ -170,7 +463,9 @@ int handleCommandLineArguments(int argc, char **argv) {
                 strncmp(operationalMode, "live-training",
                         strlen("live-training")) != 0 &&
                 strncmp(operationalMode, "inference", strlen("inference")) !=
-                    0) {
+                    0 &&
+                strncmp(operationalMode, "fit", strlen("fit")) != 0 &&
+                strncmp(operationalMode, "replay", strlen("replay")) != 0) {
                 printHelp(argv[0]);
                 return RET_FAIL;
             }
@@ -178,7 +473,7 @@ int handleCommandLineArguments(int argc, char **argv) {
 
         case 'f': {
             printf("Warning: desprecated -f switch used\n");
-            memcpy(app_settings.rates_filename, optarg, strlen(optarg));
+            snprintf(rates_filename, MAX_FILENAME_LENGTH, "%s", optarg);
         } break;
 
         case 's': {
@@ -226,61 +521,430 @@ int endsWith(const char *str, const char *suffix) {
     return strncmp(str + lenstr - lensuffix, suffix, lensuffix) == 0;
 }
 
+static plugin_v2_t *adaptLegacyPlugin(plugin_t *plugin, unsigned int index) {
+    plugin_v2_t *adapted = &adapted_plugins[index];
+
+    legacy_plugins[index] = plugin;
+
+    memset(adapted, 0, sizeof(plugin_v2_t));
+    adapted->abi_version = 1;
+    adapted->active = plugin->active;
+    memcpy(adapted->name, plugin->name, PLUGIN_NAME_LEN);
+    adapted->version = plugin->version;
+    adapted->inference = plugin->inference;
+    adapted->training = plugin->training;
+    adapted->livetraining = plugin->livetraining;
+    adapted->destroy = plugin->destroy;
+    adapted->print_report = plugin->print_report;
+
+    return adapted;
+}
+
+/**
+ * @brief Opens the plugin at path, a version 1 one being adapted into the
+ *     slot index.
+ *
+ * @return The plugin, setting loaded, or NULL if it can't be opened.
+ */
+static plugin_v2_t *openPlugin(const char *path, unsigned int index,
+                               loaded_file_t *loaded) {
+    plugin_v2_t *(*getPluginInstanceV2)();
+    plugin_t *(*getPluginInstance)();
+    char *error;
+
+    printf("Loading plugin %s\n", path);
+
+    if (loaderOpen(path, loaded) != RET_OK)
+        return NULL;
+
+    dlerror(); /* Clear any existing error */
+
+    *(void **)(&getPluginInstanceV2) = dlsym(loaded->handle, "registerMeV2");
+    if (dlerror() == NULL)
+        return getPluginInstanceV2();
+
+    *(void **)(&getPluginInstance) = dlsym(loaded->handle, "registerMe");
+    if ((error = dlerror()) != NULL) {
+        write_log("%s\n", error);
+        loaderClose(loaded);
+        return NULL;
+    }
+
+    return adaptLegacyPlugin(getPluginInstance(), index);
+}
+
+/**
+ * @brief Initializes the plugin of the slot index: a version 1 one with the
+ *     arguments it was written for, a version 2 one once the bus can give it
+ *     the metrics and knobs it declares.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if it must not be registered.
+ */
+static int initPlugin(plugin_v2_t *plugin, unsigned int index) {
+    plugin_file_t *file = &plugin_files[index];
+    unsigned int first = bus.subscriberCount;
+    settings_snapshot_t *current;
+    int ret;
+
+    /* It keeps the partition, which reloadTable() then never replaces */
+    if (plugin->abi_version == 1) {
+        legacy_plugins[index]->init(
+            interfaceName, &settings->app, &system_settings,
+            &settings->weights,
+            tables_published ? tables.current->partition : partition,
+            settings->bias, get_verbosity());
+        return RET_OK;
+    }
+
+    if (plugin->abi_version > PLUGIN_ABI_VERSION) {
+        write_log("Plugin %s needs plugin ABI %u; this phoebe has %u.\n",
+                  plugin->name, plugin->abi_version, PLUGIN_ABI_VERSION);
+        return RET_FAIL;
+    }
+    if (busAttach(&bus, plugin->metrics, plugin->knobs) == RET_FAIL) {
+        write_log("Plugin %s reads metrics not collected or writes knobs "
+                  "already written by another plugin.\n",
+                  plugin->name);
+        return RET_FAIL;
+    }
+
+    /* A plugin loaded by a reload starts from the settings it published */
+    current = settingsAcquire(&settings_store);
+    plugin_context_t context = {
+        .interfaceName = interfaceName,
+        .settings = &current->app,
+        .systemSettings = &system_settings,
+        .weights = &current->weights,
+        .values = tables_published ? NULL : partition,
+        .bias = current->bias,
+        .verbosity = get_verbosity(),
+        .bus = &bus,
+        .labels = &current->labels,
+        .tables = tables_published ? &tables : NULL,
+        .settingsStore = tables_published ? &settings_store : NULL};
+
+    /* Plugins only subscribe from their init, which runs one at a time */
+    ret = plugin->init(&context);
+    file->subscriberCount = bus.subscriberCount - first;
+    memcpy(file->subscribers, &bus.subscribers[first],
+           file->subscriberCount * sizeof(bus_subscriber_t));
+
+    if (ret != RET_OK) {
+        busDetach(&bus, plugin->knobs, file->subscribers,
+                  file->subscriberCount);
+        settingsRelease(current);
+        return ret;
+    }
+    file->settings = current;
+    return RET_OK;
+}
+
+/**
+ * @brief Starts one collector per metric read by the version 2 plugins,
+ *     publishing on the bus, for the metrics not collected yet.
+ */
+static void startCollectors() {
+    static void *(*const collectors[BUS_METRICS])(void *) = {
+        collectStats, collectCpuStats, collectPressureStats,
+        collectPerCpuStats, collectDiskStats, collectMemoryStats};
+    static unsigned int collecting = 0;
+    pthread_t threadId;
+
+    memcpy(collector_params.monitored_interface, interfaceName,
+           MAX_INTERFACE_NAME_LENGTH);
+    collector_params.stats_collection_period =
+        settings->app.stats_collection_period;
+    collector_params.bus = &bus;
+
+    for (unsigned int metric = 0; metric < BUS_METRICS; metric++)
+        if ((bus.requested & ~collecting) & BUS_METRIC_MASK(metric)) {
+            pthread_create(&threadId, NULL, collectors[metric],
+                           &collector_params);
+            pthread_detach(threadId);
+            collecting |= BUS_METRIC_MASK(metric);
+        }
+}
+
+/* Records the file loaded from path, or the one there if loaded is NULL */
+static void recordFile(plugin_file_t *file, const char *path,
+                       const loaded_file_t *loaded) {
+    struct stat st;
+
+    snprintf(file->path, sizeof(file->path), "%s", path);
+    if (loaded != NULL) {
+        file->loaded = *loaded;
+        return;
+    }
+
+    memset(&file->loaded, 0, sizeof(loaded_file_t));
+    file->loaded.fd = -1;
+    if (stat(path, &st) == 0) {
+        file->loaded.device = st.st_dev;
+        file->loaded.inode = st.st_ino;
+        file->loaded.modified = st.st_mtim;
+    }
+}
+
+static bool sameFile(const plugin_file_t *file, const struct stat *st) {
+    const loaded_file_t *loaded = &file->loaded;
+
+    return loaded->device == st->st_dev && loaded->inode == st->st_ino &&
+           loaded->modified.tv_sec == st->st_mtim.tv_sec &&
+           loaded->modified.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static plugin_file_t *skippedFile(const char *path) {
+    for (unsigned int i = 0; i < skipped_count; i++)
+        if (strcmp(skipped_files[i].path, path) == 0)
+            return &skipped_files[i];
+    return NULL;
+}
+
+/**
+ * @brief Initializes a plugin opened from path and registers it in the next
+ *     slot, closing it if it is inactive or fails to initialize.
+ *
+ * @return @ref RET_OK or @ref RET_FAIL if it was not registered.
+ */
+static int addPlugin(const char *path, plugin_v2_t *plugin,
+                     loaded_file_t *loaded) {
+    plugin_file_t *skipped;
+
+    if (!plugin->active ||
+        initPlugin(plugin, registered_plugin_count) != RET_OK) {
+        loaderClose(loaded);
+        if ((skipped = skippedFile(path)) == NULL &&
+            skipped_count < MAX_PLUGINS)
+            skipped = &skipped_files[skipped_count++];
+        if (skipped != NULL)
+            recordFile(skipped, path, NULL);
+        return RET_FAIL;
+    }
+
+    plugins[registered_plugin_count] = plugin;
+    recordFile(&plugin_files[registered_plugin_count], path, loaded);
+    write_log("Registered plugin %s (ABI %u)\n", plugin->name,
+              plugin->abi_version);
+
+    registered_plugin_count++;
+    return RET_OK;
+}
+
 /**
  * @brief Registers all plugins found in the plugins_path folder.
  *
  * @return The number of plugins that were loaded.
  */
 int registerAllPlugins() {
-    void *handle;
-    char *error;
-
     char resolved_path[MAX_FILENAME_LENGTH * 2 + 1];
+    plugin_v2_t *plugin;
+    loaded_file_t loaded;
     DIR *d;
     struct dirent *dir;
 
-    d = opendir(app_settings.plugins_path);
+    d = opendir(settings->app.plugins_path);
     if (d) {
         while ((dir = readdir(d)) != NULL) {
-            if (endsWith(dir->d_name, ".so")) {
-                sprintf(resolved_path, "%s/%s", app_settings.plugins_path,
-                        dir->d_name);
-                printf("Loading plugin %s\n", resolved_path);
-
-                handle = dlopen(resolved_path, RTLD_NOW);
-                if (!handle) {
-                    write_log("%s\n", dlerror());
+            if (endsWith(dir->d_name, ".so") &&
+                registered_plugin_count < MAX_PLUGINS) {
+                snprintf(resolved_path, sizeof(resolved_path), "%s/%s",
+                         settings->app.plugins_path, dir->d_name);
+
+                if ((plugin = openPlugin(resolved_path,
+                                         registered_plugin_count, &loaded)) ==
+                    NULL)
                     exit(EXIT_FAILURE);
-                }
+                addPlugin(resolved_path, plugin, &loaded);
+            }
+        }
+        closedir(d);
+    }
+
+    startCollectors();
+
+    return registered_plugin_count;
+}
 
-                dlerror(); /* Clear any existing error */
+static void startInference(unsigned int index) {
+    pthread_create(&threads[index], NULL, plugins[index]->inference, NULL);
+    plugin_files[index].running = true;
+}
 
-                plugin_t *(*getPluginInstance)();
-                *(void **)(&getPluginInstance) = dlsym(handle, "registerMe");
+/* Stops the inference thread of a plugin between two ticks, then the plugin */
+static void drainPlugin(unsigned int index) {
+    plugin_v2_t *plugin = plugins[index];
+    plugin_file_t *file = &plugin_files[index];
 
-                error = dlerror();
+    if (file->running) {
+        pthread_cancel(threads[index]);
+        pthread_join(threads[index], NULL);
+        file->running = false;
+    }
+    if (plugin->destroy != NULL)
+        plugin->destroy();
+    busDetach(&bus, plugin->knobs, file->subscribers, file->subscriberCount);
+    settingsRelease(file->settings);
+    file->settings = NULL;
+}
 
-                if (error != NULL) {
-                    write_log("%s\n", error);
-                    exit(EXIT_FAILURE);
-                }
+/**
+ * @brief Replaces the plugin of the slot index with the one now at path: the
+ *     new one is opened first, from its own file, the old one drained, and
+ *     restarted should the new one fail to initialize. The core keeps
+ *     collecting meanwhile.
+ */
+static void swapPlugin(unsigned int index, const char *path) {
+    plugin_v2_t *old = plugins[index], *next;
+    loaded_file_t loaded;
+
+    if (old->abi_version == 1) {
+        write_log("Plugin %s collects its own samples (ABI 1): restart "
+                  "phoebe to update it.\n",
+                  old->name);
+        return;
+    }
+    if ((next = openPlugin(path, index, &loaded)) == NULL)
+        return;
+    if (loaded.handle == plugin_files[index].loaded.handle) {
+        write_log("%s loaded as the plugin running: keeping it.\n", path);
+        loaderClose(&loaded);
+        return;
+    }
+    if (next->abi_version == 1 || !next->active) {
+        write_log("Plugin %s from %s is inactive or of ABI 1: keeping the "
+                  "one running.\n",
+                  next->name, path);
+        loaderClose(&loaded);
+        return;
+    }
 
-                plugin_t *plugin = getPluginInstance();
+    write_log("Swapping plugin %s ver. %g for ver. %g\n", old->name,
+              old->version, next->version);
+    drainPlugin(index);
+
+    if (initPlugin(next, index) != RET_OK) {
+        write_log("Plugin %s from %s failed to start: restarting the one it "
+                  "replaces.\n",
+                  next->name, path);
+        loaderClose(&loaded);
+        if (initPlugin(old, index) == RET_OK)
+            startInference(index);
+        else
+            write_log("Could not restart plugin %s.\n", old->name);
+        return;
+    }
 
-                if (plugin->active) {
-                    plugins[registered_plugin_count] = plugin;
+    loaderClose(&plugin_files[index].loaded);
+    plugins[index] = next;
+    recordFile(&plugin_files[index], path, &loaded);
+    startInference(index);
+}
 
-                    plugins[registered_plugin_count]->init(
-                        interfaceName, &app_settings, &system_settings,
-                        &weights, &reference_values, bias, get_verbosity());
+/**
+ * @brief Swaps the plugins whose file was replaced or rewritten, and loads
+ *     those added to the plugins_path of current or replaced since they failed
+ *     to register.
+ *     A plugin whose file was removed keeps running.
+ */
+static void reloadPlugins(const settings_snapshot_t *current) {
+    char path[MAX_FILENAME_LENGTH * 2 + 1];
+    plugin_v2_t *plugin;
+    struct stat st;
+    struct dirent *dir;
+    loaded_file_t loaded;
+    DIR *d;
 
-                    registered_plugin_count++;
-                }
+    if ((d = opendir(current->app.plugins_path)) == NULL)
+        return;
+
+    while ((dir = readdir(d)) != NULL) {
+        plugin_file_t *skipped;
+        unsigned int i = 0;
+
+        if (!endsWith(dir->d_name, ".so"))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", current->app.plugins_path,
+                 dir->d_name);
+        if (stat(path, &st) != 0)
+            continue;
+
+        while (i < registered_plugin_count &&
+               strcmp(plugin_files[i].path, path) != 0)
+            i++;
+
+        if (i == registered_plugin_count) {
+            if ((skipped = skippedFile(path)) != NULL && sameFile(skipped, &st))
+                continue;
+            if (registered_plugin_count < MAX_PLUGINS &&
+                (plugin = openPlugin(path, i, &loaded)) != NULL &&
+                addPlugin(path, plugin, &loaded) == RET_OK) {
+                startCollectors();
+                startInference(i);
+                n_threads = registered_plugin_count;
             }
+            continue;
         }
-        closedir(d);
+
+        /* The plugin runs from a copy: its file's inode may be reused */
+        if (sameFile(&plugin_files[i], &st))
+            continue;
+        swapPlugin(i, path);
     }
-    return registered_plugin_count;
+    closedir(d);
+}
+
+/*
+ * Runs the reloads SIGHUP asks for, one at a time and never while the main
+ * thread stops the inference; those asked for during one are coalesced.
+ */
+static void *reloadWorker(void *arg __attribute__((unused))) {
+    settings_snapshot_t *current;
+
+    while (1) {
+        if (sem_wait(&reload_requested) != 0)
+            continue;
+        while (sem_trywait(&reload_requested) == 0)
+            ;
+
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        reloadSettings();
+        current = settingsAcquire(&settings_store);
+        reloadTable(current);
+        reloadPlugins(current);
+        settingsRelease(current);
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    }
+
+    return NULL;
+}
+
+/* Reads the settings found on the host, which the rows are gated against */
+static void readHostSettings() {
+    write_log("Reading system settings...");
+    fflush(stdout);
+    if (readSystemSettings(interfaceName, &system_settings) == RET_OK)
+        write_log("DONE.\n");
+    else
+        write_log("some could not be read, see -v.\n");
+}
+
+/*
+ * Stops what the plugins still run, their apply workers among them, before
+ * the settings and the table they read are freed.
+ */
+static void destroyPlugins() {
+    for (unsigned int i = 0; i < registered_plugin_count; i++)
+        drainPlugin(i);
+}
+
+/* Drops the references of the main thread and of the plugins to the settings */
+static void releaseSettings() {
+    for (unsigned int i = 0; i < registered_plugin_count; i++) {
+        settingsRelease(plugin_files[i].settings);
+        plugin_files[i].settings = NULL;
+    }
+    settingsRelease(settings);
+    settingsStoreDestroy(&settings_store);
 }
 
 int main(int argc, char **argv) {
@@ -288,17 +952,24 @@ int main(int argc, char **argv) {
     (void)argv;
     FILE *inputDataFile;
 
+    sem_init(&reload_requested, 0, 0);
+    sem_init(&stop_requested, 0, 0);
     signal(SIGINT, handleSigint);
     signal(SIGTERM, handleSigint);
     signal(SIGHUP, handleSighup);
 
-    bzero(&app_settings, sizeof(app_settings_t));
     bzero(&system_settings, sizeof(tuning_params_t));
+    busInit(&bus);
 
     // set default verbosity setting before cmdline parsing, so
     // that it can be used before
     if (handleCommandLineArguments(argc, argv) == RET_FAIL)
         exit(RET_FAIL);
+    /* Only the inference reloads: elsewhere SIGHUP must not end the run */
+    if (strncmp(operationalMode, "inference", strlen("inference")) != 0) {
+        signal(SIGHUP, SIG_IGN);
+        write_adv_log("SIGHUP only reloads in inference mode: ignored.\n");
+    }
 #ifdef M_THREADS
     retrieveNumberOfCores(&n_threads);
 #else
@@ -311,15 +982,22 @@ int main(int argc, char **argv) {
 
     write_log("Loading file (%s)...", settingsFileName);
     fflush(stdout);
-    if (readSettingsFromJsonFile(settingsFileName, &app_settings, &labels,
-                                 &weights, &bias) == RET_FAIL)
+    if (loadSettings(&settings) == RET_FAIL)
         exit(1);
+    /* The store keeps the reference of the loading, the main thread another */
+    settingsStoreInit(&settings_store, settings);
+    settings = settingsAcquire(&settings_store);
     write_log("DONE.\n");
 
+    /* Each plugin links its own backend, so the core selects one for its
+     * collectors too; only the plugins apply knobs and log them */
+    if (selectSystemBackend(&settings->app, false) == RET_FAIL)
+        exit(1);
+
     write_log("Loading file (%s)...", inputFileName);
     fflush(stdout);
 
-    inputDataFile = fopen(app_settings.rates_filename, "r");
+    inputDataFile = fopen(settings->app.rates_filename, "r");
     if (inputDataFile == NULL) {
         printf("Error (%d) opening input CSV file.\n\n", errno);
         printHelp(argv[0]);
@@ -327,7 +1005,7 @@ int main(int argc, char **argv) {
     }
 
     if ((fileRows = allocateMemoryBasedOnInputAndMaxLearningValues(
-             inputDataFile, &app_settings, &reference_values)) == RET_FAIL)
+             inputDataFile, &settings->app, &reference_values)) == RET_FAIL)
         printf("allocateMemoryBasedOnInputAndMaxLearningValues(...) error\n");
 
     rewind(inputDataFile);
@@ -341,9 +1019,42 @@ int main(int argc, char **argv) {
     fflush(stdout);
 
     write_log("Memory footprint to hold data: %ld bytes\n",
-              sizeof(tuning_params_t) * reference_values.totalLength +
+              (sizeof(tuning_params_t) + sizeof(label_t)) *
+                      reference_values.totalLength +
                   sizeof(all_values_t));
 
+    /* Fitting needs the table alone */
+    if (strncmp(operationalMode, "fit", strlen("fit")) == 0) {
+        int ret = runFit();
+
+        free(reference_values.parameters);
+        free(reference_values.labels);
+        destroyPlugins();
+        releaseSettings();
+        return ret == RET_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* Inference, and the bandit, only search the rows labelled for this host */
+    if (strncmp(operationalMode, "inference", strlen("inference")) == 0)
+        publishTable();
+    else if (strncmp(operationalMode, "replay", strlen("replay")) == 0 ||
+             (strncmp(operationalMode, "live-training",
+                      strlen("live-training")) == 0 &&
+              settings->app.bandit_policy != BANDIT_OFF))
+        selectPartition();
+
+    /* Replaying needs the table alone as well, and applies nothing */
+    if (strncmp(operationalMode, "replay", strlen("replay")) == 0) {
+        int ret = runReplay();
+
+        labelsPartitionFree(partition, &reference_values);
+        free(reference_values.parameters);
+        free(reference_values.labels);
+        destroyPlugins();
+        releaseSettings();
+        return ret == RET_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if (registerAllPlugins() == 0) {
         write_log("No plugins were registered! Cannot run any training");
         return EXIT_FAILURE;
@@ -382,32 +1093,52 @@ int main(int argc, char **argv) {
 
         srand(time(NULL));
 
-        printf("Augmenting data...\n");
-
-        runLiveTraining();
+        /* The bandit applies the rows it scores, as the inference does */
+        if (settings->app.bandit_policy != BANDIT_OFF) {
+            readHostSettings();
+            printf("Tuning online...\n");
+        } else
+            printf("Augmenting data...\n");
+
+        /* In a thread, so that SIGINT ends a bandit as it ends inference */
+        threads = calloc(1, sizeof(pthread_t));
+        n_threads = 1;
+        pthread_create(&threads[0], NULL, runLiveTraining, NULL);
+        pthread_join(threads[0], NULL);
+        free(threads);
 
         printf("DONE.\n");
 
         // printTable(&allValues);
 
-        printf("Final table length: %d\n", reference_values.validValues);
+        /* The bandit scores the rows of the table without adding any */
+        if (settings->app.bandit_policy == BANDIT_OFF) {
+            printf("Final table length: %d\n", reference_values.validValues);
 
-        unsigned int totalFileEntries =
-            saveTrainedDataToFile(&reference_values, inputFileName);
+            unsigned int totalFileEntries =
+                saveTrainedDataToFile(&reference_values, inputFileName);
 
-        printf("Total entries in file: %d\n", totalFileEntries);
+            printf("Total entries in file: %d\n", totalFileEntries);
+        }
 
     } else if (strncmp(operationalMode, "inference", strlen("inference")) ==
                0) {
 
-        readSystemSettings(&system_settings);
+        readHostSettings();
 
-        printTable(&reference_values);
+        printTable(partition);
 
         runInference();
     }
 
+    destroyPlugins();
+    if (tables_published)
+        tableStoreDestroy(&tables);
+    else
+        labelsPartitionFree(partition, &reference_values);
     free(reference_values.parameters);
+    free(reference_values.labels);
+    releaseSettings();
 
     fflush(stdout);
 
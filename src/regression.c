@@ -0,0 +1,193 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <string.h>
+
+#include "regression.h"
+#include "utils.h"
+
+/* Pivots of the standardized system below this mean collinear rates */
+#define FIT_MIN_PIVOT 1e-10
+/* A hair below 1, so that rounding on the way through the settings file
+ * does not push the sum of the weights over it */
+#define FIT_MAX_WEIGHT_SUM (1.0 - 1e-9)
+
+static inline void rowFeatures(const tuning_params_t *row,
+                               double x[FIT_FEATURES]) {
+    x[FIT_TRANSFER_RATE] = row->transfer_rate;
+    x[FIT_DROP_RATE] = row->drop_rate;
+    x[FIT_ERRORS_RATE] = row->errors_rate;
+    x[FIT_FIFO_ERRORS_RATE] = row->fifo_errors_rate;
+}
+
+/* The rank of row i, spread evenly over the transfer rates of the table so
+ * that the tolerances computed from the weighted value stay those of a rate */
+static inline double rowTarget(const all_values_t *values, unsigned int i) {
+    unsigned int n = values->validValues;
+    double first = values->parameters[0].transfer_rate;
+    double last = values->parameters[n - 1].transfer_rate;
+
+    return n > 1 ? first + (last - first) * i / (n - 1) : first;
+}
+
+/* Factors the symmetric positive definite a in place into L L^T, of which
+ * only the lower triangle is used and kept */
+static int choleskyFactor(double a[FIT_FEATURES][FIT_FEATURES],
+                          unsigned int n) {
+    for (unsigned int j = 0; j < n; j++) {
+        double d = a[j][j];
+
+        for (unsigned int k = 0; k < j; k++)
+            d -= a[j][k] * a[j][k];
+        if (d <= FIT_MIN_PIVOT)
+            return RET_FAIL;
+        a[j][j] = sqrt(d);
+
+        for (unsigned int i = j + 1; i < n; i++) {
+            double s = a[i][j];
+
+            for (unsigned int k = 0; k < j; k++)
+                s -= a[i][k] * a[j][k];
+            a[i][j] = s / a[j][j];
+        }
+    }
+    return RET_OK;
+}
+
+/* Solves L L^T x = b in place: L y = b, then L^T x = y */
+static void choleskySolve(double l[FIT_FEATURES][FIT_FEATURES],
+                          double b[FIT_FEATURES], unsigned int n) {
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int k = 0; k < i; k++)
+            b[i] -= l[i][k] * b[k];
+        b[i] /= l[i][i];
+    }
+    for (unsigned int i = n; i-- > 0;) {
+        for (unsigned int k = i + 1; k < n; k++)
+            b[i] -= l[k][i] * b[k];
+        b[i] /= l[i][i];
+    }
+}
+
+void fitError(const all_values_t *values, fit_result_t *fit) {
+    double mean = 0.0, sse = 0.0, sst = 0.0;
+    unsigned int n = values->validValues;
+
+    fit->rows = n;
+    fit->rmse = fit->maxError = fit->r2 = 0.0;
+    if (n == 0)
+        return;
+
+    for (unsigned int i = 0; i < n; i++)
+        mean += rowTarget(values, i);
+    mean /= n;
+
+    for (unsigned int i = 0; i < n; i++) {
+        const tuning_params_t *row = &values->parameters[i];
+        double error =
+            calculateWeightedValue(row->transfer_rate, row->drop_rate,
+                                   row->errors_rate, row->fifo_errors_rate,
+                                   &fit->weights, fit->bias) -
+            rowTarget(values, i);
+        double spread = rowTarget(values, i) - mean;
+
+        sse += error * error;
+        sst += spread * spread;
+        if (fabs(error) > fit->maxError)
+            fit->maxError = fabs(error);
+    }
+
+    fit->rmse = sqrt(sse / n);
+    fit->r2 = sst > 0.0 ? 1.0 - sse / sst : (sse == 0.0 ? 1.0 : 0.0);
+}
+
+int fitWeights(const all_values_t *values, double ridge, fit_result_t *fit) {
+    double mean[FIT_FEATURES] = {0}, scale[FIT_FEATURES] = {0};
+    double xtx[FIT_FEATURES][FIT_FEATURES] = {{0}}, xty[FIT_FEATURES] = {0};
+    double a[FIT_FEATURES][FIT_FEATURES], b[FIT_FEATURES];
+    double c[FIT_FEATURES], z[FIT_FEATURES], sum = 0.0;
+    double w[FIT_FEATURES] = {0}, x[FIT_FEATURES], meanY = 0.0;
+    unsigned int n = values->validValues, used[FIT_FEATURES], m = 0;
+
+    if (n < 2)
+        return RET_FAIL;
+
+    for (unsigned int i = 0; i < n; i++) {
+        rowFeatures(&values->parameters[i], x);
+        for (unsigned int f = 0; f < FIT_FEATURES; f++)
+            mean[f] += x[f];
+        meanY += rowTarget(values, i);
+    }
+    for (unsigned int f = 0; f < FIT_FEATURES; f++)
+        mean[f] /= n;
+    meanY /= n;
+
+    /* Centered sums: the rates reach 10^9 and more, and the spread of their
+     * uncentered squares would be lost to rounding */
+    for (unsigned int i = 0; i < n; i++) {
+        double y = rowTarget(values, i) - meanY;
+
+        rowFeatures(&values->parameters[i], x);
+        for (unsigned int f = 0; f < FIT_FEATURES; f++)
+            x[f] -= mean[f];
+        for (unsigned int f = 0; f < FIT_FEATURES; f++) {
+            for (unsigned int g = 0; g <= f; g++)
+                xtx[f][g] += x[f] * x[g];
+            xty[f] += x[f] * y;
+        }
+    }
+
+    /* Standardize, dropping the rates the table does not vary on */
+    for (unsigned int f = 0; f < FIT_FEATURES; f++)
+        if (xtx[f][f] > 0.0) {
+            scale[f] = 1.0 / sqrt(xtx[f][f] / n);
+            used[m++] = f;
+        }
+    for (unsigned int j = 0; j < m; j++) {
+        unsigned int f = used[j];
+
+        for (unsigned int k = 0; k <= j; k++) {
+            unsigned int g = used[k];
+
+            a[j][k] = xtx[f][g] * scale[f] * scale[g] / n;
+        }
+        a[j][j] += ridge > 0.0 ? ridge : 0.0;
+        b[j] = xty[f] * scale[f] / n;
+    }
+
+    if (m > 0 && choleskyFactor(a, m) == RET_FAIL)
+        return RET_FAIL;
+    choleskySolve(a, b, m);
+
+    /* readSettingsFromJsonFile() refuses weights adding up to more than 1:
+     * past that, the least squares solution on the plane where they add up
+     * to 1 is the closest one allowed */
+    for (unsigned int j = 0; j < m; j++) {
+        c[j] = scale[used[j]];
+        sum += b[j] * c[j];
+    }
+    if (sum > FIT_MAX_WEIGHT_SUM) {
+        double cz = 0.0;
+
+        memcpy(z, c, sizeof(z));
+        choleskySolve(a, z, m);
+        for (unsigned int j = 0; j < m; j++)
+            cz += c[j] * z[j];
+        for (unsigned int j = 0; j < m; j++)
+            b[j] -= z[j] * (sum - FIT_MAX_WEIGHT_SUM) / cz;
+    }
+    for (unsigned int j = 0; j < m; j++)
+        w[used[j]] = b[j] * scale[used[j]];
+
+    fit->weights.transfer_rate_weight = w[FIT_TRANSFER_RATE];
+    fit->weights.drop_rate_weight = w[FIT_DROP_RATE];
+    fit->weights.errors_rate_weight = w[FIT_ERRORS_RATE];
+    fit->weights.fifo_errors_rate_weight = w[FIT_FIFO_ERRORS_RATE];
+    fit->bias = meanY;
+    for (unsigned int f = 0; f < FIT_FEATURES; f++)
+        fit->bias -= w[f] * mean[f];
+
+    fitError(values, fit);
+    return RET_OK;
+}
@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "filehelper.h"
+#include "replay.h"
+#include "utils.h"
+
+/* As stats.c keeps the CPU usage, in hundredths of a percent */
+#define CPU_SKETCH_SCALE 100
+
+/* The load_quantile smoothing of the live inference, on the virtual clock */
+static windowed_sketch_t _transferRate, _dropRate, _errorsRate, _fifoErrorsRate,
+    _cpuBusy;
+
+int replayLoadSamples(const char *path, all_values_t *samples) {
+    app_settings_t noLearning;
+    int rows;
+    FILE *fp;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        write_log("Could not open the recording %s: %s\n", path,
+                  strerror(errno));
+        return RET_FAIL;
+    }
+
+    write_log("Loading the recording (%s)...", path);
+    fflush(stdout);
+
+    memset(&noLearning, 0, sizeof(app_settings_t));
+    if ((rows = allocateMemoryBasedOnInputAndMaxLearningValues(
+             fp, &noLearning, samples)) == RET_FAIL) {
+        fclose(fp);
+        return RET_FAIL;
+    }
+    rewind(fp);
+    if (loadFile(fp, rows, samples) == RET_FAIL) {
+        write_log("Could not read the recording %s\n", path);
+        fclose(fp);
+        return RET_FAIL;
+    }
+
+    fclose(fp);
+    write_log("DONE.\n");
+    return RET_OK;
+}
+
+static void recordSample(const tuning_params_t *sample, uint64_t now) {
+    windowedSketchRecord(&_transferRate, sample->transfer_rate, now);
+    windowedSketchRecord(&_dropRate, sample->drop_rate, now);
+    windowedSketchRecord(&_errorsRate, sample->errors_rate, now);
+    windowedSketchRecord(&_fifoErrorsRate, sample->fifo_errors_rate, now);
+    if (!isnan(sample->cpu_usage_percentage))
+        windowedSketchRecord(&_cpuBusy,
+                             sample->cpu_usage_percentage * CPU_SKETCH_SCALE,
+                             now);
+}
+
+/* readLoad() of the inference loop, when the last sample arrived is last */
+static void readLoad(const app_settings_t *settings,
+                     const tuning_params_t *last, uint64_t now,
+                     inference_load_t *load) {
+    double quantile = settings->load_quantile;
+    unsigned int window = settings->load_window;
+
+    memset(load, 0, sizeof(inference_load_t));
+    if (quantile > 0.0) {
+        load->transfer_rate =
+            windowedSketchQuantile(&_transferRate, window, quantile, now);
+        load->drop_rate =
+            windowedSketchQuantile(&_dropRate, window, quantile, now);
+        load->errors_rate =
+            windowedSketchQuantile(&_errorsRate, window, quantile, now);
+        load->fifo_errors_rate =
+            windowedSketchQuantile(&_fifoErrorsRate, window, quantile, now);
+        load->cpu_usage =
+            (double)windowedSketchQuantile(&_cpuBusy, window, quantile, now) /
+            CPU_SKETCH_SCALE;
+        return;
+    }
+
+    /* Before the first sample the rates are still 0 */
+    if (last == NULL)
+        return;
+    load->transfer_rate = last->transfer_rate;
+    load->drop_rate = last->drop_rate;
+    load->errors_rate = last->errors_rate;
+    load->fifo_errors_rate = last->fifo_errors_rate;
+    load->cpu_usage = last->cpu_usage_percentage;
+}
+
+static inline long elapsedNsec(const struct timespec *start,
+                               const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000000L +
+           (end->tv_nsec - start->tv_nsec);
+}
+
+/* The apply of the replay: it only takes note of the decision */
+static void recordReconfiguration(replay_report_t *report,
+                                  const decision_t *decision,
+                                  unsigned long now) {
+    replay_reconfiguration_t *last = &report->last;
+
+    if (report->reconfigurations > 0)
+        sketchRecord(&report->interval, (now - last->time) / USEC_IN_SEC);
+    if (report->reconfigurations == 0 || decision->row != last->row)
+        report->rowChanges++;
+
+    *last = (replay_reconfiguration_t){
+        .time = now, .row = decision->row, .outcome = decision->outcome};
+    if (report->reconfigurations < REPLAY_TIMELINE)
+        report->timeline[report->reconfigurations] = *last;
+    report->reconfigurations++;
+}
+
+int replay(const decision_context_t *context, const all_values_t *samples,
+           replay_report_t *report) {
+    const app_settings_t *settings = context->settings;
+    unsigned long samplePeriod =
+        USEC_IN_SEC * settings->stats_collection_period;
+    unsigned long tickPeriod = USEC_IN_SEC * settings->inference_loop_period;
+    unsigned long end = samples->validValues * samplePeriod;
+    const tuning_params_t *last = NULL;
+    decision_state_t state = {0};
+    struct timespec wallStart, start, stop;
+    unsigned int arrived = 0;
+    decision_t decision;
+
+    if (samplePeriod == 0 || tickPeriod == 0) {
+        write_log("Replaying needs a stats_collection_period and an "
+                  "inference_loop_period above 0.\n");
+        return RET_FAIL;
+    }
+
+    memset(report, 0, sizeof(replay_report_t));
+    windowedSketchInit(&_transferRate);
+    windowedSketchInit(&_dropRate);
+    windowedSketchInit(&_errorsRate);
+    windowedSketchInit(&_fifoErrorsRate);
+    windowedSketchInit(&_cpuBusy);
+    report->samples = samples->validValues;
+
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+    for (unsigned long now = tickPeriod; now <= end; now += tickPeriod) {
+        inference_load_t load;
+
+        /* The samples collected while the inference loop slept */
+        while (arrived < samples->validValues &&
+               (arrived + 1) * samplePeriod <= now) {
+            last = &samples->parameters[arrived++];
+            if (settings->load_quantile > 0.0)
+                recordSample(last, arrived * samplePeriod / USEC_IN_SEC);
+        }
+        readLoad(settings, last, now / USEC_IN_SEC, &load);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        decide(context, &state, &load, tickPeriod, &decision);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+
+        sketchRecord(&report->latency, elapsedNsec(&start, &stop));
+        report->ticks++;
+        report->outcomes[decision.outcome]++;
+        if (decision.outcome == DECISION_MATCHED ||
+            decision.outcome == DECISION_INTERPOLATED)
+            recordReconfiguration(report, &decision, now);
+        report->virtualUsec = now;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    report->wallUsec = elapsedNsec(&wallStart, &stop) / 1000;
+
+    return RET_OK;
+}
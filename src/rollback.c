@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <string.h>
+
+#include "rollback.h"
+
+void rateHistoryRecord(rate_history_t *history, const if_rates_t *rates) {
+    history->rates[history->next] = *rates;
+    history->next = (history->next + 1) % RATE_HISTORY_TICKS;
+    if (history->count < RATE_HISTORY_TICKS)
+        history->count++;
+}
+
+unsigned int rateHistoryTotals(const rate_history_t *history,
+                               unsigned int ticks, rate_totals_t *totals) {
+    memset(totals, 0, sizeof(rate_totals_t));
+    if (ticks > history->count)
+        ticks = history->count;
+
+    for (unsigned int i = 1; i <= ticks; i++) {
+        const if_rates_t *r =
+            &history->rates[(history->next + RATE_HISTORY_TICKS - i) %
+                            RATE_HISTORY_TICKS];
+
+        totals->transfer_rate += r->transfer_rate;
+        totals->drop_rate += r->drop_rate;
+        totals->errors_rate += r->errors_rate;
+    }
+    totals->ticks = ticks;
+
+    return ticks;
+}
+
+bool rateWorse(double baseline, double result, double threshold,
+               bool higherIsBetter) {
+    double margin = fmax(baseline, 1.0) * threshold / 100.0;
+
+    return higherIsBetter ? result < baseline - margin
+                          : result > baseline + margin;
+}
+
+bool rollbackNeeded(const rate_totals_t *baseline, const rate_totals_t *result,
+                    double threshold) {
+    return rateWorse(rateMean(baseline->transfer_rate, baseline->ticks),
+                     rateMean(result->transfer_rate, result->ticks), threshold,
+                     true) ||
+           rateWorse(rateMean(baseline->drop_rate, baseline->ticks),
+                     rateMean(result->drop_rate, result->ticks), threshold,
+                     false) ||
+           rateWorse(rateMean(baseline->errors_rate, baseline->ticks),
+                     rateMean(result->errors_rate, result->ticks), threshold,
+                     false);
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filehelper.h"
+#include "settings.h"
+
+int settingsLoad(char *fileName, settings_snapshot_t **snapshot) {
+    settings_snapshot_t *loaded;
+
+    if ((loaded = calloc(1, sizeof(settings_snapshot_t))) == NULL) {
+        perror(strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (readSettingsFromJsonFile(fileName, &loaded->app, &loaded->labels,
+                                 &loaded->weights,
+                                 &loaded->bias) == RET_FAIL) {
+        free(loaded);
+        return RET_FAIL;
+    }
+
+    loaded->references = 1;
+    *snapshot = loaded;
+    return RET_OK;
+}
+
+void settingsStoreInit(settings_store_t *store, settings_snapshot_t *first) {
+    pthread_mutex_init(&store->lock, NULL);
+    first->generation = 1;
+    store->current = first;
+}
+
+void settingsStoreDestroy(settings_store_t *store) {
+    settingsRelease(store->current);
+    store->current = NULL;
+    pthread_mutex_destroy(&store->lock);
+}
+
+settings_snapshot_t *settingsAcquire(settings_store_t *store) {
+    settings_snapshot_t *snapshot;
+
+    /* Under the lock, current still has the reference of the store */
+    pthread_mutex_lock(&store->lock);
+    snapshot = store->current;
+    __atomic_add_fetch(&snapshot->references, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&store->lock);
+
+    return snapshot;
+}
+
+void settingsRelease(settings_snapshot_t *snapshot) {
+    if (snapshot != NULL &&
+        __atomic_sub_fetch(&snapshot->references, 1, __ATOMIC_SEQ_CST) == 0)
+        free(snapshot);
+}
+
+bool settingsFollow(settings_store_t *store, settings_snapshot_t **held) {
+    settings_snapshot_t *previous = *held;
+
+    if (__atomic_load_n(&store->current, __ATOMIC_ACQUIRE) == previous)
+        return false;
+
+    *held = settingsAcquire(store);
+    settingsRelease(previous);
+    return *held != previous;
+}
+
+void settingsPublish(settings_store_t *store, settings_snapshot_t *snapshot) {
+    settings_snapshot_t *previous;
+
+    pthread_mutex_lock(&store->lock);
+    previous = store->current;
+    snapshot->generation = previous->generation + 1;
+    __atomic_store_n(&store->current, snapshot, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&store->lock);
+
+    settingsRelease(previous);
+}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <math.h>
+#include <string.h>
+
+#include "sketch.h"
+
+/* Slot layout of the 1m, 5m and 1h windows: 6x10s, 5x1m and 12x5m */
+static const unsigned int WINDOW_SLOT_SECONDS[SKETCH_WINDOWS] = {10, 60, 300};
+static const unsigned int WINDOW_SLOTS[SKETCH_WINDOWS] = {6, 5, 12};
+static const char *WINDOW_NAMES[SKETCH_WINDOWS] = {"1m", "5m", "1h"};
+
+static inline unsigned int bucketIndex(uint64_t value) {
+    if (value < SKETCH_SUB_BUCKETS)
+        return value;
+
+    unsigned int msb = 63 - __builtin_clzll(value);
+    unsigned int shift = msb - (SKETCH_SUB_BUCKET_BITS - 1);
+    unsigned int sub = value >> shift;
+
+    return SKETCH_SUB_BUCKETS + (shift - 1) * SKETCH_HALF_SUB_BUCKETS +
+           (sub - SKETCH_HALF_SUB_BUCKETS);
+}
+
+/* Returns the midpoint of the range of values counted by a bucket */
+static inline uint64_t bucketValue(unsigned int index) {
+    if (index < SKETCH_SUB_BUCKETS)
+        return index;
+
+    unsigned int k = index - SKETCH_SUB_BUCKETS;
+    unsigned int shift = k / SKETCH_HALF_SUB_BUCKETS + 1;
+    uint64_t sub = k % SKETCH_HALF_SUB_BUCKETS + SKETCH_HALF_SUB_BUCKETS;
+
+    return (sub << shift) + ((1ULL << shift) >> 1);
+}
+
+static inline uint64_t quantileRank(uint64_t count, double quantile) {
+    if (quantile < 0.0)
+        quantile = 0.0;
+    if (quantile > 1.0)
+        quantile = 1.0;
+
+    uint64_t rank = (uint64_t)ceil(quantile * count);
+    return rank == 0 ? 1 : rank;
+}
+
+void sketchReset(quantile_sketch_t *sketch) {
+    memset(sketch, 0, sizeof(quantile_sketch_t));
+}
+
+void sketchRecord(quantile_sketch_t *sketch, uint64_t value) {
+    sketch->buckets[bucketIndex(value)]++;
+    sketch->count++;
+}
+
+uint64_t sketchQuantile(const quantile_sketch_t *sketch, double quantile) {
+    uint64_t seen = 0;
+
+    if (sketch->count == 0)
+        return 0;
+
+    uint64_t rank = quantileRank(sketch->count, quantile);
+    for (unsigned int i = 0; i < SKETCH_BUCKETS; i++) {
+        seen += sketch->buckets[i];
+        if (seen >= rank)
+            return bucketValue(i);
+    }
+    return bucketValue(SKETCH_BUCKETS - 1);
+}
+
+void windowedSketchInit(windowed_sketch_t *sketch) {
+    memset(sketch, 0, sizeof(windowed_sketch_t));
+
+    for (unsigned int w = 0; w < SKETCH_WINDOWS; w++) {
+        sketch->windows[w].slot_seconds = WINDOW_SLOT_SECONDS[w];
+        sketch->windows[w].slots = WINDOW_SLOTS[w];
+    }
+}
+
+void windowedSketchRecord(windowed_sketch_t *sketch, uint64_t value,
+                          uint64_t now) {
+    for (unsigned int w = 0; w < SKETCH_WINDOWS; w++) {
+        rolling_sketch_t *window = &sketch->windows[w];
+        uint64_t epoch = now / window->slot_seconds;
+        unsigned int i = epoch % window->slots;
+
+        if (window->epochs[i] != epoch) {
+            sketchReset(&window->slot[i]);
+            window->epochs[i] = epoch;
+        }
+        sketchRecord(&window->slot[i], value);
+    }
+}
+
+static inline int slotIsLive(const rolling_sketch_t *window, unsigned int i,
+                             uint64_t now) {
+    uint64_t epoch = now / window->slot_seconds;
+
+    return window->epochs[i] <= epoch &&
+           window->epochs[i] + window->slots > epoch;
+}
+
+uint64_t windowedSketchCount(const windowed_sketch_t *sketch,
+                             unsigned int window, uint64_t now) {
+    const rolling_sketch_t *w = &sketch->windows[window];
+    uint64_t count = 0;
+
+    for (unsigned int i = 0; i < w->slots; i++)
+        if (slotIsLive(w, i, now))
+            count += w->slot[i].count;
+
+    return count;
+}
+
+uint64_t windowedSketchQuantile(const windowed_sketch_t *sketch,
+                                unsigned int window, double quantile,
+                                uint64_t now) {
+    const rolling_sketch_t *w = &sketch->windows[window];
+    unsigned int live[SKETCH_MAX_SLOTS];
+    unsigned int nLive = 0;
+    uint64_t count = 0, seen = 0;
+
+    for (unsigned int i = 0; i < w->slots; i++) {
+        if (slotIsLive(w, i, now) && w->slot[i].count > 0) {
+            live[nLive++] = i;
+            count += w->slot[i].count;
+        }
+    }
+
+    if (count == 0)
+        return 0;
+
+    /* Walk the buckets of all live slots at once instead of merging them
+     * into a temporary sketch first */
+    uint64_t rank = quantileRank(count, quantile);
+    for (unsigned int b = 0; b < SKETCH_BUCKETS; b++) {
+        for (unsigned int i = 0; i < nLive; i++)
+            seen += w->slot[live[i]].buckets[b];
+        if (seen >= rank)
+            return bucketValue(b);
+    }
+    return bucketValue(SKETCH_BUCKETS - 1);
+}
+
+int sketchWindowFromString(const char *window) {
+    for (unsigned int w = 0; w < SKETCH_WINDOWS; w++)
+        if (strcmp(window, WINDOW_NAMES[w]) == 0)
+            return w;
+    return -1;
+}
+
+const char *sketchWindowName(unsigned int window) {
+    if (window >= SKETCH_WINDOWS)
+        return "?";
+    return WINDOW_NAMES[window];
+}
@@ -3,9 +3,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
-#include <linux/ethtool.h>
-#include <linux/sockios.h>
 #include <math.h>
 #include <net/if.h>
 #include <netinet/ip.h>
@@ -15,32 +14,195 @@
 #include <netlink/netlink.h>
 #include <netlink/route/link.h>
 #include <netlink/route/rtnl.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "backend.h"
+#include "bus.h"
+#include "cpu.h"
+#include "io.h"
+#include "rollback.h"
+#include "sketch.h"
 #include "stats.h"
 #include "types.h"
 #include "utils.h"
-
-// Based on https://www.kernel.org/doc/Documentation/cpu-freq/governors.txt
-static const char *GOVERNORS[] = {
-    "performance", "powersave",    "userspace",
-    "ondemand",    "conservative", "schedutil",
-};
+#include "vm.h"
 
 volatile double cpuBusyTime = 0.0;
 
 volatile if_rates_t rates;
 
+static const char *PSI_FILES[PSI_RESOURCES] = {
+    "/proc/pressure/cpu",
+    "/proc/pressure/io",
+    "/proc/pressure/memory",
+};
+
+/* Wake up as soon as tasks stall for 100ms within any 1s window */
+static const char PSI_TRIGGER[] = "some 100000 1000000";
+
+static pthread_mutex_t _pressureLock = PTHREAD_MUTEX_INITIALIZER;
+static psi_stats_t _pressure[PSI_RESOURCES];
+
+/* CPU busy time is recorded in hundredths of a percent */
+#define CPU_SKETCH_SCALE 100
+
+static pthread_once_t _sketchOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t _sketchLock = PTHREAD_MUTEX_INITIALIZER;
+static windowed_sketch_t _transferRateSketch;
+static windowed_sketch_t _dropRateSketch;
+static windowed_sketch_t _errorsRateSketch;
+static windowed_sketch_t _fifoErrorsRateSketch;
+static windowed_sketch_t _cpuBusySketch;
+
+static pthread_mutex_t _rateTotalsLock = PTHREAD_MUTEX_INITIALIZER;
+static rate_totals_t _rateTotals;
+static rate_history_t _rateHistory;
+
 double getCpuBusyTime() { return cpuBusyTime; }
 
+static inline uint64_t monotonicSeconds() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static void initRateSketches() {
+    windowedSketchInit(&_transferRateSketch);
+    windowedSketchInit(&_dropRateSketch);
+    windowedSketchInit(&_errorsRateSketch);
+    windowedSketchInit(&_fifoErrorsRateSketch);
+    windowedSketchInit(&_cpuBusySketch);
+}
+
+static inline void recordRates(const if_rates_t *r) {
+    uint64_t now = monotonicSeconds();
+
+    pthread_once(&_sketchOnce, initRateSketches);
+    pthread_mutex_lock(&_sketchLock);
+    windowedSketchRecord(&_transferRateSketch, r->transfer_rate, now);
+    windowedSketchRecord(&_dropRateSketch, r->drop_rate, now);
+    windowedSketchRecord(&_errorsRateSketch, r->errors_rate, now);
+    windowedSketchRecord(&_fifoErrorsRateSketch, r->fifo_err_rate, now);
+    pthread_mutex_unlock(&_sketchLock);
+}
+
+static inline void addRateTotals(const if_rates_t *r) {
+    pthread_mutex_lock(&_rateTotalsLock);
+    _rateTotals.ticks++;
+    _rateTotals.transfer_rate += r->transfer_rate;
+    _rateTotals.drop_rate += r->drop_rate;
+    _rateTotals.errors_rate += r->errors_rate;
+    rateHistoryRecord(&_rateHistory, r);
+    pthread_mutex_unlock(&_rateTotalsLock);
+}
+
+unsigned int getRateTotalsTicks() {
+    unsigned int ticks;
+
+    pthread_mutex_lock(&_rateTotalsLock);
+    ticks = _rateTotals.ticks;
+    pthread_mutex_unlock(&_rateTotalsLock);
+
+    return ticks;
+}
+
+unsigned int takeRateTotals(rate_totals_t *totals) {
+    pthread_mutex_lock(&_rateTotalsLock);
+    *totals = _rateTotals;
+    memset(&_rateTotals, 0, sizeof(rate_totals_t));
+    pthread_mutex_unlock(&_rateTotalsLock);
+
+    return totals->ticks;
+}
+
+unsigned int restartRateTotals(unsigned int ticks, rate_totals_t *recent) {
+    pthread_mutex_lock(&_rateTotalsLock);
+    rateHistoryTotals(&_rateHistory, ticks, recent);
+    memset(&_rateTotals, 0, sizeof(rate_totals_t));
+    pthread_mutex_unlock(&_rateTotalsLock);
+
+    return recent->ticks;
+}
+
+static inline void recordCpuBusyTime(double busy) {
+    if (isnan(busy))
+        return;
+
+    uint64_t now = monotonicSeconds();
+
+    pthread_once(&_sketchOnce, initRateSketches);
+    pthread_mutex_lock(&_sketchLock);
+    windowedSketchRecord(&_cpuBusySketch, busy * CPU_SKETCH_SCALE, now);
+    pthread_mutex_unlock(&_sketchLock);
+}
+
+static inline void recordLinkRates(const if_rates_t *r) {
+    rates = *r;
+    recordRates(r);
+    addRateTotals(r);
+}
+
+static inline void recordCpuBusy(double busy) {
+    cpuBusyTime = busy;
+    recordCpuBusyTime(busy);
+}
+
+static inline void recordPressure(const psi_stats_t *pressure) {
+    pthread_mutex_lock(&_pressureLock);
+    memcpy(_pressure, pressure, sizeof(_pressure));
+    pthread_mutex_unlock(&_pressureLock);
+}
+
+void recordBusSample(const bus_sample_t *sample,
+                     void *context __attribute__((unused))) {
+    switch (sample->metric) {
+    case BUS_METRIC_LINK:
+        recordLinkRates(&sample->link);
+        break;
+    case BUS_METRIC_CPU:
+        recordCpuBusy(sample->cpu_busy);
+        break;
+    case BUS_METRIC_PRESSURE:
+        recordPressure(sample->pressure);
+        break;
+    }
+}
+
+/* A sample goes to the bus if the collector has one, else straight here */
+static inline void deliverSample(const stats_input_param_t *params,
+                                 bus_sample_t *sample) {
+    if (params != NULL && params->bus != NULL)
+        busPublish(params->bus, sample);
+    else
+        recordBusSample(sample, NULL);
+}
+
+static inline uint64_t sketchQuantileLocked(windowed_sketch_t *sketch,
+                                            unsigned int window,
+                                            double quantile) {
+    uint64_t value;
+
+    if (window >= SKETCH_WINDOWS)
+        return 0;
+
+    pthread_once(&_sketchOnce, initRateSketches);
+    pthread_mutex_lock(&_sketchLock);
+    value = windowedSketchQuantile(sketch, window, quantile,
+                                   monotonicSeconds());
+    pthread_mutex_unlock(&_sketchLock);
+
+    return value;
+}
+
 inline double calculateCpuBusyPercentage(cpu_stats_t *prev, cpu_stats_t *cur) {
     // differentiate: actual value minus the previous one
     double idled = cur->idleTotal - prev->idleTotal;
@@ -53,13 +215,15 @@ inline double calculateCpuBusyPercentage(cpu_stats_t *prev, cpu_stats_t *cur) {
     return NAN;
 }
 
-inline void *collectCpuStats() {
+inline void *collectCpuStats(void *stats_input_params) {
+    bus_sample_t sample = {.metric = BUS_METRIC_CPU};
     cpu_stats_t stats, prev = {0};
     while (1) {
         readCpuStats(&stats);
 
-        cpuBusyTime = calculateCpuBusyPercentage(&prev, &stats);
-        write_adv_log("Busy for : %lf %% of the time.\n", cpuBusyTime);
+        sample.cpu_busy = calculateCpuBusyPercentage(&prev, &stats);
+        deliverSample(stats_input_params, &sample);
+        write_adv_log("Busy for : %lf %% of the time.\n", sample.cpu_busy);
 
         prev = stats;
 
@@ -69,298 +233,384 @@ inline void *collectCpuStats() {
     return NULL;
 }
 
-inline void readCpuStats(cpu_stats_t *stats) {
-    char str[MAX_PROC_STRING_LENGTH];
-    cpu_raw_stats_t raw;
-    memset(&raw, 0, sizeof(cpu_raw_stats_t));
-
-    /*  cpu user nice system idle iowait irq softirq steal guest guest_nice
-     */
-    FILE *fp = fopen("/proc/stat", "r");
-    if (fp == NULL) {
-        perror(strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    fgets(str, MAX_PROC_STRING_LENGTH, fp);
-    sscanf(str, "%s %u %u %u %u %u %u %u %u %u %u", raw.cpu, &raw.user,
-           &raw.nice, &raw.system, &raw.idle, &raw.iowait, &raw.irq,
-           &raw.softirq, &raw.steal, &raw.guest, &raw.guest_nice);
-    fclose(fp);
+void *collectPerCpuStats(void *stats_input_params) {
+    const system_backend_t *backend = systemBackend();
+    stats_input_param_t *params = stats_input_params;
+    cpu_stats_t stats[MAX_BUS_CPUS], prev[MAX_BUS_CPUS];
+    cpu_stats_t beyondStats;
+    unsigned int ids[MAX_BUS_CPUS];
+    char path[MAX_FILENAME_LENGTH], buffer[MAX_SYSCTL_VALUE_LENGTH];
+    bus_sample_t sample = {.metric = BUS_METRIC_CPUS};
+    bus_cpus_t *cpus = &sample.cpus;
+    unsigned int count, beyond;
+    bool truncated = false;
+    FILE *fp;
 
-    stats->idleTotal = raw.idle + raw.iowait;
-    stats->nonIdleTotal =
-        raw.user + raw.nice + raw.system + raw.irq + raw.softirq + raw.steal;
-}
+    while (1) {
+        if ((fp = backend->openFile("/proc/stat")) != NULL) {
+            count = cpuParseStats(fp, stats, ids, MAX_BUS_CPUS);
+            /* A line left over is a CPU the samples have no room for */
+            if (count == MAX_BUS_CPUS && !truncated &&
+                cpuParseStats(fp, &beyondStats, &beyond, 1) == 1) {
+                write_log("Only the first %u CPUs are sampled and tuned.\n",
+                          MAX_BUS_CPUS);
+                truncated = true;
+            }
+            fclose(fp);
+
+            for (unsigned int i = 0; i < count; i++) {
+                /* A CPU going on or offline shifts the ones after it */
+                cpus->busy[i] =
+                    i < cpus->count && cpus->id[i] == ids[i]
+                        ? calculateCpuBusyPercentage(&prev[i], &stats[i])
+                        : NAN;
+                cpus->id[i] = ids[i];
+                prev[i] = stats[i];
+
+                snprintf(path, sizeof(path),
+                         CPUFREQ_CPU_PATH "scaling_cur_freq", ids[i]);
+                cpus->khz[i] = backend->readLine(path, buffer,
+                                                 sizeof(buffer)) == RET_OK
+                                   ? strtoul(buffer, NULL, 10)
+                                   : 0;
+            }
+            cpus->count = count;
+            deliverSample(params, &sample);
+        }
 
-inline int cpuGovernorIndex(const char *query) {
-    for (unsigned long i = 0; i < sizeof(GOVERNORS); i++) {
-        const char *governor = GOVERNORS[i];
-        if (strcmp(query, governor) == 0)
-            // Begin from 1
-            return i + 1;
+        usleep(USEC_IN_SEC * params->stats_collection_period);
     }
-    return -1;
-}
 
-void calculateInterfaceRatesPerSecond(if_stats_t *prev, if_stats_t *cur,
-                                      if_rates_t *rates,
-                                      double stats_collection_period) {
-    rates->transfer_rate =
-        (cur->bytes_total - prev->bytes_total) / stats_collection_period;
-    rates->errors_rate =
-        (cur->errors_total - prev->errors_total) / stats_collection_period;
-    rates->drop_rate =
-        (cur->dropped_total - prev->dropped_total) / stats_collection_period;
-    rates->fifo_err_rate =
-        (cur->fifo_err_total - prev->fifo_err_total) / stats_collection_period;
-
-    if (rates->transfer_rate < rates->min_transfer_rate)
-        rates->min_transfer_rate = rates->transfer_rate;
-    if (rates->transfer_rate > rates->max_transfer_rate)
-        rates->max_transfer_rate = rates->transfer_rate;
+    return NULL;
 }
 
-void *collectStats(void *stats_input_params) {
-    struct rtnl_link *link;
-    struct nl_sock *socket;
-    if_stats_t stats, prevStats;
-    if_rates_t tmpRates;
-
-    char monitored_interface[MAX_INTERFACE_NAME_LENGTH];
+/* Lines of /proc/diskstats read, partitions and virtual devices included */
+#define MAX_DISKSTATS_LINES 512
 
-    memcpy(monitored_interface,
-           ((stats_input_param_t *)stats_input_params)->monitored_interface,
-           MAX_INTERFACE_NAME_LENGTH);
+/* Partitions have no queue of their own, whole devices do */
+static bool hasQueue(const system_backend_t *backend,
+                     const disk_stats_t *disk) {
+    char path[MAX_FILENAME_LENGTH], buffer[MAX_PROC_STRING_LENGTH];
+    char name[MAX_DISK_NAME_LENGTH];
 
-    socket = nl_socket_alloc();
-    nl_connect(socket, NETLINK_ROUTE);
+    /* A copy, for gcc to see how long the name can be */
+    memcpy(name, disk->name, MAX_DISK_NAME_LENGTH);
+    snprintf(path, sizeof(path), BLOCK_QUEUE_PATH "scheduler", name);
+    return backend->readLine(path, buffer, sizeof(buffer)) == RET_OK;
+}
 
-    if (rtnl_link_get_kernel(socket, 0, monitored_interface, &link) >= 0) {
-        readStats(link, &prevStats);
-        rtnl_link_put(link);
-    }
+void *collectDiskStats(void *stats_input_params) {
+    const system_backend_t *backend = systemBackend();
+    stats_input_param_t *params = stats_input_params;
+    disk_stats_t stats[MAX_DISKSTATS_LINES], prev[MAX_DISKSTATS_LINES];
+    /* Whether the device of each line has a queue, i.e. is a whole one */
+    bool queued[MAX_DISKSTATS_LINES];
+    bus_sample_t sample = {.metric = BUS_METRIC_DISKS};
+    bus_disks_t *disks = &sample.disks;
+    unsigned int count, prevCount = 0;
+    FILE *fp;
 
     while (1) {
-        if (rtnl_link_get_kernel(socket, 0, monitored_interface, &link) >= 0) {
-            readStats(link, &stats);
-            rtnl_link_put(link);
-
-            tmpRates.min_transfer_rate = rates.min_transfer_rate;
-            tmpRates.max_transfer_rate = rates.max_transfer_rate;
-            calculateInterfaceRatesPerSecond(
-                &prevStats, &stats, &tmpRates,
-                ((stats_input_param_t *)stats_input_params)
-                    ->stats_collection_period);
-            rates = tmpRates;
-            write_adv_log(
-                "transfer_rate(in+out)=%ld B/s, error_rate(rx+tx)=%ld/s, "
-                "drop_rate(rx+tx)=%ld, fifo_err_rate(rx+tx)=%ld/s\n",
-                rates.transfer_rate, rates.errors_rate, rates.drop_rate,
-                rates.fifo_err_rate);
-
-            prevStats = stats;
-
-            usleep(USEC_IN_SEC * ((stats_input_param_t *)stats_input_params)
-                                     ->stats_collection_period);
+        if ((fp = backend->openFile("/proc/diskstats")) != NULL) {
+            count = ioParseDiskstats(fp, stats, MAX_DISKSTATS_LINES);
+            fclose(fp);
+
+            disks->count = 0;
+            for (unsigned int i = 0; i < count; i++) {
+                const disk_stats_t *disk = &stats[i];
+                bool known =
+                    i < prevCount && strcmp(prev[i].name, disk->name) == 0;
+
+                /* /sys is only looked at again when devices come or go */
+                if (!known) {
+                    queued[i] = hasQueue(backend, disk);
+                    continue;
+                }
+                if (!queued[i] || disks->count == MAX_BUS_DISKS)
+                    continue;
+
+                memcpy(disks->name[disks->count], disk->name,
+                       MAX_DISK_NAME_LENGTH);
+                ioRates(&prev[i], disk, params->stats_collection_period,
+                        &disks->rates[disks->count]);
+                disks->count++;
+            }
+            memcpy(prev, stats, count * sizeof(disk_stats_t));
+            prevCount = count;
+            deliverSample(params, &sample);
         }
-    }
 
-    nl_socket_free(socket);
-
-    write_log("Stats Collection exiting...\n");
+        usleep(USEC_IN_SEC * params->stats_collection_period);
+    }
 
     return NULL;
 }
 
-inline void readStats(struct rtnl_link *link, if_stats_t *stats) {
-    if_raw_stats_t raw;
+static int readMemoryStats(const system_backend_t *backend,
+                           vm_stats_t *stats) {
+    FILE *fp;
 
-    raw.rx_errors = rtnl_link_get_stat(link, RTNL_LINK_RX_ERRORS);
-    raw.tx_errors = rtnl_link_get_stat(link, RTNL_LINK_TX_ERRORS);
-    raw.rx_dropped = rtnl_link_get_stat(link, RTNL_LINK_RX_DROPPED);
-    raw.tx_dropped = rtnl_link_get_stat(link, RTNL_LINK_TX_DROPPED);
-    raw.rx_fifo_err = rtnl_link_get_stat(link, RTNL_LINK_RX_FIFO_ERR);
-    raw.tx_fifo_err = rtnl_link_get_stat(link, RTNL_LINK_TX_FIFO_ERR);
-    raw.bytes_in = rtnl_link_get_stat(link, RTNL_LINK_RX_BYTES);
-    raw.bytes_out = rtnl_link_get_stat(link, RTNL_LINK_TX_BYTES);
+    memset(stats, 0, sizeof(vm_stats_t));
+    if ((fp = backend->openFile("/proc/vmstat")) == NULL)
+        return RET_FAIL;
+    vmParseVmstat(fp, stats);
+    fclose(fp);
+
+    if ((fp = backend->openFile("/proc/meminfo")) == NULL)
+        return RET_FAIL;
+    vmParseMeminfo(fp, stats);
+    fclose(fp);
 
-    stats->bytes_total = raw.bytes_in + raw.bytes_out;
-    stats->errors_total = raw.rx_errors + raw.tx_errors;
-    stats->dropped_total = raw.rx_dropped + raw.tx_dropped;
-    stats->fifo_err_total = raw.rx_fifo_err + raw.tx_fifo_err;
+    /* Without IPv4 there are no TCP buffers to account for */
+    if ((fp = backend->openFile("/proc/net/sockstat")) != NULL) {
+        stats->tcp_pages = vmParseSockstat(fp);
+        fclose(fp);
+    }
 
-    write_adv_log("rx_errors=%ld, tx_errors=%ld, rx_dropped=%ld, "
-                  "tx_dropped=%ld, rx_fifo_err=%ld, tx_fifo_err=%ld, ",
-                  raw.rx_errors, raw.tx_errors, raw.rx_dropped, raw.tx_dropped,
-                  raw.rx_fifo_err, raw.tx_fifo_err);
+    return RET_OK;
 }
 
-struct ifreq *allocInterfaceRequest(const char *ifname) {
-    struct ifreq *ifr;
+void *collectMemoryStats(void *stats_input_params) {
+    const system_backend_t *backend = systemBackend();
+    stats_input_param_t *params = stats_input_params;
+    unsigned long pageKb = sysconf(_SC_PAGESIZE) / 1024;
+    bus_sample_t sample = {.metric = BUS_METRIC_MEMORY};
+    vm_stats_t stats, prev;
+    bool first = true;
 
-    ifr = (struct ifreq *)malloc(sizeof(struct ifreq));
-    if (!ifr) {
-        return NULL;
+    while (1) {
+        if (readMemoryStats(backend, &stats) == RET_OK) {
+            if (!first) {
+                vmRates(&prev, &stats, params->stats_collection_period,
+                        pageKb, &sample.memory);
+                deliverSample(params, &sample);
+            }
+            prev = stats;
+            first = false;
+        }
+
+        usleep(USEC_IN_SEC * params->stats_collection_period);
     }
-    strncpy(ifr->ifr_name, ifname, sizeof(ifr->ifr_name) - 1);
 
-    return ifr;
+    return NULL;
 }
 
-static inline void freeInterfaceRequest(struct ifreq *ifr) { free(ifr); }
-
-struct ifreq *allocRingSizeRequest(const char *ifname) {
-    struct ifreq *ifr;
-    struct ethtool_ringparam *ering;
+inline void readCpuStats(cpu_stats_t *stats) {
+    if (systemBackend()->readCpuStats(stats) != RET_OK) {
+        perror(strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
 
-    ifr = allocInterfaceRequest(ifname);
-    if (!ifr)
-        return NULL;
+int parsePressure(const char *buffer, psi_stats_t *stats) {
+    char kind[8];
+    psi_line_t line;
+    int lines = 0;
+
+    memset(stats, 0, sizeof(psi_stats_t));
+
+    while (buffer != NULL && *buffer != '\0') {
+        if (sscanf(buffer, "%7s avg10=%lf avg60=%lf avg300=%lf total=%lu",
+                   kind, &line.avg10, &line.avg60, &line.avg300,
+                   &line.total) == 5) {
+            if (strcmp(kind, "some") == 0) {
+                stats->some = line;
+                lines++;
+            } else if (strcmp(kind, "full") == 0) {
+                stats->full = line;
+                lines++;
+            }
+        }
 
-    ering =
-        (struct ethtool_ringparam *)malloc(sizeof(struct ethtool_ringparam));
-    if (!ering) {
-        freeInterfaceRequest(ifr);
-        return NULL;
+        buffer = strchr(buffer, '\n');
+        if (buffer != NULL)
+            buffer++;
     }
-    ifr->ifr_data = (char *)ering;
 
-    return ifr;
+    return lines > 0 ? RET_OK : RET_FAIL;
 }
 
-inline void freeRingSizeRequest(struct ifreq *ifr) {
-    free(ifr->ifr_data);
-    freeInterfaceRequest(ifr);
+int readPressure(int fd, psi_stats_t *stats) {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    ssize_t len;
+
+    /* PSI files are regenerated on every read from offset 0, so the same fd
+     * can be reused for the whole lifetime of the collector */
+    len = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0)
+        return RET_FAIL;
+    buffer[len] = '\0';
+
+    return parsePressure(buffer, stats);
 }
 
-inline void readRingSize(int sock, struct ifreq *ifr, if_ring_size_t *stats) {
-    struct ethtool_ringparam *ering = (struct ethtool_ringparam *)ifr->ifr_data;
+static inline int openPressureFile(const char *path, bool *trigger) {
+    int fd;
 
-    ering->cmd = ETHTOOL_GRINGPARAM;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GRINGPARAM failed: %s\n", strerror(errno));
-        return;
+    *trigger = false;
+
+    /* Triggers need a writable fd; fall back to plain polling otherwise */
+    fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd >= 0) {
+        if (write(fd, PSI_TRIGGER, strlen(PSI_TRIGGER) + 1) >= 0) {
+            *trigger = true;
+            return fd;
+        }
+        close(fd);
     }
 
-    stats->rx = ering->rx_pending;
-    stats->tx = ering->tx_pending;
-    return;
+    return open(path, O_RDONLY | O_CLOEXEC);
 }
 
-struct ifreq *allocGetCoalesceRequest(const char *ifname) {
-    struct ifreq *ifr;
-    struct ethtool_coalesce *ecoalesce;
-
-    ifr = allocInterfaceRequest(ifname);
-    if (!ifr)
-        return NULL;
+void *collectPressureStats(void *stats_input_params) {
+    int fds[PSI_RESOURCES];
+    struct pollfd triggers[PSI_RESOURCES];
+    nfds_t nTriggers = 0;
+    int available = 0;
+    psi_stats_t stats;
+    /* Keeps the last values read of the resources failing to be read */
+    bus_sample_t sample = {.metric = BUS_METRIC_PRESSURE};
+
+    int timeout = 1000 * ((stats_input_param_t *)stats_input_params)
+                             ->stats_collection_period;
+
+    for (unsigned int i = 0; i < PSI_RESOURCES; i++) {
+        bool trigger;
+
+        fds[i] = openPressureFile(PSI_FILES[i], &trigger);
+        if (fds[i] < 0)
+            continue;
+
+        available++;
+        if (trigger) {
+            triggers[nTriggers].fd = fds[i];
+            triggers[nTriggers].events = POLLPRI;
+            nTriggers++;
+        }
+    }
 
-    ecoalesce =
-        (struct ethtool_coalesce *)malloc(sizeof(struct ethtool_coalesce));
-    if (!ecoalesce) {
-        freeInterfaceRequest(ifr);
+    if (available == 0) {
+        write_log("Pressure stall information is not available: %s\n",
+                  strerror(errno));
         return NULL;
     }
-    ecoalesce->cmd = ETHTOOL_GCOALESCE;
-    ifr->ifr_data = (char *)ecoalesce;
 
-    return ifr;
-}
+    while (1) {
+        /* A regular timeout keeps the averages fresh, a trigger firing
+         * makes a stall visible to the inference right away */
+        if (nTriggers > 0) {
+            if (poll(triggers, nTriggers, timeout) < 0 && errno != EINTR)
+                nTriggers = 0;
+        } else {
+            usleep(timeout * 1000);
+        }
 
-inline void freeGetCoalesceRequest(struct ifreq *ifr) {
-    free(ifr->ifr_data);
-    freeInterfaceRequest(ifr);
-}
+        for (unsigned int i = 0; i < PSI_RESOURCES; i++) {
+            if (fds[i] < 0 || readPressure(fds[i], &stats) == RET_FAIL)
+                continue;
 
-inline void readCoalesce(int sock, struct ifreq *ifr, if_coalesce_t *stats) {
-    struct ethtool_coalesce *ecoalesce;
+            sample.pressure[i] = stats;
+        }
+        deliverSample(stats_input_params, &sample);
 
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GCOALESCE failed: %s\n", strerror(errno));
-        return;
+        write_adv_log("Stalled (some avg10): cpu=%.2lf%%, io=%.2lf%%, "
+                      "memory=%.2lf%%\n",
+                      sample.pressure[PSI_CPU].some.avg10,
+                      sample.pressure[PSI_IO].some.avg10,
+                      sample.pressure[PSI_MEMORY].some.avg10);
     }
 
-    ecoalesce = (struct ethtool_coalesce *)ifr->ifr_data;
-    stats->rx_coalesce_usecs = ecoalesce->rx_coalesce_usecs;
-    stats->rx_max_coalesced_frames = ecoalesce->rx_max_coalesced_frames;
-    stats->tx_coalesce_usecs = ecoalesce->tx_coalesce_usecs;
-    stats->tx_max_coalesced_frames = ecoalesce->tx_max_coalesced_frames;
-
-    return;
+    return NULL;
 }
 
-struct ifreq *allocGetOffloadsRequest(const char *ifname) {
-    struct ifreq *ifr;
-    struct ethtool_value *evalue;
+double getPressure(unsigned int resource, bool full) {
+    double value;
 
-    ifr = allocInterfaceRequest(ifname);
-    if (!ifr)
-        return NULL;
+    if (resource >= PSI_RESOURCES)
+        return 0.0;
 
-    evalue = (struct ethtool_value *)malloc(sizeof(struct ethtool_value));
-    if (!evalue) {
-        freeInterfaceRequest(ifr);
-        return NULL;
-    }
-    ifr->ifr_data = (char *)evalue;
+    pthread_mutex_lock(&_pressureLock);
+    value = full ? _pressure[resource].full.avg10
+                 : _pressure[resource].some.avg10;
+    pthread_mutex_unlock(&_pressureLock);
 
-    return ifr;
+    return value;
 }
 
-inline void freeGetOffloadsRequest(struct ifreq *ifr) {
-    free(ifr->ifr_data);
-    freeInterfaceRequest(ifr);
+unsigned int getHostState(double busyThreshold, double stallThreshold) {
+    for (unsigned int i = 0; i < PSI_RESOURCES; i++)
+        if (getPressure(i, false) >= stallThreshold)
+            return HOST_STATE_STALLED;
+
+    if (getCpuBusyTime() >= busyThreshold)
+        return HOST_STATE_BUSY;
+
+    return HOST_STATE_OK;
 }
 
-void readOffloads(int sock, struct ifreq *ifr, if_offloads_t *stats) {
-    struct ethtool_value *evalue = (struct ethtool_value *)ifr->ifr_data;
+void calculateInterfaceRatesPerSecond(if_stats_t *prev, if_stats_t *cur,
+                                      if_rates_t *rates,
+                                      double stats_collection_period) {
+    rates->transfer_rate =
+        (cur->bytes_total - prev->bytes_total) / stats_collection_period;
+    rates->errors_rate =
+        (cur->errors_total - prev->errors_total) / stats_collection_period;
+    rates->drop_rate =
+        (cur->dropped_total - prev->dropped_total) / stats_collection_period;
+    rates->fifo_err_rate =
+        (cur->fifo_err_total - prev->fifo_err_total) / stats_collection_period;
 
-    evalue->cmd = ETHTOOL_GRXCSUM;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GRXCSUM failed: %s\n", strerror(errno));
-        return;
-    }
-    stats->rx_chksum_offload = !!evalue->data;
+    if (rates->transfer_rate < rates->min_transfer_rate)
+        rates->min_transfer_rate = rates->transfer_rate;
+    if (rates->transfer_rate > rates->max_transfer_rate)
+        rates->max_transfer_rate = rates->transfer_rate;
+}
 
-    evalue->cmd = ETHTOOL_GTXCSUM;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GTXCSUM failed: %s\n", strerror(errno));
-        return;
-    }
-    stats->tx_chksum_offload = !!evalue->data;
+void *collectStats(void *stats_input_params) {
+    const system_backend_t *backend = systemBackend();
+    void *iface;
+    if_stats_t stats, prevStats;
+    bus_sample_t sample = {.metric = BUS_METRIC_LINK};
 
-    evalue->cmd = ETHTOOL_GGSO;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GGSO failed: %s\n", strerror(errno));
-        return;
-    }
-    stats->general_segmentation_offload = !!evalue->data;
+    char monitored_interface[MAX_INTERFACE_NAME_LENGTH];
 
-    evalue->cmd = ETHTOOL_GTSO;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GTSO failed: %s\n", strerror(errno));
-        return;
-    }
-    stats->tcp_segmentation_offload = !!evalue->data;
+    memcpy(monitored_interface,
+           ((stats_input_param_t *)stats_input_params)->monitored_interface,
+           MAX_INTERFACE_NAME_LENGTH);
 
-    evalue->cmd = ETHTOOL_GGRO;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GGRO failed: %s\n", strerror(errno));
-        return;
+    if ((iface = backend->openInterface(monitored_interface)) == NULL) {
+        write_log("Could not open %s for statistics.\n", monitored_interface);
+        return NULL;
     }
-    stats->general_receive_offload = !!evalue->data;
 
-    evalue->cmd = ETHTOOL_GFLAGS;
-    if (ioctl(sock, SIOCETHTOOL, ifr) == -1) {
-        printf("ETHTOOL_GFLAGS failed: %s\n", strerror(errno));
-        return;
+    backend->readLinkStats(iface, &prevStats);
+
+    while (1) {
+        if (backend->readLinkStats(iface, &stats) == RET_OK) {
+            /* The sample keeps the minimum and maximum from tick to tick */
+            calculateInterfaceRatesPerSecond(
+                &prevStats, &stats, &sample.link,
+                ((stats_input_param_t *)stats_input_params)
+                    ->stats_collection_period);
+            deliverSample(stats_input_params, &sample);
+            write_adv_log(
+                "transfer_rate(in+out)=%ld B/s, error_rate(rx+tx)=%ld/s, "
+                "drop_rate(rx+tx)=%ld, fifo_err_rate(rx+tx)=%ld/s\n",
+                sample.link.transfer_rate, sample.link.errors_rate,
+                sample.link.drop_rate, sample.link.fifo_err_rate);
+
+            prevStats = stats;
+
+            usleep(USEC_IN_SEC * ((stats_input_param_t *)stats_input_params)
+                                     ->stats_collection_period);
+        }
     }
-    stats->large_receive_offload = ETH_FLAG_LRO & evalue->data;
-    stats->rx_vlan_offload = ETH_FLAG_RXVLAN & evalue->data;
-    stats->tx_vlan_offload = ETH_FLAG_TXVLAN & evalue->data;
-    stats->rx_hash = ETH_FLAG_RXHASH & evalue->data;
 
-    return;
+    backend->closeInterface(iface);
+
+    write_log("Stats Collection exiting...\n");
+
+    return NULL;
 }
 
 inline uint64_t getTransferRate() { return rates.transfer_rate; }
@@ -374,3 +624,24 @@ inline uint64_t getFifoErrorsRate() { return rates.fifo_err_rate; }
 inline uint64_t getMinTransferRate() { return rates.min_transfer_rate; }
 
 inline uint64_t getMaxTransferRate() { return rates.max_transfer_rate; }
+
+uint64_t getTransferRateQuantile(unsigned int window, double quantile) {
+    return sketchQuantileLocked(&_transferRateSketch, window, quantile);
+}
+
+uint64_t getDropRateQuantile(unsigned int window, double quantile) {
+    return sketchQuantileLocked(&_dropRateSketch, window, quantile);
+}
+
+uint64_t getErrorsRateQuantile(unsigned int window, double quantile) {
+    return sketchQuantileLocked(&_errorsRateSketch, window, quantile);
+}
+
+uint64_t getFifoErrorsRateQuantile(unsigned int window, double quantile) {
+    return sketchQuantileLocked(&_fifoErrorsRateSketch, window, quantile);
+}
+
+double getCpuBusyTimeQuantile(unsigned int window, double quantile) {
+    return (double)sketchQuantileLocked(&_cpuBusySketch, window, quantile) /
+           CPU_SKETCH_SCALE;
+}
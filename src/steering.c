@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+#include "steering.h"
+#include "utils.h"
+
+#define QUEUE_PATH "/sys/class/net/%s/queues/%s-%u/%s"
+
+int formatCpuMask(unsigned long mask, char *buffer, size_t len) {
+    int n;
+
+    if (mask >> 32)
+        n = snprintf(buffer, len, "%lx,%08lx", mask >> 32, mask & 0xffffffffUL);
+    else
+        n = snprintf(buffer, len, "%lx", mask);
+
+    return n < 0 || (size_t)n >= len ? RET_FAIL : RET_OK;
+}
+
+int parseCpuMask(const char *buffer, unsigned long *mask) {
+    unsigned int digits = 0;
+
+    *mask = 0;
+    for (const char *c = buffer; *c != '\0' && *c != '\n'; c++) {
+        if (*c == ',')
+            continue;
+        if (!isxdigit((unsigned char)*c))
+            return RET_FAIL;
+        /* Masks of more than 64 CPUs keep their lowest bits */
+        *mask = (*mask << 4) |
+                (isdigit((unsigned char)*c) ? *c - '0'
+                                            : tolower((unsigned char)*c) - 'a' +
+                                                  10);
+        digits++;
+    }
+    return digits > 0 ? RET_OK : RET_FAIL;
+}
+
+/* A queue interrupt is named after the interface ("eth0", "eth0-TxRx-0") or
+ * after the device for drivers like virtio_net ("virtio1-input.0") */
+static bool isQueueInterrupt(const char *name, const char *ifname,
+                             const char *device) {
+    size_t len = strlen(ifname);
+
+    if (strncmp(name, ifname, len) == 0 &&
+        (name[len] == '\0' || name[len] == '-'))
+        return true;
+
+    len = device != NULL ? strlen(device) : 0;
+    return len > 0 && strncmp(name, device, len) == 0 && name[len] == '-' &&
+           strcmp(name + len + 1, "config") != 0;
+}
+
+int parseInterrupts(FILE *fp, const char *ifname, const char *device,
+                    irq_queue_t *queues, unsigned int max) {
+    unsigned int cpus = 0, found = 0;
+    char *line = NULL, *next, *end;
+    size_t len = 0;
+
+    /* The header names one column per CPU */
+    if (getline(&line, &len, fp) == -1) {
+        free(line);
+        return RET_FAIL;
+    }
+    for (next = strstr(line, "CPU"); next != NULL; next = strstr(next, "CPU")) {
+        cpus++;
+        next += 3;
+    }
+    if (cpus == 0) {
+        free(line);
+        return RET_FAIL;
+    }
+
+    while (found < max && getline(&line, &len, fp) != -1) {
+        irq_queue_t queue = {0};
+        char *name;
+
+        /* Skips the architecture specific lines, like NMI: */
+        queue.irq = strtoul(line, &end, 10);
+        if (end == line || *end != ':')
+            continue;
+
+        next = end + 1;
+        for (unsigned int cpu = 0; cpu < cpus; cpu++) {
+            unsigned long long count = strtoull(next, &end, 10);
+
+            if (end == next)
+                break;
+            queue.count += count;
+            if (count > 0 && cpu < MAX_STEERING_CPUS)
+                queue.cpus |= 1UL << cpu;
+            next = end;
+        }
+
+        /* The name is the last column */
+        next[strcspn(next, "\n")] = '\0';
+        for (end = next + strlen(next); end > next && isspace(end[-1]); end--)
+            end[-1] = '\0';
+        name = strrchr(next, ' ');
+        name = name != NULL ? name + 1 : next;
+
+        if (isQueueInterrupt(name, ifname, device))
+            queues[found++] = queue;
+    }
+    free(line);
+
+    return found;
+}
+
+static int readQueueFile(const char *ifname, const char *dir,
+                         unsigned int queue, const char *file, char *buffer,
+                         size_t len) {
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), QUEUE_PATH, ifname, dir, queue, file);
+    return systemBackend()->readLine(path, buffer, len);
+}
+
+static int writeQueueFile(const char *ifname, const char *dir,
+                          unsigned int queue, const char *file,
+                          const char *value) {
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), QUEUE_PATH, ifname, dir, queue, file);
+    if (systemBackend()->writeLine(path, value) != RET_OK) {
+        write_log("Could not write %s to %s: %s\n", value, path,
+                  strerror(errno));
+        return RET_FAIL;
+    }
+    return RET_OK;
+}
+
+/* Returns the number of interrupt lines of the interface, or RET_FAIL */
+static int readInterfaceInterrupts(const if_queues_t *queues,
+                                   const char *ifname, irq_queue_t *irqs) {
+    FILE *fp;
+    int found;
+
+    if ((fp = systemBackend()->openFile("/proc/interrupts")) == NULL)
+        return RET_FAIL;
+    found = parseInterrupts(fp, ifname, queues->device, irqs,
+                            MAX_STEERING_QUEUES);
+    fclose(fp);
+
+    return found;
+}
+
+/*
+ * The CPUs the queue interrupts may be serviced on, as set: those which
+ * serviced them so far, in /proc/interrupts, may have been set otherwise
+ * since
+ */
+static int readIrqAffinity(const irq_queue_t *irqs, int found,
+                           unsigned long *cpus) {
+    char buffer[MAX_PROC_STRING_LENGTH], path[PATH_MAX];
+    unsigned long mask;
+
+    *cpus = 0;
+    for (int i = 0; i < found; i++) {
+        snprintf(path, sizeof(path), "/proc/irq/%u/smp_affinity", irqs[i].irq);
+        if (systemBackend()->readLine(path, buffer, sizeof(buffer)) !=
+                RET_OK ||
+            parseCpuMask(buffer, &mask) != RET_OK)
+            return RET_FAIL;
+        *cpus |= mask;
+    }
+    return RET_OK;
+}
+
+unsigned int readSteeringSettings(void *iface, const char *ifname,
+                                  tuning_params_t *settings) {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    irq_queue_t irqs[MAX_STEERING_QUEUES];
+    unsigned long mask, xps = 0;
+    unsigned int failed = 0;
+    if_queues_t queues;
+    int found;
+
+    if (systemBackend()->readQueues(iface, &queues) != RET_OK) {
+        write_adv_log("Could not read the queues of %s\n", ifname);
+        return STEERING_SETTINGS;
+    }
+
+    if (queues.rx > 0) {
+        if (readQueueFile(ifname, "rx", 0, "rps_cpus", buffer,
+                          sizeof(buffer)) == RET_OK &&
+            parseCpuMask(buffer, &mask) == RET_OK)
+            settings->rps_cpus = mask;
+        else
+            failed++;
+
+        if (readQueueFile(ifname, "rx", 0, "rps_flow_cnt", buffer,
+                          sizeof(buffer)) == RET_OK)
+            settings->rps_flow_cnt = strtoul(buffer, NULL, 10);
+        else
+            failed++;
+    }
+
+    for (unsigned int q = 0; q < queues.tx; q++) {
+        if (readQueueFile(ifname, "tx", q, "xps_cpus", buffer,
+                          sizeof(buffer)) != RET_OK ||
+            parseCpuMask(buffer, &mask) != RET_OK) {
+            failed++;
+            break;
+        }
+        xps |= mask;
+        if (q == queues.tx - 1)
+            settings->xps_cpus = xps;
+    }
+
+    if ((found = readInterfaceInterrupts(&queues, ifname, irqs)) < 0 ||
+        readIrqAffinity(irqs, found, &mask) != RET_OK)
+        failed++;
+    else
+        settings->irq_affinity = mask;
+
+    return failed;
+}
+
+static unsigned int maskCpus(unsigned long mask, unsigned int *cpus) {
+    unsigned int n = 0;
+
+    for (unsigned int cpu = 0; cpu < MAX_STEERING_CPUS; cpu++)
+        if (mask & (1UL << cpu))
+            cpus[n++] = cpu;
+    return n;
+}
+
+static int busiestFirst(const void *a, const void *b) {
+    uint64_t countA = ((const irq_queue_t *)a)->count;
+    uint64_t countB = ((const irq_queue_t *)b)->count;
+
+    return countA < countB ? 1 : (countA > countB ? -1 : 0);
+}
+
+static unsigned int applyRps(const char *ifname, const if_queues_t *queues,
+                             unsigned long rpsCpus) {
+    char value[MAX_CPU_MASK_LENGTH];
+    unsigned int failed = 0;
+
+    formatCpuMask(rpsCpus, value, sizeof(value));
+    for (unsigned int q = 0; q < queues->rx; q++)
+        if (writeQueueFile(ifname, "rx", q, "rps_cpus", value) != RET_OK)
+            failed = STEERING_RPS_CPUS;
+    return failed;
+}
+
+static unsigned int applyRpsFlowCount(const char *ifname,
+                                      const if_queues_t *queues,
+                                      unsigned int flowCount) {
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+    sysctl_write_t entry;
+    unsigned int failed = 0;
+
+    snprintf(value, sizeof(value), "%u", flowCount);
+    for (unsigned int q = 0; q < queues->rx; q++)
+        if (writeQueueFile(ifname, "rx", q, "rps_flow_cnt", value) != RET_OK)
+            failed = STEERING_RPS_FLOW_CNT;
+
+    /* The per-queue tables are only used when the global one covers them */
+    sysctlSet(&entry, "net.core.rps_sock_flow_entries", "%u",
+              flowCount * queues->rx);
+    if (systemBackend()->writeSysctls(&entry, 1) != 0) {
+        write_log("Could not set %s to %s: %s\n", entry.name, entry.value,
+                  strerror(entry.error));
+        failed = STEERING_RPS_FLOW_CNT;
+    }
+    return failed;
+}
+
+static unsigned int applyXps(const char *ifname, const if_queues_t *queues,
+                             unsigned long xpsCpus) {
+    unsigned int cpus[MAX_STEERING_CPUS];
+    unsigned int n = maskCpus(xpsCpus, cpus);
+    char value[MAX_CPU_MASK_LENGTH];
+    unsigned int failed = 0;
+
+    for (unsigned int q = 0; q < queues->tx; q++) {
+        formatCpuMask(1UL << cpus[q % n], value, sizeof(value));
+        if (writeQueueFile(ifname, "tx", q, "xps_cpus", value) != RET_OK)
+            failed = STEERING_XPS_CPUS;
+    }
+    return failed;
+}
+
+static unsigned int applyIrqAffinity(const char *ifname,
+                                     const if_queues_t *queues,
+                                     unsigned long irqCpus) {
+    irq_queue_t irqs[MAX_STEERING_QUEUES];
+    unsigned int cpus[MAX_STEERING_CPUS];
+    unsigned int n = maskCpus(irqCpus, cpus);
+    char value[MAX_CPU_MASK_LENGTH], path[PATH_MAX];
+    unsigned int failed = 0;
+    int found;
+
+    if ((found = readInterfaceInterrupts(queues, ifname, irqs)) < 0)
+        return STEERING_IRQ_AFFINITY;
+    if (found == 0)
+        write_adv_log("No interrupts of %s in /proc/interrupts\n", ifname);
+
+    qsort(irqs, found, sizeof(irq_queue_t), busiestFirst);
+    for (int i = 0; i < found; i++) {
+        formatCpuMask(1UL << cpus[i % n], value, sizeof(value));
+        snprintf(path, sizeof(path), "/proc/irq/%u/smp_affinity", irqs[i].irq);
+        if (systemBackend()->writeLine(path, value) != RET_OK) {
+            write_log("Could not write %s to %s: %s\n", value, path,
+                      strerror(errno));
+            failed = STEERING_IRQ_AFFINITY;
+        }
+    }
+    return failed;
+}
+
+#define STEERING_CHANGED(target, applied, field)                               \
+    ((target)->field != 0 &&                                                   \
+     ((applied) == NULL || (applied)->field != (target)->field))
+
+unsigned int applySteering(void *iface, const char *ifname,
+                           const steering_t *target,
+                           const steering_t *applied) {
+    unsigned int failed = 0, requested = 0;
+    if_queues_t queues;
+
+    if (STEERING_CHANGED(target, applied, rps_cpus))
+        requested |= STEERING_RPS_CPUS;
+    if (STEERING_CHANGED(target, applied, rps_flow_cnt))
+        requested |= STEERING_RPS_FLOW_CNT;
+    if (STEERING_CHANGED(target, applied, xps_cpus))
+        requested |= STEERING_XPS_CPUS;
+    if (STEERING_CHANGED(target, applied, irq_affinity))
+        requested |= STEERING_IRQ_AFFINITY;
+
+    if (requested == 0)
+        return 0;
+    if (systemBackend()->readQueues(iface, &queues) != RET_OK) {
+        write_log("Could not read the queues of %s\n", ifname);
+        return requested;
+    }
+
+    if (requested & STEERING_RPS_CPUS)
+        failed |= applyRps(ifname, &queues, target->rps_cpus);
+    if (requested & STEERING_RPS_FLOW_CNT)
+        failed |= applyRpsFlowCount(ifname, &queues, target->rps_flow_cnt);
+    if (requested & STEERING_XPS_CPUS)
+        failed |= applyXps(ifname, &queues, target->xps_cpus);
+    if (requested & STEERING_IRQ_AFFINITY)
+        failed |= applyIrqAffinity(ifname, &queues, target->irq_affinity);
+
+    return failed;
+}
@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <linux/magic.h>
+#include <string.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "sysctl.h"
+#include "types.h"
+#include "utils.h"
+
+typedef struct sysctl_fd_s {
+    char name[MAX_SYSCTL_NAME_LENGTH];
+    int fd;
+    /* errno of the read-write open(2) of a sysctl only opened to be read */
+    int error;
+    bool writable;
+    /* procfs files replace their value on every write, plain files (e.g. a
+     * fake /proc/sys tree) must be truncated */
+    bool truncate;
+} sysctl_fd_t;
+
+static pthread_mutex_t _sysctlLock = PTHREAD_MUTEX_INITIALIZER;
+static sysctl_fd_t _sysctls[MAX_SYSCTLS];
+static unsigned int _sysctlCount = 0;
+static char _sysctlRoot[MAX_FILENAME_LENGTH] = SYSCTL_PROC_PATH;
+
+static void closeAllLocked() {
+    for (unsigned int i = 0; i < _sysctlCount; i++)
+        close(_sysctls[i].fd);
+    _sysctlCount = 0;
+}
+
+void sysctlSetRoot(const char *root) {
+    pthread_mutex_lock(&_sysctlLock);
+    closeAllLocked();
+    snprintf(_sysctlRoot, sizeof(_sysctlRoot), "%s", root);
+    pthread_mutex_unlock(&_sysctlLock);
+}
+
+int sysctlPath(const char *name, char *path, size_t len) {
+    size_t rootLen = strlen(_sysctlRoot);
+
+    if (rootLen + strlen(name) + 1 > len) {
+        errno = ENAMETOOLONG;
+        return RET_FAIL;
+    }
+
+    memcpy(path, _sysctlRoot, rootLen);
+    for (size_t i = 0; name[i] != '\0'; i++)
+        path[rootLen + i] = name[i] == '.' ? '/' : name[i];
+    path[rootLen + strlen(name)] = '\0';
+
+    return RET_OK;
+}
+
+/*
+ * Returns the cached entry of name, opening it on first use, or NULL with
+ * errno set. Only opened sysctls are cached: one missing may show up later,
+ * e.g. once its module is loaded.
+ */
+static sysctl_fd_t *lookupLocked(const char *name) {
+    char path[MAX_FILENAME_LENGTH];
+    struct statfs fs;
+    sysctl_fd_t *entry;
+
+    for (unsigned int i = 0; i < _sysctlCount; i++)
+        if (strcmp(_sysctls[i].name, name) == 0)
+            return &_sysctls[i];
+
+    if (_sysctlCount == MAX_SYSCTLS) {
+        errno = ENFILE;
+        return NULL;
+    }
+
+    entry = &_sysctls[_sysctlCount];
+    entry->error = 0;
+    entry->writable = true;
+
+    if (sysctlPath(name, path, sizeof(path)) == RET_FAIL)
+        return NULL;
+    if ((entry->fd = open(path, O_RDWR | O_CLOEXEC)) < 0) {
+        entry->error = errno;
+        /* still allow reading sysctls we are not allowed to change */
+        if (entry->error != EACCES && entry->error != EPERM)
+            return NULL;
+        if ((entry->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+            return NULL;
+        entry->writable = false;
+    }
+
+    entry->truncate =
+        fstatfs(entry->fd, &fs) == 0 && fs.f_type != PROC_SUPER_MAGIC;
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    _sysctlCount++;
+    return entry;
+}
+
+int sysctlWrite(const char *name, const char *value) {
+    sysctl_fd_t *entry;
+    size_t len = strlen(value);
+    int ret = RET_OK;
+
+    pthread_mutex_lock(&_sysctlLock);
+    entry = lookupLocked(name);
+    if (entry == NULL) {
+        ret = RET_FAIL;
+    } else if (!entry->writable) {
+        errno = entry->error;
+        ret = RET_FAIL;
+    } else if (pwrite(entry->fd, value, len, 0) != (ssize_t)len ||
+               (entry->truncate && ftruncate(entry->fd, len) < 0)) {
+        ret = RET_FAIL;
+    }
+    pthread_mutex_unlock(&_sysctlLock);
+
+    return ret;
+}
+
+int sysctlRead(const char *name, char *value, size_t len) {
+    sysctl_fd_t *entry;
+    ssize_t valueLen = -1;
+
+    pthread_mutex_lock(&_sysctlLock);
+    entry = lookupLocked(name);
+    if (entry != NULL)
+        valueLen = pread(entry->fd, value, len - 1, 0);
+    pthread_mutex_unlock(&_sysctlLock);
+
+    if (valueLen < 0)
+        return RET_FAIL;
+
+    value[valueLen] = '\0';
+    if (valueLen > 0 && value[valueLen - 1] == '\n')
+        value[valueLen - 1] = '\0';
+
+    return RET_OK;
+}
+
+void sysctlSet(sysctl_write_t *entry, const char *name, const char *format,
+               ...) {
+    va_list args;
+
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+
+    va_start(args, format);
+    vsnprintf(entry->value, sizeof(entry->value), format, args);
+    va_end(args);
+
+    entry->error = 0;
+}
+
+unsigned int sysctlWriteBatch(sysctl_write_t *batch, unsigned int count) {
+    unsigned int failed = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        batch[i].error = 0;
+        if (sysctlWrite(batch[i].name, batch[i].value) == RET_FAIL) {
+            batch[i].error = errno;
+            failed++;
+        }
+    }
+
+    return failed;
+}
+
+void sysctlCloseAll() {
+    pthread_mutex_lock(&_sysctlLock);
+    closeAllLocked();
+    pthread_mutex_unlock(&_sysctlLock);
+}
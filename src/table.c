@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filehelper.h"
+#include "labels.h"
+#include "table.h"
+#include "utils.h"
+
+knn_index_t *tableBuildKnn(const all_values_t *values,
+                           const app_settings_t *settings) {
+    struct timespec start, end;
+    knn_index_t *index;
+
+    if (settings->knn_neighbours == 0)
+        return NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if ((index = knnBuild(values->parameters, values->validValues)) == NULL) {
+        write_log("Could not index the table: matching the weighted value "
+                  "instead.\n");
+        return NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    write_log("Indexed %u rows for %u nearest neighbours in %ld usec\n",
+              values->validValues, settings->knn_neighbours,
+              (end.tv_sec - start.tv_sec) * USEC_IN_SEC +
+                  (end.tv_nsec - start.tv_nsec) / 1000);
+
+    return index;
+}
+
+nn_model_t *tableLoadModel(const app_settings_t *settings) {
+    nn_model_t *model;
+
+    if (settings->model_filename[0] == '\0')
+        return NULL;
+
+    if ((model = nnLoad(settings->model_filename)) == NULL) {
+        write_log("Could not load the model: matching the table without "
+                  "it.\n");
+        return NULL;
+    }
+    write_log("Loaded a %u layer model from %s\n", model->layerCount,
+              settings->model_filename);
+
+    return model;
+}
+
+table_snapshot_t *tableCreate(all_values_t *values, const label_t *labels,
+                              const app_settings_t *settings) {
+    table_snapshot_t *snapshot;
+
+    if ((snapshot = calloc(1, sizeof(table_snapshot_t))) == NULL) {
+        perror(strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    snapshot->values = *values;
+    memset(values, 0, sizeof(all_values_t));
+
+    snapshot->partition = labelsPartition(&snapshot->values, labels);
+    snapshot->knnIndex = tableBuildKnn(snapshot->partition, settings);
+    snapshot->model = tableLoadModel(settings);
+
+    return snapshot;
+}
+
+int tableValidate(const all_values_t *values) {
+    if (values->validValues == 0) {
+        write_log("The table has no rows to search.\n");
+        return RET_FAIL;
+    }
+
+    for (unsigned int i = 1; i < values->validValues; i++)
+        if (values->parameters[i].transfer_rate <
+            values->parameters[i - 1].transfer_rate) {
+            write_log("Row %u of the table has a lower transfer rate than the "
+                      "one before it: rows must be sorted by transfer rate.\n",
+                      i + 1);
+            return RET_FAIL;
+        }
+
+    return RET_OK;
+}
+
+static int readTable(const app_settings_t *settings, all_values_t *values) {
+    FILE *fp;
+    int ret;
+
+    if ((fp = fopen(settings->rates_filename, "r")) == NULL) {
+        write_log("Could not open %s: %s\n", settings->rates_filename,
+                  strerror(errno));
+        return RET_FAIL;
+    }
+
+    ret = allocateMemoryBasedOnInputAndMaxLearningValues(fp, settings, values);
+    if (ret != RET_FAIL) {
+        rewind(fp);
+        ret = loadFileChecked(fp, values);
+    }
+    fclose(fp);
+
+    if (ret == RET_FAIL)
+        write_log("Could not read the table of %s\n",
+                  settings->rates_filename);
+    return ret == RET_FAIL ? RET_FAIL : RET_OK;
+}
+
+int tableLoad(const app_settings_t *settings, const label_t *labels,
+              table_snapshot_t **snapshot) {
+    all_values_t values = {0};
+    table_snapshot_t *loaded;
+
+    if (readTable(settings, &values) == RET_FAIL ||
+        tableValidate(&values) == RET_FAIL) {
+        free(values.parameters);
+        free(values.labels);
+        return RET_FAIL;
+    }
+
+    loaded = tableCreate(&values, labels, settings);
+    if (loaded->partition->validValues == 0) {
+        write_log("No row of the table matches the labels of the host.\n");
+        tableFree(loaded);
+        return RET_FAIL;
+    }
+    /* The table in use is better than one searched without what was asked */
+    if ((settings->knn_neighbours > 0 && loaded->knnIndex == NULL) ||
+        (settings->model_filename[0] != '\0' && loaded->model == NULL)) {
+        tableFree(loaded);
+        return RET_FAIL;
+    }
+
+    *snapshot = loaded;
+    return RET_OK;
+}
+
+void tableFree(table_snapshot_t *snapshot) {
+    if (snapshot == NULL)
+        return;
+
+    knnFree(snapshot->knnIndex);
+    nnFree(snapshot->model);
+    labelsPartitionFree(snapshot->partition, &snapshot->values);
+    free(snapshot->values.parameters);
+    free(snapshot->values.labels);
+    free(snapshot);
+}
+
+void tableStoreInit(table_store_t *store, table_snapshot_t *first) {
+    memset(store, 0, sizeof(table_store_t));
+    pthread_mutex_init(&store->lock, NULL);
+    store->epoch = 1;
+    first->generation = 1;
+    store->current = first;
+}
+
+void tableStoreDestroy(table_store_t *store) {
+    tableFree(store->current);
+    store->current = NULL;
+    pthread_mutex_destroy(&store->lock);
+}
+
+int tableReaderRegister(table_store_t *store) {
+    int reader = -1;
+
+    pthread_mutex_lock(&store->lock);
+    for (unsigned int i = 0; i < MAX_TABLE_READERS && reader == -1; i++)
+        if (__atomic_load_n(&store->seen[i], __ATOMIC_SEQ_CST) == 0) {
+            /* No publisher runs: the reader holds no older table */
+            __atomic_store_n(&store->seen[i], store->epoch, __ATOMIC_SEQ_CST);
+            reader = i;
+        }
+    pthread_mutex_unlock(&store->lock);
+
+    return reader;
+}
+
+void tableReaderUnregister(table_store_t *store, int reader) {
+    if (reader >= 0 && reader < MAX_TABLE_READERS)
+        __atomic_store_n(&store->seen[reader], 0, __ATOMIC_SEQ_CST);
+}
+
+table_snapshot_t *tableRead(table_store_t *store, int reader) {
+    /* The epoch first: if it is the one of the last publish, so is the table */
+    unsigned long epoch = __atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST);
+    table_snapshot_t *snapshot =
+        __atomic_load_n(&store->current, __ATOMIC_SEQ_CST);
+
+    __atomic_store_n(&store->seen[reader], epoch, __ATOMIC_SEQ_CST);
+    return snapshot;
+}
+
+/* Whether every reader read the table once the epoch was epoch */
+static bool readersMovedOn(table_store_t *store, unsigned long epoch) {
+    for (unsigned int i = 0; i < MAX_TABLE_READERS; i++) {
+        unsigned long seen = __atomic_load_n(&store->seen[i], __ATOMIC_SEQ_CST);
+
+        if (seen != 0 && seen < epoch)
+            return false;
+    }
+
+    return true;
+}
+
+void tablePublish(table_store_t *store, table_snapshot_t *snapshot) {
+    table_snapshot_t *previous;
+    unsigned long epoch;
+
+    pthread_mutex_lock(&store->lock);
+    epoch = store->epoch + 1;
+    snapshot->generation = epoch;
+    previous = __atomic_exchange_n(&store->current, snapshot, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&store->epoch, epoch, __ATOMIC_SEQ_CST);
+
+    while (!readersMovedOn(store, epoch))
+        usleep(TABLE_GRACE_POLL_USEC);
+    pthread_mutex_unlock(&store->lock);
+
+    tableFree(previous);
+}
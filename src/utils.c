@@ -2,6 +2,7 @@
 // Copyright SUSE LLC
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <math.h>
 #include <netinet/ip.h>
@@ -17,10 +18,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/sysinfo.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "backend.h"
 #include "stats.h"
+#include "steering.h"
 #include "utils.h"
 
 /*
@@ -53,6 +57,8 @@ void _repositionElements(all_values_t *destParams, unsigned int pivot) {
     for (unsigned int i = destParams->validValues; i > pivot; i--) {
         memcpy(&destParams->parameters[i], &destParams->parameters[i - 1],
                sizeof(tuning_params_t));
+        if (destParams->labels != NULL)
+            destParams->labels[i] = destParams->labels[i - 1];
     }
     return;
 }
@@ -290,6 +296,39 @@ extern inline double calculateTolerance(double weightedValue, double eps,
     return toleranceValue;
 }
 
+extern inline int binarySearchWithTolerance(tuning_params_t *parameters, int l,
+                                            int r, double weighted_value,
+                                            double tolerance,
+                                            unsigned int *closestIndex,
+                                            weights_reference_t *weights,
+                                            double bias) {
+    if (r >= l) {
+        unsigned int mid = l + (r - l) / 2;
+
+        double ref_weighted_value = calculateWeightedValue(
+            parameters[mid].transfer_rate, parameters[mid].drop_rate,
+            parameters[mid].errors_rate, parameters[mid].fifo_errors_rate,
+            weights, bias);
+
+        double diff = fabs(weighted_value - ref_weighted_value);
+
+        *closestIndex = mid;
+
+        if (diff <= tolerance)
+            return mid;
+
+        if (parameters[mid].transfer_rate > weighted_value)
+            return binarySearchWithTolerance(parameters, l, mid - 1,
+                                             weighted_value, tolerance,
+                                             closestIndex, weights, bias);
+
+        return binarySearchWithTolerance(parameters, mid + 1, r, weighted_value,
+                                         tolerance, closestIndex, weights,
+                                         bias);
+    }
+    return -1;
+}
+
 void printTable(all_values_t *values) {
 #ifdef PRINT_TABLE
     unsigned int i;
@@ -349,7 +388,11 @@ void printTable(all_values_t *values) {
                "large_receive_offload=%hd,"
                "rx_vlan_offload=%hd,"
                "tx_vlan_offload=%hd,"
-               "rx_hash=%hd\n\n",
+               "rx_hash=%hd,"
+               "rps_cpus=%lx,"
+               "xps_cpus=%lx,"
+               "rps_flow_cnt=%u,"
+               "irq_affinity=%lx\n\n",
                i, values->parameters[i].transfer_rate,
                values->parameters[i].drop_rate,
                values->parameters[i].errors_rate,
@@ -397,7 +440,10 @@ void printTable(all_values_t *values) {
                values->parameters[i].large_receive_offload,
                values->parameters[i].rx_vlan_offload,
                values->parameters[i].tx_vlan_offload,
-               values->parameters[i].rx_hash);
+               values->parameters[i].rx_hash, values->parameters[i].rps_cpus,
+               values->parameters[i].xps_cpus,
+               values->parameters[i].rps_flow_cnt,
+               values->parameters[i].irq_affinity);
     }
     printf("############################################## TABLE CONTENT END "
            "##############################################\n\n");
@@ -406,127 +452,288 @@ void printTable(all_values_t *values) {
 #endif
 }
 
-static inline void parseSystemSetting(tuning_params_t *systemSettings,
-                                      unsigned int field) {
-    FILE *fp;
-    char command[MAX_COMMAND_LENGTH];
-    char param[MAX_COMMAND_LENGTH];
-
-    if (field == RX_RING_SIZE) {
-
-    } else if (field == TX_RING_SIZE) {
-
-    } else if (field == NET_CORE_NETDEV_BUDGET) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.netdev_budget");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %u", param,
-               &(systemSettings->net_core_netdev_budget));
-        fclose(fp);
-    } else if (field == NET_CORE_SOMAXCONN) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.somaxconn");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %u", param,
-               &(systemSettings->net_core_somaxconn));
-        fclose(fp);
-    } else if (field == NET_CORE_NETDEV_MAX_BACKLOG) {
-        snprintf(command, MAX_COMMAND_LENGTH,
-                 "sysctl net.core.netdev_max_backlog");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %u", param,
-               &(systemSettings->net_core_netdev_max_backlog));
-        fclose(fp);
-    } else if (field == TCP_MAX_SYN_BACKLOG) {
-        snprintf(command, MAX_COMMAND_LENGTH,
-                 "sysctl net.ipv4.tcp_max_syn_backlog");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %u", param,
-               &(systemSettings->tcp_max_syn_backlog));
-        fclose(fp);
-    } else if (field == NET_CORE_RMEM_MAX) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.rmem_max");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu", param,
-               &(systemSettings->net_core_rmem_max));
-        fclose(fp);
-    } else if (field == NET_CORE_RMEM_DEFAULT) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.rmem_default");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu", param,
-               &(systemSettings->net_core_rmem_default));
-        fclose(fp);
-    } else if (field == NET_CORE_WMEM_MAX) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.wmem_max");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu", param,
-               &(systemSettings->net_core_wmem_max));
-        fclose(fp);
-    } else if (field == NET_CORE_WMEM_DEFAULT) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.core.wmem_default");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu", param,
-               &(systemSettings->net_core_wmem_default));
-        fclose(fp);
-    } else if (field == TCP_RMEM_0 || field == TCP_RMEM_1 ||
-               field == TCP_RMEM_2) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.ipv4.tcp_rmem");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu\t%lu\t%lu", param,
-               &(systemSettings->tcp_rmem0), &(systemSettings->tcp_rmem1),
-               &(systemSettings->tcp_rmem2));
-        fclose(fp);
-    } else if (field == TCP_WMEM_0 || field == TCP_WMEM_1 ||
-               field == TCP_WMEM_2) {
-        snprintf(command, MAX_COMMAND_LENGTH, "sysctl net.ipv4.tcp_wmem");
-        fp = popen(command, "r");
-        assert(fp != NULL);
-        fgets(command, MAX_COMMAND_LENGTH, fp);
-        sscanf(command, "%s = %lu\t%lu\t%lu", param,
-               &(systemSettings->tcp_wmem0), &(systemSettings->tcp_wmem1),
-               &(systemSettings->tcp_wmem2));
-        fclose(fp);
+// Based on https://www.kernel.org/doc/Documentation/cpu-freq/governors.txt
+static const char *GOVERNORS[] = {
+    "performance", "powersave",    "userspace",
+    "ondemand",    "conservative", "schedutil",
+};
+
+int cpuGovernorIndex(const char *query) {
+    for (unsigned long i = 0; i < sizeof(GOVERNORS) / sizeof(GOVERNORS[0]);
+         i++) {
+        const char *governor = GOVERNORS[i];
+        if (strcmp(query, governor) == 0)
+            // Begin from 1
+            return i + 1;
     }
+    return -1;
+}
+
+const char *cpuGovernorName(int index) {
+    if (index < 1 || index > (int)(sizeof(GOVERNORS) / sizeof(GOVERNORS[0])))
+        return "?";
+    return GOVERNORS[index - 1];
 }
 
-extern inline void readSystemSettings(tuning_params_t *systemSettings) {
-    write_log("Reading system settings...");
-    fflush(stdout);
-
-    parseSystemSetting(systemSettings, RX_RING_SIZE);
-    parseSystemSetting(systemSettings, TX_RING_SIZE);
-    parseSystemSetting(systemSettings, NET_CORE_NETDEV_MAX_BACKLOG);
-    parseSystemSetting(systemSettings, NET_CORE_NETDEV_BUDGET);
-    parseSystemSetting(systemSettings, NET_CORE_SOMAXCONN);
-    parseSystemSetting(systemSettings, NET_CORE_RMEM_MAX);
-    parseSystemSetting(systemSettings, NET_CORE_RMEM_DEFAULT);
-    parseSystemSetting(systemSettings, NET_CORE_WMEM_MAX);
-    parseSystemSetting(systemSettings, NET_CORE_WMEM_DEFAULT);
-    parseSystemSetting(systemSettings, TCP_MAX_SYN_BACKLOG);
-    parseSystemSetting(systemSettings, TCP_RMEM_0);
-    parseSystemSetting(systemSettings, TCP_RMEM_1);
-    parseSystemSetting(systemSettings, TCP_RMEM_2);
-    parseSystemSetting(systemSettings, TCP_WMEM_0);
-    parseSystemSetting(systemSettings, TCP_WMEM_1);
-    parseSystemSetting(systemSettings, TCP_WMEM_2);
-
-    write_log("DONE.\n");
+static const char *IO_SCHEDULERS[] = {"none", "mq-deadline", "kyber", "bfq"};
+
+int ioSchedulerIndex(const char *query) {
+    for (unsigned long i = 0;
+         i < sizeof(IO_SCHEDULERS) / sizeof(IO_SCHEDULERS[0]); i++)
+        if (strcmp(query, IO_SCHEDULERS[i]) == 0)
+            // Begin from 1, like the governors
+            return i + 1;
+    return -1;
+}
+
+const char *ioSchedulerName(int index) {
+    if (index < 1 ||
+        index > (int)(sizeof(IO_SCHEDULERS) / sizeof(IO_SCHEDULERS[0])))
+        return "?";
+    return IO_SCHEDULERS[index - 1];
+}
+
+unsigned int levelUpdate(unsigned int *level, unsigned int *calm,
+                         unsigned int measured, unsigned int calmSamples) {
+    if (measured >= *level) {
+        *level = measured;
+        *calm = 0;
+    } else if (++*calm >= calmSamples) {
+        (*level)--;
+        *calm = 0;
+    }
+
+    return *level;
+}
+
+unsigned int parseSelection(const char *line, int (*indexOf)(const char *),
+                            unsigned short *active) {
+    char buffer[MAX_PROC_STRING_LENGTH];
+    char *rest = buffer, *name;
+    unsigned int choices = 0;
+    int choice;
+
+    *active = 0;
+    snprintf(buffer, sizeof(buffer), "%s", line);
+    while ((name = strsep(&rest, " \t\n")) != NULL) {
+        size_t length = strlen(name);
+        bool selected =
+            length > 2 && name[0] == '[' && name[length - 1] == ']';
+
+        if (selected) {
+            name[length - 1] = '\0';
+            name++;
+        }
+        if (*name == '\0' || (choice = indexOf(name)) == -1)
+            continue;
+        choices |= 1U << choice;
+        if (selected)
+            *active = choice;
+    }
+
+    return choices;
+}
+
+/* Parses count whitespace separated numbers out of a sysctl */
+static int readSysctlValues(const char *name, unsigned long *values,
+                            unsigned int count) {
+    char buffer[MAX_SYSCTL_VALUE_LENGTH];
+    char *next = buffer, *end;
+
+    if (systemBackend()->readSysctl(name, buffer, sizeof(buffer)) !=
+        RET_OK) {
+        int err = errno;
+
+        if (err == ENOENT)
+            write_verb_log("%s is absent.\n", name);
+        else
+            write_adv_log("Could not read %s: %s\n", name, strerror(err));
+        errno = err;
+        return RET_FAIL;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        values[i] = strtoul(next, &end, 10);
+        if (end == next) {
+            write_adv_log("Could not parse %s: '%s'\n", name, buffer);
+            errno = EINVAL;
+            return RET_FAIL;
+        }
+        next = end;
+    }
+    return RET_OK;
+}
+
+/*
+ * A setting absent from the host, like the kernel.sched_* sysctls from 5.13 on,
+ * is left as it is: only those there but unreadable count as failed.
+ */
+#define NOT_READ(failed)                                                       \
+    do {                                                                       \
+        if (errno != ENOENT)                                                   \
+            (failed)++;                                                        \
+    } while (0)
+
+#define READ_SYSCTL(settings, name, field, failed)                             \
+    do {                                                                       \
+        unsigned long value;                                                   \
+        if (readSysctlValues(name, &value, 1) == RET_OK)                       \
+            (settings)->field = value;                                         \
+        else                                                                   \
+            NOT_READ(failed);                                                  \
+    } while (0)
+
+static unsigned int readSysctlSettings(tuning_params_t *settings) {
+    unsigned long values[3];
+    unsigned int failed = 0;
+
+    READ_SYSCTL(settings, "kernel.sched_min_granularity_ns",
+                kernel_sched_min_granularity_ns, failed);
+    READ_SYSCTL(settings, "kernel.sched_wakeup_granularity_ns",
+                kernel_sched_wakeup_granularity_ns, failed);
+    READ_SYSCTL(settings, "kernel.sched_migration_cost_ns",
+                kernel_sched_migration_cost_ns, failed);
+    READ_SYSCTL(settings, "kernel.numa_balancing", kernel_numa_balancing,
+                failed);
+    READ_SYSCTL(settings, "kernel.pid_max", kernel_pid_max, failed);
+    READ_SYSCTL(settings, "net.core.netdev_max_backlog",
+                net_core_netdev_max_backlog, failed);
+    READ_SYSCTL(settings, "net.core.netdev_budget", net_core_netdev_budget,
+                failed);
+    READ_SYSCTL(settings, "net.core.somaxconn", net_core_somaxconn, failed);
+    READ_SYSCTL(settings, "net.core.busy_poll", net_core_busy_poll, failed);
+    READ_SYSCTL(settings, "net.core.busy_read", net_core_busy_read, failed);
+    READ_SYSCTL(settings, "net.core.rmem_max", net_core_rmem_max, failed);
+    READ_SYSCTL(settings, "net.core.wmem_max", net_core_wmem_max, failed);
+    READ_SYSCTL(settings, "net.core.rmem_default", net_core_rmem_default,
+                failed);
+    READ_SYSCTL(settings, "net.core.wmem_default", net_core_wmem_default,
+                failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_fastopen", tcp_fastopen, failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_low_latency", tcp_low_latency, failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_sack", tcp_sack, failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_max_syn_backlog", tcp_max_syn_backlog,
+                failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_tw_reuse", tcp_tw_reuse, failed);
+    /* net.ipv4.tcp_tw_recycle is no longer available */
+    READ_SYSCTL(settings, "net.ipv4.tcp_timestamps", tcp_timestamps, failed);
+    READ_SYSCTL(settings, "net.ipv4.tcp_syn_retries", tcp_syn_retries, failed);
+
+    if (readSysctlValues("net.ipv4.tcp_rmem", values, 3) == RET_OK) {
+        settings->tcp_rmem0 = values[0];
+        settings->tcp_rmem1 = values[1];
+        settings->tcp_rmem2 = values[2];
+    } else
+        NOT_READ(failed);
+
+    if (readSysctlValues("net.ipv4.tcp_wmem", values, 3) == RET_OK) {
+        settings->tcp_wmem0 = values[0];
+        settings->tcp_wmem1 = values[1];
+        settings->tcp_wmem2 = values[2];
+    } else
+        NOT_READ(failed);
+
+    return failed;
+}
+
+/* The ring size, coalescing and offloads read besides the packet steering */
+#define INTERFACE_SETTINGS 3
+
+static unsigned int readInterfaceSettings(const char *interfaceName,
+                                          tuning_params_t *settings) {
+    if_ring_size_t ringSize;
+    if_coalesce_t coalesce;
+    if_offloads_t offloads;
+    const system_backend_t *backend = systemBackend();
+    unsigned int failed = 0;
+    void *iface;
+
+    if ((iface = backend->openInterface(interfaceName)) == NULL) {
+        write_adv_log("Could not open %s: %s\n", interfaceName,
+                      strerror(errno));
+        return INTERFACE_SETTINGS + STEERING_SETTINGS;
+    }
+
+    if (backend->readRingSize(iface, &ringSize) == RET_OK) {
+        settings->rx_ring_size = ringSize.rx;
+        settings->tx_ring_size = ringSize.tx;
+    } else
+        failed++;
+
+    if (backend->readCoalesce(iface, &coalesce) == RET_OK) {
+        settings->rx_interrupt_coalesce_usecs = coalesce.rx_coalesce_usecs;
+        settings->rx_interrupt_max_coalesce_frames =
+            coalesce.rx_max_coalesced_frames;
+        settings->tx_interrupt_coalesce_usecs = coalesce.tx_coalesce_usecs;
+        settings->tx_interrupt_max_coalesce_frames =
+            coalesce.tx_max_coalesced_frames;
+    } else
+        failed++;
+
+    if (backend->readOffloads(iface, &offloads) == RET_OK) {
+        settings->rx_checksum_offload = offloads.rx_chksum_offload;
+        settings->tx_checksum_offload = offloads.tx_chksum_offload;
+        settings->general_segmentation_offload =
+            offloads.general_segmentation_offload;
+        settings->tcp_segmentation_offload = offloads.tcp_segmentation_offload;
+        settings->general_receive_offload = offloads.general_receive_offload;
+        settings->large_receive_offload = offloads.large_receive_offload;
+        settings->rx_vlan_offload = offloads.rx_vlan_offload;
+        settings->tx_vlan_offload = offloads.tx_vlan_offload;
+        settings->rx_hash = offloads.rx_hash;
+    } else
+        failed++;
+
+    failed += readSteeringSettings(iface, interfaceName, settings);
+    backend->closeInterface(iface);
+
+    return failed;
+}
+
+static unsigned int readCpuSettings(tuning_params_t *settings) {
+    const system_backend_t *backend = systemBackend();
+    char buffer[MAX_SYSCTL_VALUE_LENGTH];
+    unsigned int failed = 0;
+    int governor;
+
+    settings->cores = get_nprocs();
+
+    /*
+     * cpu0 stands for all of them: they are tuned together. Without cpufreq,
+     * as in most virtual machines, there is nothing to read.
+     */
+    if (backend->readLine(CPUFREQ_PATH "scaling_governor", buffer,
+                          sizeof(buffer)) != RET_OK)
+        NOT_READ(failed);
+    else if ((governor = cpuGovernorIndex(buffer)) != -1)
+        settings->governor = governor;
+    else
+        failed++;
+
+    if (backend->readLine(CPUFREQ_PATH "scaling_cur_freq", buffer,
+                          sizeof(buffer)) == RET_OK)
+        settings->cpu_speed = strtoul(buffer, NULL, 10);
+    else
+        NOT_READ(failed);
+
+    return failed;
+}
+
+int readSystemSettings(const char *interfaceName,
+                       tuning_params_t *systemSettings) {
+    unsigned int failed;
+
+    /* Silent: scripts/collect_stats.py calls it as it writes CSV to stdout */
+    failed = readSysctlSettings(systemSettings);
+    if (interfaceName != NULL && interfaceName[0] != '\0')
+        failed += readInterfaceSettings(interfaceName, systemSettings);
+    failed += readCpuSettings(systemSettings);
+
+    if (failed > 0) {
+        write_adv_log("%u settings could not be read.\n", failed);
+        return RET_FAIL;
+    }
+    return RET_OK;
 }
 
 void set_verbosity(unsigned int verbosity) { verbosity_level = verbosity; }
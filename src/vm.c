@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: BSD-3-Clause
+// Copyright SUSE LLC
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "vm.h"
+
+static const char *LEVEL_NAMES[VM_LEVELS] = {"relaxed", "tight",
+                                             "reclaiming"};
+
+/* By how much a fault may stall on compaction */
+static const char *THP_DEFRAG_MODES[] = {"never", "defer", "defer+madvise",
+                                         "madvise", "always"};
+
+typedef struct vm_field_s {
+    const char *name;
+    size_t offset;
+} vm_field_t;
+
+#define VM_FIELD(name, field) {name, offsetof(vm_stats_t, field)}
+
+static const vm_field_t VMSTAT_FIELDS[] = {
+    VM_FIELD("pgfault", pgfault),
+    VM_FIELD("pgmajfault", pgmajfault),
+    VM_FIELD("pgscan_kswapd", pgscan_kswapd),
+    VM_FIELD("pgscan_direct", pgscan_direct),
+    VM_FIELD("pgsteal_kswapd", pgsteal_kswapd),
+    VM_FIELD("pgsteal_direct", pgsteal_direct),
+    VM_FIELD("thp_fault_fallback", thp_fault_fallback),
+    VM_FIELD("thp_collapse_alloc_failed", thp_collapse_alloc_failed)};
+
+static const vm_field_t MEMINFO_FIELDS[] = {
+    VM_FIELD("MemTotal", mem_total_kb),
+    VM_FIELD("MemAvailable", mem_available_kb),
+    VM_FIELD("Dirty", dirty_kb), VM_FIELD("Writeback", writeback_kb)};
+
+static unsigned int parseFields(FILE *fp, const char *format,
+                                const vm_field_t *fields, unsigned int count,
+                                vm_stats_t *stats) {
+    char line[MAX_PROC_STRING_LENGTH], name[64];
+    unsigned long value;
+    unsigned int found = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, format, name, &value) != 2)
+            continue;
+        for (unsigned int i = 0; i < count; i++)
+            if (strcmp(name, fields[i].name) == 0) {
+                *(unsigned long *)((char *)stats + fields[i].offset) = value;
+                found++;
+                break;
+            }
+    }
+
+    return found;
+}
+
+unsigned int vmParseVmstat(FILE *fp, vm_stats_t *stats) {
+    return parseFields(fp, "%63s %lu", VMSTAT_FIELDS,
+                       sizeof(VMSTAT_FIELDS) / sizeof(VMSTAT_FIELDS[0]),
+                       stats);
+}
+
+unsigned int vmParseMeminfo(FILE *fp, vm_stats_t *stats) {
+    return parseFields(fp, "%63[^:]: %lu", MEMINFO_FIELDS,
+                       sizeof(MEMINFO_FIELDS) / sizeof(MEMINFO_FIELDS[0]),
+                       stats);
+}
+
+unsigned long vmParseSockstat(FILE *fp) {
+    char line[MAX_PROC_STRING_LENGTH];
+    const char *mem;
+    unsigned long pages = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL)
+        if (strncmp(line, "TCP:", 4) == 0 &&
+            (mem = strstr(line, " mem ")) != NULL)
+            sscanf(mem, " mem %lu", &pages);
+
+    return pages;
+}
+
+static inline double rate(unsigned long prev, unsigned long cur,
+                          double period) {
+    return cur >= prev ? (cur - prev) / period : 0.0;
+}
+
+void vmRates(const vm_stats_t *prev, const vm_stats_t *cur, double period,
+             unsigned long pageKb, vm_rates_t *rates) {
+    memset(rates, 0, sizeof(vm_rates_t));
+    if (period > 0.0) {
+        rates->fault_rate = rate(prev->pgfault, cur->pgfault, period);
+        rates->major_fault_rate =
+            rate(prev->pgmajfault, cur->pgmajfault, period);
+        rates->kswapd_scan_rate =
+            rate(prev->pgscan_kswapd, cur->pgscan_kswapd, period);
+        rates->direct_scan_rate =
+            rate(prev->pgscan_direct, cur->pgscan_direct, period);
+        rates->steal_rate =
+            rate(prev->pgsteal_kswapd, cur->pgsteal_kswapd, period) +
+            rate(prev->pgsteal_direct, cur->pgsteal_direct, period);
+        rates->thp_failure_rate =
+            rate(prev->thp_fault_fallback, cur->thp_fault_fallback, period) +
+            rate(prev->thp_collapse_alloc_failed,
+                 cur->thp_collapse_alloc_failed, period);
+    }
+
+    rates->mem_total_kb = cur->mem_total_kb;
+    rates->mem_available_kb = cur->mem_available_kb;
+    rates->dirty_kb = cur->dirty_kb;
+    rates->writeback_kb = cur->writeback_kb;
+    rates->tcp_kb = cur->tcp_pages * pageKb;
+    rates->page_kb = pageKb;
+}
+
+int vmThpDefragIndex(const char *query) {
+    for (unsigned long i = 0;
+         i < sizeof(THP_DEFRAG_MODES) / sizeof(THP_DEFRAG_MODES[0]); i++)
+        if (strcmp(query, THP_DEFRAG_MODES[i]) == 0)
+            return i + 1;
+    return -1;
+}
+
+const char *vmThpDefragName(int index) {
+    if (index < 1 ||
+        index > (int)(sizeof(THP_DEFRAG_MODES) / sizeof(THP_DEFRAG_MODES[0])))
+        return "?";
+    return THP_DEFRAG_MODES[index - 1];
+}
+
+const char *vmLevelName(unsigned int level) {
+    if (level >= VM_LEVELS)
+        return "?";
+    return LEVEL_NAMES[level];
+}
+
+void vmTunerInit(vm_tuner_t *tuner, double low, double high) {
+    memset(tuner, 0, sizeof(vm_tuner_t));
+    tuner->low = low;
+    tuner->high = high;
+    tuner->level = VM_LEVEL_RELAXED;
+}
+
+/* Whether kswapd does more than topping the free pages up */
+static bool kswapdStrained(const vm_rates_t *rates) {
+    double scanned, scannedPercent;
+
+    if (rates->mem_total_kb == 0 || rates->kswapd_scan_rate <= 0)
+        return false;
+
+    scanned = rates->kswapd_scan_rate + rates->direct_scan_rate;
+    scannedPercent =
+        100.0 * rates->kswapd_scan_rate * rates->page_kb / rates->mem_total_kb;
+    return scannedPercent >= VM_TIGHT_SCAN_PERCENT ||
+           (scannedPercent >= VM_TIGHT_SCAN_PERCENT / 10 &&
+            rates->steal_rate < VM_TIGHT_RECLAIM_EFFICIENCY * scanned);
+}
+
+unsigned int vmTunerUpdate(vm_tuner_t *tuner, const vm_rates_t *rates) {
+    double available = 100.0;
+    unsigned int level = VM_LEVEL_RELAXED;
+
+    if (rates->mem_total_kb > 0)
+        available = 100.0 * rates->mem_available_kb / rates->mem_total_kb;
+
+    if (rates->direct_scan_rate > 0 || available < tuner->low)
+        level = VM_LEVEL_RECLAIMING;
+    else if (kswapdStrained(rates) || rates->thp_failure_rate > 0 ||
+             available < tuner->high)
+        level = VM_LEVEL_TIGHT;
+
+    return levelUpdate(&tuner->level, &tuner->calm, level, VM_CALM_SAMPLES);
+}
+
+void vmProfileFor(unsigned int level, const vm_profile_t *baseline,
+                  unsigned int thpModes, const vm_rates_t *rates,
+                  const vm_profile_t *applied, vm_profile_t *profile) {
+    bool reclaiming = level == VM_LEVEL_RECLAIMING;
+    unsigned int dirtyRatio =
+        reclaiming ? VM_RECLAIMING_DIRTY_RATIO : VM_TIGHT_DIRTY_RATIO;
+    unsigned long backgroundBytes = reclaiming
+                                        ? VM_RECLAIMING_DIRTY_BACKGROUND_BYTES
+                                        : VM_TIGHT_DIRTY_BACKGROUND_BYTES;
+    unsigned long hostBackgroundBytes = baseline->dirty_background_bytes;
+    unsigned long freeKb, maxFreeKb;
+    int defrag;
+
+    memcpy(profile, baseline, sizeof(vm_profile_t));
+    if (level == VM_LEVEL_RELAXED)
+        return;
+
+    if (dirtyRatio < baseline->dirty_ratio)
+        profile->dirty_ratio = dirtyRatio;
+    if (hostBackgroundBytes == 0)
+        hostBackgroundBytes =
+            rates->mem_total_kb * 1024 / 100 * baseline->dirty_background_ratio;
+    if (backgroundBytes < hostBackgroundBytes) {
+        profile->dirty_background_bytes = backgroundBytes;
+        profile->dirty_background_ratio = 0;
+    }
+    if (VM_SHORT_SWAPPINESS < baseline->swappiness)
+        profile->swappiness = VM_SHORT_SWAPPINESS;
+
+    /* A quarter of the TCP buffers when tight, half when reclaiming */
+    freeKb = rates->tcp_kb / (reclaiming ? 2 : 4);
+    freeKb = (freeKb + VM_MIN_FREE_STEP_KB - 1) / VM_MIN_FREE_STEP_KB *
+             VM_MIN_FREE_STEP_KB;
+    maxFreeKb = rates->mem_total_kb / 100 * VM_MAX_MIN_FREE_PERCENT;
+    if (freeKb > maxFreeKb)
+        freeKb = maxFreeKb;
+    /* Within a step of what was raised to, the TCP buffers only wobble */
+    if (applied != NULL &&
+        applied->min_free_kbytes > baseline->min_free_kbytes &&
+        labs((long)freeKb - (long)applied->min_free_kbytes) <=
+            (long)VM_MIN_FREE_STEP_KB)
+        freeKb = applied->min_free_kbytes;
+    if (freeKb > baseline->min_free_kbytes)
+        profile->min_free_kbytes = freeKb;
+
+    defrag = vmThpDefragIndex(reclaiming ? "defer" : "defer+madvise");
+    if (!(thpModes & (1U << defrag)))
+        defrag = vmThpDefragIndex("defer");
+    if (baseline->thp_defrag != 0 && (thpModes & (1U << defrag)) &&
+        defrag < baseline->thp_defrag)
+        profile->thp_defrag = defrag;
+}
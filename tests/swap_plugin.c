@@ -0,0 +1,2 @@
+/* Built once per SWAP_VERSION, for the loader tests to swap one for another */
+int swapVersion() { return SWAP_VERSION; }
@@ -0,0 +1,163 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "ethtool.h"
+#include "types.h"
+#include "utils.h"
+
+struct backend_state {
+    char script[32];
+};
+
+static int setupFakeBackend(void **state) {
+    struct backend_state *s = calloc(1, sizeof(struct backend_state));
+    FILE *fp;
+    int fd;
+
+    if (s == NULL)
+        return -1;
+
+    snprintf(s->script, sizeof(s->script), "/tmp/phoebeXXXXXX");
+    if ((fd = mkstemp(s->script)) < 0 || (fp = fdopen(fd, "w")) == NULL)
+        return -1;
+    fputs("# two ticks, played in a loop\n"
+          "tick 1000 1 2 0 25\n"
+          "\n"
+          "tick 3000 0 0 1 75\n"
+          "sysctl net.core.somaxconn 4096\n"
+          "sysctl net.ipv4.tcp_rmem 4096 131072 6291456\n"
+          "file " CPUFREQ_PATH "scaling_governor performance\n"
+          "ring 256 512\n",
+          fp);
+    fclose(fp);
+
+    fakeBackendReset();
+    if (fakeBackendLoadScript(s->script) != RET_OK)
+        return -1;
+    setSystemBackend(fakeBackend());
+
+    *state = s;
+    return 0;
+}
+
+static int teardownFakeBackend(void **state) {
+    struct backend_state *s = *state;
+
+    setSystemBackend(hostBackend());
+    fakeBackendReset();
+    unlink(s->script);
+    free(s);
+    return 0;
+}
+
+void fakeBackendPlaysCountersInALoop() {
+    const system_backend_t *backend = systemBackend();
+    void *iface = backend->openInterface("eth0");
+    if_stats_t stats;
+    cpu_stats_t cpu;
+
+    assert_non_null(iface);
+    assert_int_equal(RET_OK, backend->readLinkStats(iface, &stats));
+    assert_int_equal(1000, stats.bytes_total);
+    assert_int_equal(RET_OK, backend->readLinkStats(iface, &stats));
+    assert_int_equal(4000, stats.bytes_total);
+    assert_int_equal(1, stats.errors_total);
+    assert_int_equal(2, stats.dropped_total);
+    assert_int_equal(1, stats.fifo_err_total);
+    assert_int_equal(RET_OK, backend->readLinkStats(iface, &stats));
+    assert_int_equal(5000, stats.bytes_total);
+
+    assert_int_equal(RET_OK, backend->readCpuStats(&cpu));
+    assert_int_equal(250, cpu.nonIdleTotal);
+    assert_int_equal(750, cpu.idleTotal);
+    backend->closeInterface(iface);
+}
+
+void fakeBackendLogsAppliedKnobs() {
+    const system_backend_t *backend = systemBackend();
+    void *iface = backend->openInterface("eth0");
+    if_ring_size_t size = {.rx = 1024, .tx = 1024};
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+    sysctl_write_t batch[2];
+    fake_applied_t entry;
+    if_stats_t stats;
+
+    assert_int_equal(RET_OK, backend->readLinkStats(iface, &stats));
+    sysctlSet(&batch[0], "net.core.somaxconn", "%u", 1024U);
+    sysctlSet(&batch[1], "net.core.busy_poll", "%d", 50);
+    assert_int_equal(0, backend->writeSysctls(batch, 2));
+    assert_int_equal(0, backend->writeInterface(iface, &size, NULL, NULL));
+
+    assert_int_equal(3, fakeBackendAppliedCount());
+    assert_int_equal(RET_OK, fakeBackendApplied(0, &entry));
+    assert_int_equal(1, entry.tick);
+    assert_string_equal("net.core.somaxconn", entry.name);
+    assert_string_equal("1024", entry.value);
+    assert_int_equal(RET_OK, fakeBackendApplied(2, &entry));
+    assert_string_equal("ring", entry.name);
+    assert_string_equal("1024 1024", entry.value);
+    assert_int_equal(RET_FAIL, fakeBackendApplied(3, &entry));
+
+    assert_int_equal(RET_OK, backend->readSysctl("net.core.busy_poll", value,
+                                                 sizeof(value)));
+    assert_string_equal("50", value);
+    assert_int_equal(RET_OK, backend->readRingSize(iface, &size));
+    assert_int_equal(1024, size.rx);
+    backend->closeInterface(iface);
+}
+
+void readSystemSettingsUsesTheBackend() {
+    tuning_params_t settings;
+
+    memset(&settings, 0, sizeof(settings));
+
+    /* Without /proc/interrupts in the script, the steering can't be read */
+    assert_int_equal(RET_FAIL, readSystemSettings("eth0", &settings));
+    assert_int_equal(4096, settings.net_core_somaxconn);
+    assert_int_equal(131072, settings.tcp_rmem1);
+    assert_int_equal(cpuGovernorIndex("performance"), settings.governor);
+    assert_int_equal(256, settings.rx_ring_size);
+    assert_int_equal(512, settings.tx_ring_size);
+}
+
+void fakeBackendRejectsBadScripts() {
+    char script[32] = "/tmp/phoebeXXXXXX";
+    int fd = mkstemp(script);
+
+    assert_true(fd >= 0);
+    assert_true(write(fd, "tick 1 2\n", 9) == 9);
+    close(fd);
+
+    assert_int_equal(RET_FAIL, fakeBackendLoadScript(script));
+    assert_int_equal(RET_FAIL, fakeBackendLoadScript("/nonexistent/script"));
+    unlink(script);
+}
+
+void systemBackendNamesRoundTrip() {
+    assert_int_equal(SYSTEM_BACKEND_HOST, systemBackendFromString("host"));
+    assert_int_equal(SYSTEM_BACKEND_FAKE, systemBackendFromString("fake"));
+    assert_int_equal(-1, systemBackendFromString("kernel"));
+    assert_string_equal("fake", systemBackendName(SYSTEM_BACKEND_FAKE));
+    assert_true(hostBackend() == systemBackend());
+}
+
+extern int runBackendTests() {
+    const struct CMUnitTest backendTests[] = {
+        cmocka_unit_test(systemBackendNamesRoundTrip),
+        cmocka_unit_test(fakeBackendRejectsBadScripts),
+        cmocka_unit_test_setup_teardown(fakeBackendPlaysCountersInALoop,
+                                        setupFakeBackend, teardownFakeBackend),
+        cmocka_unit_test_setup_teardown(fakeBackendLogsAppliedKnobs,
+                                        setupFakeBackend, teardownFakeBackend),
+        cmocka_unit_test_setup_teardown(readSystemSettingsUsesTheBackend,
+                                        setupFakeBackend,
+                                        teardownFakeBackend)};
+
+    return cmocka_run_group_tests_name("backend tests", backendTests, NULL,
+                                       NULL);
+}
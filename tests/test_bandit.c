@@ -0,0 +1,180 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bandit.h"
+#include "types.h"
+
+#define ROWS 10
+
+static tuning_params_t _rows[ROWS];
+static all_values_t _values = {
+    .parameters = _rows, .totalLength = ROWS, .validValues = ROWS};
+
+static int setupRows(void **state __attribute__((unused))) {
+    memset(_rows, 0, sizeof(_rows));
+    for (unsigned int i = 0; i < ROWS; i++)
+        _rows[i].transfer_rate = (i + 1) * 100;
+    return 0;
+}
+
+void banditPolicyNamesRoundTrip() {
+    assert_int_equal(BANDIT_OFF, banditPolicyFromString("off"));
+    assert_int_equal(BANDIT_EPSILON_GREEDY,
+                     banditPolicyFromString("epsilon-greedy"));
+    assert_int_equal(BANDIT_THOMPSON, banditPolicyFromString("thompson"));
+    assert_int_equal(-1, banditPolicyFromString("ucb"));
+    assert_string_equal("thompson", banditPolicyName(BANDIT_THOMPSON));
+}
+
+void banditCandidatesAreCenteredOnTheLoad() {
+    unsigned int first, count;
+
+    banditCandidates(&_values, 500, 5, &first, &count);
+    assert_int_equal(2, first);
+    assert_int_equal(5, count);
+
+    /* Shifted to stay within the table at either end */
+    banditCandidates(&_values, 10, 5, &first, &count);
+    assert_int_equal(0, first);
+    banditCandidates(&_values, 100000, 5, &first, &count);
+    assert_int_equal(ROWS - 5, first);
+
+    banditCandidates(&_values, 500, 2 * ROWS, &first, &count);
+    assert_int_equal(0, first);
+    assert_int_equal(ROWS, count);
+}
+
+void banditTriesEveryRowThenExploits() {
+    bandit_t *bandit = banditCreate(BANDIT_EPSILON_GREEDY, 0.0, ROWS, 1);
+
+    assert_non_null(bandit);
+    for (unsigned int i = 0; i < 3; i++) {
+        unsigned int row = banditChoose(bandit, 2, 3);
+
+        assert_int_equal(2 + i, row);
+        banditUpdate(bandit, row, row == 3 ? 0.5 : -0.1);
+    }
+    assert_int_equal(3, bandit->explorations);
+
+    assert_int_equal(3, banditChoose(bandit, 2, 3));
+    assert_int_equal(4, bandit->rounds);
+    assert_int_equal(3, bandit->explorations);
+    banditFree(bandit);
+}
+
+void banditThompsonSamplingFavoursTheBestRow() {
+    bandit_t *bandit = banditCreate(BANDIT_THOMPSON, 0.0, ROWS, 42);
+    unsigned int best = 0;
+
+    for (unsigned int i = 0; i < 20; i++) {
+        banditUpdate(bandit, 0, -0.2 + (i % 2) * 0.1);
+        banditUpdate(bandit, 1, 0.3 + (i % 2) * 0.1);
+    }
+    for (unsigned int i = 0; i < 100; i++)
+        best += banditChoose(bandit, 0, 2) == 1;
+
+    assert_true(best >= 95);
+    banditFree(bandit);
+}
+
+void banditHasNothingToPickInAnEmptyTable() {
+    all_values_t empty = {.parameters = _rows, .totalLength = ROWS};
+    bandit_t *bandit = banditCreate(BANDIT_EPSILON_GREEDY, 1.0, ROWS, 1);
+    unsigned int first, count;
+
+    banditCandidates(&empty, 500, 5, &first, &count);
+    assert_int_equal(0, first);
+    assert_int_equal(0, count);
+
+    /* Exploring would draw one of no rows */
+    assert_int_equal(RET_FAIL, banditChoose(bandit, first, count));
+    bandit->policy = BANDIT_THOMPSON;
+    assert_int_equal(RET_FAIL, banditChoose(bandit, first, count));
+    assert_int_equal(0, bandit->rounds);
+    banditFree(bandit);
+}
+
+void banditRewardsThroughputAndPenalisesLosses() {
+    bandit_measure_t before = {.transfer_rate = 1000, .cpu_usage = 10};
+    bandit_measure_t after = before;
+
+    after.transfer_rate = 1500;
+    assert_true(fabs(banditReward(&before, &after) - 0.5) < 1e-9);
+
+    /* Each rate counts for at most 1 */
+    after.drop_rate = 100;
+    assert_true(fabs(banditReward(&before, &after) + 0.5) < 1e-9);
+
+    after.drop_rate = 0;
+    after.cpu_usage = 30;
+    assert_true(fabs(banditReward(&before, &after) - 0.4) < 1e-9);
+}
+
+void banditUpdateKeepsTheMeanAndVariance() {
+    bandit_t *bandit = banditCreate(BANDIT_THOMPSON, 0.0, ROWS, 1);
+
+    banditUpdate(bandit, 4, 1.0);
+    banditUpdate(bandit, 4, 2.0);
+    banditUpdate(bandit, 4, 3.0);
+    banditUpdate(bandit, ROWS, 3.0);
+
+    assert_int_equal(3, bandit->scores[4].pulls);
+    assert_true(fabs(bandit->scores[4].mean - 2.0) < 1e-9);
+    assert_true(fabs(bandit->scores[4].m2 - 2.0) < 1e-9);
+    banditFree(bandit);
+}
+
+void banditScoresSurviveASaveAndLoad() {
+    char path[] = "/tmp/phoebeXXXXXX";
+    bandit_t *saved = banditCreate(BANDIT_THOMPSON, 0.0, ROWS, 1);
+    bandit_t *loaded = banditCreate(BANDIT_THOMPSON, 0.0, ROWS, 1);
+    int fd = mkstemp(path);
+
+    assert_true(fd >= 0);
+    close(fd);
+
+    banditUpdate(saved, 1, 0.25);
+    banditUpdate(saved, 7, -0.5);
+    banditUpdate(saved, 7, 0.5);
+    assert_int_equal(RET_OK, banditSave(saved, &_values, path));
+
+    /* The row of transfer rate 800 is gone from the table */
+    _rows[7].transfer_rate = 750;
+    assert_int_equal(1, banditLoad(loaded, &_values, path));
+    assert_int_equal(1, loaded->scores[1].pulls);
+    assert_true(fabs(loaded->scores[1].mean - 0.25) < 1e-6);
+    assert_int_equal(0, loaded->scores[7].pulls);
+
+    unlink(path);
+    banditFree(saved);
+    banditFree(loaded);
+}
+
+void banditScoresPathIsNamedAfterTheTable() {
+    char path[MAX_FILENAME_LENGTH];
+
+    banditScoresPath("/etc/phoebe/rates.csv", path, sizeof(path));
+    assert_string_equal("/etc/phoebe/rates_scores.csv", path);
+}
+
+extern int runBanditTests() {
+    const struct CMUnitTest banditTests[] = {
+        cmocka_unit_test(banditPolicyNamesRoundTrip),
+        cmocka_unit_test_setup(banditCandidatesAreCenteredOnTheLoad,
+                               setupRows),
+        cmocka_unit_test(banditTriesEveryRowThenExploits),
+        cmocka_unit_test(banditThompsonSamplingFavoursTheBestRow),
+        cmocka_unit_test_setup(banditHasNothingToPickInAnEmptyTable,
+                               setupRows),
+        cmocka_unit_test(banditRewardsThroughputAndPenalisesLosses),
+        cmocka_unit_test(banditUpdateKeepsTheMeanAndVariance),
+        cmocka_unit_test_setup(banditScoresSurviveASaveAndLoad, setupRows),
+        cmocka_unit_test(banditScoresPathIsNamedAfterTheTable)};
+
+    return cmocka_run_group_tests_name("bandit tests", banditTests, NULL,
+                                       NULL);
+}
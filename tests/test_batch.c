@@ -0,0 +1,143 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "interpolation.h"
+#include "types.h"
+#include "utils.h"
+
+#define ROWS 500
+#define SAMPLES 10003
+
+static tuning_params_t _rows[ROWS];
+static all_values_t _values = {.parameters = _rows, .validValues = ROWS};
+static weights_reference_t _weights = {0.8, 0.1, 0.05, 0.05};
+static app_settings_t _settings;
+
+static uint64_t _transfer[SAMPLES], _drop[SAMPLES], _errors[SAMPLES],
+    _fifo[SAMPLES];
+static int _found[SAMPLES];
+static uint8_t _kinds[SAMPLES];
+static double _weightedValues[SAMPLES], _tolerances[SAMPLES];
+
+static batch_samples_t _samples = {SAMPLES, _transfer, _drop, _errors, _fifo};
+static batch_results_t _results = {_found, _kinds, _weightedValues,
+                                   _tolerances};
+
+static int setupTable(void **state __attribute__((unused))) {
+    memset(_rows, 0, sizeof(_rows));
+    for (unsigned int i = 0; i < ROWS; i++) {
+        _rows[i].transfer_rate = 1000 + 20000UL * i * i;
+        _rows[i].drop_rate = i % 7;
+    }
+    srand(11);
+    for (unsigned int i = 0; i < SAMPLES; i++) {
+        _transfer[i] = rand() % (20000UL * ROWS * ROWS);
+        _drop[i] = rand() % 10;
+        _errors[i] = rand() % 3;
+        _fifo[i] = 0;
+    }
+    memset(&_settings, 0, sizeof(_settings));
+    _settings.accuracy = 1.5;
+    _settings.max_extrapolation = 10.0;
+    return 0;
+}
+
+/* binarySearchWithTolerance(), bounded to the valid rows */
+static int reference(double weightedValue, double tolerance, int l, int r) {
+    while (r >= l) {
+        int mid = l + (r - l) / 2;
+        double ref = calculateWeightedValue(
+            _rows[mid].transfer_rate, _rows[mid].drop_rate,
+            _rows[mid].errors_rate, _rows[mid].fifo_errors_rate, &_weights, 10);
+
+        if (fabs(weightedValue - ref) <= tolerance)
+            return mid;
+        if (_rows[mid].transfer_rate > weightedValue)
+            r = mid - 1;
+        else
+            l = mid + 1;
+    }
+    return -1;
+}
+
+void batchMatchesLikeTheLiveInference() {
+    batch_table_t *table;
+    unsigned int matched, expected = 0;
+
+    for (unsigned int f = 0; f <= 2; f++) {
+        _settings.approx_function = f;
+        table = batchPrepare(&_values, &_weights, 10, &_settings);
+        assert_non_null(table);
+
+        matched = batchInfer(table, &_samples, &_results);
+        expected = 0;
+        for (unsigned int i = 0; i < SAMPLES; i++) {
+            double weightedValue = calculateWeightedValue(
+                _transfer[i], _drop[i], _errors[i], _fifo[i], &_weights, 10);
+            unsigned short zeros = digits(weightedValue) * _settings.accuracy;
+            double epsilon = calculateEpsilon(zeros, _settings.accuracy);
+            /* calculateTolerance() logs every call without a function */
+            double tolerance =
+                f == 0 ? weightedValue * epsilon
+                       : calculateTolerance(weightedValue, epsilon, f);
+            int row = reference(weightedValue, tolerance, 0, ROWS - 1);
+
+            assert_true(fabs(_weightedValues[i] - weightedValue) <=
+                        1e-9 * weightedValue);
+            assert_true(fabs(_tolerances[i] - tolerance) <=
+                        1e-9 * fabs(tolerance));
+            assert_int_equal(row, _found[i]);
+            assert_int_equal(row == -1 ? BATCH_MISSED : BATCH_MATCHED,
+                             _kinds[i]);
+            expected += row != -1;
+        }
+        assert_int_equal(expected, matched);
+        /* A mix of matches and misses, which the other functions skew */
+        if (f == 0)
+            assert_true(matched > 0 && matched < SAMPLES);
+        batchFree(table);
+    }
+}
+
+void batchInterpolatesTheMisses() {
+    batch_table_t *table;
+
+    _settings.interpolate = true;
+    table = batchPrepare(&_values, &_weights, 10, &_settings);
+    assert_int_equal(SAMPLES, batchInfer(table, &_samples, &_results));
+    for (unsigned int i = 0; i < SAMPLES; i++)
+        if (_kinds[i] == BATCH_INTERPOLATED)
+            assert_int_equal(
+                interpolationRow(&_values, _transfer[i], 10.0), _found[i]);
+
+    /* Far beyond the table */
+    _transfer[0] = 100 * _rows[ROWS - 1].transfer_rate;
+    _samples.count = 1;
+    assert_int_equal(0, batchInfer(table, &_samples, &_results));
+    assert_int_equal(-1, _found[0]);
+    assert_int_equal(BATCH_MISSED, _kinds[0]);
+    _samples.count = SAMPLES;
+    batchFree(table);
+
+    /* Nothing to match against */
+    _values.validValues = 0;
+    table = batchPrepare(&_values, &_weights, 10, &_settings);
+    assert_non_null(table);
+    assert_int_equal(0, batchInfer(table, &_samples, &_results));
+    assert_int_equal(BATCH_MISSED, _kinds[SAMPLES - 1]);
+    batchFree(table);
+    _values.validValues = ROWS;
+}
+
+extern int runBatchTests() {
+    const struct CMUnitTest batchTests[] = {
+        cmocka_unit_test_setup(batchMatchesLikeTheLiveInference, setupTable),
+        cmocka_unit_test_setup(batchInterpolatesTheMisses, setupTable)};
+
+    return cmocka_run_group_tests_name("batch inference tests", batchTests,
+                                       NULL, NULL);
+}
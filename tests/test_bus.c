@@ -0,0 +1,138 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "bus.h"
+#include "types.h"
+
+static unsigned int _received;
+static bus_sample_t _last;
+
+static void countSample(const bus_sample_t *sample, void *context) {
+    _received += *(unsigned int *)context;
+    _last = *sample;
+}
+
+void busAttachNegotiatesMetricsAndKnobs() {
+    sample_bus_t bus;
+
+    busInit(&bus);
+    assert_int_equal(RET_OK,
+                     busAttach(&bus, BUS_METRIC_MASK(BUS_METRIC_LINK),
+                               KNOB_NET_SYSCTL | KNOB_NET_INTERFACE));
+    assert_int_equal(RET_OK, busAttach(&bus, BUS_METRIC_MASK(BUS_METRIC_CPU),
+                                       KNOB_CPU));
+
+    /* A knob already claimed, or a metric this core does not collect */
+    assert_int_equal(RET_FAIL, busAttach(&bus, BUS_METRIC_MASK(BUS_METRIC_CPU),
+                                         KNOB_NET_SYSCTL | KNOB_VM));
+    assert_int_equal(RET_FAIL,
+                     busAttach(&bus, BUS_METRIC_MASK(BUS_METRICS), KNOB_IO));
+
+    assert_int_equal(BUS_METRIC_MASK(BUS_METRIC_LINK) |
+                         BUS_METRIC_MASK(BUS_METRIC_CPU),
+                     bus.requested);
+    assert_int_equal(KNOB_NET_SYSCTL | KNOB_NET_INTERFACE | KNOB_CPU,
+                     bus.claimed);
+    busDestroy(&bus);
+}
+
+void busPublishReachesTheSubscribersOfTheMetric() {
+    sample_bus_t bus;
+    unsigned int one = 1, ten = 10;
+    bus_sample_t sample = {.metric = BUS_METRIC_CPU, .cpu_busy = 42.5};
+
+    busInit(&bus);
+    _received = 0;
+    assert_int_equal(RET_OK, busSubscribe(&bus, BUS_ALL_METRICS, countSample,
+                                          &one));
+    assert_int_equal(RET_OK,
+                     busSubscribe(&bus, BUS_METRIC_MASK(BUS_METRIC_LINK),
+                                  countSample, &ten));
+
+    busPublish(&bus, &sample);
+    assert_int_equal(1, _received);
+    assert_int_equal(1, _last.sequence);
+    assert_true(_last.cpu_busy == 42.5);
+
+    sample.metric = BUS_METRIC_LINK;
+    sample.link.transfer_rate = 1000;
+    busPublish(&bus, &sample);
+    assert_int_equal(12, _received);
+    assert_int_equal(1000, _last.link.transfer_rate);
+
+    sample.metric = BUS_METRICS;
+    busPublish(&bus, &sample);
+    assert_int_equal(12, _received);
+    busDestroy(&bus);
+}
+
+void busLatestKeepsTheLastSampleOfEachMetric() {
+    sample_bus_t bus;
+    bus_sample_t sample = {.metric = BUS_METRIC_PRESSURE}, latest;
+
+    busInit(&bus);
+    assert_int_equal(RET_FAIL, busLatest(&bus, BUS_METRIC_PRESSURE, &latest));
+
+    sample.pressure[PSI_IO].some.avg10 = 3.0;
+    busPublish(&bus, &sample);
+    sample.pressure[PSI_IO].some.avg10 = 5.0;
+    busPublish(&bus, &sample);
+
+    assert_int_equal(RET_OK, busLatest(&bus, BUS_METRIC_PRESSURE, &latest));
+    assert_int_equal(2, latest.sequence);
+    assert_true(latest.pressure[PSI_IO].some.avg10 == 5.0);
+    assert_int_equal(RET_FAIL, busLatest(&bus, BUS_METRIC_LINK, &latest));
+    busDestroy(&bus);
+}
+
+void busSubscribersAreBounded() {
+    sample_bus_t bus;
+    unsigned int one = 1;
+
+    busInit(&bus);
+    for (unsigned int i = 0; i < MAX_BUS_SUBSCRIBERS; i++)
+        assert_int_equal(RET_OK, busSubscribe(&bus, BUS_ALL_METRICS,
+                                              countSample, &one));
+    assert_int_equal(RET_FAIL,
+                     busSubscribe(&bus, BUS_ALL_METRICS, countSample, &one));
+    busDestroy(&bus);
+}
+
+void busDetachDropsThePluginSubscriptions() {
+    sample_bus_t bus;
+    unsigned int one = 1, ten = 10;
+    bus_sample_t sample = {.metric = BUS_METRIC_CPU};
+    bus_subscriber_t plugin = {BUS_ALL_METRICS, countSample, &ten};
+
+    busInit(&bus);
+    _received = 0;
+    assert_int_equal(RET_OK, busAttach(&bus, BUS_METRIC_MASK(BUS_METRIC_CPU),
+                                       KNOB_CPU | KNOB_VM));
+    assert_int_equal(RET_OK, busSubscribe(&bus, BUS_ALL_METRICS, countSample,
+                                          &one));
+    assert_int_equal(RET_OK, busSubscribe(&bus, BUS_ALL_METRICS, countSample,
+                                          &ten));
+
+    /* The knobs are free for the plugin swapped in, the metric still read */
+    busDetach(&bus, KNOB_CPU | KNOB_VM, &plugin, 1);
+    assert_int_equal(0, bus.claimed);
+    assert_int_equal(BUS_METRIC_MASK(BUS_METRIC_CPU), bus.requested);
+    assert_int_equal(1, bus.subscriberCount);
+
+    busPublish(&bus, &sample);
+    assert_int_equal(1, _received);
+    assert_int_equal(RET_OK, busAttach(&bus, 0, KNOB_CPU));
+    busDestroy(&bus);
+}
+
+extern int runBusTests() {
+    const struct CMUnitTest busTests[] = {
+        cmocka_unit_test(busAttachNegotiatesMetricsAndKnobs),
+        cmocka_unit_test(busPublishReachesTheSubscribersOfTheMetric),
+        cmocka_unit_test(busLatestKeepsTheLastSampleOfEachMetric),
+        cmocka_unit_test(busSubscribersAreBounded),
+        cmocka_unit_test(busDetachDropsThePluginSubscriptions)};
+
+    return cmocka_run_group_tests_name("bus tests", busTests, NULL, NULL);
+}
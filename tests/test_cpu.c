@@ -0,0 +1,158 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "types.h"
+#include "utils.h"
+
+#define BIT(governor) (1U << cpuGovernorIndex(governor))
+
+static cpu_limits_t _limits = {.min_khz = 800000, .max_khz = 3000000};
+
+static int setupGovernors(void **state __attribute__((unused))) {
+    _limits.governors =
+        BIT("performance") | BIT("powersave") | BIT("schedutil");
+    return 0;
+}
+
+void cpuStatsAreParsedPerCpu() {
+    cpu_stats_t stats[4];
+    unsigned int ids[4];
+    FILE *fp = tmpfile();
+
+    assert_non_null(fp);
+    fputs("cpu  10 0 10 80 0 0 0 0 0 0\n"
+          "cpu0 5 0 5 40 0 0 0 0 0 0\n"
+          "cpu2 1 2 3 30 10 4 5 6 0 0\n"
+          "intr 12345\n"
+          "cpu3 1 1 1 1 0 0 0 0 0 0\n",
+          fp);
+    rewind(fp);
+
+    assert_int_equal(2, cpuParseStats(fp, stats, ids, 4));
+    assert_int_equal(0, ids[0]);
+    assert_int_equal(10, stats[0].nonIdleTotal);
+    assert_int_equal(40, stats[0].idleTotal);
+    /* cpu1 is offline */
+    assert_int_equal(2, ids[1]);
+    assert_int_equal(21, stats[1].nonIdleTotal);
+    assert_int_equal(40, stats[1].idleTotal);
+
+    rewind(fp);
+    assert_int_equal(1, cpuParseStats(fp, stats, ids, 1));
+    /* Reading on finds the CPUs there was no room for */
+    assert_int_equal(1, cpuParseStats(fp, stats, ids, 1));
+    assert_int_equal(2, ids[0]);
+    fclose(fp);
+}
+
+void cpuGovernorsAreParsed() {
+    assert_int_equal(BIT("performance") | BIT("powersave"),
+                     cpuParseGovernors("performance powersave"));
+    assert_int_equal(0, cpuParseGovernors("fast slow\n"));
+
+    /* intel_pstate has no other dynamic governor than powersave */
+    assert_int_equal(cpuGovernorIndex("powersave"),
+                     cpuDynamicGovernor(BIT("performance") | BIT("powersave")));
+    assert_int_equal(cpuGovernorIndex("schedutil"),
+                     cpuDynamicGovernor(_limits.governors));
+    assert_int_equal(0, cpuDynamicGovernor(BIT("performance")));
+
+    assert_string_equal("schedutil",
+                        cpuGovernorName(cpuGovernorIndex("schedutil")));
+    assert_string_equal("?", cpuGovernorName(0));
+}
+
+void cpuTunerRaisesAtOnceAndLowersWhenCalm() {
+    cpu_tuner_t tuner;
+
+    cpuTunerInit(&tuner, 20.0, 75.0, false);
+    assert_int_equal(CPU_LEVEL_IDLE, cpuTunerUpdate(&tuner, 10.0));
+    assert_int_equal(CPU_LEVEL_SATURATED, cpuTunerUpdate(&tuner, 90.0));
+
+    for (unsigned int i = 1; i < CPU_CALM_SAMPLES; i++)
+        assert_int_equal(CPU_LEVEL_SATURATED, cpuTunerUpdate(&tuner, 5.0));
+    assert_int_equal(CPU_LEVEL_LOADED, cpuTunerUpdate(&tuner, 5.0));
+
+    /* A spike restarts the count */
+    assert_int_equal(CPU_LEVEL_LOADED, cpuTunerUpdate(&tuner, 50.0));
+    for (unsigned int i = 1; i < CPU_CALM_SAMPLES; i++)
+        cpuTunerUpdate(&tuner, 5.0);
+    assert_int_equal(CPU_LEVEL_IDLE, cpuTunerUpdate(&tuner, 5.0));
+}
+
+void cpuTunerKeepsLatencyHostsLoaded() {
+    cpu_tuner_t tuner;
+
+    cpuTunerInit(&tuner, 20.0, 75.0, true);
+    for (unsigned int i = 0; i < 2 * CPU_CALM_SAMPLES; i++)
+        assert_int_equal(CPU_LEVEL_LOADED, cpuTunerUpdate(&tuner, 0.0));
+}
+
+void cpuProfilesFollowTheLevel() {
+    cpu_limits_t noPerformance = _limits;
+    cpu_profile_t profile;
+
+    cpuProfileFor(CPU_LEVEL_IDLE, false, &_limits, &profile);
+    assert_int_equal(cpuGovernorIndex("schedutil"), profile.governor);
+    assert_int_equal(800000, profile.min_khz);
+    assert_int_equal(0, profile.sched_min_granularity_ns);
+
+    cpuProfileFor(CPU_LEVEL_LOADED, false, &_limits, &profile);
+    assert_int_equal(cpuGovernorIndex("schedutil"), profile.governor);
+    assert_int_equal(1900000, profile.min_khz);
+
+    cpuProfileFor(CPU_LEVEL_SATURATED, false, &_limits, &profile);
+    assert_int_equal(cpuGovernorIndex("performance"), profile.governor);
+    assert_int_equal(3000000, profile.min_khz);
+    assert_int_equal(CPU_THROUGHPUT_MIN_GRANULARITY_NS,
+                     profile.sched_min_granularity_ns);
+
+    /* No frequency ramp for latency-sensitive hosts once loaded */
+    cpuProfileFor(CPU_LEVEL_LOADED, true, &_limits, &profile);
+    assert_int_equal(cpuGovernorIndex("performance"), profile.governor);
+    assert_int_equal(3000000, profile.min_khz);
+    assert_int_equal(CPU_LATENCY_WAKEUP_GRANULARITY_NS,
+                     profile.sched_wakeup_granularity_ns);
+
+    noPerformance.governors &= ~BIT("performance");
+    cpuProfileFor(CPU_LEVEL_SATURATED, false, &noPerformance, &profile);
+    assert_int_equal(cpuGovernorIndex("schedutil"), profile.governor);
+    assert_int_equal(3000000, profile.min_khz);
+}
+
+void cpuProfilesWithoutDynamicGovernorKeepTheHostOne() {
+    cpu_limits_t limits = _limits;
+    cpu_profile_t profile;
+
+    limits.governors = BIT("performance") | BIT("userspace");
+    cpuProfileFor(CPU_LEVEL_IDLE, false, &limits, &profile);
+    assert_int_equal(0, profile.governor);
+    assert_int_equal(800000, profile.min_khz);
+
+    cpuProfileFor(CPU_LEVEL_LOADED, false, &limits, &profile);
+    assert_int_equal(0, profile.governor);
+
+    cpuProfileFor(CPU_LEVEL_SATURATED, false, &limits, &profile);
+    assert_int_equal(cpuGovernorIndex("performance"), profile.governor);
+
+    /* Nor performance: the host keeps the governor it has at every level */
+    limits.governors = BIT("userspace");
+    cpuProfileFor(CPU_LEVEL_SATURATED, false, &limits, &profile);
+    assert_int_equal(0, profile.governor);
+    assert_int_equal(3000000, profile.min_khz);
+}
+
+extern int runCpuTests() {
+    const struct CMUnitTest cpuTests[] = {
+        cmocka_unit_test(cpuStatsAreParsedPerCpu),
+        cmocka_unit_test_setup(cpuGovernorsAreParsed, setupGovernors),
+        cmocka_unit_test(cpuTunerRaisesAtOnceAndLowersWhenCalm),
+        cmocka_unit_test(cpuTunerKeepsLatencyHostsLoaded),
+        cmocka_unit_test_setup(cpuProfilesFollowTheLevel, setupGovernors),
+        cmocka_unit_test(cpuProfilesWithoutDynamicGovernorKeepTheHostOne)};
+
+    return cmocka_run_group_tests_name("cpu tests", cpuTests, NULL, NULL);
+}
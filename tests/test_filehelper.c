@@ -12,6 +12,7 @@ struct test_state {
     FILE *pFile;
     char file_name[18];
     tuning_params_t *parameters;
+    label_t *labels;
 };
 
 static int setup(void **state) {
@@ -40,6 +41,7 @@ static int teardown(void **state) {
     if (to_destroy->parameters != NULL) {
         free(to_destroy->parameters);
     }
+    free(to_destroy->labels);
     const int unlink_res = unlink(to_destroy->file_name);
     free(to_destroy);
     return unlink_res;
@@ -107,8 +109,10 @@ void allocateMemoryInitializesReferenceValues(void **state) {
     assert_int_equal(reference_values.totalLength,
                      app_settings.max_learning_values + 1);
     assert_int_equal(reference_values.validValues, 0);
+    assert_int_equal(reference_values.labels[0].optimize_for, NOT_SET);
 
     temp->parameters = reference_values.parameters;
+    temp->labels = reference_values.labels;
 }
 
 void allocateMemoryInitializesReferenceValuesForSuperLongLines(void **state) {
@@ -138,6 +142,7 @@ void allocateMemoryInitializesReferenceValuesForSuperLongLines(void **state) {
     assert_int_equal(reference_values.validValues, 0);
 
     tmp->parameters = reference_values.parameters;
+    tmp->labels = reference_values.labels;
 }
 
 extern int runFileHelperTests() {
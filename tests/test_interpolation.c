@@ -0,0 +1,91 @@
+#include "test.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "interpolation.h"
+#include "types.h"
+#include "utils.h"
+
+static tuning_params_t _rows[3];
+static all_values_t _values = {.parameters = _rows, .validValues = 3};
+
+static void setRow(tuning_params_t *row, unsigned long transferRate,
+                   unsigned long rmemMax, unsigned int budget,
+                   unsigned short lro) {
+    memset(row, 0, sizeof(tuning_params_t));
+    row->transfer_rate = transferRate;
+    row->net_core_rmem_max = rmemMax;
+    row->net_core_netdev_budget = budget;
+    row->large_receive_offload = lro;
+}
+
+static int setupRows(void **state __attribute__((unused))) {
+    setRow(&_rows[0], 1000, 1000, 100, 0);
+    setRow(&_rows[1], 2000, 4000, 300, 1);
+    setRow(&_rows[2], 4000, 16000, 700, 1);
+    return 0;
+}
+
+void interpolationBlendsTheBracketingRows() {
+    tuning_params_t settings;
+
+    /* A quarter of the way from the first row to the second */
+    assert_int_equal(0, interpolateSettings(&_values, 1250, 10.0, &settings));
+    assert_int_equal(1250, settings.transfer_rate);
+    /* Sizes grow geometrically: 1000 * 4^0.25 */
+    assert_int_equal(1414, settings.net_core_rmem_max);
+    assert_int_equal(150, settings.net_core_netdev_budget);
+    assert_int_equal(0, settings.large_receive_offload);
+
+    /* Three quarters of the way from the second row to the third */
+    assert_int_equal(2, interpolateSettings(&_values, 3500, 10.0, &settings));
+    assert_int_equal(11314, settings.net_core_rmem_max);
+    assert_int_equal(600, settings.net_core_netdev_budget);
+    assert_int_equal(1, settings.large_receive_offload);
+
+    /* On a row */
+    assert_int_equal(1, interpolateSettings(&_values, 2000, 10.0, &settings));
+    assert_int_equal(0, memcmp(&settings, &_rows[1], sizeof(settings)));
+}
+
+void interpolationExtrapolatesUpToTheLimit() {
+    tuning_params_t settings;
+
+    /* 5% beyond the last row, along the line through the last two */
+    assert_int_equal(2, interpolateSettings(&_values, 4200, 10.0, &settings));
+    assert_int_equal(740, settings.net_core_netdev_budget);
+    assert_true(settings.net_core_rmem_max > 16000);
+    assert_int_equal(-1, interpolateSettings(&_values, 4200, 4.0, &settings));
+
+    /* 20% below the first row; the budget is kept from going negative */
+    assert_int_equal(0, interpolateSettings(&_values, 800, 25.0, &settings));
+    assert_int_equal(60, settings.net_core_netdev_budget);
+    assert_int_equal(-1, interpolateSettings(&_values, 800, 10.0, &settings));
+    assert_int_equal(0, interpolateSettings(&_values, 10, 100.0, &settings));
+    assert_int_equal(0, settings.net_core_netdev_budget);
+}
+
+void interpolationNeedsRows() {
+    all_values_t single = {.parameters = _rows, .validValues = 1};
+    all_values_t empty = {.parameters = _rows, .validValues = 0};
+    tuning_params_t settings;
+
+    assert_int_equal(-1, interpolateSettings(&empty, 1000, 10.0, &settings));
+    assert_int_equal(0, interpolateSettings(&single, 1050, 10.0, &settings));
+    assert_int_equal(1050, settings.transfer_rate);
+    assert_int_equal(1000, settings.net_core_rmem_max);
+    assert_int_equal(-1, interpolateSettings(&single, 2000, 10.0, &settings));
+}
+
+extern int runInterpolationTests() {
+    const struct CMUnitTest interpolationTests[] = {
+        cmocka_unit_test_setup(interpolationBlendsTheBracketingRows,
+                               setupRows),
+        cmocka_unit_test_setup(interpolationExtrapolatesUpToTheLimit,
+                               setupRows),
+        cmocka_unit_test_setup(interpolationNeedsRows, setupRows)};
+
+    return cmocka_run_group_tests_name("interpolation tests",
+                                       interpolationTests, NULL, NULL);
+}
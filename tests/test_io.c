@@ -0,0 +1,163 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "io.h"
+#include "types.h"
+#include "utils.h"
+
+#define BIT(scheduler) (1U << ioSchedulerIndex(scheduler))
+
+void ioSchedulerNamesRoundTrip() {
+    assert_int_equal(1, ioSchedulerIndex("none"));
+    assert_int_equal(4, ioSchedulerIndex("bfq"));
+    assert_int_equal(-1, ioSchedulerIndex("cfq"));
+    assert_string_equal("mq-deadline", ioSchedulerName(2));
+    assert_string_equal("?", ioSchedulerName(0));
+    assert_string_equal("?", ioSchedulerName(5));
+}
+
+void ioDiskstatsAreParsedPerDevice() {
+    disk_stats_t stats[4];
+    FILE *fp = tmpfile();
+
+    assert_non_null(fp);
+    /* The discard and flush counters of newer kernels are ignored */
+    fputs(" 259       0 nvme0n1 1000 5 80000 400 2000 7 160000 900 3 1200 "
+          "1300 0 0 0 0 10 20\n"
+          " 259       1 nvme0n1p1 10 0 80 4 20 0 160 9 0 12 13\n"
+          "   7       0 loop0 0 0\n",
+          fp);
+    rewind(fp);
+
+    assert_int_equal(2, ioParseDiskstats(fp, stats, 4));
+    assert_string_equal("nvme0n1", stats[0].name);
+    assert_int_equal(1000, stats[0].reads);
+    assert_int_equal(80000, stats[0].read_sectors);
+    assert_int_equal(400, stats[0].read_ms);
+    assert_int_equal(2000, stats[0].writes);
+    assert_int_equal(160000, stats[0].write_sectors);
+    assert_int_equal(900, stats[0].write_ms);
+    assert_int_equal(3, stats[0].in_flight);
+    assert_int_equal(1200, stats[0].io_ms);
+    assert_int_equal(1300, stats[0].weighted_io_ms);
+    assert_string_equal("nvme0n1p1", stats[1].name);
+    fclose(fp);
+}
+
+void ioRatesAreComputedOverThePeriod() {
+    disk_stats_t prev = {.reads = 100,
+                         .read_sectors = 800,
+                         .read_ms = 50,
+                         .writes = 100,
+                         .write_sectors = 800,
+                         .write_ms = 50,
+                         .io_ms = 1000,
+                         .weighted_io_ms = 2000};
+    disk_stats_t cur = prev;
+    disk_rates_t rates;
+
+    cur.reads += 300;
+    cur.writes += 100;
+    cur.read_sectors += 2400;
+    cur.write_sectors += 800;
+    cur.read_ms += 600;
+    cur.write_ms += 200;
+    cur.io_ms += 1000;
+    cur.weighted_io_ms += 4000;
+
+    ioRates(&prev, &cur, 2.0, &rates);
+    assert_true(fabs(rates.iops - 200.0) < 1e-9);
+    assert_true(fabs(rates.bytes_rate - 3200.0 * 512 / 2) < 1e-9);
+    assert_true(fabs(rates.queue_depth - 2.0) < 1e-9);
+    assert_true(fabs(rates.latency_ms - 2.0) < 1e-9);
+    assert_true(fabs(rates.utilization - 50.0) < 1e-9);
+
+    /* A wrapped counter counts as nothing done */
+    cur.reads = 10;
+    ioRates(&prev, &cur, 2.0, &rates);
+    assert_true(fabs(rates.iops - 50.0) < 1e-9);
+}
+
+void ioSchedulersAreParsedWithTheActiveOne() {
+    unsigned short active;
+
+    assert_int_equal(BIT("mq-deadline") | BIT("kyber") | BIT("none"),
+                     ioParseSchedulers("[mq-deadline] kyber none\n", &active));
+    assert_int_equal(ioSchedulerIndex("mq-deadline"), active);
+
+    assert_int_equal(BIT("none"), ioParseSchedulers("[none]", &active));
+    assert_int_equal(ioSchedulerIndex("none"), active);
+
+    assert_int_equal(0, ioParseSchedulers("noop [cfq]", &active));
+    assert_int_equal(0, active);
+}
+
+void ioTableIsLoadedSortedByIops() {
+    char path[] = "/tmp/phoebeXXXXXX";
+    int fd = mkstemp(path);
+    io_table_t table;
+    FILE *fp;
+
+    assert_true(fd >= 0);
+    fp = fdopen(fd, "w");
+    assert_non_null(fp);
+    fputs("iops,scheduler,nr_requests,read_ahead_kb,rq_affinity\n"
+          "50000,none,1023,64,2\n"
+          "0,bfq,32,512,1\n"
+          "5000,kyber,256,128,1\n",
+          fp);
+    fclose(fp);
+
+    assert_int_equal(RET_OK, ioLoadTable(path, &table));
+    assert_int_equal(3, table.count);
+    assert_int_equal(0, table.rows[0].iops);
+    assert_int_equal(ioSchedulerIndex("bfq"), table.rows[0].scheduler);
+    assert_int_equal(5000, table.rows[1].iops);
+    assert_int_equal(50000, table.rows[2].iops);
+    assert_int_equal(1023, table.rows[2].nr_requests);
+    assert_int_equal(64, table.rows[2].read_ahead_kb);
+    assert_int_equal(2, table.rows[2].rq_affinity);
+
+    fp = fopen(path, "a");
+    assert_non_null(fp);
+    fputs("9000,cfq,64,128,1\n", fp);
+    fclose(fp);
+    assert_int_equal(RET_FAIL, ioLoadTable(path, &table));
+
+    unlink(path);
+}
+
+void ioNearestRowFollowsTheLoad() {
+    io_table_t table;
+
+    ioDefaultTable(&table);
+    assert_int_equal(4, table.count);
+    assert_int_equal(ioSchedulerIndex("mq-deadline"),
+                     table.rows[0].scheduler);
+    assert_int_equal(ioSchedulerIndex("none"), table.rows[3].scheduler);
+
+    assert_int_equal(0, ioNearestRow(&table, 500));
+    assert_int_equal(1, ioNearestRow(&table, 5000));
+    assert_int_equal(2, ioNearestRow(&table, 30000));
+    assert_int_equal(3, ioNearestRow(&table, 1e7));
+
+    table.count = 0;
+    assert_int_equal(0, ioNearestRow(&table, 500));
+}
+
+extern int runIoTests() {
+    const struct CMUnitTest ioTests[] = {
+        cmocka_unit_test(ioSchedulerNamesRoundTrip),
+        cmocka_unit_test(ioDiskstatsAreParsedPerDevice),
+        cmocka_unit_test(ioRatesAreComputedOverThePeriod),
+        cmocka_unit_test(ioSchedulersAreParsedWithTheActiveOne),
+        cmocka_unit_test(ioTableIsLoadedSortedByIops),
+        cmocka_unit_test(ioNearestRowFollowsTheLoad)};
+
+    return cmocka_run_group_tests_name("io tests", ioTests, NULL, NULL);
+}
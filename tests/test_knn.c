@@ -0,0 +1,135 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knn.h"
+#include "types.h"
+#include "utils.h"
+
+static void setRow(tuning_params_t *row, unsigned long transferRate,
+                   unsigned long dropRate, double cpuUsage) {
+    memset(row, 0, sizeof(tuning_params_t));
+    row->transfer_rate = transferRate;
+    row->drop_rate = dropRate;
+    row->cpu_usage_percentage = cpuUsage;
+}
+
+void knnTellsLoadsApartBeyondTheTransferRate() {
+    tuning_params_t rows[3];
+    double load[KNN_DIMENSIONS] = {0};
+    knn_index_t *index;
+    knn_match_t match;
+
+    setRow(&rows[0], 1000000, 0, 10.0);
+    setRow(&rows[1], 1000000, 5000, 10.0);
+    setRow(&rows[2], 1000000, 0, 90.0);
+    index = knnBuild(rows, 3);
+    assert_non_null(index);
+
+    load[KNN_TRANSFER_RATE] = 1000000;
+    load[KNN_DROP_RATE] = 4000;
+    load[KNN_CPU_USAGE] = 12.0;
+    assert_int_equal(RET_OK, knnQuery(index, load, 1, &match));
+    assert_int_equal(1, match.row);
+    assert_true(match.confidence == 1.0);
+
+    load[KNN_DROP_RATE] = 0;
+    load[KNN_CPU_USAGE] = 80.0;
+    assert_int_equal(RET_OK, knnQuery(index, load, 3, &match));
+    assert_int_equal(2, match.row);
+
+    knnFree(index);
+}
+
+void knnConfidenceReflectsTheNeighbours() {
+    tuning_params_t rows[2];
+    double load[KNN_DIMENSIONS] = {0};
+    knn_index_t *index;
+    knn_match_t match;
+
+    setRow(&rows[0], 100, 0, 20.0);
+    setRow(&rows[1], 100, 0, 40.0);
+    index = knnBuild(rows, 2);
+
+    /* Halfway between two rows */
+    load[KNN_TRANSFER_RATE] = 100;
+    load[KNN_CPU_USAGE] = 30.0;
+    assert_int_equal(RET_OK, knnQuery(index, load, 2, &match));
+    assert_true(fabs(match.confidence - 0.5) < 1e-6);
+
+    /* On top of one of them */
+    load[KNN_CPU_USAGE] = 40.0;
+    assert_int_equal(RET_OK, knnQuery(index, load, 2, &match));
+    assert_int_equal(1, match.row);
+    assert_true(match.distance < 1e-6);
+    assert_true(match.confidence > 0.99);
+
+    knnFree(index);
+    assert_null(knnBuild(rows, 0));
+    assert_int_equal(RET_FAIL, knnQuery(NULL, load, 1, &match));
+}
+
+void knnMatchesAnExhaustiveSearch() {
+    const unsigned int count = 5000;
+    tuning_params_t *rows = calloc(count, sizeof(tuning_params_t));
+    double load[KNN_DIMENSIONS];
+    knn_index_t *index;
+
+    assert_non_null(rows);
+    srand(42);
+    for (unsigned int i = 0; i < count; i++) {
+        rows[i].transfer_rate = rand() % 100000000;
+        rows[i].drop_rate = rand() % 4 == 0 ? rand() % 10000 : 0;
+        rows[i].errors_rate = rand() % 100;
+        rows[i].fifo_errors_rate = 0;
+        rows[i].cpu_usage_percentage = rand() % 10000 / 100.0;
+    }
+    index = knnBuild(rows, count);
+    assert_non_null(index);
+
+    for (unsigned int q = 0; q < 200; q++) {
+        float x[KNN_DIMENSIONS];
+        double best = INFINITY;
+        knn_match_t match;
+
+        load[KNN_TRANSFER_RATE] = rand() % 100000000;
+        load[KNN_DROP_RATE] = rand() % 2 == 0 ? rand() % 10000 : 0;
+        load[KNN_ERRORS_RATE] = rand() % 100;
+        load[KNN_FIFO_ERRORS_RATE] = 0;
+        load[KNN_CPU_USAGE] = rand() % 10000 / 100.0;
+
+        for (unsigned int d = 0; d < KNN_DIMENSIONS; d++)
+            x[d] = ((d == KNN_CPU_USAGE ? load[d] : log1p(load[d])) -
+                    index->min[d]) *
+                   index->scale[d];
+        for (unsigned int i = 0; i < count; i++) {
+            double d2 = 0.0;
+
+            for (unsigned int d = 0; d < KNN_DIMENSIONS; d++) {
+                double diff = x[d] - index->points[i].x[d];
+                d2 += diff * diff;
+            }
+            if (d2 < best)
+                best = d2;
+        }
+
+        assert_int_equal(RET_OK, knnQuery(index, load, 4, &match));
+        assert_true(fabs(match.distance - sqrt(best)) < 1e-9);
+        assert_true(match.row < count);
+    }
+
+    knnFree(index);
+    free(rows);
+}
+
+extern int runKnnTests() {
+    const struct CMUnitTest knnTests[] = {
+        cmocka_unit_test(knnTellsLoadsApartBeyondTheTransferRate),
+        cmocka_unit_test(knnConfidenceReflectsTheNeighbours),
+        cmocka_unit_test(knnMatchesAnExhaustiveSearch)};
+
+    return cmocka_run_group_tests_name("k-nearest neighbours tests", knnTests,
+                                       NULL, NULL);
+}
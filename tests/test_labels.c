@@ -0,0 +1,118 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "filehelper.h"
+#include "labels.h"
+#include "types.h"
+
+#define UNLABELLED                                                             \
+    { .geo = NOT_SET, .business = NOT_SET, .optimize_for = NOT_SET }
+#define OPTIMIZED_FOR(b)                                                       \
+    { .geo = NOT_SET, .business = NOT_SET, .optimize_for = b }
+
+static tuning_params_t _rows[5];
+static label_t _labels[5] = {UNLABELLED, OPTIMIZED_FOR(THROUGHPUT),
+                             OPTIMIZED_FOR(LATENCY), UNLABELLED,
+                             OPTIMIZED_FOR(LATENCY)};
+static all_values_t _values = {
+    .parameters = _rows, .labels = _labels, .totalLength = 5, .validValues = 5};
+
+static int setupRows(void **state __attribute__((unused))) {
+    static const unsigned long rates[5] = {100, 200, 200, 300, 300};
+
+    memset(_rows, 0, sizeof(_rows));
+    for (unsigned int i = 0; i < 5; i++)
+        _rows[i].transfer_rate = rates[i];
+    _rows[2].net_core_busy_poll = 50;
+    _rows[4].net_core_busy_poll = 50;
+    return 0;
+}
+
+void labelsAreLookedUpByExactName() {
+    assert_int_equal(APAC, labelFromName(LABEL_GEOGRAPHY, "APAC"));
+    assert_int_equal(NA, labelFromName(LABEL_GEOGRAPHY, "NA"));
+    assert_int_equal(SERVICE, labelFromName(LABEL_BUSINESS, "SERVICE"));
+    assert_int_equal(LATENCY, labelFromName(LABEL_BEHAVIOR, "LATENCY"));
+
+    assert_int_equal(NOT_SET, labelFromName(LABEL_GEOGRAPHY, "NAM"));
+    assert_int_equal(NOT_SET, labelFromName(LABEL_BEHAVIOR, "RETAIL"));
+    assert_int_equal(NOT_SET, labelFromName(LABEL_BEHAVIOR, "NOT_SET"));
+    assert_int_equal(NOT_SET, labelFromName(LABEL_BEHAVIOR, NULL));
+
+    assert_string_equal("POWER", labelName(LABEL_BEHAVIOR, POWER));
+    assert_string_equal("NOT_SET", labelName(LABEL_BUSINESS, NOT_SET));
+}
+
+void labelsAreLoadedFromTheTrailingColumns() {
+    tuning_params_t parameters[2];
+    label_t labels[2];
+    all_values_t values = {.parameters = parameters, .labels = labels,
+                           .totalLength = 2};
+    char line[1024];
+    size_t length = 0;
+
+    for (unsigned int i = 0; i < NUM_TUNING_PARAMS; i++)
+        length += snprintf(line + length, sizeof(line) - length, "%s%u",
+                           i > 0 ? "," : "", i + 1);
+    loadValues(line, 0, &values);
+    assert_int_equal(NOT_SET, labels[0].geo);
+    assert_int_equal(NOT_SET, labels[0].optimize_for);
+
+    snprintf(line + length, sizeof(line) - length, ",EMEA, NOT_SET,LATENCY\n");
+    loadValues(line, 1, &values);
+    assert_int_equal(2, values.validValues);
+    assert_int_equal(1, parameters[1].transfer_rate);
+    assert_int_equal(NUM_TUNING_PARAMS, parameters[1].irq_affinity);
+    assert_int_equal(EMEA, labels[1].geo);
+    assert_int_equal(NOT_SET, labels[1].business);
+    assert_int_equal(LATENCY, labels[1].optimize_for);
+}
+
+void labelsPartitionKeepsTheRowsOfTheHost() {
+    label_t host = OPTIMIZED_FOR(LATENCY);
+    all_values_t *partition = labelsPartition(&_values, &host);
+
+    assert_true(partition != &_values);
+    assert_int_equal(3, partition->validValues);
+    assert_int_equal(100, partition->parameters[0].transfer_rate);
+    /* The rows labelled LATENCY win over generic ones at the same rate */
+    assert_int_equal(200, partition->parameters[1].transfer_rate);
+    assert_int_equal(50, partition->parameters[1].net_core_busy_poll);
+    assert_int_equal(300, partition->parameters[2].transfer_rate);
+    assert_int_equal(50, partition->parameters[2].net_core_busy_poll);
+    assert_int_equal(LATENCY, partition->labels[2].optimize_for);
+    labelsPartitionFree(partition, &_values);
+
+    host.optimize_for = THROUGHPUT;
+    partition = labelsPartition(&_values, &host);
+    assert_int_equal(3, partition->validValues);
+    assert_int_equal(0, partition->parameters[1].net_core_busy_poll);
+    assert_int_equal(0, partition->parameters[2].net_core_busy_poll);
+    labelsPartitionFree(partition, &_values);
+}
+
+void labelsPartitionIsTheTableWhenEveryRowMatches() {
+    label_t host = UNLABELLED;
+    all_values_t unlabelled = {.parameters = _rows, .validValues = 5};
+
+    assert_true(labelsPartition(&_values, &host) == &_values);
+
+    host.optimize_for = LATENCY;
+    assert_true(labelsPartition(&unlabelled, &host) == &unlabelled);
+    labelsPartitionFree(&unlabelled, &unlabelled);
+}
+
+extern int runLabelsTests() {
+    const struct CMUnitTest labelsTests[] = {
+        cmocka_unit_test(labelsAreLookedUpByExactName),
+        cmocka_unit_test(labelsAreLoadedFromTheTrailingColumns),
+        cmocka_unit_test_setup(labelsPartitionKeepsTheRowsOfTheHost,
+                               setupRows),
+        cmocka_unit_test_setup(labelsPartitionIsTheTableWhenEveryRowMatches,
+                               setupRows)};
+
+    return cmocka_run_group_tests_name("labels tests", labelsTests, NULL,
+                                       NULL);
+}
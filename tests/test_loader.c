@@ -0,0 +1,111 @@
+#include "test.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "loader.h"
+#include "types.h"
+
+struct loader_state {
+    char dir[32];
+    char path[MAX_FILENAME_LENGTH];
+};
+
+/* Installs the plugin built as version as a new file, like install(1) */
+static void installPlugin(struct loader_state *s, unsigned int version) {
+    char variable[16], staged[MAX_FILENAME_LENGTH], cmd[MAX_COMMAND_LENGTH];
+    const char *built;
+
+    snprintf(variable, sizeof(variable), "SWAP_PLUGIN_V%u", version);
+    assert_non_null(built = getenv(variable));
+    snprintf(staged, sizeof(staged), "%s/staged.so", s->dir);
+    snprintf(cmd, sizeof(cmd), "cp %s %s", built, staged);
+    assert_int_equal(0, system(cmd));
+    assert_int_equal(0, rename(staged, s->path));
+}
+
+static int swapVersionOf(const loaded_file_t *file) {
+    int (*swapVersion)();
+
+    *(void **)(&swapVersion) = dlsym(file->handle, "swapVersion");
+    assert_non_null(swapVersion);
+    return swapVersion();
+}
+
+static int setupPluginDir(void **state) {
+    struct loader_state *s = calloc(1, sizeof(struct loader_state));
+
+    if (s == NULL)
+        return -1;
+    snprintf(s->dir, sizeof(s->dir), "/tmp/phoebeXXXXXX");
+    if (mkdtemp(s->dir) == NULL)
+        return -1;
+    snprintf(s->path, sizeof(s->path), "%s/plugin.so", s->dir);
+
+    *state = s;
+    return 0;
+}
+
+static int teardownPluginDir(void **state) {
+    char cmd[MAX_COMMAND_LENGTH];
+    struct loader_state *s = *state;
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", s->dir);
+    free(s);
+    return system(cmd);
+}
+
+void loaderOpensTheFileNowAtThePath(void **state) {
+    struct loader_state *s = *state;
+    loaded_file_t old, next, again;
+
+    installPlugin(s, 1);
+    assert_int_equal(RET_OK, loaderOpen(s->path, &old));
+    assert_int_equal(1, swapVersionOf(&old));
+
+    installPlugin(s, 2);
+    assert_int_equal(RET_OK, loaderOpen(s->path, &next));
+    assert_true(next.handle != old.handle);
+    assert_true(next.inode != old.inode);
+    assert_int_equal(2, swapVersionOf(&next));
+    assert_int_equal(1, swapVersionOf(&old));
+
+    loaderClose(&old);
+    assert_null(old.handle);
+    loaderClose(&old);
+
+    /* Even the path of a loaded file which was not replaced loads anew */
+    assert_int_equal(RET_OK, loaderOpen(s->path, &again));
+    assert_true(again.handle != next.handle);
+    assert_int_equal(2, swapVersionOf(&again));
+    loaderClose(&next);
+    assert_int_equal(2, swapVersionOf(&again));
+    loaderClose(&again);
+}
+
+void loaderRejectsWhatIsNotAnObject(void **state) {
+    struct loader_state *s = *state;
+    loaded_file_t file;
+    FILE *fp = fopen(s->path, "w");
+
+    assert_non_null(fp);
+    fputs("not an ELF file\n", fp);
+    fclose(fp);
+
+    assert_int_equal(RET_FAIL, loaderOpen(s->path, &file));
+    assert_int_equal(RET_FAIL, loaderOpen("/nonexistent/plugin.so", &file));
+}
+
+extern int runLoaderTests() {
+    const struct CMUnitTest loaderTests[] = {
+        cmocka_unit_test_setup_teardown(loaderOpensTheFileNowAtThePath,
+                                        setupPluginDir, teardownPluginDir),
+        cmocka_unit_test_setup_teardown(loaderRejectsWhatIsNotAnObject,
+                                        setupPluginDir, teardownPluginDir)};
+
+    return cmocka_run_group_tests_name("loader tests", loaderTests, NULL,
+                                       NULL);
+}
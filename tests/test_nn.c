@@ -0,0 +1,148 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nn.h"
+#include "types.h"
+#include "utils.h"
+
+#define TEST_LAYERS 3
+
+/* A 5 -> 20 -> 3 -> 1 network: layers narrower than the previous one and
+ * widths that are not a multiple of NN_LANES */
+static const unsigned int WIDTHS[TEST_LAYERS + 1] = {NN_INPUTS, 20, 3, 1};
+static const unsigned int ACTIVATIONS[TEST_LAYERS] = {
+    NN_ACTIVATION_RELU, NN_ACTIVATION_TANH, NN_ACTIVATION_LINEAR};
+
+static float _weights[TEST_LAYERS][20][20];
+static float _bias[TEST_LAYERS][20];
+static float _mean[NN_INPUTS], _scale[NN_INPUTS];
+
+static void writeUint(FILE *fp, uint32_t value) {
+    fwrite(&value, sizeof(value), 1, fp);
+}
+
+/* Writes the network above with layers layers and version, then extra */
+static void writeModel(const char *path, uint32_t version, uint32_t layers,
+                       const char *extra) {
+    FILE *fp = fopen(path, "wb");
+
+    assert_non_null(fp);
+    fwrite(NN_MAGIC, 4, 1, fp);
+    writeUint(fp, version);
+    writeUint(fp, NN_INPUTS);
+    writeUint(fp, layers);
+    fwrite(_mean, sizeof(float), NN_INPUTS, fp);
+    fwrite(_scale, sizeof(float), NN_INPUTS, fp);
+    for (unsigned int l = 0; l < layers; l++) {
+        writeUint(fp, WIDTHS[l + 1]);
+        writeUint(fp, ACTIVATIONS[l]);
+        for (unsigned int o = 0; o < WIDTHS[l + 1]; o++)
+            fwrite(_weights[l][o], sizeof(float), WIDTHS[l], fp);
+        fwrite(_bias[l], sizeof(float), WIDTHS[l + 1], fp);
+    }
+    fputs(extra, fp);
+    fclose(fp);
+}
+
+static int setupModel(void **state __attribute__((unused))) {
+    srand(3);
+    for (unsigned int l = 0; l < TEST_LAYERS; l++)
+        for (unsigned int o = 0; o < 20; o++) {
+            for (unsigned int i = 0; i < 20; i++)
+                _weights[l][o][i] = (rand() % 2000 - 1000) / 1000.0f;
+            _bias[l][o] = (rand() % 200 - 100) / 1000.0f;
+        }
+    for (unsigned int d = 0; d < NN_INPUTS; d++) {
+        _mean[d] = d == NN_CPU_USAGE ? 50.0f : 8.0f;
+        _scale[d] = d == NN_CPU_USAGE ? 0.02f : 0.25f;
+    }
+    return 0;
+}
+
+static double reference(const double load[NN_INPUTS]) {
+    double in[20], out[20];
+
+    for (unsigned int d = 0; d < NN_INPUTS; d++)
+        in[d] = ((d == NN_CPU_USAGE ? load[d] : log1p(load[d])) - _mean[d]) *
+                _scale[d];
+    for (unsigned int l = 0; l < TEST_LAYERS; l++) {
+        for (unsigned int o = 0; o < WIDTHS[l + 1]; o++) {
+            double sum = _bias[l][o];
+
+            for (unsigned int i = 0; i < WIDTHS[l]; i++)
+                sum += _weights[l][o][i] * in[i];
+            out[o] = ACTIVATIONS[l] == NN_ACTIVATION_RELU   ? fmax(sum, 0.0)
+                     : ACTIVATIONS[l] == NN_ACTIVATION_TANH ? tanh(sum)
+                                                            : sum;
+        }
+        memcpy(in, out, sizeof(in));
+    }
+    return in[0];
+}
+
+void nnPredictsLikeAPlainImplementation() {
+    char path[32] = "/tmp/phoebeXXXXXX";
+    nn_model_t *model;
+    int fd;
+
+    assert_true((fd = mkstemp(path)) >= 0);
+    close(fd);
+    writeModel(path, NN_FORMAT_VERSION, TEST_LAYERS, "");
+    model = nnLoad(path);
+    unlink(path);
+    assert_non_null(model);
+    assert_int_equal(TEST_LAYERS, model->layerCount);
+
+    for (unsigned int s = 0; s < 100; s++) {
+        double load[NN_INPUTS] = {rand() % 1000000000, rand() % 10000,
+                                  rand() % 100, 0, rand() % 100};
+        double expected = reference(load);
+        double predicted = nnPredict(model, load);
+
+        if (expected <= 0.0)
+            assert_true(predicted == 0.0);
+        else
+            assert_true(fabs(log1p(predicted) - expected) < 1e-4);
+    }
+
+    nnFree(model);
+}
+
+void nnRefusesBrokenModels() {
+    char path[32] = "/tmp/phoebeXXXXXX";
+    int fd;
+
+    assert_true((fd = mkstemp(path)) >= 0);
+    close(fd);
+
+    writeModel(path, NN_FORMAT_VERSION + 1, TEST_LAYERS, "");
+    assert_null(nnLoad(path));
+    /* The last layer must have a single output */
+    writeModel(path, NN_FORMAT_VERSION, TEST_LAYERS - 1, "");
+    assert_null(nnLoad(path));
+    writeModel(path, NN_FORMAT_VERSION, TEST_LAYERS, "trailing");
+    assert_null(nnLoad(path));
+
+    _bias[TEST_LAYERS - 1][0] = NAN;
+    writeModel(path, NN_FORMAT_VERSION, TEST_LAYERS, "");
+    assert_null(nnLoad(path));
+
+    assert_int_equal(0, truncate(path, 40));
+    assert_null(nnLoad(path));
+    unlink(path);
+    assert_null(nnLoad(path));
+}
+
+extern int runNnTests() {
+    const struct CMUnitTest nnTests[] = {
+        cmocka_unit_test_setup(nnPredictsLikeAPlainImplementation, setupModel),
+        cmocka_unit_test_setup(nnRefusesBrokenModels, setupModel)};
+
+    return cmocka_run_group_tests_name("neural network tests", nnTests, NULL,
+                                       NULL);
+}
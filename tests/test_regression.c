@@ -0,0 +1,121 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "regression.h"
+#include "types.h"
+#include "utils.h"
+
+#define ROWS 200
+
+static tuning_params_t _rows[ROWS];
+static all_values_t _values = {.parameters = _rows, .validValues = ROWS};
+
+static int setupRows(void **state __attribute__((unused))) {
+    memset(_rows, 0, sizeof(_rows));
+    srand(7);
+    for (unsigned int i = 0; i < ROWS; i++) {
+        _rows[i].transfer_rate = 1000000 + 10000 * i;
+        _rows[i].drop_rate = rand() % 1000;
+        _rows[i].errors_rate = _rows[i].transfer_rate / 10000 + rand() % 10;
+        _rows[i].fifo_errors_rate = 0;
+    }
+    return 0;
+}
+
+void regressionMatchesTheTransferRates() {
+    weights_reference_t guessed = {0.8, 0.1, 0.05, 0.05};
+    fit_result_t fit, current = {.weights = guessed, .bias = 10};
+
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.0, &fit));
+    assert_int_equal(ROWS, fit.rows);
+    /* Evenly spaced, the transfer rates are the ranks of the rows */
+    assert_true(fabs(fit.weights.transfer_rate_weight - 1.0) < 1e-6);
+    assert_true(fabs(fit.weights.drop_rate_weight) < 1e-6);
+    assert_true(fabs(fit.weights.errors_rate_weight) < 1e-6);
+    assert_true(fit.weights.fifo_errors_rate_weight == 0.0);
+    assert_true(fit.weights.transfer_rate_weight +
+                    fit.weights.drop_rate_weight +
+                    fit.weights.errors_rate_weight +
+                    fit.weights.fifo_errors_rate_weight <=
+                1.0);
+    assert_true(fabs(fit.bias) < 1.0);
+    assert_true(fit.rmse < 1.0);
+    assert_true(fit.r2 > 0.999999);
+
+    /* Guessed weights are a fifth off */
+    fitError(&_values, &current);
+    assert_true(current.maxError > 0.19 * _rows[ROWS - 1].transfer_rate);
+    assert_true(current.rmse > fit.rmse);
+}
+
+void regressionFitsTheRanksOfTheRows() {
+    fit_result_t fit;
+
+    /* Ever further apart transfer rates, errors rates growing evenly */
+    for (unsigned int i = 0; i < ROWS; i++) {
+        _rows[i].transfer_rate = 1000000 + 100 * i * i;
+        _rows[i].errors_rate = 2 * 19900 * i;
+    }
+
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.0, &fit));
+    /* The ranks go from 1000000 up by 19900 each */
+    assert_true(fabs(fit.weights.errors_rate_weight - 0.5) < 1e-6);
+    assert_true(fabs(fit.weights.transfer_rate_weight) < 1e-6);
+    assert_true(fabs(fit.weights.drop_rate_weight) < 1e-6);
+    assert_true(fabs(fit.bias - 1000000) < 1.0);
+    assert_true(fit.r2 > 0.999999);
+}
+
+void regressionRidgeShrinksTheWeights() {
+    fit_result_t fit, plain;
+
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.0, &plain));
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.5, &fit));
+    assert_true(fit.weights.transfer_rate_weight <
+                plain.weights.transfer_rate_weight);
+    assert_true(fit.weights.transfer_rate_weight > 0.0);
+    /* The bias, which isn't regularized, makes up for it on average */
+    assert_true(fit.bias > plain.bias);
+    assert_true(fit.r2 < plain.r2);
+    assert_true(fit.r2 > 0.5);
+}
+
+void regressionHandlesDegenerateTables() {
+    fit_result_t fit;
+
+    /* The errors rate is a copy of the transfer rate */
+    for (unsigned int i = 0; i < ROWS; i++)
+        _rows[i].errors_rate = _rows[i].transfer_rate;
+    assert_int_equal(RET_FAIL, fitWeights(&_values, 0.0, &fit));
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.01, &fit));
+    assert_true(fabs(fit.weights.transfer_rate_weight -
+                     fit.weights.errors_rate_weight) < 1e-6);
+
+    /* Nothing varies: the bias is all there is */
+    for (unsigned int i = 0; i < ROWS; i++) {
+        _rows[i].transfer_rate = 5000;
+        _rows[i].drop_rate = _rows[i].errors_rate = 0;
+    }
+    assert_int_equal(RET_OK, fitWeights(&_values, 0.0, &fit));
+    assert_true(fit.weights.transfer_rate_weight == 0.0);
+    assert_true(fit.bias == 5000.0);
+    assert_true(fit.rmse == 0.0);
+
+    _values.validValues = 1;
+    assert_int_equal(RET_FAIL, fitWeights(&_values, 0.0, &fit));
+    _values.validValues = ROWS;
+}
+
+extern int runRegressionTests() {
+    const struct CMUnitTest regressionTests[] = {
+        cmocka_unit_test_setup(regressionMatchesTheTransferRates, setupRows),
+        cmocka_unit_test_setup(regressionFitsTheRanksOfTheRows, setupRows),
+        cmocka_unit_test_setup(regressionRidgeShrinksTheWeights, setupRows),
+        cmocka_unit_test_setup(regressionHandlesDegenerateTables, setupRows)};
+
+    return cmocka_run_group_tests_name("regression tests", regressionTests,
+                                       NULL, NULL);
+}
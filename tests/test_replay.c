@@ -0,0 +1,103 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "decision.h"
+#include "replay.h"
+#include "types.h"
+#include "utils.h"
+
+#define ROWS 4
+#define SAMPLES 20
+
+static tuning_params_t _rows[ROWS];
+static all_values_t _values = {.parameters = _rows, .validValues = ROWS};
+static tuning_params_t _recorded[SAMPLES];
+static all_values_t _samples = {.parameters = _recorded,
+                                .validValues = SAMPLES};
+static weights_reference_t _weights = {1.0, 0.0, 0.0, 0.0};
+static app_settings_t _settings;
+static decision_context_t _context = {.values = &_values,
+                                      .weights = &_weights,
+                                      .settings = &_settings};
+
+static int setupReplay(void **state __attribute__((unused))) {
+    memset(_rows, 0, sizeof(_rows));
+    for (unsigned int i = 0; i < ROWS; i++)
+        _rows[i].transfer_rate = 1000000 * (i + 1);
+
+    memset(&_settings, 0, sizeof(_settings));
+    _settings.accuracy = 1.5;
+    _settings.stats_collection_period = 1;
+    _settings.inference_loop_period = 1;
+    return 0;
+}
+
+/* The first half of the samples at rate, the second half at then */
+static void record(unsigned long rate, unsigned long then) {
+    memset(_recorded, 0, sizeof(_recorded));
+    for (unsigned int i = 0; i < SAMPLES; i++)
+        _recorded[i].transfer_rate = i < SAMPLES / 2 ? rate : then;
+}
+
+void replayMatchesOnceForASteadyLoad() {
+    replay_report_t report;
+
+    record(2000000, 2000000);
+    assert_int_equal(RET_OK, replay(&_context, &_samples, &report));
+
+    assert_int_equal(SAMPLES, report.samples);
+    assert_int_equal(SAMPLES, report.ticks);
+    assert_int_equal(1, report.outcomes[DECISION_MATCHED]);
+    assert_int_equal(SAMPLES - 1, report.outcomes[DECISION_SMALL_DELTA]);
+    assert_int_equal(1, report.reconfigurations);
+    assert_int_equal(1, report.timeline[0].row);
+    assert_int_equal(USEC_IN_SEC, report.timeline[0].time);
+}
+
+void replayHoldsOffAFallingLoadForTheGracePeriod() {
+    replay_report_t report;
+
+    record(4000000, 1000000);
+    assert_int_equal(RET_OK, replay(&_context, &_samples, &report));
+    assert_int_equal(2, report.reconfigurations);
+    assert_int_equal(0, report.timeline[1].row);
+    assert_int_equal(11 * USEC_IN_SEC, report.timeline[1].time);
+
+    /* Ten virtual seconds are well within a minute */
+    _settings.grace_period = 1;
+    assert_int_equal(RET_OK, replay(&_context, &_samples, &report));
+    assert_int_equal(1, report.reconfigurations);
+    assert_int_equal(SAMPLES / 2,
+                     report.outcomes[DECISION_GRACE_PERIOD]);
+}
+
+void replayMissesAndInterpolates() {
+    replay_report_t report;
+
+    /* Halfway between two rows, beyond the tolerance of either */
+    record(2500000, 2500000);
+    assert_int_equal(RET_OK, replay(&_context, &_samples, &report));
+    assert_int_equal(SAMPLES, report.outcomes[DECISION_MISSED]);
+    assert_int_equal(0, report.reconfigurations);
+
+    _settings.interpolate = true;
+    _settings.max_extrapolation = 10.0;
+    assert_int_equal(RET_OK, replay(&_context, &_samples, &report));
+    assert_int_equal(1, report.outcomes[DECISION_INTERPOLATED]);
+    assert_int_equal(DECISION_INTERPOLATED, report.timeline[0].outcome);
+
+    _settings.inference_loop_period = 0;
+    assert_int_equal(RET_FAIL, replay(&_context, &_samples, &report));
+}
+
+extern int runReplayTests() {
+    const struct CMUnitTest replayTests[] = {
+        cmocka_unit_test_setup(replayMatchesOnceForASteadyLoad, setupReplay),
+        cmocka_unit_test_setup(replayHoldsOffAFallingLoadForTheGracePeriod,
+                               setupReplay),
+        cmocka_unit_test_setup(replayMissesAndInterpolates, setupReplay)};
+
+    return cmocka_run_group_tests_name("replay tests", replayTests, NULL,
+                                       NULL);
+}
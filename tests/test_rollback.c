@@ -0,0 +1,95 @@
+#include "test.h"
+
+#include <string.h>
+
+#include "rollback.h"
+#include "types.h"
+
+static void recordTicks(rate_history_t *history, uint64_t transferRate,
+                        uint64_t dropRate, unsigned int ticks) {
+    if_rates_t rates;
+
+    memset(&rates, 0, sizeof(rates));
+    rates.transfer_rate = transferRate;
+    rates.drop_rate = dropRate;
+    for (unsigned int i = 0; i < ticks; i++)
+        rateHistoryRecord(history, &rates);
+}
+
+static rate_totals_t totalsOf(uint64_t transferRate, uint64_t dropRate,
+                              uint64_t errorsRate, unsigned int ticks) {
+    rate_totals_t totals = {.ticks = ticks,
+                            .transfer_rate = transferRate * ticks,
+                            .drop_rate = dropRate * ticks,
+                            .errors_rate = errorsRate * ticks};
+
+    return totals;
+}
+
+void rateHistorySumsTheLastTicks() {
+    rate_history_t history;
+    rate_totals_t totals;
+
+    memset(&history, 0, sizeof(history));
+    assert_int_equal(0, rateHistoryTotals(&history, 5, &totals));
+    assert_int_equal(0, totals.transfer_rate);
+
+    /* Settings applied long before the last ticks do not count */
+    recordTicks(&history, 1000, 7, 10);
+    recordTicks(&history, 100, 0, 3);
+    assert_int_equal(3, rateHistoryTotals(&history, 3, &totals));
+    assert_int_equal(300, totals.transfer_rate);
+    assert_int_equal(0, totals.drop_rate);
+
+    assert_int_equal(5, rateHistoryTotals(&history, 5, &totals));
+    assert_int_equal(2300, totals.transfer_rate);
+    assert_int_equal(14, totals.drop_rate);
+
+    /* Only RATE_HISTORY_TICKS are kept */
+    recordTicks(&history, 10, 0, RATE_HISTORY_TICKS + 1);
+    assert_int_equal(RATE_HISTORY_TICKS,
+                     rateHistoryTotals(&history, 1000, &totals));
+    assert_int_equal(10 * RATE_HISTORY_TICKS, totals.transfer_rate);
+}
+
+void rateWorseAllowsTheThreshold() {
+    /* 10% of 1000 either way */
+    assert_false(rateWorse(1000.0, 901.0, 10.0, true));
+    assert_true(rateWorse(1000.0, 899.0, 10.0, true));
+    assert_false(rateWorse(1000.0, 5000.0, 10.0, true));
+    assert_false(rateWorse(1000.0, 1099.0, 10.0, false));
+    assert_true(rateWorse(1000.0, 1101.0, 10.0, false));
+    assert_false(rateWorse(1000.0, 0.0, 10.0, false));
+
+    /* Near 0, 10% of 1 */
+    assert_false(rateWorse(0.0, 0.1, 10.0, false));
+    assert_true(rateWorse(0.0, 0.2, 10.0, false));
+}
+
+void rollbackNeededComparesTheMeans() {
+    rate_totals_t baseline = totalsOf(1000, 0, 0, 5);
+    rate_totals_t kept = totalsOf(950, 0, 0, 5);
+    rate_totals_t slower = totalsOf(800, 0, 0, 5);
+    rate_totals_t dropping = totalsOf(1200, 3, 0, 5);
+    rate_totals_t failing = totalsOf(1000, 0, 2, 5);
+
+    assert_false(rollbackNeeded(&baseline, &kept, 10.0));
+    assert_true(rollbackNeeded(&baseline, &slower, 10.0));
+    assert_true(rollbackNeeded(&baseline, &dropping, 10.0));
+    assert_true(rollbackNeeded(&baseline, &failing, 10.0));
+    assert_false(rollbackNeeded(&baseline, &slower, 25.0));
+
+    /* Means are compared, not sums over a different number of ticks */
+    kept = totalsOf(1000, 0, 0, 3);
+    assert_false(rollbackNeeded(&baseline, &kept, 0.0));
+}
+
+extern int runRollbackTests() {
+    const struct CMUnitTest rollbackTests[] = {
+        cmocka_unit_test(rateHistorySumsTheLastTicks),
+        cmocka_unit_test(rateWorseAllowsTheThreshold),
+        cmocka_unit_test(rollbackNeededComparesTheMeans)};
+
+    return cmocka_run_group_tests_name("rollback tests", rollbackTests, NULL,
+                                       NULL);
+}
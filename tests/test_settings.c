@@ -0,0 +1,119 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "settings.h"
+#include "types.h"
+
+static char _fileName[MAX_FILENAME_LENGTH];
+
+/* As settingsLoad() returns it: the caller holds the only reference */
+static settings_snapshot_t *snapshotOf(double bias) {
+    settings_snapshot_t *snapshot = calloc(1, sizeof(settings_snapshot_t));
+
+    snapshot->references = 1;
+    snapshot->bias = bias;
+    return snapshot;
+}
+
+static void writeSettings(const char *json) {
+    FILE *fp = fopen(_fileName, "w");
+
+    assert_non_null(fp);
+    fprintf(fp, "%s", json);
+    fclose(fp);
+}
+
+static int setupFile(void **state __attribute__((unused))) {
+    int fd;
+
+    snprintf(_fileName, MAX_FILENAME_LENGTH, "/tmp/phoebeXXXXXX");
+    if ((fd = mkstemp(_fileName)) == -1)
+        return -1;
+    close(fd);
+    return 0;
+}
+
+static int teardownFile(void **state __attribute__((unused))) {
+    return unlink(_fileName);
+}
+
+void settingsLoadReadsTheFile() {
+    settings_snapshot_t *snapshot = NULL;
+
+    writeSettings("{\"app_settings\": {\"plugins_path\": \"/tmp\", "
+                  "\"inference_loop_period\": 2}, \"bias\": 0.5}");
+    assert_int_equal(RET_OK, settingsLoad(_fileName, &snapshot));
+    assert_non_null(snapshot);
+    assert_int_equal(1, snapshot->references);
+    assert_string_equal("/tmp", snapshot->app.plugins_path);
+    assert_true(snapshot->app.inference_loop_period == 2.0);
+    assert_true(snapshot->bias == 0.5);
+    settingsRelease(snapshot);
+
+    /* The settings in use stay when the file is half written */
+    snapshot = NULL;
+    writeSettings("{\"app_settings\": {\"plugins_path\":");
+    assert_int_equal(RET_FAIL, settingsLoad(_fileName, &snapshot));
+    assert_null(snapshot);
+    assert_int_equal(RET_FAIL, settingsLoad("/nonexistent/settings.json",
+                                            &snapshot));
+    assert_null(snapshot);
+}
+
+void settingsFollowMovesToThePublishedSnapshot() {
+    settings_store_t store;
+    settings_snapshot_t *first = snapshotOf(1.0), *second = snapshotOf(2.0);
+    settings_snapshot_t *held = NULL;
+
+    settingsStoreInit(&store, first);
+    assert_true(settingsFollow(&store, &held));
+    assert_true(held == first);
+    assert_int_equal(1, held->generation);
+    assert_int_equal(2, first->references);
+
+    /* Nothing was published since */
+    assert_false(settingsFollow(&store, &held));
+    assert_int_equal(2, first->references);
+
+    settingsPublish(&store, second);
+    assert_int_equal(2, second->generation);
+    assert_int_equal(1, first->references);
+
+    assert_true(settingsFollow(&store, &held));
+    assert_true(held == second);
+    assert_true(held->bias == 2.0);
+    assert_int_equal(2, second->references);
+
+    settingsRelease(held);
+    settingsStoreDestroy(&store);
+}
+
+void settingsHoldersOutliveTheStore() {
+    settings_store_t store;
+    settings_snapshot_t *held;
+
+    settingsStoreInit(&store, snapshotOf(1.0));
+    held = settingsAcquire(&store);
+    settingsPublish(&store, snapshotOf(2.0));
+    settingsStoreDestroy(&store);
+
+    /* The reference of the holder is the last one left */
+    assert_int_equal(1, held->references);
+    assert_true(held->bias == 1.0);
+    settingsRelease(held);
+    settingsRelease(NULL);
+}
+
+extern int runSettingsTests() {
+    const struct CMUnitTest settingsTests[] = {
+        cmocka_unit_test_setup_teardown(settingsLoadReadsTheFile, setupFile,
+                                        teardownFile),
+        cmocka_unit_test(settingsFollowMovesToThePublishedSnapshot),
+        cmocka_unit_test(settingsHoldersOutliveTheStore)};
+
+    return cmocka_run_group_tests_name("settings tests", settingsTests, NULL,
+                                       NULL);
+}
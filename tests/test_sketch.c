@@ -0,0 +1,96 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "sketch.h"
+
+void sketchQuantileOfEmptySketchIsZero() {
+    quantile_sketch_t sketch;
+
+    sketchReset(&sketch);
+    assert_int_equal(0, sketchQuantile(&sketch, 0.95));
+}
+
+void sketchCountsSmallValuesExactly() {
+    quantile_sketch_t sketch;
+
+    sketchReset(&sketch);
+    for (uint64_t v = 0; v < SKETCH_SUB_BUCKETS; v++)
+        sketchRecord(&sketch, v);
+
+    assert_int_equal(0, sketchQuantile(&sketch, 0.0));
+    assert_int_equal(SKETCH_SUB_BUCKETS - 1, sketchQuantile(&sketch, 1.0));
+}
+
+void sketchQuantilesAreWithinRelativeError() {
+    static const double QUANTILES[] = {0.5, 0.9, 0.95, 0.99};
+    quantile_sketch_t sketch;
+
+    sketchReset(&sketch);
+    for (uint64_t v = 1; v <= 100000; v++)
+        sketchRecord(&sketch, v * 1000);
+
+    for (unsigned int i = 0; i < sizeof(QUANTILES) / sizeof(double); i++) {
+        double expected = QUANTILES[i] * 100000 * 1000;
+        double actual = sketchQuantile(&sketch, QUANTILES[i]);
+
+        assert_true(fabs(actual - expected) <=
+                    expected / SKETCH_SUB_BUCKETS + 1000);
+    }
+}
+
+void sketchHandlesLargestValue() {
+    quantile_sketch_t sketch;
+
+    sketchReset(&sketch);
+    sketchRecord(&sketch, UINT64_MAX);
+
+    assert_true(sketchQuantile(&sketch, 1.0) >= UINT64_MAX / 16 * 15);
+}
+
+void windowedSketchExpiresOldSlots() {
+    windowed_sketch_t *sketch = malloc(sizeof(windowed_sketch_t));
+    assert_non_null(sketch);
+
+    windowedSketchInit(sketch);
+    for (uint64_t now = 1000; now < 1060; now++)
+        windowedSketchRecord(sketch, 10, now);
+    for (uint64_t now = 1060; now < 1120; now++)
+        windowedSketchRecord(sketch, 1000, now);
+
+    /* the 1m window only sees the second minute, the 5m one both */
+    assert_in_range(
+        windowedSketchQuantile(sketch, SKETCH_WINDOW_1M, 0.05, 1119),
+        1000 - 1000 / SKETCH_SUB_BUCKETS, 1000 + 1000 / SKETCH_SUB_BUCKETS);
+    assert_int_equal(10, windowedSketchQuantile(sketch, SKETCH_WINDOW_5M,
+                                                0.05, 1119));
+    assert_int_equal(120, windowedSketchCount(sketch, SKETCH_WINDOW_5M, 1119));
+
+    /* after an hour without samples every window is empty */
+    assert_int_equal(0, windowedSketchCount(sketch, SKETCH_WINDOW_1H, 5000));
+    assert_int_equal(
+        0, windowedSketchQuantile(sketch, SKETCH_WINDOW_1H, 0.95, 5000));
+
+    free(sketch);
+}
+
+void sketchWindowNamesRoundTrip() {
+    for (unsigned int w = 0; w < SKETCH_WINDOWS; w++)
+        assert_int_equal(w, sketchWindowFromString(sketchWindowName(w)));
+    assert_int_equal(-1, sketchWindowFromString("2d"));
+}
+
+extern int runSketchTests() {
+    const struct CMUnitTest sketchTests[] = {
+        cmocka_unit_test(sketchQuantileOfEmptySketchIsZero),
+        cmocka_unit_test(sketchCountsSmallValuesExactly),
+        cmocka_unit_test(sketchQuantilesAreWithinRelativeError),
+        cmocka_unit_test(sketchHandlesLargestValue),
+        cmocka_unit_test(windowedSketchExpiresOldSlots),
+        cmocka_unit_test(sketchWindowNamesRoundTrip)};
+
+    return cmocka_run_group_tests_name("quantile sketch tests", sketchTests,
+                                       NULL, NULL);
+}
@@ -0,0 +1,85 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "types.h"
+
+void pressureLinesAreParsed() {
+    psi_stats_t stats;
+
+    assert_int_equal(
+        RET_OK,
+        parsePressure("some avg10=1.50 avg60=0.75 avg300=0.25 total=123456\n"
+                      "full avg10=0.50 avg60=0.10 avg300=0.00 total=789\n",
+                      &stats));
+    assert_true(stats.some.avg10 == 1.5);
+    assert_true(stats.some.avg60 == 0.75);
+    assert_true(stats.some.avg300 == 0.25);
+    assert_int_equal(123456, stats.some.total);
+    assert_true(stats.full.avg10 == 0.5);
+    assert_int_equal(789, stats.full.total);
+}
+
+void pressureWithoutFullLineIsParsed() {
+    psi_stats_t stats;
+
+    /* The cpu file has no full line before kernel 5.13 */
+    assert_int_equal(
+        RET_OK,
+        parsePressure("some avg10=2.00 avg60=1.00 avg300=0.50 total=42",
+                      &stats));
+    assert_true(stats.some.avg10 == 2.0);
+    assert_int_equal(42, stats.some.total);
+    assert_true(stats.full.avg10 == 0.0);
+    assert_int_equal(0, stats.full.total);
+}
+
+void malformedPressureIsRejected() {
+    psi_stats_t stats;
+
+    assert_int_equal(RET_FAIL, parsePressure("", &stats));
+    assert_int_equal(RET_FAIL, parsePressure(NULL, &stats));
+    assert_int_equal(RET_FAIL,
+                     parsePressure("some avg10=1.00 avg60=oops\n", &stats));
+    assert_int_equal(
+        RET_FAIL,
+        parsePressure("most avg10=1.00 avg60=1.00 avg300=1.00 total=1\n",
+                      &stats));
+
+    /* A malformed line is skipped, the others are kept */
+    assert_int_equal(
+        RET_OK,
+        parsePressure("some avg10=\n"
+                      "full avg10=3.00 avg60=2.00 avg300=1.00 total=7\n",
+                      &stats));
+    assert_true(stats.some.avg10 == 0.0);
+    assert_true(stats.full.avg10 == 3.0);
+}
+
+void pressureIsReadFromTheStart() {
+    psi_stats_t stats;
+    FILE *fp = tmpfile();
+
+    assert_non_null(fp);
+    fputs("some avg10=4.00 avg60=3.00 avg300=2.00 total=1000\n", fp);
+    fflush(fp);
+
+    /* The same fd is read again on every tick */
+    assert_int_equal(RET_OK, readPressure(fileno(fp), &stats));
+    assert_int_equal(RET_OK, readPressure(fileno(fp), &stats));
+    assert_true(stats.some.avg10 == 4.0);
+    assert_int_equal(1000, stats.some.total);
+    fclose(fp);
+}
+
+extern int runStatsTests() {
+    const struct CMUnitTest statsTests[] = {
+        cmocka_unit_test(pressureLinesAreParsed),
+        cmocka_unit_test(pressureWithoutFullLineIsParsed),
+        cmocka_unit_test(malformedPressureIsRejected),
+        cmocka_unit_test(pressureIsReadFromTheStart)};
+
+    return cmocka_run_group_tests_name("stats tests", statsTests, NULL, NULL);
+}
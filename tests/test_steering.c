@@ -0,0 +1,188 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "backend.h"
+#include "steering.h"
+#include "types.h"
+#include "utils.h"
+
+#define INTERRUPTS                                                             \
+    "           CPU0       CPU1       \n"                                     \
+    "  0:         31          0   IO-APIC    2-edge      timer\n"             \
+    " 24:          0          0   PCI-MSI 49152-edge      virtio1-config\n"   \
+    " 25:        100       4000   PCI-MSI 49153-edge      virtio1-input.0\n"  \
+    " 26:         12          0   PCI-MSI 49154-edge      virtio1-output.0\n" \
+    " 27:         10         20   PCI-MSI 49155-edge      virtio1-input.1\n"  \
+    " 30:          5          0   PCI-MSI 524288-edge      eth10\n"           \
+    "NMI:          0          0   Non-maskable interrupts\n"
+
+static int setupFakeSteering(void **state) {
+    char script[32] = "/tmp/phoebeXXXXXX";
+    FILE *fp;
+    int fd, rc;
+
+    (void)state;
+
+    if ((fd = mkstemp(script)) < 0 || (fp = fdopen(fd, "w")) == NULL)
+        return -1;
+    fputs("queues 2 3 virtio1\n", fp);
+    fclose(fp);
+
+    fakeBackendReset();
+    rc = fakeBackendLoadScript(script);
+    unlink(script);
+    if (rc != RET_OK ||
+        fakeBackendSetValue("/proc/interrupts", INTERRUPTS) != RET_OK)
+        return -1;
+    setSystemBackend(fakeBackend());
+    return 0;
+}
+
+static int teardownFakeSteering(void **state) {
+    (void)state;
+
+    setSystemBackend(hostBackend());
+    fakeBackendReset();
+    return 0;
+}
+
+void cpuMasksRoundTrip() {
+    char buffer[MAX_CPU_MASK_LENGTH];
+    unsigned long mask;
+
+    assert_int_equal(RET_OK, formatCpuMask(0xf, buffer, sizeof(buffer)));
+    assert_string_equal("f", buffer);
+    assert_int_equal(RET_OK, formatCpuMask(1UL << 32, buffer, sizeof(buffer)));
+    assert_string_equal("1,00000000", buffer);
+    assert_int_equal(RET_OK, parseCpuMask(buffer, &mask));
+    assert_true(mask == 1UL << 32);
+
+    /* Only the lowest 64 CPUs of larger masks are kept */
+    assert_int_equal(RET_OK,
+                     parseCpuMask("00000001,00000000,0000000F\n", &mask));
+    assert_true(mask == 0xf);
+    assert_int_equal(RET_FAIL, parseCpuMask("", &mask));
+    assert_int_equal(RET_FAIL, parseCpuMask("0x3", &mask));
+    assert_int_equal(RET_FAIL, formatCpuMask(1UL << 32, buffer, 4));
+}
+
+void interruptsAreMatchedByInterfaceOrDevice() {
+    irq_queue_t queues[4];
+    FILE *fp = fmemopen(INTERRUPTS, strlen(INTERRUPTS), "r");
+
+    assert_non_null(fp);
+    assert_int_equal(3, parseInterrupts(fp, "eth1", "virtio1", queues, 4));
+    fclose(fp);
+
+    /* The config interrupt is not a queue */
+    assert_int_equal(25, queues[0].irq);
+    assert_true(queues[0].count == 4100);
+    assert_true(queues[0].cpus == 3);
+    assert_int_equal(26, queues[1].irq);
+    assert_true(queues[1].cpus == 1);
+    assert_int_equal(27, queues[2].irq);
+
+    /* eth10 is not eth1 */
+    fp = fmemopen(INTERRUPTS, strlen(INTERRUPTS), "r");
+    assert_int_equal(0, parseInterrupts(fp, "eth1", "", queues, 4));
+    fclose(fp);
+    fp = fmemopen(INTERRUPTS, strlen(INTERRUPTS), "r");
+    assert_int_equal(1, parseInterrupts(fp, "eth10", "", queues, 4));
+    fclose(fp);
+}
+
+static void assertApplied(unsigned int index, const char *name,
+                          const char *value) {
+    fake_applied_t entry;
+
+    assert_int_equal(RET_OK, fakeBackendApplied(index, &entry));
+    assert_string_equal(name, entry.name);
+    assert_string_equal(value, entry.value);
+}
+
+void steeringIsSpreadOverTheQueues() {
+    steering_t target = {.rps_cpus = 0x6,
+                         .xps_cpus = 0x3,
+                         .rps_flow_cnt = 2048,
+                         .irq_affinity = 0x5};
+    steering_t applied = target;
+    const system_backend_t *backend = systemBackend();
+    void *iface = backend->openInterface("eth1");
+
+    assert_int_equal(0, applySteering(iface, "eth1", &target, NULL));
+    assertApplied(0, "/sys/class/net/eth1/queues/rx-0/rps_cpus", "6");
+    assertApplied(1, "/sys/class/net/eth1/queues/rx-1/rps_cpus", "6");
+    assertApplied(2, "/sys/class/net/eth1/queues/rx-0/rps_flow_cnt", "2048");
+    assertApplied(3, "/sys/class/net/eth1/queues/rx-1/rps_flow_cnt", "2048");
+    assertApplied(4, "net.core.rps_sock_flow_entries", "4096");
+    /* One CPU per transmit queue, in turn */
+    assertApplied(5, "/sys/class/net/eth1/queues/tx-0/xps_cpus", "1");
+    assertApplied(6, "/sys/class/net/eth1/queues/tx-1/xps_cpus", "2");
+    assertApplied(7, "/sys/class/net/eth1/queues/tx-2/xps_cpus", "1");
+    /* The busiest queues get their own CPU */
+    assertApplied(8, "/proc/irq/25/smp_affinity", "1");
+    assertApplied(9, "/proc/irq/27/smp_affinity", "4");
+    assertApplied(10, "/proc/irq/26/smp_affinity", "1");
+    assert_int_equal(11, fakeBackendAppliedCount());
+
+    /* Only what changed is written again */
+    target.rps_flow_cnt = 0;
+    target.xps_cpus = 0xc;
+    assert_int_equal(0, applySteering(iface, "eth1", &target, &applied));
+    assert_int_equal(14, fakeBackendAppliedCount());
+    assertApplied(11, "/sys/class/net/eth1/queues/tx-0/xps_cpus", "4");
+
+    backend->closeInterface(iface);
+}
+
+void steeringIsReadBack() {
+    const system_backend_t *backend = systemBackend();
+    tuning_params_t settings;
+    void *iface;
+
+    fakeBackendSetValue("/sys/class/net/eth1/queues/rx-0/rps_cpus",
+                        "00000000,00000006");
+    fakeBackendSetValue("/sys/class/net/eth1/queues/rx-0/rps_flow_cnt", "512");
+    fakeBackendSetValue("/sys/class/net/eth1/queues/tx-0/xps_cpus", "1");
+    fakeBackendSetValue("/sys/class/net/eth1/queues/tx-1/xps_cpus", "2");
+    fakeBackendSetValue("/sys/class/net/eth1/queues/tx-2/xps_cpus", "8");
+    fakeBackendSetValue("/proc/irq/25/smp_affinity", "1");
+    fakeBackendSetValue("/proc/irq/26/smp_affinity", "1");
+    fakeBackendSetValue("/proc/irq/27/smp_affinity", "4");
+    memset(&settings, 0, sizeof(settings));
+    iface = backend->openInterface("eth1");
+
+    assert_int_equal(0, readSteeringSettings(iface, "eth1", &settings));
+    assert_true(settings.rps_cpus == 6);
+    assert_int_equal(512, settings.rps_flow_cnt);
+    assert_true(settings.xps_cpus == 0xb);
+    /* As set, even if both CPUs serviced the queues of virtio1 so far */
+    assert_true(settings.irq_affinity == 5);
+
+    /* An interrupt whose affinity can't be read leaves it as it is */
+    fakeBackendSetValue("/proc/irq/26/smp_affinity", "none");
+    assert_int_equal(1, readSteeringSettings(iface, "eth1", &settings));
+    assert_true(settings.irq_affinity == 5);
+
+    /* Neither the queue files of eth10 nor its affinity are in the backend */
+    assert_int_equal(4, readSteeringSettings(iface, "eth10", &settings));
+    backend->closeInterface(iface);
+}
+
+extern int runSteeringTests() {
+    const struct CMUnitTest steeringTests[] = {
+        cmocka_unit_test(cpuMasksRoundTrip),
+        cmocka_unit_test(interruptsAreMatchedByInterfaceOrDevice),
+        cmocka_unit_test_setup_teardown(steeringIsSpreadOverTheQueues,
+                                        setupFakeSteering,
+                                        teardownFakeSteering),
+        cmocka_unit_test_setup_teardown(steeringIsReadBack, setupFakeSteering,
+                                        teardownFakeSteering)};
+
+    return cmocka_run_group_tests_name("steering tests", steeringTests, NULL,
+                                       NULL);
+}
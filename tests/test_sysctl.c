@@ -0,0 +1,159 @@
+#include "test.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sysctl.h"
+#include "types.h"
+#include "utils.h"
+
+struct sysctl_state {
+    char root[32];
+};
+
+static void writeFile(const char *root, const char *rel, const char *value) {
+    char path[MAX_FILENAME_LENGTH];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s%s", root, rel);
+    fp = fopen(path, "w");
+    assert_non_null(fp);
+    fputs(value, fp);
+    fclose(fp);
+}
+
+static int setupSysctlTree(void **state) {
+    char path[MAX_FILENAME_LENGTH];
+    struct sysctl_state *s = calloc(1, sizeof(struct sysctl_state));
+    if (s == NULL)
+        return -1;
+
+    snprintf(s->root, sizeof(s->root), "/tmp/phoebeXXXXXX");
+    if (mkdtemp(s->root) == NULL)
+        return -1;
+    strcat(s->root, "/");
+
+    snprintf(path, sizeof(path), "%snet", s->root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%snet/core", s->root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%snet/ipv4", s->root);
+    mkdir(path, 0700);
+
+    writeFile(s->root, "net/core/rmem_max", "212992\n");
+    writeFile(s->root, "net/core/somaxconn", "4096\n");
+    writeFile(s->root, "net/ipv4/tcp_rmem", "4096\t131072\t6291456\n");
+    sysctlSetRoot(s->root);
+
+    *state = s;
+    return 0;
+}
+
+static int teardownSysctlTree(void **state) {
+    char cmd[MAX_COMMAND_LENGTH];
+    struct sysctl_state *s = *state;
+
+    sysctlSetRoot(SYSCTL_PROC_PATH);
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", s->root);
+    free(s);
+    return system(cmd);
+}
+
+void sysctlPathReplacesDots() {
+    char path[MAX_FILENAME_LENGTH];
+
+    assert_int_equal(RET_OK, sysctlPath("net.ipv4.tcp_rmem", path,
+                                        sizeof(path)));
+    assert_string_equal(SYSCTL_PROC_PATH "net/ipv4/tcp_rmem", path);
+    assert_int_equal(RET_FAIL, sysctlPath("net.ipv4.tcp_rmem", path, 8));
+}
+
+void sysctlReadStripsNewline() {
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+
+    assert_int_equal(RET_OK,
+                     sysctlRead("net.core.rmem_max", value, sizeof(value)));
+    assert_string_equal("212992", value);
+}
+
+void sysctlWriteReplacesValue() {
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+
+    assert_int_equal(RET_OK, sysctlWrite("net.core.rmem_max", "4096"));
+    assert_int_equal(RET_OK,
+                     sysctlRead("net.core.rmem_max", value, sizeof(value)));
+    assert_string_equal("4096", value);
+}
+
+void sysctlBatchReportsEachFailure() {
+    sysctl_write_t batch[3];
+
+    sysctlSet(&batch[0], "net.core.rmem_max", "%lu", 8388608UL);
+    sysctlSet(&batch[1], "net.core.busy_poll", "%d", 50);
+    sysctlSet(&batch[2], "net.core.somaxconn", "%u", 1024U);
+
+    assert_int_equal(1, sysctlWriteBatch(batch, 3));
+    assert_int_equal(0, batch[0].error);
+    assert_int_equal(ENOENT, batch[1].error);
+    assert_int_equal(0, batch[2].error);
+}
+
+void sysctlShowingUpLaterIsWritten(void **state) {
+    struct sysctl_state *s = *state;
+    char value[MAX_SYSCTL_VALUE_LENGTH];
+
+    assert_int_equal(RET_FAIL, sysctlWrite("net.core.busy_poll", "50"));
+    assert_int_equal(ENOENT, errno);
+
+    /* An empty plain file still has its old value cut off */
+    writeFile(s->root, "net/core/busy_poll", "");
+    assert_int_equal(RET_OK, sysctlWrite("net.core.busy_poll", "50"));
+    assert_int_equal(RET_OK, sysctlWrite("net.core.busy_poll", "0"));
+    assert_int_equal(RET_OK,
+                     sysctlRead("net.core.busy_poll", value, sizeof(value)));
+    assert_string_equal("0", value);
+}
+
+void readSystemSettingsParsesSysctls(void **state) {
+    struct sysctl_state *s = *state;
+    tuning_params_t settings;
+
+    memset(&settings, 0, sizeof(settings));
+    settings.net_core_wmem_max = 42;
+
+    /* Most sysctls are missing from the test tree, which is no failure */
+    assert_int_equal(RET_OK, readSystemSettings(NULL, &settings));
+    assert_int_equal(212992, settings.net_core_rmem_max);
+    assert_int_equal(4096, settings.net_core_somaxconn);
+    assert_int_equal(4096, settings.tcp_rmem0);
+    assert_int_equal(131072, settings.tcp_rmem1);
+    assert_int_equal(6291456, settings.tcp_rmem2);
+    assert_int_equal(42, settings.net_core_wmem_max);
+
+    /* A sysctl there but unreadable is one */
+    writeFile(s->root, "net/core/somaxconn", "many\n");
+    assert_int_equal(RET_FAIL, readSystemSettings(NULL, &settings));
+    assert_int_equal(4096, settings.net_core_somaxconn);
+}
+
+extern int runSysctlTests() {
+    const struct CMUnitTest sysctlTests[] = {
+        cmocka_unit_test(sysctlPathReplacesDots),
+        cmocka_unit_test_setup_teardown(sysctlReadStripsNewline,
+                                        setupSysctlTree, teardownSysctlTree),
+        cmocka_unit_test_setup_teardown(sysctlWriteReplacesValue,
+                                        setupSysctlTree, teardownSysctlTree),
+        cmocka_unit_test_setup_teardown(sysctlBatchReportsEachFailure,
+                                        setupSysctlTree, teardownSysctlTree),
+        cmocka_unit_test_setup_teardown(sysctlShowingUpLaterIsWritten,
+                                        setupSysctlTree, teardownSysctlTree),
+        cmocka_unit_test_setup_teardown(readSystemSettingsParsesSysctls,
+                                        setupSysctlTree, teardownSysctlTree)};
+
+    return cmocka_run_group_tests_name("sysctl tests", sysctlTests, NULL,
+                                       NULL);
+}
@@ -0,0 +1,185 @@
+#include "test.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "table.h"
+#include "types.h"
+
+static app_settings_t _settings;
+static label_t _host = {
+    .geo = NOT_SET, .business = NOT_SET, .optimize_for = NOT_SET};
+
+static void writeRow(FILE *fp, unsigned long transferRate) {
+    fprintf(fp, "%lu", transferRate);
+    for (unsigned int i = 1; i < NUM_TUNING_PARAMS; i++)
+        fprintf(fp, ",%u", i + 1);
+    fprintf(fp, "\n");
+}
+
+static void writeTable(const unsigned long *rates, unsigned int count) {
+    FILE *fp = fopen(_settings.rates_filename, "w");
+
+    assert_non_null(fp);
+    fprintf(fp, "transfer_rate,...\n");
+    for (unsigned int i = 0; i < count; i++)
+        writeRow(fp, rates[i]);
+    fclose(fp);
+}
+
+static table_snapshot_t *snapshotOf(unsigned long transferRate) {
+    all_values_t values = {.totalLength = 1, .validValues = 1};
+
+    values.parameters = calloc(1, sizeof(tuning_params_t));
+    values.labels = calloc(1, sizeof(label_t));
+    values.parameters[0].transfer_rate = transferRate;
+    values.labels[0] = _host;
+
+    return tableCreate(&values, &_host, &_settings);
+}
+
+static int setupSettings(void **state __attribute__((unused))) {
+    memset(&_settings, 0, sizeof(app_settings_t));
+    return 0;
+}
+
+static int setupTable(void **state) {
+    int fd;
+
+    setupSettings(state);
+    snprintf(_settings.rates_filename, MAX_FILENAME_LENGTH,
+             "/tmp/phoebeXXXXXX");
+    if ((fd = mkstemp(_settings.rates_filename)) == -1)
+        return -1;
+    close(fd);
+    return 0;
+}
+
+static int teardownTable(void **state __attribute__((unused))) {
+    return unlink(_settings.rates_filename);
+}
+
+void tableRowsMustBeSortedByTransferRate() {
+    tuning_params_t rows[3] = {{.transfer_rate = 100},
+                               {.transfer_rate = 100},
+                               {.transfer_rate = 300}};
+    all_values_t values = {
+        .parameters = rows, .totalLength = 3, .validValues = 3};
+
+    assert_int_equal(RET_OK, tableValidate(&values));
+
+    rows[2].transfer_rate = 50;
+    assert_int_equal(RET_FAIL, tableValidate(&values));
+
+    values.validValues = 0;
+    assert_int_equal(RET_FAIL, tableValidate(&values));
+}
+
+void tableCreateTakesTheValuesOver() {
+    table_snapshot_t *snapshot = snapshotOf(1000);
+
+    assert_int_equal(1, snapshot->values.validValues);
+    assert_true(snapshot->partition == &snapshot->values);
+    assert_null(snapshot->knnIndex);
+    assert_null(snapshot->model);
+    tableFree(snapshot);
+}
+
+void tableLoadChecksTheTable() {
+    static const unsigned long sorted[] = {100, 200, 300};
+    static const unsigned long unsorted[] = {100, 300, 200};
+    table_snapshot_t *snapshot = NULL;
+    FILE *fp;
+
+    writeTable(sorted, 3);
+    assert_int_equal(RET_OK, tableLoad(&_settings, &_host, &snapshot));
+    assert_non_null(snapshot);
+    assert_int_equal(3, snapshot->partition->validValues);
+    assert_int_equal(300, snapshot->partition->parameters[2].transfer_rate);
+    tableFree(snapshot);
+
+    writeTable(unsorted, 3);
+    assert_int_equal(RET_FAIL, tableLoad(&_settings, &_host, &snapshot));
+
+    /* A malformed row fails the reload rather than exiting */
+    writeTable(sorted, 1);
+    fp = fopen(_settings.rates_filename, "a");
+    assert_non_null(fp);
+    fprintf(fp, "200,1,2\n");
+    fclose(fp);
+    assert_int_equal(RET_FAIL, tableLoad(&_settings, &_host, &snapshot));
+
+    writeTable(sorted, 0);
+    assert_int_equal(RET_FAIL, tableLoad(&_settings, &_host, &snapshot));
+
+    /* The model asked for must load too */
+    writeTable(sorted, 3);
+    snprintf(_settings.model_filename, MAX_FILENAME_LENGTH,
+             "/nonexistent/model.json");
+    assert_int_equal(RET_FAIL, tableLoad(&_settings, &_host, &snapshot));
+}
+
+static void *publish(void *store) {
+    tablePublish(store, snapshotOf(2000));
+    return NULL;
+}
+
+void tablePublishWaitsForTheReaders() {
+    table_store_t store;
+    pthread_t publisher;
+    table_snapshot_t *read;
+    int reader, idle;
+
+    tableStoreInit(&store, snapshotOf(1000));
+    reader = tableReaderRegister(&store);
+    idle = tableReaderRegister(&store);
+    assert_true(reader >= 0 && idle >= 0 && reader != idle);
+    /* A reader which left holds nothing */
+    tableReaderUnregister(&store, idle);
+
+    read = tableRead(&store, reader);
+    assert_int_equal(1, read->generation);
+    assert_int_equal(1000, read->partition->parameters[0].transfer_rate);
+
+    assert_int_equal(0, pthread_create(&publisher, NULL, publish, &store));
+    do {
+        read = tableRead(&store, reader);
+        usleep(TABLE_GRACE_POLL_USEC);
+    } while (read->generation == 1);
+    assert_int_equal(0, pthread_join(publisher, NULL));
+
+    assert_int_equal(2, read->generation);
+    assert_int_equal(2000, read->partition->parameters[0].transfer_rate);
+    assert_true(read == tableRead(&store, reader));
+
+    tableReaderUnregister(&store, reader);
+    tableStoreDestroy(&store);
+}
+
+void tableReadersAreBounded() {
+    table_store_t store;
+
+    tableStoreInit(&store, snapshotOf(1000));
+    for (unsigned int i = 0; i < MAX_TABLE_READERS; i++)
+        assert_int_equal(i, tableReaderRegister(&store));
+    assert_int_equal(-1, tableReaderRegister(&store));
+
+    tableReaderUnregister(&store, 3);
+    assert_int_equal(3, tableReaderRegister(&store));
+    tableStoreDestroy(&store);
+}
+
+extern int runTableTests() {
+    const struct CMUnitTest tableTests[] = {
+        cmocka_unit_test(tableRowsMustBeSortedByTransferRate),
+        cmocka_unit_test_setup(tableCreateTakesTheValuesOver, setupSettings),
+        cmocka_unit_test_setup_teardown(tableLoadChecksTheTable, setupTable,
+                                        teardownTable),
+        cmocka_unit_test_setup(tablePublishWaitsForTheReaders, setupSettings),
+        cmocka_unit_test_setup(tableReadersAreBounded, setupSettings)};
+
+    return cmocka_run_group_tests_name("table tests", tableTests, NULL, NULL);
+}
@@ -0,0 +1,225 @@
+#include "test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "utils.h"
+#include "vm.h"
+
+#define BIT(mode) (1U << vmThpDefragIndex(mode))
+
+static vm_profile_t _baseline = {.dirty_ratio = 20,
+                                 .dirty_background_ratio = 10,
+                                 .swappiness = 60,
+                                 .min_free_kbytes = 65536};
+static unsigned int _thpModes;
+static vm_rates_t _rates = {.mem_total_kb = 16000000,
+                            .mem_available_kb = 8000000,
+                            .tcp_kb = 1000000,
+                            .page_kb = 4};
+
+static int setupThp(void **state __attribute__((unused))) {
+    _thpModes = BIT("always") | BIT("defer") | BIT("defer+madvise") |
+                BIT("madvise") | BIT("never");
+    _baseline.thp_defrag = vmThpDefragIndex("madvise");
+    return 0;
+}
+
+void vmCountersAreParsed() {
+    vm_stats_t stats;
+    FILE *fp = tmpfile();
+
+    assert_non_null(fp);
+    memset(&stats, 0, sizeof(vm_stats_t));
+    fputs("nr_free_pages 1000\npgfault 123456\npgmajfault 78\n"
+          "pgscan_kswapd 900\npgscan_direct 12\nthp_fault_fallback 3\n",
+          fp);
+    rewind(fp);
+    assert_int_equal(5, vmParseVmstat(fp, &stats));
+    assert_int_equal(123456, stats.pgfault);
+    assert_int_equal(78, stats.pgmajfault);
+    assert_int_equal(900, stats.pgscan_kswapd);
+    assert_int_equal(12, stats.pgscan_direct);
+    assert_int_equal(3, stats.thp_fault_fallback);
+    fclose(fp);
+
+    fp = tmpfile();
+    assert_non_null(fp);
+    fputs("MemTotal:       16000000 kB\nMemFree:          100000 kB\n"
+          "MemAvailable:    3200000 kB\nDirty:              5000 kB\n"
+          "Writeback:            8 kB\n",
+          fp);
+    rewind(fp);
+    assert_int_equal(4, vmParseMeminfo(fp, &stats));
+    assert_int_equal(16000000, stats.mem_total_kb);
+    assert_int_equal(3200000, stats.mem_available_kb);
+    assert_int_equal(5000, stats.dirty_kb);
+    assert_int_equal(8, stats.writeback_kb);
+    fclose(fp);
+
+    fp = tmpfile();
+    assert_non_null(fp);
+    fputs("sockets: used 100\nTCP: inuse 5 orphan 0 tw 0 alloc 7 mem 42\n"
+          "UDP: inuse 1 mem 3\n",
+          fp);
+    rewind(fp);
+    assert_int_equal(42, vmParseSockstat(fp));
+    fclose(fp);
+}
+
+void vmRatesAreComputedOverThePeriod() {
+    vm_stats_t prev = {.pgfault = 1000, .pgscan_kswapd = 100};
+    vm_stats_t cur = {.pgfault = 3000,
+                      .pgscan_kswapd = 50,
+                      .pgscan_direct = 40,
+                      .mem_total_kb = 1000,
+                      .tcp_pages = 10};
+    vm_rates_t rates;
+
+    vmRates(&prev, &cur, 2.0, 4, &rates);
+    assert_true(fabs(rates.fault_rate - 1000.0) < 1e-9);
+    /* A counter which went back counts as nothing done */
+    assert_true(fabs(rates.kswapd_scan_rate) < 1e-9);
+    assert_true(fabs(rates.direct_scan_rate - 20.0) < 1e-9);
+    assert_int_equal(1000, rates.mem_total_kb);
+    assert_int_equal(40, rates.tcp_kb);
+}
+
+void vmTunerRisesAtOnceAndCalmsDownSlowly() {
+    vm_tuner_t tuner;
+    vm_rates_t rates = _rates;
+
+    vmTunerInit(&tuner, 10.0, 25.0);
+    assert_int_equal(VM_LEVEL_RELAXED, vmTunerUpdate(&tuner, &rates));
+
+    /* kswapd topping the free pages up is no shortage */
+    rates.kswapd_scan_rate = 100;
+    rates.steal_rate = 90;
+    assert_int_equal(VM_LEVEL_RELAXED, vmTunerUpdate(&tuner, &rates));
+
+    /* Scanning 1% of the memory per second is */
+    rates.kswapd_scan_rate = 40000;
+    rates.steal_rate = 40000;
+    assert_int_equal(VM_LEVEL_TIGHT, vmTunerUpdate(&tuner, &rates));
+    rates.mem_available_kb = 1000000;
+    assert_int_equal(VM_LEVEL_RECLAIMING, vmTunerUpdate(&tuner, &rates));
+
+    rates = _rates;
+    for (unsigned int i = 1; i < VM_CALM_SAMPLES; i++)
+        assert_int_equal(VM_LEVEL_RECLAIMING, vmTunerUpdate(&tuner, &rates));
+    assert_int_equal(VM_LEVEL_TIGHT, vmTunerUpdate(&tuner, &rates));
+
+    /* THP allocations failing are a sign of fragmented memory */
+    rates.thp_failure_rate = 1;
+    assert_int_equal(VM_LEVEL_TIGHT, vmTunerUpdate(&tuner, &rates));
+    assert_int_equal(0, tuner.calm);
+}
+
+void vmTunerWatchesTheReclaimEfficiency() {
+    vm_tuner_t tuner;
+    vm_rates_t rates = _rates;
+
+    vmTunerInit(&tuner, 10.0, 25.0);
+
+    /* 0.2% of the memory scanned per second */
+    rates.kswapd_scan_rate = 8000;
+    rates.steal_rate = 6000;
+    assert_int_equal(VM_LEVEL_RELAXED, vmTunerUpdate(&tuner, &rates));
+    rates.steal_rate = 2000;
+    assert_int_equal(VM_LEVEL_TIGHT, vmTunerUpdate(&tuner, &rates));
+}
+
+void vmRelaxedProfileIsTheHostOne() {
+    vm_profile_t profile;
+
+    vmProfileFor(VM_LEVEL_RELAXED, &_baseline, _thpModes, &_rates, NULL,
+                 &profile);
+    assert_int_equal(20, profile.dirty_ratio);
+    assert_int_equal(10, profile.dirty_background_ratio);
+    assert_int_equal(0, profile.dirty_background_bytes);
+    assert_int_equal(60, profile.swappiness);
+    assert_int_equal(65536, profile.min_free_kbytes);
+    assert_int_equal(vmThpDefragIndex("madvise"), profile.thp_defrag);
+}
+
+void vmShortMemoryLowersTheLimits() {
+    vm_profile_t profile;
+
+    vmProfileFor(VM_LEVEL_TIGHT, &_baseline, _thpModes, &_rates, NULL,
+                 &profile);
+    assert_int_equal(VM_TIGHT_DIRTY_RATIO, profile.dirty_ratio);
+    assert_int_equal(0, profile.dirty_background_ratio);
+    assert_true(profile.dirty_background_bytes ==
+                VM_TIGHT_DIRTY_BACKGROUND_BYTES);
+    assert_int_equal(VM_SHORT_SWAPPINESS, profile.swappiness);
+    /* A quarter of the TCP buffers, in whole steps */
+    assert_int_equal(16 * VM_MIN_FREE_STEP_KB, profile.min_free_kbytes);
+    assert_int_equal(vmThpDefragIndex("defer+madvise"), profile.thp_defrag);
+
+    vmProfileFor(VM_LEVEL_RECLAIMING, &_baseline, _thpModes, &_rates,
+                 NULL, &profile);
+    assert_int_equal(VM_RECLAIMING_DIRTY_RATIO, profile.dirty_ratio);
+    assert_int_equal(31 * VM_MIN_FREE_STEP_KB, profile.min_free_kbytes);
+    assert_int_equal(vmThpDefragIndex("defer"), profile.thp_defrag);
+}
+
+void vmProfileNeverLoosensTheHostSettings() {
+    vm_profile_t baseline = _baseline, profile;
+    vm_rates_t rates = _rates;
+
+    baseline.dirty_ratio = 5;
+    baseline.swappiness = 0;
+    baseline.min_free_kbytes = 900000;
+    baseline.thp_defrag = vmThpDefragIndex("never");
+    rates.tcp_kb = 100000000;
+
+    vmProfileFor(VM_LEVEL_RECLAIMING, &baseline, _thpModes, &rates, NULL,
+                 &profile);
+    assert_int_equal(5, profile.dirty_ratio);
+    assert_int_equal(0, profile.swappiness);
+    assert_int_equal(900000, profile.min_free_kbytes);
+    assert_int_equal(vmThpDefragIndex("never"), profile.thp_defrag);
+
+    /* Capped at 5% of the memory */
+    baseline.min_free_kbytes = 0;
+    vmProfileFor(VM_LEVEL_RECLAIMING, &baseline, _thpModes, &rates, NULL,
+                 &profile);
+    assert_int_equal(800000, profile.min_free_kbytes);
+}
+
+void vmMinFreeMovesByMoreThanAStep() {
+    vm_profile_t applied, profile;
+    vm_rates_t rates = _rates;
+
+    vmProfileFor(VM_LEVEL_TIGHT, &_baseline, _thpModes, &rates, NULL,
+                 &applied);
+    assert_int_equal(16 * VM_MIN_FREE_STEP_KB, applied.min_free_kbytes);
+
+    /* One step up is kept as it is */
+    rates.tcp_kb = 1050000;
+    vmProfileFor(VM_LEVEL_TIGHT, &_baseline, _thpModes, &rates, &applied,
+                 &profile);
+    assert_true(memcmp(&applied, &profile, sizeof(vm_profile_t)) == 0);
+
+    rates.tcp_kb = 1200000;
+    vmProfileFor(VM_LEVEL_TIGHT, &_baseline, _thpModes, &rates, &applied,
+                 &profile);
+    assert_int_equal(19 * VM_MIN_FREE_STEP_KB, profile.min_free_kbytes);
+}
+
+extern int runVmTests() {
+    const struct CMUnitTest vmTests[] = {
+        cmocka_unit_test(vmCountersAreParsed),
+        cmocka_unit_test(vmRatesAreComputedOverThePeriod),
+        cmocka_unit_test(vmTunerRisesAtOnceAndCalmsDownSlowly),
+        cmocka_unit_test(vmTunerWatchesTheReclaimEfficiency),
+        cmocka_unit_test_setup(vmRelaxedProfileIsTheHostOne, setupThp),
+        cmocka_unit_test_setup(vmShortMemoryLowersTheLimits, setupThp),
+        cmocka_unit_test_setup(vmProfileNeverLoosensTheHostSettings,
+                               setupThp),
+        cmocka_unit_test_setup(vmMinFreeMovesByMoreThanAStep, setupThp)};
+
+    return cmocka_run_group_tests_name("vm tests", vmTests, NULL, NULL);
+}
@@ -1,5 +1,35 @@
 #include "test.h"
 
+extern int runBackendTests();
+extern int runBanditTests();
+extern int runBatchTests();
+extern int runBusTests();
+extern int runCpuTests();
 extern int runFileHelperTests();
+extern int runInterpolationTests();
+extern int runIoTests();
+extern int runKnnTests();
+extern int runLabelsTests();
+extern int runLoaderTests();
+extern int runNnTests();
+extern int runRegressionTests();
+extern int runReplayTests();
+extern int runRollbackTests();
+extern int runSettingsTests();
+extern int runSketchTests();
+extern int runStatsTests();
+extern int runSteeringTests();
+extern int runSysctlTests();
+extern int runTableTests();
+extern int runVmTests();
 
-int main(void) { return runFileHelperTests(); }
+int main(void) {
+    return runBackendTests() | runBanditTests() | runBatchTests() |
+           runBusTests() | runCpuTests() | runFileHelperTests() |
+           runInterpolationTests() | runIoTests() | runKnnTests() |
+           runLabelsTests() | runLoaderTests() | runNnTests() |
+           runRegressionTests() | runReplayTests() | runRollbackTests() |
+           runSettingsTests() | runSketchTests() | runStatsTests() |
+           runSteeringTests() | runSysctlTests() | runTableTests() |
+           runVmTests();
+}